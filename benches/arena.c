@@ -0,0 +1,95 @@
+#include "internal/bench.h"
+#include "cstl/arena.h"
+#include "cstl/map.h"
+#include "cstl/vector.h"
+#include "cstl/string.h"
+#include <stdlib.h>
+
+static int cmp_key(const void * const a, const void * const b, void * const p)
+{
+    (void)p;
+    return (uintptr_t)a - (uintptr_t)b;
+}
+
+/*
+ * simulate the handling of a single request: build a few maps,
+ * vectors, and strings and then throw all of them away. when an
+ * arena is supplied, the containers allocate from it and are
+ * discarded by resetting the arena rather than being cleared
+ * one at a time.
+ */
+static void bench_request(struct cstl_arena * const arena)
+{
+    const cstl_allocator_t * const a =
+        arena != NULL ? cstl_arena_allocator(arena) : NULL;
+
+    cstl_map_t map[4];
+    cstl_vector_t vec[4];
+    cstl_string_t str[16];
+    unsigned int i, j;
+
+    for (i = 0; i < 4; i++) {
+        cstl_map_init(&map[i], cmp_key, NULL);
+        cstl_map_set_allocator(&map[i], a);
+        for (j = 0; j < 128; j++) {
+            cstl_map_insert(&map[i], (void *)(uintptr_t)rand(), NULL, NULL);
+        }
+
+        cstl_vector_init(&vec[i], sizeof(int));
+        cstl_vector_set_allocator(&vec[i], a);
+        for (j = 0; j < 256; j++) {
+            if (j == cstl_vector_capacity(&vec[i])) {
+                cstl_vector_reserve(&vec[i], 2 * j + 1);
+            }
+            cstl_vector_resize(&vec[i], j + 1);
+            *(int *)cstl_vector_at(&vec[i], j) = j;
+        }
+    }
+
+    for (i = 0; i < 16; i++) {
+        cstl_string_init(&str[i]);
+        cstl_string_set_allocator(&str[i], a);
+        for (j = 0; j < 8; j++) {
+            cstl_string_append_str(&str[i], "header: value; ");
+        }
+    }
+
+    if (arena != NULL) {
+        cstl_arena_reset(arena);
+    } else {
+        for (i = 0; i < 4; i++) {
+            cstl_map_clear(&map[i], NULL, NULL);
+            cstl_vector_clear(&vec[i]);
+        }
+        for (i = 0; i < 16; i++) {
+            cstl_string_clear(&str[i]);
+        }
+    }
+}
+
+void bench_request_malloc(struct bench_context * const ctx,
+                          const unsigned long count)
+{
+    unsigned long i;
+
+    for (i = 0; i < count; i++) {
+        bench_request(NULL);
+    }
+
+    (void)ctx;
+}
+
+void bench_request_arena(struct bench_context * const ctx,
+                         const unsigned long count)
+{
+    DECLARE_CSTL_ARENA(arena, 0);
+    unsigned long i;
+
+    for (i = 0; i < count; i++) {
+        bench_request(&arena);
+    }
+
+    bench_stop_timer(ctx);
+    cstl_arena_clear(&arena);
+    bench_start_timer(ctx);
+}
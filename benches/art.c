@@ -0,0 +1,191 @@
+#include "internal/bench.h"
+#include "cstl/art.h"
+#include "cstl/map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * the radix tree and the map, both keyed by strings that look like
+ * paths. neighboring keys share long prefixes, which the map compares
+ * again at every level of its tree
+ */
+
+static int cmp_string(const void * const a, const void * const b,
+                      void * const p)
+{
+    (void)p;
+    return cstl_string_compare(a, b);
+}
+
+static cstl_string_t * bench_art_paths(const unsigned int n)
+{
+    cstl_string_t * const s = malloc(n * sizeof(*s));
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        char buf[64];
+
+        sprintf(buf, "/srv/projects/%04u/src/module%02u/file%04u.c",
+                rand() % 64, rand() % 32, rand() % 10000);
+
+        cstl_string_init(&s[i]);
+        cstl_string_set_str(&s[i], buf);
+    }
+
+    return s;
+}
+
+static void bench_art_paths_free(cstl_string_t * const s, const unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        cstl_string_clear(&s[i]);
+    }
+    free(s);
+}
+
+static void bench_art_string(struct bench_context * const ctx,
+                             const unsigned long count,
+                             const bool art, const bool find)
+{
+    const unsigned int n = 1 << 16;
+    cstl_string_t * keys;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    keys = bench_art_paths(n);
+
+    for (i = 0; i < count; i++) {
+        cstl_art_t t;
+        cstl_map_t m;
+        unsigned int j;
+
+        cstl_art_init(&t);
+        cstl_map_init(&m, cmp_string, NULL);
+
+        if (!find) {
+            bench_start_timer(ctx);
+        }
+        for (j = 0; j < n; j++) {
+            if (art) {
+                cstl_art_insert_string(&t, &keys[j], NULL);
+            } else {
+                cstl_map_insert(&m, &keys[j], NULL, NULL);
+            }
+        }
+        if (find) {
+            bench_start_timer(ctx);
+            for (j = 0; j < n; j++) {
+                const cstl_string_t * const k = &keys[rand() % n];
+
+                if (art) {
+                    (void)cstl_art_find_string(&t, k);
+                } else {
+                    cstl_map_iterator_t it;
+                    cstl_map_find(&m, k, &it);
+                }
+            }
+        }
+        bench_stop_timer(ctx);
+
+        cstl_art_clear(&t, NULL, NULL);
+        cstl_map_clear(&m, NULL, NULL);
+    }
+
+    bench_art_paths_free(keys, n);
+    bench_start_timer(ctx);
+}
+
+void bench_art_string_insert(struct bench_context * const ctx,
+                             const unsigned long count)
+{
+    bench_art_string(ctx, count, true, false);
+}
+
+void bench_art_map_string_insert(struct bench_context * const ctx,
+                                 const unsigned long count)
+{
+    bench_art_string(ctx, count, false, false);
+}
+
+void bench_art_string_find(struct bench_context * const ctx,
+                           const unsigned long count)
+{
+    bench_art_string(ctx, count, true, true);
+}
+
+void bench_art_map_string_find(struct bench_context * const ctx,
+                               const unsigned long count)
+{
+    bench_art_string(ctx, count, false, true);
+}
+
+/*
+ * fixed-length, 16-byte binary identifiers. the map stores
+ * copies of the keys in its nodes and compares them by memcmp()
+ */
+static void bench_art_id_find(struct bench_context * const ctx,
+                              const unsigned long count,
+                              const bool art)
+{
+    const unsigned int n = 1 << 17;
+    unsigned char (* const keys)[16] = malloc(n * sizeof(*keys));
+    cstl_art_t t;
+    cstl_map_t m;
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+
+    cstl_art_init(&t);
+    cstl_map_init(&m, NULL, NULL);
+    cstl_map_set_inline_keys(&m, sizeof(*keys), CSTL_MAP_KEY_MEMCMP);
+    for (j = 0; j < n; j++) {
+        unsigned int b;
+
+        for (b = 0; b < sizeof(*keys); b++) {
+            keys[j][b] = rand();
+        }
+
+        if (art) {
+            cstl_art_insert(&t, keys[j], sizeof(*keys), NULL);
+        } else {
+            cstl_map_insert(&m, keys[j], NULL, NULL);
+        }
+    }
+
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < n; j++) {
+            const unsigned char * const k = keys[rand() % n];
+
+            if (art) {
+                (void)cstl_art_find(&t, k, sizeof(*keys));
+            } else {
+                cstl_map_iterator_t it;
+                cstl_map_find(&m, k, &it);
+            }
+        }
+    }
+
+    bench_stop_timer(ctx);
+    cstl_art_clear(&t, NULL, NULL);
+    cstl_map_clear(&m, NULL, NULL);
+    free(keys);
+    bench_start_timer(ctx);
+}
+
+void bench_art_id_find_art(struct bench_context * const ctx,
+                           const unsigned long count)
+{
+    bench_art_id_find(ctx, count, true);
+}
+
+void bench_art_id_find_map(struct bench_context * const ctx,
+                           const unsigned long count)
+{
+    bench_art_id_find(ctx, count, false);
+}
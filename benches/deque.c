@@ -0,0 +1,113 @@
+#include "internal/bench.h"
+#include "cstl/deque.h"
+#include "cstl/dlist.h"
+#include <stdlib.h>
+
+/*
+ * a fifo of small records, e.g. packets waiting to be sent, kept at
+ * a steady depth while a stream of records passes through it. the
+ * deque holds the records themselves; the list holds records that
+ * are allocated one at a time and linked through a node within each.
+ * each iteration also walks the queue from front to back once
+ */
+#define BENCH_DEQUE_DEPTH       (1 << 12)
+#define BENCH_DEQUE_RECORDS     (1 << 20)
+
+struct bench_record
+{
+    unsigned long seq;
+    unsigned int len, flags;
+};
+
+struct bench_record_node
+{
+    struct bench_record r;
+    struct cstl_dlist_node ln;
+};
+
+static int bench_record_sum(void * const e, void * const p)
+{
+    *(unsigned long *)p += ((struct bench_record_node *)e)->r.len;
+    return 0;
+}
+
+static void bench_record_free(void * const e, void * const p)
+{
+    (void)p;
+    cstl_allocator_free(NULL, e, sizeof(struct bench_record_node));
+}
+
+void bench_deque_fifo(struct bench_context * const ctx,
+                      const unsigned long count)
+{
+    DECLARE_CSTL_DEQUE(d, struct bench_record);
+    volatile unsigned long res;
+    unsigned long i, sum = 0;
+
+    (void)ctx;
+
+    for (i = 0; i < count; i++) {
+        unsigned long j;
+
+        for (j = 0; j < BENCH_DEQUE_RECORDS; j++) {
+            struct bench_record * const r = cstl_deque_push_back(&d);
+
+            r->seq = j;
+            r->len = j % 1500;
+            r->flags = 0;
+
+            if (cstl_deque_size(&d) > BENCH_DEQUE_DEPTH) {
+                sum += ((struct bench_record *)cstl_deque_front(&d))->len;
+                cstl_deque_pop_front(&d);
+            }
+        }
+
+        for (j = 0; j < cstl_deque_size(&d); j++) {
+            sum += ((struct bench_record *)cstl_deque_at(&d, j))->len;
+        }
+    }
+
+    cstl_deque_clear(&d);
+    res = sum;
+    (void)res;
+}
+
+void bench_deque_fifo_dlist(struct bench_context * const ctx,
+                            const unsigned long count)
+{
+    struct cstl_dlist l;
+    volatile unsigned long res;
+    unsigned long i, sum = 0;
+
+    (void)ctx;
+
+    cstl_dlist_init(&l, offsetof(struct bench_record_node, ln));
+
+    for (i = 0; i < count; i++) {
+        unsigned long j;
+
+        for (j = 0; j < BENCH_DEQUE_RECORDS; j++) {
+            struct bench_record_node * const n =
+                cstl_allocator_alloc(NULL, sizeof(*n));
+
+            n->r.seq = j;
+            n->r.len = j % 1500;
+            n->r.flags = 0;
+            cstl_dlist_push_back(&l, n);
+
+            if (cstl_dlist_size(&l) > BENCH_DEQUE_DEPTH) {
+                struct bench_record_node * const f = cstl_dlist_pop_front(&l);
+
+                sum += f->r.len;
+                bench_record_free(f, NULL);
+            }
+        }
+
+        cstl_dlist_foreach(&l, bench_record_sum, &sum,
+                           CSTL_DLIST_FOREACH_DIR_FWD);
+    }
+
+    cstl_dlist_clear(&l, bench_record_free);
+    res = sum;
+    (void)res;
+}
@@ -0,0 +1,429 @@
+#include "internal/bench.h"
+#include "cstl/heap.h"
+#include "cstl/dheap.h"
+#include "cstl/pheap.h"
+#include "cstl/rheap.h"
+#include <stdlib.h>
+
+/*
+ * compare the pointer-linked binary heap with array heaps of various
+ * degrees. the objects look like the entries of a scheduler's queue:
+ * a deadline and a pointer to the thing to be run, 16 bytes in all,
+ * so four of them fill a cache line
+ */
+
+struct bench_heap_entry
+{
+    uint64_t deadline;
+    void * task;
+};
+
+struct bench_heap_node
+{
+    struct bench_heap_entry e;
+    struct cstl_heap_node hn;
+    struct cstl_pheap_node pn;
+    struct cstl_rheap_node rn;
+};
+
+static int bench_heap_cmp(const void * const _a, const void * const _b,
+                          void * const p)
+{
+    const struct bench_heap_entry * const a = _a;
+    const struct bench_heap_entry * const b = _b;
+
+    (void)p;
+
+    /* the earliest deadline is at the top */
+    return (a->deadline < b->deadline) - (a->deadline > b->deadline);
+}
+
+/*
+ * push n random deadlines and then pop them all
+ */
+static void bench_heap_fill(struct bench_context * const ctx,
+                            const unsigned long count,
+                            const unsigned int d)
+{
+    const unsigned int n = 1 << 16;
+    struct bench_heap_node * const nodes = malloc(n * sizeof(*nodes));
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        struct cstl_heap h;
+        cstl_dheap_t dh;
+        unsigned int j;
+
+        for (j = 0; j < n; j++) {
+            nodes[j].e.deadline = rand();
+            nodes[j].e.task = &nodes[j];
+        }
+
+        cstl_heap_init(&h, bench_heap_cmp, NULL,
+                       offsetof(struct bench_heap_node, hn));
+        cstl_dheap_init(&dh, sizeof(struct bench_heap_entry), d < 2 ? 2 : d,
+                        bench_heap_cmp, NULL);
+
+        bench_start_timer(ctx);
+        if (d < 2) {
+            for (j = 0; j < n; j++) {
+                cstl_heap_push(&h, &nodes[j]);
+            }
+            while (cstl_heap_pop(&h) != NULL)
+                ;
+        } else {
+            for (j = 0; j < n; j++) {
+                cstl_dheap_push(&dh, &nodes[j].e);
+            }
+            while (cstl_dheap_pop(&dh, NULL))
+                ;
+        }
+        bench_stop_timer(ctx);
+
+        cstl_dheap_clear(&dh);
+    }
+
+    free(nodes);
+    bench_start_timer(ctx);
+}
+
+void bench_heap_fill_linked(struct bench_context * const ctx,
+                            const unsigned long count)
+{
+    bench_heap_fill(ctx, count, 0);
+}
+
+void bench_heap_fill_d2(struct bench_context * const ctx,
+                        const unsigned long count)
+{
+    bench_heap_fill(ctx, count, 2);
+}
+
+void bench_heap_fill_d4(struct bench_context * const ctx,
+                        const unsigned long count)
+{
+    bench_heap_fill(ctx, count, 4);
+}
+
+void bench_heap_fill_d8(struct bench_context * const ctx,
+                        const unsigned long count)
+{
+    bench_heap_fill(ctx, count, 8);
+}
+
+/*
+ * the "hold" model: with the heap at a steady size, repeatedly
+ * pop the earliest entry and push it back with a later deadline
+ */
+static void bench_heap_hold(struct bench_context * const ctx,
+                            const unsigned long count,
+                            const unsigned int d)
+{
+    const unsigned int n = 1 << 16;
+    struct bench_heap_node * const nodes = malloc(n * sizeof(*nodes));
+    struct cstl_heap h;
+    cstl_dheap_t dh;
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+
+    cstl_heap_init(&h, bench_heap_cmp, NULL,
+                   offsetof(struct bench_heap_node, hn));
+    cstl_dheap_init(&dh, sizeof(struct bench_heap_entry), d < 2 ? 2 : d,
+                    bench_heap_cmp, NULL);
+    for (j = 0; j < n; j++) {
+        nodes[j].e.deadline = rand() % n;
+        nodes[j].e.task = &nodes[j];
+        if (d < 2) {
+            cstl_heap_push(&h, &nodes[j]);
+        } else {
+            cstl_dheap_push(&dh, &nodes[j].e);
+        }
+    }
+
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < n; j++) {
+            if (d < 2) {
+                struct bench_heap_node * const t = cstl_heap_pop(&h);
+
+                t->e.deadline += 1 + rand() % n;
+                cstl_heap_push(&h, t);
+            } else {
+                struct bench_heap_entry t;
+
+                cstl_dheap_pop(&dh, &t);
+                t.deadline += 1 + rand() % n;
+                cstl_dheap_push(&dh, &t);
+            }
+        }
+    }
+
+    bench_stop_timer(ctx);
+    cstl_dheap_clear(&dh);
+    free(nodes);
+    bench_start_timer(ctx);
+}
+
+void bench_heap_hold_linked(struct bench_context * const ctx,
+                            const unsigned long count)
+{
+    bench_heap_hold(ctx, count, 0);
+}
+
+void bench_heap_hold_d2(struct bench_context * const ctx,
+                        const unsigned long count)
+{
+    bench_heap_hold(ctx, count, 2);
+}
+
+void bench_heap_hold_d4(struct bench_context * const ctx,
+                        const unsigned long count)
+{
+    bench_heap_hold(ctx, count, 4);
+}
+
+void bench_heap_hold_d8(struct bench_context * const ctx,
+                        const unsigned long count)
+{
+    bench_heap_hold(ctx, count, 8);
+}
+
+/*
+ * seed an empty heap with a large number of objects,
+ * one at a time or all at once
+ */
+static void bench_heap_seed(struct bench_context * const ctx,
+                            const unsigned long count,
+                            const bool many)
+{
+    const unsigned int n = 1 << 20;
+    struct bench_heap_node * const nodes = malloc(n * sizeof(*nodes));
+    void ** const e = malloc(n * sizeof(*e));
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        struct cstl_heap h;
+        unsigned int j;
+
+        for (j = 0; j < n; j++) {
+            nodes[j].e.deadline = rand();
+            e[j] = &nodes[j];
+        }
+
+        cstl_heap_init(&h, bench_heap_cmp, NULL,
+                       offsetof(struct bench_heap_node, hn));
+
+        bench_start_timer(ctx);
+        if (many) {
+            cstl_heap_push_many(&h, e, n);
+        } else {
+            for (j = 0; j < n; j++) {
+                cstl_heap_push(&h, e[j]);
+            }
+        }
+        bench_stop_timer(ctx);
+    }
+
+    free(e);
+    free(nodes);
+    bench_start_timer(ctx);
+}
+
+void bench_heap_seed_push(struct bench_context * const ctx,
+                          const unsigned long count)
+{
+    bench_heap_seed(ctx, count, false);
+}
+
+void bench_heap_seed_push_many(struct bench_context * const ctx,
+                               const unsigned long count)
+{
+    bench_heap_seed(ctx, count, true);
+}
+
+/*
+ * push and pop with the pairing heap, for comparison with
+ * the linked binary heap in bench_heap_fill_linked
+ */
+void bench_heap_fill_pairing(struct bench_context * const ctx,
+                             const unsigned long count)
+{
+    const unsigned int n = 1 << 16;
+    struct bench_heap_node * const nodes = malloc(n * sizeof(*nodes));
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        struct cstl_pheap h;
+        unsigned int j;
+
+        for (j = 0; j < n; j++) {
+            nodes[j].e.deadline = rand();
+        }
+
+        cstl_pheap_init(&h, bench_heap_cmp, NULL,
+                        offsetof(struct bench_heap_node, pn));
+
+        bench_start_timer(ctx);
+        for (j = 0; j < n; j++) {
+            cstl_pheap_push(&h, &nodes[j]);
+        }
+        while (cstl_pheap_pop(&h) != NULL)
+            ;
+        bench_stop_timer(ctx);
+    }
+
+    free(nodes);
+    bench_start_timer(ctx);
+}
+
+/*
+ * move the contents of one heap into another, as when
+ * rebalancing work between per-thread queues
+ */
+static void bench_heap_move(struct bench_context * const ctx,
+                            const unsigned long count,
+                            const bool pairing)
+{
+    const unsigned int n = 1 << 16;
+    struct bench_heap_node * const nodes = malloc(2 * n * sizeof(*nodes));
+    struct cstl_heap h[2];
+    struct cstl_pheap ph[2];
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+
+    for (j = 0; j < 2; j++) {
+        cstl_heap_init(&h[j], bench_heap_cmp, NULL,
+                       offsetof(struct bench_heap_node, hn));
+        cstl_pheap_init(&ph[j], bench_heap_cmp, NULL,
+                        offsetof(struct bench_heap_node, pn));
+    }
+    for (j = 0; j < 2 * n; j++) {
+        nodes[j].e.deadline = rand();
+        if (pairing) {
+            cstl_pheap_push(&ph[j % 2], &nodes[j]);
+        } else {
+            cstl_heap_push(&h[j % 2], &nodes[j]);
+        }
+    }
+
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        /* move everything into one heap and then half of it back */
+        if (pairing) {
+            cstl_pheap_meld(&ph[0], &ph[1]);
+            for (j = 0; j < n; j++) {
+                cstl_pheap_push(&ph[1], cstl_pheap_pop(&ph[0]));
+            }
+        } else {
+            void * e;
+
+            while ((e = cstl_heap_pop(&h[1])) != NULL) {
+                cstl_heap_push(&h[0], e);
+            }
+            for (j = 0; j < n; j++) {
+                cstl_heap_push(&h[1], cstl_heap_pop(&h[0]));
+            }
+        }
+    }
+
+    bench_stop_timer(ctx);
+    free(nodes);
+    bench_start_timer(ctx);
+}
+
+void bench_heap_move_linked(struct bench_context * const ctx,
+                            const unsigned long count)
+{
+    bench_heap_move(ctx, count, false);
+}
+
+void bench_heap_move_pairing(struct bench_context * const ctx,
+                             const unsigned long count)
+{
+    bench_heap_move(ctx, count, true);
+}
+
+/*
+ * the radix heap on the same workloads as the comparison heaps
+ * in bench_heap_fill and bench_heap_hold. both are monotone: the
+ * deadlines pushed are never earlier than the last one popped
+ */
+void bench_heap_fill_radix(struct bench_context * const ctx,
+                           const unsigned long count)
+{
+    const unsigned int n = 1 << 16;
+    struct bench_heap_node * const nodes = malloc(n * sizeof(*nodes));
+    struct cstl_rheap h;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+
+    cstl_rheap_init(&h, offsetof(struct bench_heap_node, rn));
+
+    for (i = 0; i < count; i++) {
+        unsigned int j;
+
+        for (j = 0; j < n; j++) {
+            nodes[j].e.deadline = rand();
+        }
+
+        bench_start_timer(ctx);
+        for (j = 0; j < n; j++) {
+            cstl_rheap_push(&h, &nodes[j], nodes[j].e.deadline);
+        }
+        while (cstl_rheap_pop(&h, NULL) != NULL)
+            ;
+        bench_stop_timer(ctx);
+
+        /* allow the next iteration to start over from zero */
+        cstl_rheap_init(&h, offsetof(struct bench_heap_node, rn));
+    }
+
+    free(nodes);
+    bench_start_timer(ctx);
+}
+
+void bench_heap_hold_radix(struct bench_context * const ctx,
+                           const unsigned long count)
+{
+    const unsigned int n = 1 << 16;
+    struct bench_heap_node * const nodes = malloc(n * sizeof(*nodes));
+    struct cstl_rheap h;
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+
+    cstl_rheap_init(&h, offsetof(struct bench_heap_node, rn));
+    for (j = 0; j < n; j++) {
+        nodes[j].e.deadline = rand() % n;
+        cstl_rheap_push(&h, &nodes[j], nodes[j].e.deadline);
+    }
+
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < n; j++) {
+            struct bench_heap_node * const t = cstl_rheap_pop(&h, NULL);
+
+            t->e.deadline += 1 + rand() % n;
+            cstl_rheap_push(&h, t, t->e.deadline);
+        }
+    }
+
+    bench_stop_timer(ctx);
+    free(nodes);
+    bench_start_timer(ctx);
+}
@@ -5,7 +5,6 @@
 #include <time.h>
 #include <math.h>
 
-#define CLOCK_BENCH     CLOCK_PROCESS_CPUTIME_ID
 #define NS_PER_S        1000000000
 
 struct stdev_context
@@ -18,6 +17,7 @@ struct bench_context
 {
     struct stdev_context stdev;
 
+    clockid_t clk;
     struct timespec start, accum;
 };
 
@@ -94,10 +94,13 @@ static float stdev_final(const struct stdev_context * const ctx)
     return sqrtf(ctx->S / ctx->n);
 }
 
-static void bench_context_init(struct bench_context * const ctx)
+static void bench_context_init(struct bench_context * const ctx,
+                               const clockid_t clk)
 {
     stdev_init(&ctx->stdev);
 
+    ctx->clk = clk;
+
     timespec_clr(&ctx->accum);
     timespec_set(&ctx->start, -1, 0);
 }
@@ -107,7 +110,7 @@ void bench_stop_timer(struct bench_context * const ctx)
     if (ctx->start.tv_sec >= 0) {
         struct timespec dur;
 
-        clock_gettime(CLOCK_BENCH, &dur);
+        clock_gettime(ctx->clk, &dur);
 
         timespec_sub(&dur, &ctx->start, &dur);
         timespec_add(&ctx->accum, &dur, &ctx->accum);
@@ -119,7 +122,7 @@ void bench_stop_timer(struct bench_context * const ctx)
 void bench_start_timer(struct bench_context * const ctx)
 {
     if (ctx->start.tv_sec < 0) {
-        clock_gettime(CLOCK_BENCH, &ctx->start);
+        clock_gettime(ctx->clk, &ctx->start);
     }
 }
 
@@ -142,7 +145,8 @@ static void __bench_run(struct bench_context * const ctx,
     }
 }
 
-static void bench_run(const char * const name, bench_runner_func_t * const run)
+static void bench_run(const char * const name, bench_runner_func_t * const run,
+                      const clockid_t clk)
 {
     struct bench_context ctx;
     struct timespec accum;
@@ -152,7 +156,7 @@ static void bench_run(const char * const name, bench_runner_func_t * const run)
 
     printf("running %-20s", name); fflush(stdout);
 
-    bench_context_init(&ctx);
+    bench_context_init(&ctx, clk);
     do {
         factor++;
         runs = 1 << factor;
@@ -160,7 +164,7 @@ static void bench_run(const char * const name, bench_runner_func_t * const run)
     } while (ctx.accum.tv_sec < 1
              && ctx.accum.tv_nsec < 100000);
 
-    bench_context_init(&ctx);
+    bench_context_init(&ctx, clk);
     timespec_clr(&accum);
 
     for (unsigned int i = 1; i < 100; i++) {
@@ -181,12 +185,24 @@ static void bench_run(const char * const name, bench_runner_func_t * const run)
 
 int main(void)
 {
-#define BENCH_RUN(FUNC)                         \
+#define BENCH_RUN_CLOCK(FUNC, CLK)              \
     do {                                        \
         extern bench_runner_func_t FUNC;        \
-        bench_run(#FUNC, FUNC);                 \
+        bench_run(#FUNC, FUNC, CLK);            \
     } while (0)
 
+    /*
+     * benchmarks are timed by the cpu time used by the process.
+     * that isn't useful for benchmarks that run multiple threads:
+     * it doesn't go down when the work is spread across threads,
+     * and it doesn't count time that threads spend waiting on
+     * each other. those benchmarks are timed by the wall clock
+     */
+#define BENCH_RUN(FUNC)                                 \
+    BENCH_RUN_CLOCK(FUNC, CLOCK_PROCESS_CPUTIME_ID)
+#define BENCH_RUN_THREADED(FUNC)                        \
+    BENCH_RUN_CLOCK(FUNC, CLOCK_MONOTONIC)
+
     /* warm up the cpu */
     for (volatile int32_t x = 0; x >= 0; x++)
         ;
@@ -195,8 +211,113 @@ int main(void)
     BENCH_RUN(bench_qsort_r);
     BENCH_RUN(bench_qsort_m);
     BENCH_RUN(bench_hsort);
+    BENCH_RUN(bench_select_sort);
+    BENCH_RUN(bench_select_partial_sort);
+    BENCH_RUN(bench_select_top_k);
+
+    BENCH_RUN(bench_deque_fifo);
+    BENCH_RUN(bench_deque_fifo_dlist);
 
     BENCH_RUN(bench_map_insert);
+    BENCH_RUN(bench_map_churn_malloc);
+    BENCH_RUN(bench_map_churn_pool);
+    BENCH_RUN(bench_map_rb_insert);
+    BENCH_RUN(bench_map_bt_insert);
+    BENCH_RUN(bench_map_rb_find);
+    BENCH_RUN(bench_map_bt_find);
+    BENCH_RUN(bench_map_rb_scan);
+    BENCH_RUN(bench_map_bt_scan);
+    BENCH_RUN(bench_map_rb_insert_1m);
+    BENCH_RUN(bench_map_bt_insert_1m);
+    BENCH_RUN(bench_map_rb_find_1m);
+    BENCH_RUN(bench_map_bt_find_1m);
+    BENCH_RUN(bench_map_rb_scan_1m);
+    BENCH_RUN(bench_map_bt_scan_1m);
+    BENCH_RUN(bench_map_window_scan);
+    BENCH_RUN(bench_map_window_range_x1024);
+    BENCH_RUN(bench_map_percentile_walk_x4);
+    BENCH_RUN(bench_map_percentile_select_x32k);
+    BENCH_RUN(bench_map_sorted_insert);
+    BENCH_RUN(bench_map_sorted_build);
+    BENCH_RUN(bench_map_stream_insert);
+    BENCH_RUN(bench_map_stream_hint);
+    BENCH_RUN(bench_map_union_insert);
+    BENCH_RUN(bench_map_union_merge);
+    BENCH_RUN(bench_map_wide_find_pointer);
+    BENCH_RUN(bench_map_wide_find_inline);
+    BENCH_RUN(bench_map_wide_find_memcmp);
+    BENCH_RUN(bench_map_int_find_uint);
+
+    BENCH_RUN(bench_pmap_snapshot);
+    BENCH_RUN(bench_pmap_map_copy);
+    BENCH_RUN(bench_pmap_insert);
+    BENCH_RUN(bench_pmap_insert_snapshot);
+    BENCH_RUN(bench_pmap_find);
+
+    BENCH_RUN_THREADED(bench_skipmap_r90_t1);
+    BENCH_RUN_THREADED(bench_skipmap_r90_t2);
+    BENCH_RUN_THREADED(bench_skipmap_r90_t4);
+    BENCH_RUN_THREADED(bench_skipmap_r90_t8);
+    BENCH_RUN_THREADED(bench_skipmap_locked_r90_t1);
+    BENCH_RUN_THREADED(bench_skipmap_locked_r90_t4);
+    BENCH_RUN_THREADED(bench_skipmap_r50_t1);
+    BENCH_RUN_THREADED(bench_skipmap_r50_t2);
+    BENCH_RUN_THREADED(bench_skipmap_r50_t4);
+    BENCH_RUN_THREADED(bench_skipmap_r50_t8);
+    BENCH_RUN_THREADED(bench_skipmap_locked_r50_t1);
+    BENCH_RUN_THREADED(bench_skipmap_locked_r50_t4);
+
+    BENCH_RUN(bench_art_string_insert);
+    BENCH_RUN(bench_art_map_string_insert);
+    BENCH_RUN(bench_art_string_find);
+    BENCH_RUN(bench_art_map_string_find);
+    BENCH_RUN(bench_art_id_find_art);
+    BENCH_RUN(bench_art_id_find_map);
+
+    BENCH_RUN(bench_heap_fill_linked);
+    BENCH_RUN(bench_heap_fill_d2);
+    BENCH_RUN(bench_heap_fill_d4);
+    BENCH_RUN(bench_heap_fill_d8);
+    BENCH_RUN(bench_heap_hold_linked);
+    BENCH_RUN(bench_heap_hold_d2);
+    BENCH_RUN(bench_heap_hold_d4);
+    BENCH_RUN(bench_heap_hold_d8);
+    BENCH_RUN(bench_heap_seed_push);
+    BENCH_RUN(bench_heap_seed_push_many);
+    BENCH_RUN(bench_heap_fill_pairing);
+    BENCH_RUN(bench_heap_move_linked);
+    BENCH_RUN(bench_heap_move_pairing);
+    BENCH_RUN(bench_heap_fill_radix);
+    BENCH_RUN(bench_heap_hold_radix);
+
+    BENCH_RUN(bench_twheel_cancel_wheel);
+    BENCH_RUN(bench_twheel_cancel_heap);
+    BENCH_RUN(bench_twheel_expire_wheel);
+    BENCH_RUN(bench_twheel_expire_heap);
+
+    BENCH_RUN_THREADED(bench_mqueue_t1);
+    BENCH_RUN_THREADED(bench_mqueue_t2);
+    BENCH_RUN_THREADED(bench_mqueue_t4);
+    BENCH_RUN_THREADED(bench_mqueue_t8);
+    BENCH_RUN_THREADED(bench_mqueue_locked_t1);
+    BENCH_RUN_THREADED(bench_mqueue_locked_t4);
+
+    BENCH_RUN_THREADED(bench_ring_spsc);
+    BENCH_RUN_THREADED(bench_ring_spsc_batch);
+    BENCH_RUN_THREADED(bench_ring_mpmc);
+    BENCH_RUN_THREADED(bench_ring_mpmc_batch);
+    BENCH_RUN_THREADED(bench_ring_locked);
+    BENCH_RUN_THREADED(bench_ring_locked_batch);
+    BENCH_RUN_THREADED(bench_ring_pingpong_spsc);
+    BENCH_RUN_THREADED(bench_ring_pingpong_mpmc);
+    BENCH_RUN_THREADED(bench_ring_pingpong_locked);
+
+    BENCH_RUN(bench_rbtree_foreach);
+    BENCH_RUN(bench_rbtree_foreach_inorder);
+    BENCH_RUN(bench_rbtree_clear);
+
+    BENCH_RUN(bench_request_malloc);
+    BENCH_RUN(bench_request_arena);
 
     return 0;
 }
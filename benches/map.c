@@ -44,3 +44,702 @@ void bench_map_insert(struct bench_context * const ctx,
 
     bench_start_timer(ctx);
 }
+
+/*
+ * simulate a map whose contents are constantly changing: keep the
+ * map at a steady size, removing an existing key for every new key
+ * that is inserted. the whole map is thrown away at the end of
+ * each iteration, so the cost of clearing it is included, too.
+ */
+static void bench_map_churn(struct bench_context * const ctx,
+                            const unsigned long count,
+                            struct cstl_pool * const pool)
+{
+    const unsigned int n = 2000;
+    unsigned int i;
+
+    bench_stop_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        unsigned int j;
+        uintptr_t k;
+        cstl_map_t map;
+
+        cstl_map_init(&map, cmp_key, NULL);
+        cstl_map_set_pool(&map, pool);
+
+        bench_start_timer(ctx);
+        for (j = 0, k = 0; j < n; j++, k++) {
+            cstl_map_insert(&map, (void *)k, NULL, NULL);
+        }
+        for (j = 0; j < 4 * n; j++, k++) {
+            cstl_map_erase(&map, (void *)(k - n), NULL);
+            cstl_map_insert(&map, (void *)k, NULL, NULL);
+        }
+        cstl_map_clear(&map, NULL, NULL);
+        bench_stop_timer(ctx);
+    }
+
+    bench_start_timer(ctx);
+}
+
+void bench_map_churn_malloc(struct bench_context * const ctx,
+                            const unsigned long count)
+{
+    bench_map_churn(ctx, count, NULL);
+}
+
+void bench_map_churn_pool(struct bench_context * const ctx,
+                          const unsigned long count)
+{
+    struct cstl_pool pool;
+
+    cstl_map_pool_init(&pool, 0);
+    bench_map_churn(ctx, count, &pool);
+    cstl_pool_clear(&pool);
+}
+
+/*
+ * the functions below compare the red-black tree and B-tree
+ * backends. the B-tree packs many keys into each node, so
+ * searches and in-order scans touch far fewer cache lines.
+ *
+ * each is run on a map of 16k or 128k keys, which fits (mostly)
+ * in cache, and on one of 1M keys, which doesn't. an iteration
+ * of the find benchmarks is 128k lookups, and an iteration of
+ * the scan benchmarks visits 4M keys, whatever the map's size
+ */
+#define BENCH_MAP_FINDS         (1 << 17)
+#define BENCH_MAP_SCANS         (1 << 22)
+
+static void bench_map_fill(cstl_map_t * const map,
+                           const cstl_map_backend_t backend,
+                           uintptr_t * const keys, const unsigned int n)
+{
+    unsigned int j;
+
+    __cstl_map_init(map, cmp_key, NULL, backend);
+    for (j = 0; j < n; j++) {
+        keys[j] = rand();
+        cstl_map_insert(map, (void *)keys[j], NULL, NULL);
+    }
+}
+
+static void bench_map_backend_insert(struct bench_context * const ctx,
+                                     const unsigned long count,
+                                     const cstl_map_backend_t backend,
+                                     const unsigned int n)
+{
+    uintptr_t * const keys = malloc(n * sizeof(*keys));
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        cstl_map_t map;
+
+        bench_start_timer(ctx);
+        bench_map_fill(&map, backend, keys, n);
+        bench_stop_timer(ctx);
+
+        cstl_map_clear(&map, NULL, NULL);
+    }
+
+    free(keys);
+
+    bench_start_timer(ctx);
+}
+
+void bench_map_rb_insert(struct bench_context * const ctx,
+                         const unsigned long count)
+{
+    bench_map_backend_insert(ctx, count, CSTL_MAP_BACKEND_RBTREE, 1 << 14);
+}
+
+void bench_map_bt_insert(struct bench_context * const ctx,
+                         const unsigned long count)
+{
+    bench_map_backend_insert(ctx, count, CSTL_MAP_BACKEND_BTREE, 1 << 14);
+}
+
+void bench_map_rb_insert_1m(struct bench_context * const ctx,
+                            const unsigned long count)
+{
+    bench_map_backend_insert(ctx, count, CSTL_MAP_BACKEND_RBTREE, 1 << 20);
+}
+
+void bench_map_bt_insert_1m(struct bench_context * const ctx,
+                            const unsigned long count)
+{
+    bench_map_backend_insert(ctx, count, CSTL_MAP_BACKEND_BTREE, 1 << 20);
+}
+
+static void bench_map_backend_find(struct bench_context * const ctx,
+                                   const unsigned long count,
+                                   const cstl_map_backend_t backend,
+                                   const unsigned int n)
+{
+    uintptr_t * const keys = malloc(n * sizeof(*keys));
+    cstl_map_t map;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    bench_map_fill(&map, backend, keys, n);
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        unsigned int j;
+
+        for (j = 0; j < BENCH_MAP_FINDS; j++) {
+            cstl_map_iterator_t it;
+            cstl_map_find(&map, (void *)keys[rand() % n], &it);
+        }
+    }
+
+    bench_stop_timer(ctx);
+    cstl_map_clear(&map, NULL, NULL);
+    free(keys);
+    bench_start_timer(ctx);
+}
+
+void bench_map_rb_find(struct bench_context * const ctx,
+                       const unsigned long count)
+{
+    bench_map_backend_find(ctx, count, CSTL_MAP_BACKEND_RBTREE, 1 << 17);
+}
+
+void bench_map_bt_find(struct bench_context * const ctx,
+                       const unsigned long count)
+{
+    bench_map_backend_find(ctx, count, CSTL_MAP_BACKEND_BTREE, 1 << 17);
+}
+
+void bench_map_rb_find_1m(struct bench_context * const ctx,
+                          const unsigned long count)
+{
+    bench_map_backend_find(ctx, count, CSTL_MAP_BACKEND_RBTREE, 1 << 20);
+}
+
+void bench_map_bt_find_1m(struct bench_context * const ctx,
+                          const unsigned long count)
+{
+    bench_map_backend_find(ctx, count, CSTL_MAP_BACKEND_BTREE, 1 << 20);
+}
+
+static int bench_map_scan_visit(void * const e, void * const p)
+{
+    const cstl_map_iterator_t * const i = e;
+    uintptr_t * const sum = p;
+
+    *sum += (uintptr_t)i->key;
+    return 0;
+}
+
+static void bench_map_backend_scan(struct bench_context * const ctx,
+                                   const unsigned long count,
+                                   const cstl_map_backend_t backend,
+                                   const unsigned int n)
+{
+    uintptr_t * const keys = malloc(n * sizeof(*keys));
+    volatile uintptr_t res;
+    cstl_map_t map;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    bench_map_fill(&map, backend, keys, n);
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        uintptr_t sum = 0;
+        unsigned int j;
+
+        for (j = 0; j < BENCH_MAP_SCANS / n; j++) {
+            cstl_map_foreach(&map, bench_map_scan_visit, &sum);
+        }
+        res = sum;
+    }
+
+    bench_stop_timer(ctx);
+    cstl_map_clear(&map, NULL, NULL);
+    free(keys);
+    bench_start_timer(ctx);
+
+    (void)res;
+}
+
+void bench_map_rb_scan(struct bench_context * const ctx,
+                       const unsigned long count)
+{
+    bench_map_backend_scan(ctx, count, CSTL_MAP_BACKEND_RBTREE, 1 << 17);
+}
+
+void bench_map_bt_scan(struct bench_context * const ctx,
+                       const unsigned long count)
+{
+    bench_map_backend_scan(ctx, count, CSTL_MAP_BACKEND_BTREE, 1 << 17);
+}
+
+void bench_map_rb_scan_1m(struct bench_context * const ctx,
+                          const unsigned long count)
+{
+    bench_map_backend_scan(ctx, count, CSTL_MAP_BACKEND_RBTREE, 1 << 20);
+}
+
+void bench_map_bt_scan_1m(struct bench_context * const ctx,
+                          const unsigned long count)
+{
+    bench_map_backend_scan(ctx, count, CSTL_MAP_BACKEND_BTREE, 1 << 20);
+}
+
+/*
+ * time-window style queries: find the (roughly 64) keys within a
+ * narrow range of a large map, either by filtering a walk of the
+ * whole map or by seeking to the start of the range. the range
+ * queries are so much faster that each iteration of that benchmark
+ * performs 1024 queries to keep the setup from dominating the run
+ */
+struct bench_map_window
+{
+    uintptr_t lo, hi;
+    unsigned int cnt;
+};
+
+static int bench_map_window_visit(void * const e, void * const p)
+{
+    const cstl_map_iterator_t * const i = e;
+    struct bench_map_window * const w = p;
+
+    if ((uintptr_t)i->key >= w->lo && (uintptr_t)i->key < w->hi) {
+        w->cnt++;
+    }
+    return 0;
+}
+
+static void bench_map_window(struct bench_context * const ctx,
+                             const unsigned long count,
+                             const unsigned int queries,
+                             const bool range)
+{
+    const unsigned int n = 1 << 17;
+    uintptr_t * const keys = malloc(n * sizeof(*keys));
+    volatile unsigned int res;
+    cstl_map_t map;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    bench_map_fill(&map, CSTL_MAP_BACKEND_DEFAULT, keys, n);
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        unsigned int j;
+
+        for (j = 0; j < queries; j++) {
+            struct bench_map_window w;
+
+            w.lo = rand();
+            w.hi = w.lo + (RAND_MAX / n) * 64;
+            w.cnt = 0;
+
+            if (range) {
+                cstl_map_foreach_range(&map, (void *)w.lo, (void *)w.hi,
+                                       bench_map_window_visit, &w);
+            } else {
+                cstl_map_foreach(&map, bench_map_window_visit, &w);
+            }
+
+            res = w.cnt;
+        }
+    }
+
+    bench_stop_timer(ctx);
+    cstl_map_clear(&map, NULL, NULL);
+    free(keys);
+    bench_start_timer(ctx);
+
+    (void)res;
+}
+
+void bench_map_window_scan(struct bench_context * const ctx,
+                           const unsigned long count)
+{
+    bench_map_window(ctx, count, 1, false);
+}
+
+void bench_map_window_range_x1024(struct bench_context * const ctx,
+                                  const unsigned long count)
+{
+    bench_map_window(ctx, count, 1024, true);
+}
+
+/*
+ * find the key at a random percentile of the map, either by
+ * walking the map in order up to the desired position or by
+ * asking a map with order statistics to select it directly
+ */
+
+static int bench_map_percentile_visit(void * const e, void * const p)
+{
+    unsigned long * const idx = p;
+
+    (void)e;
+    return (*idx)-- == 0;
+}
+
+static void bench_map_percentile(struct bench_context * const ctx,
+                                 const unsigned long count,
+                                 const unsigned int queries,
+                                 const bool ranked)
+{
+    const unsigned int n = 1 << 17;
+    volatile uintptr_t res;
+    cstl_map_t map;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    cstl_map_init(&map, cmp_key, NULL);
+    cstl_map_set_ranked(&map, ranked);
+    for (i = 0; i < n; i++) {
+        cstl_map_insert(&map, (void *)(uintptr_t)rand(), NULL, NULL);
+    }
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        unsigned int j;
+
+        for (j = 0; j < queries; j++) {
+            unsigned long idx = (cstl_map_size(&map) * (rand() % 100)) / 100;
+
+            if (ranked) {
+                cstl_map_iterator_t it;
+
+                cstl_map_select(&map, idx, &it);
+                res = (uintptr_t)it.key;
+            } else {
+                cstl_map_foreach(&map, bench_map_percentile_visit, &idx);
+                res = idx;
+            }
+        }
+    }
+
+    bench_stop_timer(ctx);
+    cstl_map_clear(&map, NULL, NULL);
+    bench_start_timer(ctx);
+
+    (void)res;
+}
+
+void bench_map_percentile_walk_x4(struct bench_context * const ctx,
+                                  const unsigned long count)
+{
+    bench_map_percentile(ctx, count, 4, false);
+}
+
+void bench_map_percentile_select_x32k(struct bench_context * const ctx,
+                                       const unsigned long count)
+{
+    bench_map_percentile(ctx, count, 32 * 1024, true);
+}
+
+/*
+ * populate a map from a sorted snapshot, either one key at a
+ * time or all at once via the bulk build operation
+ */
+static void bench_map_sorted(struct bench_context * const ctx,
+                             const unsigned long count,
+                             const bool bulk)
+{
+    const unsigned int n = 1 << 16;
+    const void ** keys;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    keys = malloc(n * sizeof(*keys));
+    for (i = 0; i < n; i++) {
+        keys[i] = (void *)(uintptr_t)(2 * i);
+    }
+
+    for (i = 0; i < count; i++) {
+        cstl_map_t map;
+
+        cstl_map_init(&map, cmp_key, NULL);
+
+        bench_start_timer(ctx);
+        if (bulk) {
+            cstl_map_build(&map, keys, NULL, n);
+        } else {
+            unsigned int j;
+
+            for (j = 0; j < n; j++) {
+                cstl_map_insert(&map, keys[j], NULL, NULL);
+            }
+        }
+        bench_stop_timer(ctx);
+
+        cstl_map_clear(&map, NULL, NULL);
+    }
+
+    free(keys);
+    bench_start_timer(ctx);
+}
+
+void bench_map_sorted_insert(struct bench_context * const ctx,
+                             const unsigned long count)
+{
+    bench_map_sorted(ctx, count, false);
+}
+
+void bench_map_sorted_build(struct bench_context * const ctx,
+                            const unsigned long count)
+{
+    bench_map_sorted(ctx, count, true);
+}
+
+/*
+ * insert a stream of keys that arrives nearly in order, like
+ * timestamps from several sources, either normally or using the
+ * previous insertion as a hint for the next
+ */
+static void bench_map_stream(struct bench_context * const ctx,
+                             const unsigned long count,
+                             const bool hint)
+{
+    const unsigned int n = 1 << 16;
+    uintptr_t * keys;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    keys = malloc(n * sizeof(*keys));
+    for (i = 0; i < n; i++) {
+        /* occasionally, a key arrives a little late */
+        keys[i] = 256 + 64 * i - ((rand() % 16 == 0) ? rand() % 256 : 0);
+    }
+
+    for (i = 0; i < count; i++) {
+        cstl_map_iterator_t it;
+        cstl_map_t map;
+        unsigned int j;
+
+        cstl_map_init(&map, cmp_key, NULL);
+        it = *cstl_map_iterator_end(&map);
+
+        bench_start_timer(ctx);
+        for (j = 0; j < n; j++) {
+            if (hint) {
+                cstl_map_insert_hint(&map, &it, (void *)keys[j], NULL, &it);
+            } else {
+                cstl_map_insert(&map, (void *)keys[j], NULL, NULL);
+            }
+        }
+        bench_stop_timer(ctx);
+
+        cstl_map_clear(&map, NULL, NULL);
+    }
+
+    free(keys);
+    bench_start_timer(ctx);
+}
+
+void bench_map_stream_insert(struct bench_context * const ctx,
+                             const unsigned long count)
+{
+    bench_map_stream(ctx, count, false);
+}
+
+void bench_map_stream_hint(struct bench_context * const ctx,
+                           const unsigned long count)
+{
+    bench_map_stream(ctx, count, true);
+}
+
+/*
+ * combine two maps with (mostly) distinct keys, either by
+ * inserting the contents of both into a new map, or by
+ * merging them with the set union operation
+ */
+
+static int bench_map_union_visit(void * const e, void * const p)
+{
+    const cstl_map_iterator_t * const i = e;
+
+    cstl_map_insert(p, i->key, i->val, NULL);
+    return 0;
+}
+
+static void bench_map_union(struct bench_context * const ctx,
+                            const unsigned long count,
+                            const bool merge)
+{
+    const unsigned int n = 1 << 16;
+    cstl_map_t a, b;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    cstl_map_init(&a, cmp_key, NULL);
+    cstl_map_init(&b, cmp_key, NULL);
+    for (i = 0; i < n; i++) {
+        cstl_map_insert(&a, (void *)(uintptr_t)rand(), NULL, NULL);
+        cstl_map_insert(&b, (void *)(uintptr_t)rand(), NULL, NULL);
+    }
+
+    for (i = 0; i < count; i++) {
+        cstl_map_t u;
+
+        cstl_map_init(&u, cmp_key, NULL);
+
+        bench_start_timer(ctx);
+        if (merge) {
+            cstl_map_union(&u, &a, &b, NULL, NULL);
+        } else {
+            cstl_map_foreach(&a, bench_map_union_visit, &u);
+            cstl_map_foreach(&b, bench_map_union_visit, &u);
+        }
+        bench_stop_timer(ctx);
+
+        cstl_map_clear(&u, NULL, NULL);
+    }
+
+    cstl_map_clear(&a, NULL, NULL);
+    cstl_map_clear(&b, NULL, NULL);
+    bench_start_timer(ctx);
+}
+
+void bench_map_union_insert(struct bench_context * const ctx,
+                            const unsigned long count)
+{
+    bench_map_union(ctx, count, false);
+}
+
+void bench_map_union_merge(struct bench_context * const ctx,
+                           const unsigned long count)
+{
+    bench_map_union(ctx, count, true);
+}
+
+/*
+ * compare maps of 16-byte keys where the nodes point to the
+ * keys against maps that hold copies of the keys in the nodes,
+ * compared either by the map's function or directly by memcmp()
+ */
+
+struct bench_map_wide_key
+{
+    uint64_t hi, lo;
+};
+
+static int bench_map_wide_cmp(const void * const _a, const void * const _b,
+                              void * const p)
+{
+    const struct bench_map_wide_key * const a = _a;
+    const struct bench_map_wide_key * const b = _b;
+
+    (void)p;
+
+    if (a->hi != b->hi) {
+        return a->hi < b->hi ? -1 : 1;
+    }
+    return (a->lo > b->lo) - (a->lo < b->lo);
+}
+
+static void bench_map_wide_find(struct bench_context * const ctx,
+                                const unsigned long count,
+                                const bool inl,
+                                const cstl_map_key_kind_t kind)
+{
+    const unsigned int n = 1 << 17;
+    struct bench_map_wide_key * const keys = malloc(n * sizeof(*keys));
+    cstl_map_t map;
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+
+    cstl_map_init(&map, bench_map_wide_cmp, NULL);
+    if (inl) {
+        cstl_map_set_inline_keys(&map, sizeof(*keys), kind);
+    }
+    for (j = 0; j < n; j++) {
+        keys[j].hi = rand() % 64;
+        keys[j].lo = rand();
+        cstl_map_insert(&map, &keys[j], NULL, NULL);
+    }
+
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < n; j++) {
+            cstl_map_iterator_t it;
+            cstl_map_find(&map, &keys[rand() % n], &it);
+        }
+    }
+
+    bench_stop_timer(ctx);
+    cstl_map_clear(&map, NULL, NULL);
+    free(keys);
+    bench_start_timer(ctx);
+}
+
+void bench_map_wide_find_pointer(struct bench_context * const ctx,
+                                 const unsigned long count)
+{
+    bench_map_wide_find(ctx, count, false, CSTL_MAP_KEY_CMP);
+}
+
+void bench_map_wide_find_inline(struct bench_context * const ctx,
+                                const unsigned long count)
+{
+    bench_map_wide_find(ctx, count, true, CSTL_MAP_KEY_CMP);
+}
+
+void bench_map_wide_find_memcmp(struct bench_context * const ctx,
+                                const unsigned long count)
+{
+    bench_map_wide_find(ctx, count, true, CSTL_MAP_KEY_MEMCMP);
+}
+
+/*
+ * the same comparison for 8-byte integer keys, which the
+ * map can also compare without calling a function at all
+ */
+static void bench_map_int_find(struct bench_context * const ctx,
+                               const unsigned long count,
+                               const bool inl)
+{
+    const unsigned int n = 1 << 17;
+    uintptr_t * const keys = malloc(n * sizeof(*keys));
+    cstl_map_t map;
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+    if (inl) {
+        cstl_map_init(&map, NULL, NULL);
+        cstl_map_set_inline_keys(&map, sizeof(*keys), CSTL_MAP_KEY_UINT);
+        for (j = 0; j < n; j++) {
+            keys[j] = rand();
+            cstl_map_insert(&map, &keys[j], NULL, NULL);
+        }
+    } else {
+        bench_map_fill(&map, CSTL_MAP_BACKEND_RBTREE, keys, n);
+    }
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < n; j++) {
+            uintptr_t * const k = &keys[rand() % n];
+            cstl_map_iterator_t it;
+
+            cstl_map_find(&map, inl ? (void *)k : (void *)*k, &it);
+        }
+    }
+
+    bench_stop_timer(ctx);
+    cstl_map_clear(&map, NULL, NULL);
+    free(keys);
+    bench_start_timer(ctx);
+}
+
+void bench_map_int_find_uint(struct bench_context * const ctx,
+                             const unsigned long count)
+{
+    bench_map_int_find(ctx, count, true);
+}
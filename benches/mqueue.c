@@ -0,0 +1,171 @@
+#include "internal/bench.h"
+#include "cstl/mqueue.h"
+#include "cstl/heap.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/*
+ * a pool of worker threads scheduling jobs by priority. the queue is
+ * primed with jobs, and each thread then repeatedly takes a job from
+ * it and puts a job with a new random priority back, so that the size
+ * of the queue stays steady. each iteration performs a fixed number of
+ * these operations, divided evenly among the threads.
+ *
+ * the multiqueue, with two heaps per thread, is compared with a single
+ * heap behind a single lock
+ */
+#define BENCH_MQUEUE_JOBS       (1 << 16)
+#define BENCH_MQUEUE_OPS        (1 << 18)
+#define BENCH_MQUEUE_THREADS    8
+
+struct bench_mqueue_job
+{
+    unsigned int prio;
+    struct cstl_heap_node hn;
+};
+
+static int bench_mqueue_cmp(const void * const _a, const void * const _b,
+                            void * const p)
+{
+    const struct bench_mqueue_job * const a = _a;
+    const struct bench_mqueue_job * const b = _b;
+
+    (void)p;
+
+    return (a->prio > b->prio) - (a->prio < b->prio);
+}
+
+static void bench_mqueue_nop(void * const e, void * const p)
+{
+    (void)e; (void)p;
+}
+
+struct bench_mqueue_thread
+{
+    cstl_mqueue_t * mq;
+
+    struct cstl_heap * h;
+    pthread_mutex_t * lock;
+
+    unsigned int ops;
+    unsigned int seed;
+};
+
+static void * bench_mqueue_thread(void * const arg)
+{
+    struct bench_mqueue_thread * const t = arg;
+    unsigned int i;
+
+    for (i = 0; i < t->ops; i++) {
+        struct bench_mqueue_job * const j = cstl_mqueue_pop(t->mq, &t->seed);
+
+        j->prio = rand_r(&t->seed);
+        cstl_mqueue_push(t->mq, j, &t->seed);
+    }
+
+    return NULL;
+}
+
+/* the same workload on a cstl_heap behind a single lock */
+static void * bench_mqueue_locked_thread(void * const arg)
+{
+    struct bench_mqueue_thread * const t = arg;
+    unsigned int i;
+
+    for (i = 0; i < t->ops; i++) {
+        struct bench_mqueue_job * j;
+        unsigned int prio;
+
+        pthread_mutex_lock(t->lock);
+        j = cstl_heap_pop(t->h);
+        pthread_mutex_unlock(t->lock);
+
+        prio = rand_r(&t->seed);
+
+        pthread_mutex_lock(t->lock);
+        j->prio = prio;
+        cstl_heap_push(t->h, j);
+        pthread_mutex_unlock(t->lock);
+    }
+
+    return NULL;
+}
+
+static void bench_mqueue(struct bench_context * const ctx,
+                         const unsigned long count,
+                         const unsigned int nthreads,
+                         const bool locked)
+{
+    struct bench_mqueue_job * const jobs =
+        malloc(BENCH_MQUEUE_JOBS * sizeof(*jobs));
+    struct bench_mqueue_thread t[BENCH_MQUEUE_THREADS];
+    pthread_t th[BENCH_MQUEUE_THREADS];
+    pthread_mutex_t lock;
+    cstl_mqueue_t mq;
+    struct cstl_heap h;
+    unsigned int r = 1;
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+
+    cstl_mqueue_init(&mq, 2 * nthreads, bench_mqueue_cmp, NULL,
+                     offsetof(struct bench_mqueue_job, hn));
+    cstl_heap_init(&h, bench_mqueue_cmp, NULL,
+                   offsetof(struct bench_mqueue_job, hn));
+    pthread_mutex_init(&lock, NULL);
+
+    for (j = 0; j < BENCH_MQUEUE_JOBS; j++) {
+        jobs[j].prio = rand();
+        if (locked) {
+            cstl_heap_push(&h, &jobs[j]);
+        } else {
+            cstl_mqueue_push(&mq, &jobs[j], &r);
+        }
+    }
+
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < nthreads; j++) {
+            t[j].mq = &mq;
+            t[j].h = &h;
+            t[j].lock = &lock;
+            t[j].ops = BENCH_MQUEUE_OPS / nthreads;
+            t[j].seed = rand();
+
+            pthread_create(&th[j], NULL,
+                           locked
+                           ? bench_mqueue_locked_thread
+                           : bench_mqueue_thread,
+                           &t[j]);
+        }
+        for (j = 0; j < nthreads; j++) {
+            pthread_join(th[j], NULL);
+        }
+    }
+
+    bench_stop_timer(ctx);
+    pthread_mutex_destroy(&lock);
+    cstl_heap_clear(&h, bench_mqueue_nop);
+    cstl_mqueue_clear(&mq, bench_mqueue_nop);
+    free(jobs);
+    bench_start_timer(ctx);
+}
+
+#define BENCH_MQUEUE(THREADS)                                           \
+    void bench_mqueue_t##THREADS(                                       \
+        struct bench_context * const ctx, const unsigned long count)    \
+    {                                                                   \
+        bench_mqueue(ctx, count, THREADS, false);                       \
+    }                                                                   \
+    void bench_mqueue_locked_t##THREADS(                                \
+        struct bench_context * const ctx, const unsigned long count)    \
+    {                                                                   \
+        bench_mqueue(ctx, count, THREADS, true);                        \
+    }
+
+BENCH_MQUEUE(1)
+BENCH_MQUEUE(2)
+BENCH_MQUEUE(4)
+BENCH_MQUEUE(8)
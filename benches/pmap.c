@@ -0,0 +1,158 @@
+#include "internal/bench.h"
+#include "cstl/pmap.h"
+#include "cstl/map.h"
+#include <stdlib.h>
+
+static int cmp_key(const void * const a, const void * const b, void * const p)
+{
+    (void)p;
+    return (uintptr_t)a - (uintptr_t)b;
+}
+
+static void bench_pmap_fill(cstl_pmap_t * const pm,
+                            uintptr_t * const keys, const unsigned int n)
+{
+    unsigned int j;
+
+    cstl_pmap_init(pm, cmp_key, NULL);
+    for (j = 0; j < n; j++) {
+        keys[j] = rand();
+        cstl_pmap_insert(pm, (void *)keys[j], NULL);
+    }
+}
+
+/*
+ * taking a snapshot of a persistent map costs the same regardless
+ * of the size of the map. the closest thing for an ordinary map is
+ * a (linear time) copy, for which the union with an empty map is
+ * the quickest way
+ */
+void bench_pmap_snapshot(struct bench_context * const ctx,
+                         const unsigned long count)
+{
+    const unsigned int n = 1 << 14;
+    uintptr_t * const keys = malloc(n * sizeof(*keys));
+    cstl_pmap_t pm, snap;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    bench_pmap_fill(&pm, keys, n);
+    cstl_pmap_init(&snap, cmp_key, NULL);
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        cstl_pmap_snapshot(&pm, &snap);
+    }
+
+    bench_stop_timer(ctx);
+    cstl_pmap_clear(&snap);
+    cstl_pmap_clear(&pm);
+    free(keys);
+    bench_start_timer(ctx);
+}
+
+void bench_pmap_map_copy(struct bench_context * const ctx,
+                         const unsigned long count)
+{
+    const unsigned int n = 1 << 14;
+    cstl_map_t map, nil;
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+    cstl_map_init(&map, cmp_key, NULL);
+    cstl_map_init(&nil, cmp_key, NULL);
+    for (j = 0; j < n; j++) {
+        cstl_map_insert(&map, (void *)(uintptr_t)rand(), NULL, NULL);
+    }
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        cstl_map_t copy;
+
+        cstl_map_init(&copy, cmp_key, NULL);
+        cstl_map_union(&copy, &map, &nil, NULL, NULL);
+        cstl_map_clear(&copy, NULL, NULL);
+    }
+
+    bench_stop_timer(ctx);
+    cstl_map_clear(&map, NULL, NULL);
+    bench_start_timer(ctx);
+}
+
+/*
+ * the cost of an update depends on whether the nodes along the path
+ * are shared with another version. with no snapshot, they're modified
+ * in place (compare with bench_map_rb_insert). with a snapshot taken
+ * before every update, the whole path is copied each time
+ */
+static void bench_pmap_update(struct bench_context * const ctx,
+                              const unsigned long count,
+                              const bool snapshot)
+{
+    const unsigned int n = 1 << 14;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        cstl_pmap_t pm, snap;
+        unsigned int j;
+
+        cstl_pmap_init(&pm, cmp_key, NULL);
+        cstl_pmap_init(&snap, cmp_key, NULL);
+
+        bench_start_timer(ctx);
+        for (j = 0; j < n; j++) {
+            if (snapshot) {
+                cstl_pmap_snapshot(&pm, &snap);
+            }
+            cstl_pmap_insert(&pm, (void *)(uintptr_t)rand(), NULL);
+        }
+        cstl_pmap_clear(&snap);
+        bench_stop_timer(ctx);
+
+        cstl_pmap_clear(&pm);
+    }
+
+    bench_start_timer(ctx);
+}
+
+void bench_pmap_insert(struct bench_context * const ctx,
+                       const unsigned long count)
+{
+    bench_pmap_update(ctx, count, false);
+}
+
+void bench_pmap_insert_snapshot(struct bench_context * const ctx,
+                                const unsigned long count)
+{
+    bench_pmap_update(ctx, count, true);
+}
+
+/* compare with bench_map_rb_find */
+void bench_pmap_find(struct bench_context * const ctx,
+                     const unsigned long count)
+{
+    const unsigned int n = 1 << 17;
+    uintptr_t * const keys = malloc(n * sizeof(*keys));
+    cstl_pmap_t pm;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    bench_pmap_fill(&pm, keys, n);
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        unsigned int j;
+
+        for (j = 0; j < n; j++) {
+            cstl_pmap_find(&pm, (void *)keys[rand() % n]);
+        }
+    }
+
+    bench_stop_timer(ctx);
+    cstl_pmap_clear(&pm);
+    free(keys);
+    bench_start_timer(ctx);
+}
@@ -0,0 +1,126 @@
+#include "internal/bench.h"
+#include "cstl/rbtree.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+struct bench_rbtree_elem
+{
+    int v;
+    struct cstl_rbtree_node n;
+};
+
+static int cmp_elem(const void * const a, const void * const b, void * const p)
+{
+    const struct bench_rbtree_elem * const x = a, * const y = b;
+
+    (void)p;
+    return (x->v > y->v) - (x->v < y->v);
+}
+
+static struct bench_rbtree_elem * bench_rbtree_fill(
+    struct cstl_rbtree * const t, const unsigned int n)
+{
+    struct bench_rbtree_elem * const e = malloc(n * sizeof(*e));
+    unsigned int i;
+
+    cstl_rbtree_init(t, cmp_elem, NULL,
+                     offsetof(struct bench_rbtree_elem, n));
+    for (i = 0; i < n; i++) {
+        e[i].v = rand();
+        cstl_rbtree_insert(t, &e[i], NULL);
+    }
+
+    return e;
+}
+
+static void bench_rbtree_nop(void * const e, void * const p)
+{
+    (void)e; (void)p;
+}
+
+static int bench_rbtree_sum(const void * const e,
+                            const cstl_bintree_visit_order_t ord,
+                            void * const p)
+{
+    if (ord == CSTL_BINTREE_VISIT_ORDER_MID
+        || ord == CSTL_BINTREE_VISIT_ORDER_LEAF) {
+        const struct bench_rbtree_elem * const x = e;
+        *(unsigned long *)p += x->v;
+    }
+
+    return 0;
+}
+
+/*
+ * walk a large tree in order, repeatedly. each iteration
+ * makes 16 passes over a tree of 128k elements
+ */
+static void bench_rbtree_walk(struct bench_context * const ctx,
+                              const unsigned long count,
+                              const bool inorder)
+{
+    struct cstl_rbtree t;
+    struct bench_rbtree_elem * e;
+    volatile unsigned long res;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    e = bench_rbtree_fill(&t, 1 << 17);
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        unsigned long sum = 0;
+        unsigned int j;
+
+        for (j = 0; j < 16; j++) {
+            if (inorder) {
+                cstl_rbtree_foreach_inorder(&t, bench_rbtree_sum, &sum,
+                                            CSTL_BINTREE_FOREACH_DIR_FWD);
+            } else {
+                cstl_rbtree_foreach(&t, bench_rbtree_sum, &sum,
+                                    CSTL_BINTREE_FOREACH_DIR_FWD);
+            }
+        }
+        res = sum;
+    }
+
+    bench_stop_timer(ctx);
+    cstl_rbtree_clear(&t, bench_rbtree_nop, NULL);
+    free(e);
+    bench_start_timer(ctx);
+
+    (void)res;
+}
+
+void bench_rbtree_foreach(struct bench_context * const ctx,
+                          const unsigned long count)
+{
+    bench_rbtree_walk(ctx, count, false);
+}
+
+void bench_rbtree_foreach_inorder(struct bench_context * const ctx,
+                                  const unsigned long count)
+{
+    bench_rbtree_walk(ctx, count, true);
+}
+
+void bench_rbtree_clear(struct bench_context * const ctx,
+                        const unsigned long count)
+{
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        struct cstl_rbtree t;
+        struct bench_rbtree_elem * const e = bench_rbtree_fill(&t, 1 << 15);
+
+        bench_start_timer(ctx);
+        cstl_rbtree_clear(&t, bench_rbtree_nop, NULL);
+        bench_stop_timer(ctx);
+
+        free(e);
+    }
+
+    bench_start_timer(ctx);
+}
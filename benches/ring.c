@@ -0,0 +1,332 @@
+#include "internal/bench.h"
+#include "cstl/spsc.h"
+#include "cstl/mpmc.h"
+#include "cstl/dlist.h"
+#include "cstl/allocator.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * records passed between two pipeline stages on separate threads.
+ * the ring buffers are compared with a list behind a lock, with a
+ * node allocated for each record.
+ *
+ * the throughput benchmarks pass a fixed number of records from a
+ * producer to a consumer, in batches of the given size, and each
+ * iteration measures the time for all of them to get through. the
+ * latency benchmarks bounce a single record back and forth between
+ * two threads through a pair of queues, and each iteration measures
+ * a fixed number of round trips.
+ *
+ * a thread that finds its queue full (or empty) yields
+ */
+#define BENCH_RING_RECORDS      (1 << 20)
+#define BENCH_RING_TRIPS        (1 << 14)
+#define BENCH_RING_CAPACITY     1024
+#define BENCH_RING_BATCH        32
+
+enum bench_ring_kind
+{
+    BENCH_RING_SPSC,
+    BENCH_RING_MPMC,
+    BENCH_RING_LOCKED,
+};
+
+struct bench_ring_rec
+{
+    unsigned long seq;
+    unsigned int len, flags;
+};
+
+struct bench_ring_node
+{
+    struct bench_ring_rec r;
+    struct cstl_dlist_node ln;
+};
+
+struct bench_ring
+{
+    enum bench_ring_kind kind;
+
+    cstl_spsc_t spsc;
+    cstl_mpmc_t mpmc;
+
+    pthread_mutex_t lock;
+    struct cstl_dlist l;
+};
+
+static void bench_ring_init(struct bench_ring * const r,
+                            const enum bench_ring_kind kind)
+{
+    r->kind = kind;
+
+    cstl_spsc_init(&r->spsc, BENCH_RING_CAPACITY,
+                   sizeof(struct bench_ring_rec));
+    cstl_mpmc_init(&r->mpmc, BENCH_RING_CAPACITY,
+                   sizeof(struct bench_ring_rec));
+
+    pthread_mutex_init(&r->lock, NULL);
+    cstl_dlist_init(&r->l, offsetof(struct bench_ring_node, ln));
+}
+
+static void bench_ring_node_free(void * const e, void * const p)
+{
+    (void)p;
+    cstl_allocator_free(NULL, e, sizeof(struct bench_ring_node));
+}
+
+static void bench_ring_clear(struct bench_ring * const r)
+{
+    cstl_spsc_clear(&r->spsc);
+    cstl_mpmc_clear(&r->mpmc);
+
+    cstl_dlist_clear(&r->l, bench_ring_node_free);
+    pthread_mutex_destroy(&r->lock);
+}
+
+static size_t bench_ring_push(struct bench_ring * const r,
+                              const struct bench_ring_rec * const e,
+                              const size_t n)
+{
+    size_t i;
+
+    switch (r->kind) {
+    case BENCH_RING_SPSC:
+        return cstl_spsc_push(&r->spsc, e, n);
+    case BENCH_RING_MPMC:
+        return cstl_mpmc_push(&r->mpmc, e, n);
+    default:
+        pthread_mutex_lock(&r->lock);
+        for (i = 0; i < n; i++) {
+            struct bench_ring_node * const b =
+                cstl_allocator_alloc(NULL, sizeof(*b));
+
+            b->r = e[i];
+            cstl_dlist_push_back(&r->l, b);
+        }
+        pthread_mutex_unlock(&r->lock);
+        return n;
+    }
+}
+
+static size_t bench_ring_pop(struct bench_ring * const r,
+                             struct bench_ring_rec * const e,
+                             const size_t n)
+{
+    struct bench_ring_node * b;
+    size_t i;
+
+    switch (r->kind) {
+    case BENCH_RING_SPSC:
+        return cstl_spsc_pop(&r->spsc, e, n);
+    case BENCH_RING_MPMC:
+        return cstl_mpmc_pop(&r->mpmc, e, n);
+    default:
+        pthread_mutex_lock(&r->lock);
+        for (i = 0; i < n && (b = cstl_dlist_pop_front(&r->l)) != NULL; i++) {
+            e[i] = b->r;
+            bench_ring_node_free(b, NULL);
+        }
+        pthread_mutex_unlock(&r->lock);
+        return i;
+    }
+}
+
+/* push (or pop) all n records, yielding whenever no progress is made */
+static void bench_ring_send(struct bench_ring * const r,
+                            const struct bench_ring_rec * const e,
+                            const size_t n)
+{
+    size_t i = 0;
+
+    while (i < n) {
+        const size_t k = bench_ring_push(r, &e[i], n - i);
+
+        if (k == 0) {
+            sched_yield();
+        }
+        i += k;
+    }
+}
+
+static void bench_ring_recv(struct bench_ring * const r,
+                            struct bench_ring_rec * const e,
+                            const size_t n)
+{
+    size_t i = 0;
+
+    while (i < n) {
+        const size_t k = bench_ring_pop(r, &e[i], n - i);
+
+        if (k == 0) {
+            sched_yield();
+        }
+        i += k;
+    }
+}
+
+struct bench_ring_thread
+{
+    struct bench_ring * in, * out;
+    size_t batch;
+    unsigned long sum;
+};
+
+static void * bench_ring_producer(void * const arg)
+{
+    struct bench_ring_thread * const t = arg;
+    struct bench_ring_rec e[BENCH_RING_BATCH];
+    unsigned long i;
+
+    for (i = 0; i < BENCH_RING_RECORDS; i += t->batch) {
+        size_t j;
+
+        for (j = 0; j < t->batch; j++) {
+            e[j].seq = i + j;
+            e[j].len = (i + j) % 1500;
+            e[j].flags = 0;
+        }
+        bench_ring_send(t->out, e, t->batch);
+    }
+
+    return NULL;
+}
+
+static void * bench_ring_consumer(void * const arg)
+{
+    struct bench_ring_thread * const t = arg;
+    struct bench_ring_rec e[BENCH_RING_BATCH];
+    unsigned long i;
+
+    for (i = 0; i < BENCH_RING_RECORDS; i += t->batch) {
+        size_t j;
+
+        bench_ring_recv(t->in, e, t->batch);
+        for (j = 0; j < t->batch; j++) {
+            t->sum += e[j].len;
+        }
+    }
+
+    return NULL;
+}
+
+static void bench_ring_throughput(struct bench_context * const ctx,
+                                  const unsigned long count,
+                                  const enum bench_ring_kind kind,
+                                  const size_t batch)
+{
+    struct bench_ring r;
+    struct bench_ring_thread p, c;
+    pthread_t pth, cth;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    bench_ring_init(&r, kind);
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        memset(&p, 0, sizeof(p));
+        p.out = &r;
+        p.batch = batch;
+        c = p;
+        c.in = &r;
+
+        pthread_create(&cth, NULL, bench_ring_consumer, &c);
+        pthread_create(&pth, NULL, bench_ring_producer, &p);
+        pthread_join(pth, NULL);
+        pthread_join(cth, NULL);
+    }
+
+    bench_stop_timer(ctx);
+    bench_ring_clear(&r);
+    bench_start_timer(ctx);
+}
+
+#define BENCH_RING_THROUGHPUT(NAME, KIND, BATCH)                        \
+    void bench_ring_##NAME(                                             \
+        struct bench_context * const ctx, const unsigned long count)    \
+    {                                                                   \
+        bench_ring_throughput(ctx, count, KIND, BATCH);                 \
+    }
+
+BENCH_RING_THROUGHPUT(spsc, BENCH_RING_SPSC, 1)
+BENCH_RING_THROUGHPUT(spsc_batch, BENCH_RING_SPSC, BENCH_RING_BATCH)
+BENCH_RING_THROUGHPUT(mpmc, BENCH_RING_MPMC, 1)
+BENCH_RING_THROUGHPUT(mpmc_batch, BENCH_RING_MPMC, BENCH_RING_BATCH)
+BENCH_RING_THROUGHPUT(locked, BENCH_RING_LOCKED, 1)
+BENCH_RING_THROUGHPUT(locked_batch, BENCH_RING_LOCKED, BENCH_RING_BATCH)
+
+/* send each record straight back to where it came from */
+static void * bench_ring_echo(void * const arg)
+{
+    struct bench_ring_thread * const t = arg;
+    unsigned long i;
+
+    for (i = 0; i < BENCH_RING_TRIPS; i++) {
+        struct bench_ring_rec e;
+
+        bench_ring_recv(t->in, &e, 1);
+        bench_ring_send(t->out, &e, 1);
+    }
+
+    return NULL;
+}
+
+static void bench_ring_latency(struct bench_context * const ctx,
+                               const unsigned long count,
+                               const enum bench_ring_kind kind)
+{
+    struct bench_ring a, b;
+    struct bench_ring_thread t;
+    pthread_t th;
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+    bench_ring_init(&a, kind);
+    bench_ring_init(&b, kind);
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        unsigned long j;
+
+        memset(&t, 0, sizeof(t));
+        t.in = &a;
+        t.out = &b;
+        pthread_create(&th, NULL, bench_ring_echo, &t);
+
+        for (j = 0; j < BENCH_RING_TRIPS; j++) {
+            struct bench_ring_rec e;
+
+            e.seq = j;
+            bench_ring_send(&a, &e, 1);
+            bench_ring_recv(&b, &e, 1);
+        }
+
+        pthread_join(th, NULL);
+    }
+
+    bench_stop_timer(ctx);
+    bench_ring_clear(&b);
+    bench_ring_clear(&a);
+    bench_start_timer(ctx);
+}
+
+void bench_ring_pingpong_spsc(struct bench_context * const ctx,
+                              const unsigned long count)
+{
+    bench_ring_latency(ctx, count, BENCH_RING_SPSC);
+}
+
+void bench_ring_pingpong_mpmc(struct bench_context * const ctx,
+                              const unsigned long count)
+{
+    bench_ring_latency(ctx, count, BENCH_RING_MPMC);
+}
+
+void bench_ring_pingpong_locked(struct bench_context * const ctx,
+                                const unsigned long count)
+{
+    bench_ring_latency(ctx, count, BENCH_RING_LOCKED);
+}
@@ -0,0 +1,170 @@
+#include "internal/bench.h"
+#include "cstl/skipmap.h"
+#include "cstl/map.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+static int cmp_key(const void * const a, const void * const b, void * const p)
+{
+    (void)p;
+    return (uintptr_t)a - (uintptr_t)b;
+}
+
+/*
+ * each iteration performs a fixed number of operations on a map of
+ * 64k elements, drawn from 128k possible keys, divided evenly among
+ * the threads. each operation is a lookup, an insertion, or a removal
+ * of a random key, with the given percentage being lookups and the
+ * rest split evenly between insertions and removals so that the size
+ * of the map stays steady.
+ */
+#define BENCH_SKIPMAP_KEYS      (1 << 17)
+#define BENCH_SKIPMAP_OPS       (1 << 16)
+#define BENCH_SKIPMAP_THREADS   8
+
+struct bench_skipmap_thread
+{
+    cstl_skipmap_t * sm;
+
+    cstl_map_t * map;
+    pthread_mutex_t * lock;
+
+    unsigned int ops, reads;
+    unsigned int seed;
+};
+
+static void * bench_skipmap_thread(void * const arg)
+{
+    struct bench_skipmap_thread * const t = arg;
+    cstl_skipmap_handle_t * const h = cstl_skipmap_attach(t->sm);
+    unsigned int i;
+
+    for (i = 0; i < t->ops; i++) {
+        const unsigned int r = rand_r(&t->seed);
+        void * const k = (void *)(uintptr_t)(r % BENCH_SKIPMAP_KEYS + 1);
+        const unsigned int op = (r / BENCH_SKIPMAP_KEYS) % 100;
+
+        if (op < t->reads) {
+            cstl_skipmap_find(h, k, NULL);
+        } else if (op % 2 == 0) {
+            cstl_skipmap_insert(h, k, NULL);
+        } else {
+            cstl_skipmap_erase(h, k, NULL);
+        }
+    }
+
+    cstl_skipmap_detach(h);
+
+    return NULL;
+}
+
+/* the same workload on a cstl_map behind a single lock */
+static void * bench_skipmap_locked_thread(void * const arg)
+{
+    struct bench_skipmap_thread * const t = arg;
+    unsigned int i;
+
+    for (i = 0; i < t->ops; i++) {
+        const unsigned int r = rand_r(&t->seed);
+        void * const k = (void *)(uintptr_t)(r % BENCH_SKIPMAP_KEYS + 1);
+        const unsigned int op = (r / BENCH_SKIPMAP_KEYS) % 100;
+        cstl_map_iterator_t it;
+
+        pthread_mutex_lock(t->lock);
+        if (op < t->reads) {
+            cstl_map_find(t->map, k, &it);
+        } else if (op % 2 == 0) {
+            cstl_map_insert(t->map, k, NULL, NULL);
+        } else {
+            cstl_map_erase(t->map, k, NULL);
+        }
+        pthread_mutex_unlock(t->lock);
+    }
+
+    return NULL;
+}
+
+static void bench_skipmap(struct bench_context * const ctx,
+                          const unsigned long count,
+                          const unsigned int nthreads,
+                          const unsigned int reads,
+                          const bool locked)
+{
+    struct bench_skipmap_thread t[BENCH_SKIPMAP_THREADS];
+    pthread_t th[BENCH_SKIPMAP_THREADS];
+    pthread_mutex_t lock;
+    cstl_skipmap_handle_t * h;
+    cstl_skipmap_t sm;
+    cstl_map_t map;
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+
+    cstl_skipmap_init(&sm, cmp_key, NULL);
+    cstl_map_init(&map, cmp_key, NULL);
+    pthread_mutex_init(&lock, NULL);
+
+    /* fill the map with half of the possible keys */
+    h = cstl_skipmap_attach(&sm);
+    for (j = 0; j < BENCH_SKIPMAP_KEYS / 2;) {
+        void * const k =
+            (void *)(uintptr_t)(rand() % BENCH_SKIPMAP_KEYS + 1);
+
+        if ((locked
+             ? cstl_map_insert(&map, k, NULL, NULL)
+             : cstl_skipmap_insert(h, k, NULL)) == 0) {
+            j++;
+        }
+    }
+    cstl_skipmap_detach(h);
+
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < nthreads; j++) {
+            t[j].sm = &sm;
+            t[j].map = &map;
+            t[j].lock = &lock;
+            t[j].ops = BENCH_SKIPMAP_OPS / nthreads;
+            t[j].reads = reads;
+            t[j].seed = rand();
+
+            pthread_create(&th[j], NULL,
+                           locked
+                           ? bench_skipmap_locked_thread
+                           : bench_skipmap_thread,
+                           &t[j]);
+        }
+        for (j = 0; j < nthreads; j++) {
+            pthread_join(th[j], NULL);
+        }
+    }
+
+    bench_stop_timer(ctx);
+    pthread_mutex_destroy(&lock);
+    cstl_map_clear(&map, NULL, NULL);
+    cstl_skipmap_clear(&sm, NULL, NULL);
+    bench_start_timer(ctx);
+}
+
+#define BENCH_SKIPMAP(READS, THREADS)                                   \
+    void bench_skipmap_r##READS##_t##THREADS(                           \
+        struct bench_context * const ctx, const unsigned long count)    \
+    {                                                                   \
+        bench_skipmap(ctx, count, THREADS, READS, false);               \
+    }                                                                   \
+    void bench_skipmap_locked_r##READS##_t##THREADS(                    \
+        struct bench_context * const ctx, const unsigned long count)    \
+    {                                                                   \
+        bench_skipmap(ctx, count, THREADS, READS, true);                \
+    }
+
+BENCH_SKIPMAP(90, 1)
+BENCH_SKIPMAP(90, 2)
+BENCH_SKIPMAP(90, 4)
+BENCH_SKIPMAP(90, 8)
+BENCH_SKIPMAP(50, 1)
+BENCH_SKIPMAP(50, 2)
+BENCH_SKIPMAP(50, 4)
+BENCH_SKIPMAP(50, 8)
@@ -57,3 +57,75 @@ void bench_hsort(struct bench_context * const ctx, const unsigned long count)
 {
     bench_sort(ctx, count, CSTL_SORT_ALGORITHM_HEAP);
 }
+
+/*
+ * find the 100 least of a million scores: by sorting all of them,
+ * by partially sorting them, and by streaming them through a bounded
+ * heap. the time to fill the vector is excluded in each case
+ */
+#define BENCH_SELECT_N          (1 << 20)
+#define BENCH_SELECT_K          100
+
+static void bench_select(struct bench_context * const ctx,
+                         const unsigned long count,
+                         const int how)
+{
+    DECLARE_CSTL_VECTOR(v, int);
+    DECLARE_CSTL_VECTOR(top, int);
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+
+    cstl_vector_resize(&v, BENCH_SELECT_N);
+
+    for (i = 0; i < count; i++) {
+        unsigned int j;
+
+        for (j = 0; j < BENCH_SELECT_N; j++) {
+            *(int *)cstl_vector_at(&v, j) = rand() % BENCH_SELECT_N;
+        }
+
+        bench_start_timer(ctx);
+        switch (how) {
+        case 0:
+            cstl_vector_sort(&v, cmp_int, NULL);
+            break;
+        case 1:
+            cstl_vector_partial_sort(&v, BENCH_SELECT_K, cmp_int, NULL);
+            break;
+        case 2:
+            cstl_vector_resize(&top, 0);
+            for (j = 0; j < BENCH_SELECT_N; j++) {
+                cstl_vector_top_k_push(&top, BENCH_SELECT_K,
+                                       cstl_vector_at(&v, j),
+                                       cmp_int, NULL);
+            }
+            cstl_vector_top_k_sort(&top, cmp_int, NULL);
+            break;
+        }
+        bench_stop_timer(ctx);
+    }
+
+    cstl_vector_clear(&top);
+    cstl_vector_clear(&v);
+
+    bench_start_timer(ctx);
+}
+
+void bench_select_sort(struct bench_context * const ctx,
+                       const unsigned long count)
+{
+    bench_select(ctx, count, 0);
+}
+
+void bench_select_partial_sort(struct bench_context * const ctx,
+                               const unsigned long count)
+{
+    bench_select(ctx, count, 1);
+}
+
+void bench_select_top_k(struct bench_context * const ctx,
+                        const unsigned long count)
+{
+    bench_select(ctx, count, 2);
+}
@@ -0,0 +1,162 @@
+#include "internal/bench.h"
+#include "cstl/twheel.h"
+#include "cstl/heap.h"
+#include <stdlib.h>
+
+/*
+ * connection timeouts, each up to a minute away on a millisecond clock.
+ * the timer wheel is compared with the heap, ordered by expiration
+ */
+
+struct bench_timeout
+{
+    unsigned long expires;
+    struct cstl_twheel_node tn;
+    struct cstl_heap_node hn;
+};
+
+static int bench_timeout_cmp(const void * const _a, const void * const _b,
+                             void * const p)
+{
+    const struct bench_timeout * const a = _a;
+    const struct bench_timeout * const b = _b;
+
+    (void)p;
+
+    /* the earliest expiration is at the top */
+    return (a->expires < b->expires) - (a->expires > b->expires);
+}
+
+static void bench_timeout_expire(void * const e, void * const p)
+{
+    (void)e;
+    (*(unsigned long *)p)++;
+}
+
+/*
+ * schedule all of the timeouts and then cancel them all,
+ * as when every request completes before its timeout
+ */
+static void bench_twheel_cancel(struct bench_context * const ctx,
+                                const unsigned long count,
+                                const bool wheel)
+{
+    const unsigned int n = 1 << 18;
+    struct bench_timeout * const t = malloc(n * sizeof(*t));
+    struct cstl_twheel w;
+    struct cstl_heap h;
+    unsigned long i;
+    unsigned int j;
+
+    bench_stop_timer(ctx);
+
+    cstl_twheel_init(&w, offsetof(struct bench_timeout, tn), 0);
+    cstl_heap_init(&h, bench_timeout_cmp, NULL,
+                   offsetof(struct bench_timeout, hn));
+    for (j = 0; j < n; j++) {
+        t[j].expires = 1 + rand() % 60000;
+    }
+
+    bench_start_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        if (wheel) {
+            for (j = 0; j < n; j++) {
+                cstl_twheel_schedule(&w, &t[j], t[j].expires);
+            }
+            for (j = 0; j < n; j++) {
+                cstl_twheel_cancel(&w, &t[j]);
+            }
+        } else {
+            for (j = 0; j < n; j++) {
+                cstl_heap_push(&h, &t[j]);
+            }
+            for (j = 0; j < n; j++) {
+                cstl_heap_erase(&h, &t[j]);
+            }
+        }
+    }
+
+    bench_stop_timer(ctx);
+    free(t);
+    bench_start_timer(ctx);
+}
+
+void bench_twheel_cancel_wheel(struct bench_context * const ctx,
+                               const unsigned long count)
+{
+    bench_twheel_cancel(ctx, count, true);
+}
+
+void bench_twheel_cancel_heap(struct bench_context * const ctx,
+                              const unsigned long count)
+{
+    bench_twheel_cancel(ctx, count, false);
+}
+
+/*
+ * schedule all of the timeouts and then advance the
+ * clock a millisecond at a time until they've all expired
+ */
+static void bench_twheel_expire(struct bench_context * const ctx,
+                                const unsigned long count,
+                                const bool wheel)
+{
+    const unsigned int n = 1 << 18;
+    struct bench_timeout * const t = malloc(n * sizeof(*t));
+    unsigned long i;
+
+    bench_stop_timer(ctx);
+
+    for (i = 0; i < count; i++) {
+        struct cstl_twheel w;
+        struct cstl_heap h;
+        unsigned long now, fired;
+        unsigned int j;
+
+        cstl_twheel_init(&w, offsetof(struct bench_timeout, tn), 0);
+        cstl_heap_init(&h, bench_timeout_cmp, NULL,
+                       offsetof(struct bench_timeout, hn));
+        for (j = 0; j < n; j++) {
+            t[j].expires = 1 + rand() % 60000;
+        }
+
+        bench_start_timer(ctx);
+        fired = 0;
+        if (wheel) {
+            for (j = 0; j < n; j++) {
+                cstl_twheel_schedule(&w, &t[j], t[j].expires);
+            }
+            for (now = 1; cstl_twheel_size(&w) > 0; now++) {
+                cstl_twheel_advance(&w, now, bench_timeout_expire, &fired);
+            }
+        } else {
+            for (j = 0; j < n; j++) {
+                cstl_heap_push(&h, &t[j]);
+            }
+            for (now = 1; cstl_heap_size(&h) > 0; now++) {
+                const struct bench_timeout * e;
+
+                while ((e = cstl_heap_get(&h)) != NULL && e->expires <= now) {
+                    bench_timeout_expire(cstl_heap_pop(&h), &fired);
+                }
+            }
+        }
+        bench_stop_timer(ctx);
+    }
+
+    free(t);
+    bench_start_timer(ctx);
+}
+
+void bench_twheel_expire_wheel(struct bench_context * const ctx,
+                               const unsigned long count)
+{
+    bench_twheel_expire(ctx, count, true);
+}
+
+void bench_twheel_expire_heap(struct bench_context * const ctx,
+                              const unsigned long count)
+{
+    bench_twheel_expire(ctx, count, false);
+}
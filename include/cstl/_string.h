@@ -76,6 +76,26 @@ static inline void STRF(init, struct cstl_STRING * const s)
     cstl_vector_init(&s->v, sizeof(cstl_STRING_char_t));
 }
 
+/*!
+ * @brief Set the allocator used by the string
+ *
+ * The allocator may only be changed while the string holds no memory,
+ * i.e. after initialization and before any characters have been added
+ * or any capacity reserved, or after the string has been cleared. An
+ * attempt to change the allocator at any other time causes the
+ * program to abort.
+ *
+ * @param[in,out] s A pointer to the string object
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+static inline void STRF(set_allocator,
+                        struct cstl_STRING * const s,
+                        const cstl_allocator_t * const a)
+{
+    cstl_vector_set_allocator(&s->v, a);
+}
+
 /*!
  * @brief Get the number of characters in a string
  *
@@ -0,0 +1,186 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_ALLOCATOR_H
+#define CSTL_ALLOCATOR_H
+
+/*!
+ * @defgroup allocators Memory allocators
+ * @brief Objects that manage memory on behalf of other objects
+ */
+
+/*!
+ * @defgroup allocator Allocator interface
+ * @ingroup allocators
+ * @brief Pluggable memory allocation for the library's containers
+ *
+ * Every object in the library that allocates memory does so through
+ * an allocator object. By default, objects use the process-wide default
+ * allocator, which is initially backed by malloc(), realloc(), and free().
+ * The default may be replaced via cstl_allocator_set_default(), and most
+ * objects also allow an allocator to be set on a per-object basis.
+ *
+ * Unlike their standard library counterparts, the allocator's functions
+ * are told the size of the memory being reallocated or freed. This allows
+ * allocators that don't track the size of each allocation (e.g. pools
+ * and arenas) to be plugged in.
+ */
+/*!
+ * @addtogroup allocator
+ * @{
+ */
+
+#include "cstl/common.h"
+
+/*!
+ * @brief Function type for allocating memory
+ *
+ * @param[in] sz The number of bytes to allocate
+ * @param[in] priv The private pointer associated with the allocator
+ *
+ * @return A pointer to the allocated memory
+ * @retval NULL The memory could not be allocated
+ */
+typedef void * cstl_alloc_func_t(size_t sz, void * priv);
+
+/*!
+ * @brief Function type for resizing previously allocated memory
+ *
+ * @param[in] ptr A pointer to memory previously allocated by the
+ *                same allocator. This pointer is never NULL
+ * @param[in] osz The number of bytes previously allocated at @p ptr
+ * @param[in] nsz The number of bytes desired
+ * @param[in] priv The private pointer associated with the allocator
+ *
+ * The contents of the memory, up to the lesser of @p osz and @p nsz
+ * bytes, must be preserved.
+ *
+ * @return A pointer to the resized memory
+ * @retval NULL The memory could not be resized, and the
+ *              memory at @p ptr is unchanged
+ */
+typedef void * cstl_realloc_func_t(void * ptr, size_t osz, size_t nsz,
+                                   void * priv);
+
+/*!
+ * @brief Function type for freeing previously allocated memory
+ *
+ * @param[in] ptr A pointer to memory previously allocated by the
+ *                same allocator. This pointer is never NULL
+ * @param[in] sz The number of bytes allocated at @p ptr
+ * @param[in] priv The private pointer associated with the allocator
+ */
+typedef void cstl_free_func_t(void * ptr, size_t sz, void * priv);
+
+/*!
+ * @brief The allocator object
+ *
+ * The object must remain valid (and unchanged) for as long as
+ * any memory allocated through it remains allocated.
+ */
+typedef struct cstl_allocator
+{
+    /*! @brief Function used to allocate memory */
+    cstl_alloc_func_t * alloc;
+    /*! @brief Function used to resize memory */
+    cstl_realloc_func_t * realloc;
+    /*! @brief Function used to free memory */
+    cstl_free_func_t * free;
+    /*! @brief Pointer passed to each of the functions */
+    void * priv;
+} cstl_allocator_t;
+
+/*!
+ * @brief Constant initialization of an allocator object
+ *
+ * @param ALLOC A pointer to a function of type @p cstl_alloc_func_t
+ * @param REALLOC A pointer to a function of type @p cstl_realloc_func_t
+ * @param FREE A pointer to a function of type @p cstl_free_func_t
+ * @param PRIV A pointer to be passed to each of the functions
+ */
+#define CSTL_ALLOCATOR_INITIALIZER(ALLOC, REALLOC, FREE, PRIV)  \
+    {                                                           \
+        .alloc = ALLOC,                                         \
+        .realloc = REALLOC,                                     \
+        .free = FREE,                                           \
+        .priv = PRIV,                                           \
+    }
+
+/*!
+ * @brief Get the process-wide default allocator
+ *
+ * @return A pointer to the current default allocator
+ */
+const cstl_allocator_t * cstl_allocator_default(void);
+
+/*!
+ * @brief Set the process-wide default allocator
+ *
+ * Objects that have not been given an allocator of their own use the
+ * default allocator at the time that they allocate, resize, or free
+ * memory. As such, the default should be set before any such objects
+ * allocate memory, and it must not be changed while memory allocated
+ * via the default remains allocated.
+ *
+ * @param[in] a A pointer to the new default allocator. A value of
+ *              NULL restores the original, malloc()-based allocator
+ */
+void cstl_allocator_set_default(const cstl_allocator_t * a);
+
+/*!
+ * @name Allocation through an allocator
+ *
+ * These functions are used by the library's objects to call into an
+ * allocator. In each case, a NULL allocator refers to the process-wide
+ * default allocator.
+ *
+ * @{
+ */
+
+/*!
+ * @brief Allocate memory via an allocator
+ *
+ * @param[in] a A pointer to an allocator
+ * @param[in] sz The number of bytes to allocate
+ *
+ * @return A pointer to the allocated memory
+ * @retval NULL The memory could not be allocated
+ */
+void * cstl_allocator_alloc(const cstl_allocator_t * a, size_t sz);
+
+/*!
+ * @brief Resize memory via an allocator
+ *
+ * @param[in] a A pointer to an allocator
+ * @param[in] ptr A pointer to the memory to be resized. If this pointer
+ *                is NULL, the call is equivalent to cstl_allocator_alloc()
+ * @param[in] osz The number of bytes currently allocated at @p ptr
+ * @param[in] nsz The number of bytes desired
+ *
+ * @return A pointer to the resized memory
+ * @retval NULL The memory could not be resized, and the
+ *              memory at @p ptr is unchanged
+ */
+void * cstl_allocator_realloc(const cstl_allocator_t * a,
+                              void * ptr, size_t osz, size_t nsz);
+
+/*!
+ * @brief Free memory via an allocator
+ *
+ * @param[in] a A pointer to an allocator
+ * @param[in] ptr A pointer to the memory to be freed. This
+ *                pointer may be NULL
+ * @param[in] sz The number of bytes allocated at @p ptr
+ */
+void cstl_allocator_free(const cstl_allocator_t * a, void * ptr, size_t sz);
+
+/*!
+ * @}
+ */
+
+/*!
+ * @}
+ */
+
+#endif
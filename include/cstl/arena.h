@@ -0,0 +1,231 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_ARENA_H
+#define CSTL_ARENA_H
+
+/*!
+ * @defgroup arena Arena
+ * @ingroup allocators
+ * @brief Bump allocation from chained chunks with bulk release
+ *
+ * The arena hands out memory by advancing a pointer through large,
+ * contiguous chunks. When a chunk is exhausted, a new one is allocated
+ * and chained to the previous ones. Individual allocations are never
+ * returned to the system; instead, all of the memory in the arena is
+ * released at once, at a cost proportional to the number of chunks
+ * rather than the number of allocations.
+ *
+ * The arena provides an allocator object (see cstl_arena_allocator())
+ * that may be given to the library's containers. Containers built on
+ * an arena may then be discarded en masse by resetting or clearing
+ * the arena, e.g.:
+ * @code{.c}
+ * DECLARE_CSTL_ARENA(arena, 0);
+ * DECLARE_CSTL_VECTOR(v, int);
+ * cstl_map_t m;
+ *
+ * cstl_vector_set_allocator(&v, cstl_arena_allocator(&arena));
+ * cstl_map_init(&m, cmp, NULL);
+ * cstl_map_set_allocator(&m, cstl_arena_allocator(&arena));
+ *
+ * // use v and m
+ *
+ * // discard v, m, and all of their memory
+ * cstl_arena_reset(&arena);
+ * @endcode
+ *
+ * Once the arena has been reset or cleared, the containers built on
+ * it must not be cleared or otherwise used; they must be reinitialized.
+ */
+/*!
+ * @addtogroup arena
+ * @{
+ */
+
+#include "cstl/allocator.h"
+
+/*! @private */
+struct cstl_arena_chunk;
+
+/*!
+ * @brief Arena object
+ *
+ * Callers declare or allocate an object of this type to instantiate
+ * an arena. Users are encouraged to declare (and initialize) this
+ * object with the DECLARE_CSTL_ARENA() macro. Any other declaration or
+ * allocation must be initialized via cstl_arena_init().
+ *
+ * Because the arena's allocator object refers to the arena itself,
+ * the arena must not be moved or copied once initialized.
+ */
+struct cstl_arena
+{
+    /*! @privatesection */
+    /*
+     * list of chunks, most recently allocated first. allocations
+     * are carved from the range [@next, @end) within the first chunk
+     */
+    struct cstl_arena_chunk * chunk;
+    void * next, * end;
+    /*
+     * the most recent allocation. only this allocation can
+     * be resized in place or have its memory reclaimed
+     */
+    void * last;
+
+    /* the number of usable bytes in each (normal) chunk */
+    size_t size;
+
+    /* the allocator from which chunks are obtained */
+    const cstl_allocator_t * allocator;
+    /* the allocator interface that allocates from this arena */
+    cstl_allocator_t a;
+};
+
+/*! @private */
+void * __cstl_arena_alloc(size_t, void *);
+/*! @private */
+void * __cstl_arena_realloc(void *, size_t, size_t, void *);
+/*! @private */
+void __cstl_arena_free(void *, size_t, void *);
+
+/*!
+ * @brief Constant initialization of an arena object
+ *
+ * @param NAME The name of the object being initialized
+ * @param SIZE The number of bytes to allocate per chunk. A value
+ *             of zero selects a default size
+ */
+#define CSTL_ARENA_INITIALIZER(NAME, SIZE)                      \
+    {                                                           \
+        .chunk = NULL,                                          \
+        .next = NULL,                                           \
+        .end = NULL,                                            \
+        .last = NULL,                                           \
+        .size = SIZE,                                           \
+        .allocator = NULL,                                      \
+        .a = CSTL_ALLOCATOR_INITIALIZER(__cstl_arena_alloc,     \
+                                        __cstl_arena_realloc,   \
+                                        __cstl_arena_free,      \
+                                        &NAME),                 \
+    }
+/*!
+ * @brief (Statically) declare and initialize an arena
+ *
+ * @param NAME The name of the variable being declared
+ * @param SIZE The number of bytes to allocate per chunk. A value
+ *             of zero selects a default size
+ */
+#define DECLARE_CSTL_ARENA(NAME, SIZE)                          \
+    struct cstl_arena NAME = CSTL_ARENA_INITIALIZER(NAME, SIZE)
+
+/*!
+ * @brief Initialize an arena object
+ *
+ * @param[out] arena A pointer to the object to be initialized
+ * @param[in] size The number of bytes to allocate per chunk. A value
+ *                 of zero selects a default size
+ */
+static inline void cstl_arena_init(struct cstl_arena * const arena,
+                                   const size_t size)
+{
+    arena->chunk = NULL;
+    arena->next = NULL;
+    arena->end = NULL;
+    arena->last = NULL;
+
+    arena->size = size;
+
+    arena->allocator = NULL;
+
+    arena->a.alloc = __cstl_arena_alloc;
+    arena->a.realloc = __cstl_arena_realloc;
+    arena->a.free = __cstl_arena_free;
+    arena->a.priv = arena;
+}
+
+/*!
+ * @brief Set the allocator from which the arena obtains its chunks
+ *
+ * The allocator may only be changed while the arena holds no chunks.
+ * Any attempt to change the allocator at any other time causes the
+ * program to abort.
+ *
+ * @param[in,out] arena A pointer to the arena
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+void cstl_arena_set_allocator(struct cstl_arena * arena,
+                              const cstl_allocator_t * a);
+
+/*!
+ * @brief Get an allocator that allocates from the arena
+ *
+ * The returned allocator may be given to any of the library's
+ * objects that accept an allocator. Memory "freed" via the allocator
+ * is only reclaimed if it was the arena's most recent allocation;
+ * otherwise it remains allocated until the arena is reset or cleared.
+ * Similarly, reallocations are performed in place when the memory
+ * is the arena's most recent allocation and the current chunk has
+ * enough room.
+ *
+ * @param[in] arena A pointer to the arena
+ *
+ * @return A pointer to an allocator that is valid for
+ *         the lifetime of the arena
+ */
+static inline const cstl_allocator_t * cstl_arena_allocator(
+    const struct cstl_arena * const arena)
+{
+    return &arena->a;
+}
+
+/*!
+ * @brief Allocate memory from the arena
+ *
+ * The returned memory is uninitialized and is suitably aligned
+ * for any type of object.
+ *
+ * @param[in] arena A pointer to the arena
+ * @param[in] sz The number of bytes to allocate
+ *
+ * @return A pointer to the allocated memory
+ * @retval NULL The arena was unable to allocate a new chunk
+ */
+static inline void * cstl_arena_alloc(struct cstl_arena * const arena,
+                                      const size_t sz)
+{
+    return __cstl_arena_alloc(sz, arena);
+}
+
+/*!
+ * @brief Discard all allocations, retaining memory for reuse
+ *
+ * All allocations made from the arena become invalid. The most
+ * recently allocated chunk is kept so that the arena can satisfy
+ * subsequent allocations without going back to its allocator;
+ * all other chunks are released.
+ *
+ * @param[in] arena A pointer to the arena
+ */
+void cstl_arena_reset(struct cstl_arena * arena);
+
+/*!
+ * @brief Release all memory held by the arena
+ *
+ * All allocations made from the arena become invalid, and all
+ * chunks are returned to the arena's allocator. The arena is as it
+ * was immediately after initialization, except that its allocator
+ * is retained.
+ *
+ * @param[in] arena A pointer to the arena
+ */
+void cstl_arena_clear(struct cstl_arena * arena);
+
+/*!
+ * @}
+ */
+
+#endif
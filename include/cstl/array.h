@@ -278,6 +278,116 @@ void cstl_raw_array_sort(
     cstl_swap_func_t * swap, void * tmp,
     cstl_sort_algorithm_t algo);
 
+/*!
+ * @brief Partially order the array around its n-th element
+ *
+ * Upon return, the element at index @p n is the element that would be
+ * there if the array were sorted. No element before it is greater than
+ * it, and no element after it is less than it; the elements on either
+ * side are otherwise in no particular order.
+ *
+ * The function uses quickselect, falling back to a heapsort of the
+ * remaining elements if its choices of pivot are consistently poor.
+ * The expected time is linear in the number of elements, and the
+ * worst case time is O(n log n).
+ *
+ * @param[in,out] arr A pointer to the first element in an array
+ * @param[in] count The number of elements in the array
+ * @param[in] size The size of each element in the array
+ * @param[in] n The index of the element to be put in its sorted position.
+ *              If the index is outside the array, the function aborts
+ * @param[in] cmp A pointer to a function to compare elements
+ * @param[in] priv A pointer to be passed to the comparison function
+ * @param[in] swap A pointer to a function to swap elements in the array
+ * @param tmp A pointer to scratch space to be used by the swap function
+ */
+void cstl_raw_array_nth_element(
+    void * arr, size_t count, size_t size,
+    size_t n,
+    cstl_compare_func_t * cmp, void * priv,
+    cstl_swap_func_t * swap, void * tmp);
+
+/*!
+ * @brief Sort the least elements of the array
+ *
+ * Upon return, the first @p k elements of the array are the least
+ * elements of the array, in sorted order. The remaining elements are
+ * in no particular order. The least elements are found as with
+ * cstl_raw_array_nth_element(), so only they are sorted, which is
+ * much less work than sorting the whole array when @p k is small.
+ *
+ * @param[in,out] arr A pointer to the first element in an array
+ * @param[in] count The number of elements in the array
+ * @param[in] size The size of each element in the array
+ * @param[in] k The number of elements to be sorted. If the number is
+ *              greater than @p count, the function aborts
+ * @param[in] cmp A pointer to a function to compare elements
+ * @param[in] priv A pointer to be passed to the comparison function
+ * @param[in] swap A pointer to a function to swap elements in the array
+ * @param tmp A pointer to scratch space to be used by the swap function
+ */
+void cstl_raw_array_partial_sort(
+    void * arr, size_t count, size_t size,
+    size_t k,
+    cstl_compare_func_t * cmp, void * priv,
+    cstl_swap_func_t * swap, void * tmp);
+
+/*!
+ * @brief Offer an element to a bounded collection of the least elements
+ *
+ * The function keeps the @p k least elements of a stream of elements,
+ * e.g. too many to be held in memory at once, in an array with room
+ * for @p k elements. The array is maintained as a heap, so each element
+ * is accepted or rejected in O(log k) time, and most are rejected in
+ * constant time once the array is full. The array begins empty,
+ * and when the stream ends, the elements kept can be put in order with
+ * cstl_raw_array_top_k_sort().
+ *
+ * The offered element is exchanged, via the @p swap function, with the
+ * element it replaces, if any. Upon return, @p e refers to the element
+ * that was displaced from the array, to the contents of the unused
+ * array slot if the array was not full, or, if the element was not
+ * accepted, to the offered element itself.
+ *
+ * @param[in,out] arr A pointer to the first element in an array
+ * @param[in] count The number of elements currently held in the array
+ * @param[in] size The size of each element in the array
+ * @param[in] k The maximum number of elements to be held in the array.
+ *              If @p count is greater than this number, the function
+ *              aborts
+ * @param[in,out] e A pointer to the offered element
+ * @param[in] cmp A pointer to a function to compare elements
+ * @param[in] priv A pointer to be passed to the comparison function
+ * @param[in] swap A pointer to a function to swap elements in the array
+ * @param tmp A pointer to scratch space to be used by the swap function
+ *
+ * @return The number of elements held in the array
+ */
+size_t cstl_raw_array_top_k_push(
+    void * arr, size_t count, size_t size,
+    size_t k, void * e,
+    cstl_compare_func_t * cmp, void * priv,
+    cstl_swap_func_t * swap, void * tmp);
+
+/*!
+ * @brief Sort the elements collected by cstl_raw_array_top_k_push()
+ *
+ * After the function returns, the array is sorted and is no longer
+ * suitable for use with cstl_raw_array_top_k_push().
+ *
+ * @param[in,out] arr A pointer to the first element in an array
+ * @param[in] count The number of elements held in the array
+ * @param[in] size The size of each element in the array
+ * @param[in] cmp A pointer to a function to compare elements
+ * @param[in] priv A pointer to be passed to the comparison function
+ * @param[in] swap A pointer to a function to swap elements in the array
+ * @param tmp A pointer to scratch space to be used by the swap function
+ */
+void cstl_raw_array_top_k_sort(
+    void * arr, size_t count, size_t size,
+    cstl_compare_func_t * cmp, void * priv,
+    cstl_swap_func_t * swap, void * tmp);
+
 /*!
  * @}
  */
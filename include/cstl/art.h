@@ -0,0 +1,234 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_ART_H
+#define CSTL_ART_H
+
+/*!
+ * @defgroup art Radix tree
+ * @ingroup highlevel
+ * @brief An ordered map keyed by strings of bytes
+ *
+ * The radix tree is a container of key/value pairs with unique keys,
+ * like the @ref map. Its keys, however, are always strings of bytes,
+ * and the keys are ordered byte by byte, as if by memcmp(), with a key
+ * ordered before any longer key that begins with it. (For narrow strings,
+ * this is the same order as given by strcmp().)
+ *
+ * Rather than comparing whole keys at each level, as the map does, the
+ * tree consumes one byte of the sought key at each level, so the time
+ * taken to find a key depends on the length of the key rather than on
+ * the number of keys in the tree. The tree is an "adaptive" radix tree
+ * (Leis et al.): each interior node is one of four sizes, holding up to
+ * 4, 16, 48, or 256 children, and nodes grow and shrink as children are
+ * added and removed. Chains of nodes with only a single child are
+ * collapsed into a prefix stored in the node below them, so long keys
+ * that share long prefixes, such as paths, do not cost a node per byte.
+ *
+ * The tree copies each key into the element that holds it, so the
+ * caller's key need not outlive the call that inserted it. The tree
+ * does not manage the memory for the values that it holds.
+ */
+/*!
+ * @addtogroup art
+ * @{
+ */
+
+#include "cstl/common.h"
+#include "cstl/allocator.h"
+#include "cstl/string.h"
+
+/*!
+ * @brief A key/value pair within the tree
+ */
+typedef struct
+{
+    /*! @brief Pointer to the tree's copy of the key */
+    const void * key;
+    /*! @brief The number of bytes in the key */
+    size_t len;
+    /*! @brief Pointer to the value associated with the key */
+    void * val;
+} cstl_art_elem_t;
+
+/*!
+ * @brief The radix tree object
+ *
+ * The tree may be declared on the stack or allocated. In either
+ * case, it must be initialized via cstl_art_init(). The tree must be
+ * cleared with cstl_art_clear() to release the memory held by it.
+ */
+typedef struct
+{
+    /*! @privatesection */
+    /* the root node or leaf, or NULL if the tree is empty */
+    void * root;
+    size_t size;
+
+    /* the allocator from which the tree's nodes are allocated */
+    const cstl_allocator_t * allocator;
+} cstl_art_t;
+
+/*!
+ * @brief Initialize a radix tree
+ *
+ * @param[out] art A pointer to the tree to be initialized
+ */
+void cstl_art_init(cstl_art_t * art);
+
+/*!
+ * @brief Set the allocator from which the tree's nodes are allocated
+ *
+ * The tree must be empty when this function is called; otherwise,
+ * the function will cause an abort.
+ *
+ * @param[in,out] art A pointer to the tree
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+void cstl_art_set_allocator(cstl_art_t * art, const cstl_allocator_t * a);
+
+/*!
+ * @brief Return the number of elements in the tree
+ *
+ * @param[in] art A pointer to the tree
+ *
+ * @return The number of elements in the tree
+ */
+static inline size_t cstl_art_size(const cstl_art_t * const art)
+{
+    return art->size;
+}
+
+/*!
+ * @brief Insert a key/value pair into the tree
+ *
+ * @param[in] art A pointer to the tree
+ * @param[in] key A pointer to the key, which is copied into the tree
+ * @param[in] len The number of bytes in the key
+ * @param[in] val A pointer to the value
+ *
+ * @retval -1 The function failed to allocate memory; the tree is unchanged
+ * @retval 0 The pair was inserted
+ * @retval 1 An element with the same key already exists in the tree.
+ *           The tree is unchanged
+ */
+int cstl_art_insert(cstl_art_t * art,
+                    const void * key, size_t len, void * val);
+
+/*!
+ * @brief Insert a key/value pair into the tree, using a string as the key
+ *
+ * The key consists of the characters of the string,
+ * not including the terminating nul character.
+ *
+ * @see cstl_art_insert()
+ */
+static inline int cstl_art_insert_string(cstl_art_t * const art,
+                                         const cstl_string_t * const s,
+                                         void * const val)
+{
+    return cstl_art_insert(art, cstl_string_str(s), cstl_string_size(s), val);
+}
+
+/*!
+ * @brief Find the element with the supplied key
+ *
+ * @param[in] art A pointer to the tree
+ * @param[in] key A pointer to the key that is sought
+ * @param[in] len The number of bytes in the key
+ *
+ * @return A pointer to the element containing the key, which remains
+ *         valid until the element is removed from the tree
+ * @retval NULL The key is not in the tree
+ */
+const cstl_art_elem_t * cstl_art_find(const cstl_art_t * art,
+                                      const void * key, size_t len);
+
+/*!
+ * @brief Find the element whose key is the supplied string
+ *
+ * @see cstl_art_find()
+ */
+static inline const cstl_art_elem_t * cstl_art_find_string(
+    const cstl_art_t * const art, const cstl_string_t * const s)
+{
+    return cstl_art_find(art, cstl_string_str(s), cstl_string_size(s));
+}
+
+/*!
+ * @brief Remove the element with the supplied key from the tree
+ *
+ * @param[in] art A pointer to the tree
+ * @param[in] key A pointer to the key to be removed
+ * @param[in] len The number of bytes in the key
+ * @param[out] val A pointer to receive the value that was associated
+ *                 with the key. The pointer may be NULL
+ *
+ * @retval 0 The element was removed
+ * @retval 1 No element with the supplied key exists in the tree
+ */
+int cstl_art_erase(cstl_art_t * art,
+                   const void * key, size_t len, void ** val);
+
+/*!
+ * @brief Remove the element whose key is the supplied string
+ *
+ * @see cstl_art_erase()
+ */
+static inline int cstl_art_erase_string(cstl_art_t * const art,
+                                        const cstl_string_t * const s,
+                                        void ** const val)
+{
+    return cstl_art_erase(art, cstl_string_str(s), cstl_string_size(s), val);
+}
+
+/*!
+ * @brief Visit, in order, each element whose key begins with a prefix
+ *
+ * @param[in] art A pointer to the tree
+ * @param[in] pfx A pointer to the prefix
+ * @param[in] len The number of bytes in the prefix. A value of zero
+ *                causes every element in the tree to be visited, in
+ *                which case @p pfx may be NULL
+ * @param[in] visit A function to be called for each element. The first
+ *                  argument to the function is a pointer to a
+ *                  (const) @p cstl_art_elem_t
+ * @param[in] priv A pointer to be passed to each invocation of @p visit
+ *
+ * @return The value returned by the @p visit function that stopped the
+ *         walk, or 0 if all elements were visited
+ */
+int cstl_art_foreach_prefix(const cstl_art_t * art,
+                            const void * pfx, size_t len,
+                            cstl_const_visit_func_t * visit, void * priv);
+
+/*!
+ * @brief Visit each element in the tree, in order
+ *
+ * @see cstl_art_foreach_prefix()
+ */
+static inline int cstl_art_foreach(const cstl_art_t * const art,
+                                   cstl_const_visit_func_t * const visit,
+                                   void * const priv)
+{
+    return cstl_art_foreach_prefix(art, NULL, 0, visit, priv);
+}
+
+/*!
+ * @brief Remove all elements from the tree and free all of its memory
+ *
+ * @param[in,out] art A pointer to the tree
+ * @param[in] clr A function to be called for each element in the tree.
+ *                The first argument to the function is a pointer to a
+ *                @p cstl_art_elem_t. The pointer may be NULL
+ * @param[in] priv A pointer to be passed to each invocation of @p clr
+ */
+void cstl_art_clear(cstl_art_t * art, cstl_xtor_func_t * clr, void * priv);
+
+/*!
+ * @}
+ */
+
+#endif
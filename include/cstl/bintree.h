@@ -24,6 +24,8 @@
 #include "cstl/common.h"
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 /*!
  * @brief Node to anchor an element within a binary tree
@@ -48,7 +50,14 @@
 struct cstl_bintree_node
 {
     /*! @privatesection */
-    struct cstl_bintree_node * p, * l, * r;
+    /*
+     * pointer to the parent node. nodes are always at least pointer
+     * aligned, so the lowest bit of the address is zero. that bit is
+     * set aside as a flag for trees built on top of this one, e.g. the
+     * red-black tree keeps each node's color there
+     */
+    uintptr_t p;
+    struct cstl_bintree_node * l, * r;
 };
 
 /*!
@@ -74,6 +83,22 @@ struct cstl_bintree
     } cmp;
 };
 
+/*!
+ * @private
+ *
+ * Constant initialization of a cstl_bintree object whose nodes
+ * are found @p OFF bytes from the start of each element
+ */
+#define _CSTL_BINTREE_INITIALIZER(OFF, CMP, PRIV)       \
+    {                                                   \
+        .root = NULL,                                   \
+        .size = 0,                                      \
+        .off = OFF,                                     \
+        .cmp = {                                        \
+            .func = CMP,                                \
+            .priv = PRIV                                \
+        }                                               \
+    }
 /*!
  * @brief Constant initialization of a cstl_bintree object
  *
@@ -87,16 +112,8 @@ struct cstl_bintree
  * @see cstl_bintree_node for a description of the relationship between
  *                        @p TYPE and @p MEMB
  */
-#define CSTL_BINTREE_INITIALIZER(TYPE, MEMB, CMP, PRIV) \
-    {                                                   \
-        .root = NULL,                                   \
-        .size = 0,                                      \
-        .off = offsetof(TYPE, MEMB),                    \
-        .cmp = {                                        \
-            .func = CMP,                                \
-            .priv = PRIV                                \
-        }                                               \
-    }
+#define CSTL_BINTREE_INITIALIZER(TYPE, MEMB, CMP, PRIV)         \
+    _CSTL_BINTREE_INITIALIZER(offsetof(TYPE, MEMB), CMP, PRIV)
 /*!
  * @brief (Statically) declare and initialize a binary tree
  *
@@ -191,6 +208,63 @@ void cstl_bintree_insert(struct cstl_bintree * bt, void * e, void * p);
 const void * cstl_bintree_find(
     const struct cstl_bintree * bt, const void * e, const void ** p);
 
+/*!
+ * @brief Find the first element in the tree that is not less than
+ *        a given object
+ *
+ * @param[in] bt A pointer to the binary tree
+ * @param[in] e A pointer to an object to compare to those in the tree
+ *
+ * @return A pointer to the left-most element in the tree that compares
+ *         as greater than or equal to @p e
+ * @retval NULL All elements in the tree are less than @p e
+ */
+const void * cstl_bintree_lower_bound(
+    const struct cstl_bintree * bt, const void * e);
+
+/*!
+ * @brief Find the first element in the tree that is greater than
+ *        a given object
+ *
+ * @param[in] bt A pointer to the binary tree
+ * @param[in] e A pointer to an object to compare to those in the tree
+ *
+ * @return A pointer to the left-most element in the tree that compares
+ *         as greater than @p e
+ * @retval NULL No element in the tree is greater than @p e
+ */
+const void * cstl_bintree_upper_bound(
+    const struct cstl_bintree * bt, const void * e);
+
+/*!
+ * @brief Get the element that follows another in the tree
+ *
+ * @param[in] bt A pointer to the binary tree
+ * @param[in] e A pointer to an element in the tree. If this pointer is
+ *              NULL, the first element in the tree is returned
+ *
+ * Stepping through the tree this way visits each element once and
+ * costs O(1) per element, amortized over a walk of the whole tree.
+ *
+ * @return A pointer to the element immediately following @p e
+ * @retval NULL @p e is the last element in the tree (or the tree is empty)
+ */
+const void * cstl_bintree_next(
+    const struct cstl_bintree * bt, const void * e);
+
+/*!
+ * @brief Get the element that precedes another in the tree
+ *
+ * @param[in] bt A pointer to the binary tree
+ * @param[in] e A pointer to an element in the tree. If this pointer is
+ *              NULL, the last element in the tree is returned
+ *
+ * @return A pointer to the element immediately preceding @p e
+ * @retval NULL @p e is the first element in the tree (or the tree is empty)
+ */
+const void * cstl_bintree_prev(
+    const struct cstl_bintree * bt, const void * e);
+
 /*!
  * @brief Remove an element from the tree
  *
@@ -314,12 +388,41 @@ typedef int cstl_bintree_const_visit_func_t(
  * non-zero value, no more elements are visited, and the function returns
  * the non-zero value that halted visitations.
  *
+ * The traversal recurses only as deep as twice the base-2 logarithm
+ * of the number of elements in the tree; any part of the tree below
+ * that depth is walked iteratively, in a constant amount of stack
+ * space, so a degenerate tree cannot exhaust the stack.
+ *
  * @see cstl_bintree_visit_order_t
  */
 int cstl_bintree_foreach(const struct cstl_bintree * bt,
                          cstl_bintree_const_visit_func_t * visit, void * priv,
                          cstl_bintree_foreach_dir_t dir);
 
+/*!
+ * @brief Visit each element in a tree, in order, calling a user-defined
+ *        function once for each element
+ *
+ * @param[in] bt A pointer to the binary tree
+ * @param[in] visit A pointer to a function to be called for each element
+ * @param[in] priv A pointer to a private data structure that will be passed
+ *                 to each call to @p visit
+ * @param[in] dir The direction in which to traverse the tree
+ *
+ * This function is like cstl_bintree_foreach() except that only the
+ * in-order visits are made: the @p visit function is called exactly
+ * once for each element, with an order of either
+ * @p CSTL_BINTREE_VISIT_ORDER_MID or @p CSTL_BINTREE_VISIT_ORDER_LEAF.
+ * Callers that only act on those visits should prefer this function
+ * as it makes a third as many calls to @p visit.
+ *
+ * @see cstl_bintree_foreach
+ */
+int cstl_bintree_foreach_inorder(const struct cstl_bintree * bt,
+                                 cstl_bintree_const_visit_func_t * visit,
+                                 void * priv,
+                                 cstl_bintree_foreach_dir_t dir);
+
 /*!
  * @brief Determine the maximum and minimum heights of a tree
  *
@@ -359,6 +462,44 @@ struct cstl_bintree_node ** __cstl_bintree_right(
     return &n->r;
 }
 
+/*! @private */
+#define __CSTL_BINTREE_FLAG     ((uintptr_t)1)
+
+/*! @private */
+static inline
+struct cstl_bintree_node * __cstl_bintree_parent(
+    const struct cstl_bintree_node * const n)
+{
+    return (struct cstl_bintree_node *)(n->p & ~__CSTL_BINTREE_FLAG);
+}
+
+/*!
+ * @private
+ *
+ * change the node's parent, leaving the flag as it was
+ */
+static inline
+void __cstl_bintree_set_parent(struct cstl_bintree_node * const n,
+                               const struct cstl_bintree_node * const p)
+{
+    n->p = (uintptr_t)p | (n->p & __CSTL_BINTREE_FLAG);
+}
+
+/*! @private */
+static inline
+bool __cstl_bintree_flag(const struct cstl_bintree_node * const n)
+{
+    return (n->p & __CSTL_BINTREE_FLAG) != 0;
+}
+
+/*! @private */
+static inline
+void __cstl_bintree_set_flag(struct cstl_bintree_node * const n,
+                             const bool f)
+{
+    n->p = (n->p & ~__CSTL_BINTREE_FLAG) | (f ? __CSTL_BINTREE_FLAG : 0);
+}
+
 /*! @private */
 void __cstl_bintree_rotate(struct cstl_bintree *,
                            struct cstl_bintree_node *,
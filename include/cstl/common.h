@@ -179,4 +179,12 @@ int cstl_fls(unsigned long);
  */
 #define CSTL_MAX_T(T, A, B)     (((T)A >= (T)B) ? (T)A : (T)B)
 
+/*!
+ * @brief The (assumed) size of a cache line, in bytes
+ *
+ * Data written by different threads is kept at least this far apart,
+ * so that the threads don't contend for the same line.
+ */
+#define CSTL_CACHE_LINE         64
+
 #endif
@@ -0,0 +1,322 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_DEQUE_H
+#define CSTL_DEQUE_H
+
+/*!
+ * @defgroup deque Double-ended queue
+ * @ingroup highlevel
+ * @brief Variable-sized array that grows and shrinks at both ends
+ *
+ * The deque stores its elements in fixed-size blocks of memory, each
+ * holding a number of contiguous elements, and keeps a "map" of pointers
+ * to the blocks in order. Elements are added to and removed from either
+ * end in constant time, and any element can be reached by its index in
+ * constant time by way of the map. Unlike a vector, the elements never
+ * move once they have been added, and adding an element only allocates
+ * memory when a new block is needed. Unlike a list, the deque incurs no
+ * per-element memory overhead, and neighboring elements share cache
+ * lines.
+ *
+ * As with the @ref vector, construction and destruction of elements
+ * is optional and is done via the functions passed to
+ * cstl_deque_init_complex(). Elements are constructed when they are
+ * added to the deque and destroyed when they are removed from it.
+ */
+/*!
+ * @addtogroup deque
+ * @{
+ */
+
+#include "cstl/common.h"
+#include "cstl/allocator.h"
+
+/*!
+ * @brief Deque object
+ *
+ * Callers declare or allocate an object of this type to instantiate
+ * a deque. Users are encouraged to declare (and initialize) this
+ * object with the DECLARE_CSTL_DEQUE() macro. Any other declaration or
+ * allocation must be initialized via cstl_deque_init().
+ */
+typedef struct cstl_deque
+{
+    /*! @privatesection */
+    struct
+    {
+        /*! @privatesection */
+        size_t size;
+
+        struct
+        {
+            /*! @privatesection */
+            cstl_xtor_func_t * cons, * dest;
+            void * priv;
+        } xtor;
+    } elem;
+
+    struct
+    {
+        /*! @privatesection */
+        /*
+         * a circular array of pointers to the blocks
+         * in use, cap is zero or a power of two
+         */
+        void ** base;
+        size_t cap, beg, count;
+    } map;
+    /* an empty block held back for reuse */
+    void * spare;
+    /* log2 of the number of elements in each block */
+    unsigned int shift;
+
+    /*
+     * the index of the first element within the
+     * first block and the number of elements
+     */
+    size_t off, count;
+
+    const cstl_allocator_t * allocator;
+} cstl_deque_t;
+
+/*!
+ * @brief Constant initialization of a deque object
+ *
+ * @param TYPE The type of object that the deque will hold
+ */
+#define CSTL_DEQUE_INITIALIZER(TYPE)            \
+    {                                           \
+        .elem = {                               \
+            .size = sizeof(TYPE),               \
+            .xtor = {                           \
+                .cons = NULL,                   \
+                .dest = NULL,                   \
+                .priv = NULL,                   \
+            },                                  \
+        },                                      \
+        .map = {                                \
+            .base = NULL,                       \
+            .cap = 0,                           \
+            .beg = 0,                           \
+            .count = 0,                         \
+        },                                      \
+        .spare = NULL,                          \
+        .shift = 0,                             \
+        .off = 0,                               \
+        .count = 0,                             \
+        .allocator = NULL,                      \
+    }
+/*!
+ * @brief (Statically) declare and initialize a deque
+ *
+ * @param NAME The name of the variable being declared
+ * @param TYPE The type of object that the deque will hold
+ */
+#define DECLARE_CSTL_DEQUE(NAME, TYPE)                          \
+    struct cstl_deque NAME = CSTL_DEQUE_INITIALIZER(TYPE)
+
+/*!
+ * @brief Initialize a deque object
+ *
+ * This function is used when construction and/or destruction of
+ * objects in the deque, as they are added and removed, is necessary.
+ * Any or all of the construction/destruction parameters may be NULL.
+ *
+ * @param[in,out] d A pointer to the deque object
+ * @param[in] sz The size of the type of object that will be
+ *               stored in the deque
+ * @param[in] cons A pointer to a function to call for each element as
+ *                 it is added to the deque
+ * @param[in] dest A pointer to a function to call for each element as
+ *                 it is removed from the deque
+ * @param[in] priv A pointer to be passed to each call to @p cons or @p dest
+ */
+static inline void cstl_deque_init_complex(
+    struct cstl_deque * const d, const size_t sz,
+    cstl_xtor_func_t * const cons, cstl_xtor_func_t * const dest,
+    void * const priv)
+{
+    d->elem.size = sz;
+
+    d->elem.xtor.cons = cons;
+    d->elem.xtor.dest = dest;
+    d->elem.xtor.priv = priv;
+
+    d->map.base = NULL;
+    d->map.cap = 0;
+    d->map.beg = 0;
+    d->map.count = 0;
+
+    d->spare = NULL;
+    d->shift = 0;
+
+    d->off = 0;
+    d->count = 0;
+
+    d->allocator = NULL;
+}
+
+/*!
+ * @brief Initialize a deque object
+ *
+ * @param[in,out] d A pointer to the deque object
+ * @param[in] sz The size of the type of object that will be
+ *               stored in the deque
+ */
+static inline void cstl_deque_init(
+    struct cstl_deque * const d, const size_t sz)
+{
+    cstl_deque_init_complex(d, sz, NULL, NULL, NULL);
+}
+
+/*!
+ * @brief Set the allocator used by the deque
+ *
+ * The allocator may only be changed while the deque holds no memory,
+ * i.e. after initialization and before any elements have been added,
+ * or after the deque has been cleared. An attempt to change the
+ * allocator at any other time causes the program to abort. The
+ * allocator is retained when the deque is cleared.
+ *
+ * @param[in,out] d A pointer to the deque object
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+void cstl_deque_set_allocator(struct cstl_deque * d,
+                              const cstl_allocator_t * a);
+
+/*!
+ * @brief Get the number of elements in the deque
+ *
+ * @param[in] d A pointer to the deque object
+ *
+ * @return The number of elements in the deque
+ */
+static inline size_t cstl_deque_size(const struct cstl_deque * const d)
+{
+    return d->count;
+}
+
+/*!
+ * @brief Get a pointer to an element in the deque
+ *
+ * @param[in] d A pointer to the deque
+ * @param[in] i The 0-based index of the desired element in the deque
+ *
+ * @return A pointer to the element indicated by the index
+ *
+ * @note The code will cause an abort if the index is outside the range
+ *       of valid elements in the deque
+ */
+void * cstl_deque_at(struct cstl_deque * d, size_t i);
+/*!
+ * @brief Get a const pointer to an element from a const deque
+ *
+ * @param[in] d A pointer to the deque
+ * @param[in] i The 0-based index of the desired element in the deque
+ *
+ * @return A pointer to the element indicated by the index
+ *
+ * @note The code will cause an abort if the index is outside the range
+ *       of valid elements in the deque
+ */
+const void * cstl_deque_at_const(const struct cstl_deque * d, size_t i);
+
+/*!
+ * @brief Get a pointer to the first element in the deque
+ *
+ * @param[in] d A pointer to the deque
+ *
+ * @return A pointer to the first element
+ * @retval NULL The deque is empty
+ */
+void * cstl_deque_front(struct cstl_deque * d);
+
+/*!
+ * @brief Get a pointer to the last element in the deque
+ *
+ * @param[in] d A pointer to the deque
+ *
+ * @return A pointer to the last element
+ * @retval NULL The deque is empty
+ */
+void * cstl_deque_back(struct cstl_deque * d);
+
+/*!
+ * @brief Add an element to the front of the deque
+ *
+ * The new element is constructed, if the deque has a constructor,
+ * and a pointer to it is returned so that the caller can fill it in.
+ *
+ * @param[in] d A pointer to the deque
+ *
+ * @return A pointer to the new element, now the first in the deque
+ * @retval NULL Memory for the element could not be allocated, and
+ *              the deque is unchanged
+ */
+void * cstl_deque_push_front(struct cstl_deque * d);
+
+/*!
+ * @brief Add an element to the back of the deque
+ *
+ * The new element is constructed, if the deque has a constructor,
+ * and a pointer to it is returned so that the caller can fill it in.
+ *
+ * @param[in] d A pointer to the deque
+ *
+ * @return A pointer to the new element, now the last in the deque
+ * @retval NULL Memory for the element could not be allocated, and
+ *              the deque is unchanged
+ */
+void * cstl_deque_push_back(struct cstl_deque * d);
+
+/*!
+ * @brief Remove the first element from the deque
+ *
+ * The element is destroyed, if the deque has a destructor. If the
+ * deque is empty, the function causes an abort.
+ *
+ * @param[in] d A pointer to the deque
+ */
+void cstl_deque_pop_front(struct cstl_deque * d);
+
+/*!
+ * @brief Remove the last element from the deque
+ *
+ * The element is destroyed, if the deque has a destructor. If the
+ * deque is empty, the function causes an abort.
+ *
+ * @param[in] d A pointer to the deque
+ */
+void cstl_deque_pop_back(struct cstl_deque * d);
+
+/*!
+ * @brief Swap the deque objects at the two given locations
+ *
+ * @param[in,out] a A pointer to a deque
+ * @param[in,out] b A pointer to a(nother) deque
+ *
+ * The deques at the given locations will be swapped such that upon
+ * return, @p a will contain the deque previously pointed to by @p b
+ * and vice versa.
+ */
+void cstl_deque_swap(struct cstl_deque * a, struct cstl_deque * b);
+
+/*!
+ * @brief Return a deque to its initialized state
+ *
+ * Each element is destroyed, if the deque has a destructor, and all
+ * memory held by the deque is released. The deque retains its element
+ * size, constructor and destructor, and allocator.
+ *
+ * @param[in] d A pointer to a deque
+ */
+void cstl_deque_clear(struct cstl_deque * d);
+
+/*!
+ * @}
+ */
+
+#endif
@@ -0,0 +1,176 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_DHEAP_H
+#define CSTL_DHEAP_H
+
+/*!
+ * @defgroup dheap Array heap
+ * @ingroup highlevel
+ * @brief A heap of objects stored contiguously in a vector
+ *
+ * Like the @ref heap, the array heap keeps the highest valued object
+ * (as determined by the associated comparison function) at the top,
+ * where it can be found in constant time, and objects are added and
+ * removed in O(log n) time. Unlike that heap, whose objects are linked
+ * together by pointers, the array heap copies its objects into a
+ * @ref vector, where the position of each object determines the
+ * positions of its parent and children.
+ *
+ * Each object has @p d children, rather than two, where @p d is chosen
+ * when the heap is initialized. A larger @p d makes the heap shallower,
+ * so that fewer levels are visited on each operation, at the cost of
+ * comparing more children at each level on the way down. The children
+ * of an object are adjacent in memory, and the heap positions them so
+ * that each group of children begins on a cache line boundary when the
+ * group exactly fills one or more cache lines, e.g. a 4-ary heap of
+ * 16-byte objects or an 8-ary heap of 8-byte objects.
+ *
+ * Objects are moved up and down the heap by moving the objects
+ * they pass over into the "hole" left by the moving object, which is
+ * copied only once, into its final position.
+ */
+/*!
+ * @addtogroup dheap
+ * @{
+ */
+
+#include "cstl/vector.h"
+
+#include <stdbool.h>
+
+/*!
+ * @brief Array heap object
+ *
+ * The heap may be declared on the stack or allocated. In either
+ * case, it must be initialized via cstl_dheap_init(). The heap must
+ * be cleared with cstl_dheap_clear() to release the memory held by it.
+ */
+typedef struct
+{
+    /*! @privatesection */
+    struct cstl_vector v;
+    /* the number of children of each object */
+    unsigned int d;
+    /*
+     * the number of unused elements at the front of the
+     * vector, ahead of the top of the heap, that align the
+     * groups of children with the cache lines
+     */
+    size_t off;
+
+    struct
+    {
+        /*! @privatesection */
+        cstl_compare_func_t * f;
+        void * p;
+    } cmp;
+} cstl_dheap_t;
+
+/*!
+ * @brief Initialize an array heap
+ *
+ * @param[out] h A pointer to the heap to be initialized
+ * @param[in] sz The size of the objects that will be stored in the heap
+ * @param[in] d The number of children of each object in the heap, which
+ *              must be at least two; otherwise, the function will cause
+ *              an abort
+ * @param[in] cmp A function that can compare objects in the heap
+ * @param[in] priv A pointer to private data that will be
+ *                 passed to the @p cmp function
+ */
+void cstl_dheap_init(cstl_dheap_t * h, size_t sz, unsigned int d,
+                     cstl_compare_func_t * cmp, void * priv);
+
+/*!
+ * @brief Set the allocator used by the heap
+ *
+ * The allocator may only be changed while the heap holds no memory,
+ * as described for cstl_vector_set_allocator().
+ *
+ * @param[in,out] h A pointer to the heap
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+static inline void cstl_dheap_set_allocator(cstl_dheap_t * const h,
+                                            const cstl_allocator_t * const a)
+{
+    cstl_vector_set_allocator(&h->v, a);
+}
+
+/*!
+ * @brief Get the number of objects in the heap
+ *
+ * @param[in] h A pointer to the heap
+ *
+ * @return The number of objects in the heap
+ */
+static inline size_t cstl_dheap_size(const cstl_dheap_t * const h)
+{
+    return cstl_vector_size(&h->v) - h->off;
+}
+
+/*!
+ * @brief Request that the heap be able to hold a number of objects
+ *        without allocating more memory
+ *
+ * As with cstl_vector_reserve(), a request that fails does so quietly.
+ *
+ * @param[in,out] h A pointer to the heap
+ * @param[in] n The number of objects the heap should be able to hold
+ */
+void cstl_dheap_reserve(cstl_dheap_t * h, size_t n);
+
+/*!
+ * @brief Insert a copy of an object into the heap
+ *
+ * If memory for the object cannot be allocated, the function
+ * causes an abort, as with cstl_vector_resize().
+ *
+ * @param[in,out] h A pointer to the heap
+ * @param[in] e A pointer to the object to be copied into the heap
+ */
+void cstl_dheap_push(cstl_dheap_t * h, const void * e);
+
+/*!
+ * @brief Get a pointer to the object at the top of the heap
+ *
+ * The object must not be modified in any way that affects
+ * its comparison with other objects in the heap.
+ *
+ * @param[in] h A pointer to the heap
+ *
+ * @return A pointer to the object at the top of the heap, which
+ *         remains valid until the heap is next modified
+ * @retval NULL The heap is empty
+ */
+const void * cstl_dheap_get(const cstl_dheap_t * h);
+
+/*!
+ * @brief Remove the highest valued object from the heap
+ *
+ * @param[in,out] h A pointer to the heap
+ * @param[out] e A pointer to memory into which to copy the removed
+ *               object. The pointer may be NULL
+ *
+ * @retval true An object was removed
+ * @retval false The heap is empty
+ */
+bool cstl_dheap_pop(cstl_dheap_t * h, void * e);
+
+/*!
+ * @brief Remove all objects from the heap and release its memory
+ *
+ * The heap retains its object size, number of children,
+ * comparison function, and allocator.
+ *
+ * @param[in,out] h A pointer to the heap
+ */
+void cstl_dheap_clear(cstl_dheap_t * h);
+
+/*!
+ * @}
+ */
+
+#endif
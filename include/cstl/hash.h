@@ -16,6 +16,7 @@
  */
 
 #include "cstl/common.h"
+#include "cstl/allocator.h"
 
 #include <stdbool.h>
 
@@ -131,6 +132,9 @@ struct cstl_hash
 
     size_t count;
     size_t off;
+
+    /* allocator from which the buckets are allocated */
+    const cstl_allocator_t * allocator;
 };
 
 /*!
@@ -156,6 +160,7 @@ struct cstl_hash
     },                                          \
     .count = 0,                                 \
     .off = offsetof(TYPE, MEMB),                \
+    .allocator = NULL,                          \
 }
 /*!
  * @brief (Statically) declare and initialize a hash
@@ -193,8 +198,25 @@ static inline void cstl_hash_init(
 
     h->count = 0;
     h->off = off;
+
+    h->allocator = NULL;
 }
 
+/*!
+ * @brief Set the allocator used for the hash's buckets
+ *
+ * The hash never allocates memory for the objects that it holds, but
+ * it does allocate an array of buckets. This function sets the allocator
+ * from which that array is allocated. The allocator may only be changed
+ * before the hash is first resized or after it has been cleared. An
+ * attempt to change it at any other time causes the program to abort.
+ *
+ * @param[in,out] h A pointer to the hash
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+void cstl_hash_set_allocator(struct cstl_hash * h, const cstl_allocator_t * a);
+
 /*!
  * @brief Get the number of objects in the hash
  *
@@ -150,6 +150,25 @@ static inline size_t cstl_heap_size(const struct cstl_heap * const h)
  */
 void cstl_heap_push(struct cstl_heap * h, void * e);
 
+/*!
+ * @brief Insert a number of objects into the heap
+ *
+ * The objects are first linked into the bottom of the heap, which
+ * avoids the search for an open position that precedes each
+ * insertion by cstl_heap_push(). If the heap was empty or the new
+ * objects outnumber those already in the heap, the heap is then
+ * rebuilt from the bottom up in O(n) time. Otherwise, each new object
+ * is moved up into place as it would have been by cstl_heap_push().
+ *
+ * The same restrictions on modification of the objects apply
+ * as with cstl_heap_push().
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] e An array of pointers to the objects to be inserted
+ * @param[in] n The number of pointers in the @p e array
+ */
+void cstl_heap_push_many(struct cstl_heap * h, void * const * e, size_t n);
+
 /*!
  * @brief Get a pointer to the object at the top of the heap
  *
@@ -170,6 +189,33 @@ const void * cstl_heap_get(const struct cstl_heap * h);
  */
 void * cstl_heap_pop(struct cstl_heap * h);
 
+/*!
+ * @brief Restore an object's position in the heap after its value changes
+ *
+ * An object in the heap may be modified in a way that changes its
+ * comparison with other objects in the heap, i.e. its priority may
+ * be raised or lowered, so long as this function is called after
+ * the modification, before any other operation on the heap. The
+ * object is moved up or down the heap, in O(log n) time, to the
+ * position appropriate to its new value.
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] e A pointer to an object in the heap
+ */
+void cstl_heap_update(struct cstl_heap * h, void * e);
+
+/*!
+ * @brief Remove an arbitrary object from the heap
+ *
+ * The object is removed in O(log n) time, and the caller
+ * regains ownership of it. The behavior is undefined if
+ * the object is not in the heap.
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] e A pointer to the object to be removed
+ */
+void cstl_heap_erase(struct cstl_heap * h, void * e);
+
 /*!
  * @brief Remove all elements from the heap
  *
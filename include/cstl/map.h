@@ -9,6 +9,18 @@
  * @defgroup map Map
  * @ingroup highlevel
  * @brief A container of key/value pairs with unique keys
+ *
+ * The map keeps its elements ordered by key. Two implementations, or
+ * "backends", are available and are selected when the map is initialized:
+ *
+ * - A red-black tree (the default) that allocates a small node for each
+ *   element. Iterators remain valid until the element to which they
+ *   refer is removed from the map.
+ * - A B-tree with wide nodes that store many keys contiguously. For
+ *   large maps, this greatly reduces the number of nodes (and cache
+ *   lines) touched by each operation. However, elements move between
+ *   nodes as the map is modified, so any insertion into or removal from
+ *   the map invalidates all existing iterators.
  */
 /*!
  * @addtogroup map
@@ -16,9 +28,45 @@
  */
 
 #include "cstl/rbtree.h"
+#include "cstl/pool.h"
+#include "cstl/allocator.h"
 
 #include <stdbool.h>
 
+/*!
+ * @brief Enumeration of the available map implementations
+ */
+typedef enum
+{
+    /*! @brief Red-black tree with one node per element */
+    CSTL_MAP_BACKEND_RBTREE,
+    /*! @brief B-tree with many elements per node */
+    CSTL_MAP_BACKEND_BTREE,
+
+    /*! @brief Unspecified default backend */
+    CSTL_MAP_BACKEND_DEFAULT = CSTL_MAP_BACKEND_RBTREE,
+} cstl_map_backend_t;
+
+/*!
+ * @brief Enumeration of the ways in which a map can compare keys
+ *
+ * @see cstl_map_set_inline_keys()
+ */
+typedef enum
+{
+    /*! @brief Keys are compared by the function given to the map */
+    CSTL_MAP_KEY_CMP,
+    /*! @brief Keys are signed integers in the native byte order */
+    CSTL_MAP_KEY_INT,
+    /*! @brief Keys are unsigned integers in the native byte order */
+    CSTL_MAP_KEY_UINT,
+    /*! @brief Keys are compared byte by byte, as if by memcmp() */
+    CSTL_MAP_KEY_MEMCMP,
+} cstl_map_key_kind_t;
+
+/*! @private */
+struct cstl_map_bnode;
+
 /*!
  * @brief The map object
  *
@@ -30,13 +78,45 @@
 typedef struct
 {
     /*! @privatesection */
+    cstl_map_backend_t backend;
+
+    /* the tree used by the red-black tree backend */
     struct cstl_rbtree t;
+    /* the tree used by the B-tree backend */
+    struct
+    {
+        /*! @privatesection */
+        struct cstl_map_bnode * root;
+        size_t size;
+    } b;
+
     struct
     {
         /*! @privatesection */
         cstl_compare_func_t * f;
         void * p;
     } cmp;
+    /*
+     * the size of the keys copied into the map's
+     * nodes (or zero if the nodes point to the keys)
+     * and how those keys are compared
+     */
+    struct
+    {
+        /*! @privatesection */
+        size_t size;
+        cstl_map_key_kind_t kind;
+    } key;
+    /*
+     * if non-NULL, the pool from which
+     * the map's nodes are allocated
+     */
+    struct cstl_pool * pool;
+    /*
+     * the allocator from which the map's nodes
+     * are allocated when no pool is set
+     */
+    const cstl_allocator_t * allocator;
 } cstl_map_t;
 
 /*!
@@ -51,6 +131,8 @@ typedef struct
 
     /*! @private */
     void * _;
+    /*! @private */
+    unsigned int _i;
 } cstl_map_iterator_t;
 
 /*!
@@ -82,16 +164,57 @@ const cstl_map_iterator_t * cstl_map_iterator_end(const cstl_map_t * map);
 static inline bool cstl_map_iterator_eq(
     const cstl_map_iterator_t * const a, const cstl_map_iterator_t * const b)
 {
-    return a->_ == b->_;
+    return a->_ == b->_ && a->_i == b->_i;
 }
 
+/*!
+ * @brief Advance an iterator to the next element in the map
+ *
+ * The "end" iterator acts as a sentinel between the last and first
+ * elements of the map: advancing an iterator that refers to the last
+ * element produces "end", and advancing "end" produces an iterator that
+ * refers to the first element (or "end", if the map is empty).
+ *
+ * @param[in] map A pointer to the map into which the iterator points
+ * @param[in,out] i A pointer to the iterator to be advanced
+ */
+void cstl_map_iterator_next(const cstl_map_t * map, cstl_map_iterator_t * i);
+/*!
+ * @brief Move an iterator to the previous element in the map
+ *
+ * Moving an iterator that refers to the first element backward
+ * produces "end", and moving "end" backward produces an iterator
+ * that refers to the last element (or "end", if the map is empty).
+ *
+ * @param[in] map A pointer to the map into which the iterator points
+ * @param[in,out] i A pointer to the iterator to be moved
+ */
+void cstl_map_iterator_prev(const cstl_map_t * map, cstl_map_iterator_t * i);
+
 /*!
  * @}
  */
 
+/*!
+ * @brief Initialize a map with a specific backend
+ *
+ * Initializing a previously initialized map that has not been cleared
+ * may cause the loss/leaking of memory.
+ *
+ * @param[out] map The map to be initialized
+ * @param[in] cmp A function to be used to compare keys
+ * @param[in] priv A pointer to be passed to each invocation of @p cmp
+ * @param[in] backend The implementation to be used by the map
+ */
+void __cstl_map_init(cstl_map_t * map,
+                     cstl_compare_func_t * cmp, void * priv,
+                     cstl_map_backend_t backend);
+
 /*!
  * @brief Initialize a map
  *
+ * The map is initialized with the default backend.
+ *
  * Initializing a previously initialized map that has not been cleared
  * may cause the loss/leaking of memory.
  *
@@ -99,7 +222,140 @@ static inline bool cstl_map_iterator_eq(
  * @param[in] cmp A function to be used to compare keys
  * @param[in] priv A pointer to be passed to each invocation of @p cmp
  */
-void cstl_map_init(cstl_map_t * map, cstl_compare_func_t * cmp, void * priv);
+static inline void cstl_map_init(cstl_map_t * const map,
+                                 cstl_compare_func_t * const cmp,
+                                 void * const priv)
+{
+    __cstl_map_init(map, cmp, priv, CSTL_MAP_BACKEND_DEFAULT);
+}
+
+/*!
+ * @brief Initialize a pool from which map nodes can be allocated
+ *
+ * The pool is initialized such that the objects it holds are
+ * the size of the nodes used internally by the map. The pool
+ * may then be given to one or more maps via cstl_map_set_pool().
+ * The pool must be cleared via cstl_pool_clear() after all maps
+ * using it have been cleared.
+ *
+ * @param[out] pool The pool to be initialized
+ * @param[in] count The number of nodes to allocate per slab. A value
+ *                  of zero selects a default number of nodes
+ */
+void cstl_map_pool_init(struct cstl_pool * pool, size_t count);
+
+/*!
+ * @brief Initialize a pool from which nodes of a map with inline keys
+ *        can be allocated
+ *
+ * The pool's objects are large enough to hold the map's nodes along
+ * with a copy of a key of the given size. Such a pool may also be used by
+ * maps with smaller keys or that do not copy their keys.
+ *
+ * @param[out] pool The pool to be initialized
+ * @param[in] ksize The size of the keys that will be stored in the nodes
+ * @param[in] count The number of nodes to allocate per slab. A value
+ *                  of zero selects a default number of nodes
+ *
+ * @see cstl_map_set_inline_keys()
+ */
+void cstl_map_inline_pool_init(struct cstl_pool * pool,
+                               size_t ksize, size_t count);
+
+/*!
+ * @brief Allocate the map's nodes from a pool
+ *
+ * By default, the map allocates (and frees) memory for each element
+ * as it is inserted into (and removed from) the map. When a pool is
+ * set, the map allocates its nodes from the pool instead, and nodes
+ * removed from the map are returned to the pool for reuse.
+ *
+ * A pool may be shared by multiple maps. If the pool is used only
+ * by a single map, cstl_map_clear() is able to release all of the
+ * pool's slabs at once, rather than returning each node individually.
+ *
+ * The pool must have been initialized via cstl_map_pool_init() (or, for
+ * a map with inline keys, via cstl_map_inline_pool_init() with a key size
+ * at least as large as the map's), and the map must be empty when this
+ * function is called. Only maps that use the red-black tree backend
+ * can allocate their nodes from a pool. If any of these conditions
+ * is not met, the function will cause an abort.
+ *
+ * @param[in,out] map A pointer to the map
+ * @param[in] pool A pointer to the pool from which to allocate nodes.
+ *                 A value of NULL causes the map to stop using a pool.
+ */
+void cstl_map_set_pool(cstl_map_t * map, struct cstl_pool * pool);
+
+/*!
+ * @brief Set the allocator from which the map's nodes are allocated
+ *
+ * The allocator is used only when the map is not using a pool. When
+ * a pool is set, the pool's allocator determines where the memory
+ * for the map's nodes comes from.
+ *
+ * The map must be empty when this function is called; otherwise,
+ * the function will cause an abort.
+ *
+ * @param[in,out] map A pointer to the map
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+void cstl_map_set_allocator(cstl_map_t * map, const cstl_allocator_t * a);
+
+/*!
+ * @brief Enable or disable order statistics for the map
+ *
+ * A map with order statistics enabled supports cstl_map_rank(),
+ * cstl_map_select(), and cstl_map_count_range() in O(log n) time,
+ * in exchange for a small amount of extra work on each insertion
+ * and removal. Order statistics are only available for maps that
+ * use the red-black tree backend.
+ *
+ * Only the nodes of a map with order statistics enabled have room for
+ * the counts that they require. Nodes allocated from a pool initialized
+ * via cstl_map_pool_init() or cstl_map_inline_pool_init() always do.
+ *
+ * The map must be empty when this function is called, and it must
+ * use the red-black tree backend if @p ranked is true; otherwise,
+ * the function will cause an abort.
+ *
+ * @param[in,out] map A pointer to the map
+ * @param[in] ranked Whether or not to maintain order statistics
+ */
+void cstl_map_set_ranked(cstl_map_t * map, bool ranked);
+
+/*!
+ * @brief Store copies of fixed-size keys within the map's elements
+ *
+ * By default, the map holds a pointer to each key, and the caller must
+ * keep the key alive for as long as it is in the map. When a (nonzero)
+ * key size is set, each key passed to the map is instead copied into the
+ * element that holds it, and the map no longer refers to the caller's
+ * key. Keys in the map are then read without following a pointer to
+ * them. The @p key member of an iterator points to the map's copy of the
+ * key, which is valid until the element is removed from the map.
+ *
+ * The copies may also be compared without calling the map's comparison
+ * function: the @p kind parameter selects whether keys are compared by
+ * that function, as integers of the given size, or as arrays of bytes.
+ * Integer keys must be 1, 2, 4, or 8 bytes long.
+ *
+ * The map must be empty and must use the red-black tree backend when
+ * this function is called. If the map allocates its nodes from a pool,
+ * the pool must be able to hold nodes with keys of the given size (see
+ * cstl_map_inline_pool_init()). If any of these conditions is not met,
+ * or the key size and kind are inconsistent, the function will cause
+ * an abort.
+ *
+ * @param[in,out] map A pointer to the map
+ * @param[in] size The size of each key. A value of zero causes the map
+ *                 to hold pointers to the caller's keys, in which case
+ *                 @p kind must be @p CSTL_MAP_KEY_CMP
+ * @param[in] kind The manner in which keys are compared
+ */
+void cstl_map_set_inline_keys(cstl_map_t * map,
+                              size_t size, cstl_map_key_kind_t kind);
 
 /*!
  * @brief Return the number of elements in the map
@@ -110,6 +366,9 @@ void cstl_map_init(cstl_map_t * map, cstl_compare_func_t * cmp, void * priv);
  */
 static inline size_t cstl_map_size(const cstl_map_t * const map)
 {
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        return map->b.size;
+    }
     return cstl_rbtree_size(&map->t);
 }
 
@@ -134,6 +393,86 @@ int cstl_map_insert(cstl_map_t * map,
                     const void * key, void * val,
                     cstl_map_iterator_t * i);
 
+/*!
+ * @brief Insert a key/value pair into the map, near a known position
+ *
+ * If the new key belongs immediately after or immediately before the
+ * element referred to by @p hint, the pair is inserted there, after
+ * comparing the key to the hint and one of its neighbors, rather than
+ * by searching for the location from the top of the map. This makes
+ * inserting a sequence of keys that is already (nearly) sorted much
+ * cheaper, e.g. by passing the iterator returned by each insertion as
+ * the hint for the next. If the hint is wrong, the pair is inserted
+ * as if by cstl_map_insert().
+ *
+ * @param[in] map The map into which to insert the pair
+ * @param[in] hint An iterator referring to an element in the map or
+ *                 to the end of the map. The end of the map is a good
+ *                 hint for a key that is greater than all others
+ * @param[in] key A pointer to the key
+ * @param[in] val A pointer to the value
+ * @param[out] i A pointer to an iterator in which to return a pointer to
+ *               the new or existing element in the map. This parameter
+ *               may be NULL, and it may point to the same iterator as
+ *               @p hint
+ *
+ * @return The same values as cstl_map_insert()
+ */
+int cstl_map_insert_hint(cstl_map_t * map,
+                         const cstl_map_iterator_t * hint,
+                         const void * key, void * val,
+                         cstl_map_iterator_t * i);
+
+/*!
+ * @brief Append sorted key/value pairs to the map
+ *
+ * For a map that uses the red-black tree backend, the new elements are
+ * assembled into a balanced tree which is then joined to the existing
+ * tree. The cost of the operation is O(n + log m), where n is the number
+ * of pairs being appended and m is the number of elements already in the
+ * map, and no keys are compared. For a map that uses the B-tree backend,
+ * the pairs are inserted individually.
+ *
+ * The keys must be sorted in ascending order with no duplicates, and the
+ * first of them must be greater than every key already in the map. If
+ * these conditions are not met, the behavior of subsequent operations
+ * on the map is undefined.
+ *
+ * @param[in] map A pointer to the map
+ * @param[in] keys An array of pointers to the keys
+ * @param[in] vals An array of pointers to the values associated with
+ *                 the keys. This parameter may be NULL, in which case
+ *                 all of the values are NULL
+ * @param[in] n The number of pairs to append
+ *
+ * @retval -1 The function failed to allocate memory. The map is unchanged
+ * @retval 0 The pairs were successfully appended to the map
+ */
+int cstl_map_append(cstl_map_t * map,
+                    const void * const * keys, void * const * vals,
+                    size_t n);
+
+/*!
+ * @brief Populate an empty map from sorted key/value pairs
+ *
+ * This function is equivalent to cstl_map_append() except that the map
+ * must be empty when the function is called. If it is not, the function
+ * will cause an abort.
+ *
+ * @param[in] map A pointer to the map
+ * @param[in] keys An array of pointers to the keys
+ * @param[in] vals An array of pointers to the values associated with
+ *                 the keys. This parameter may be NULL, in which case
+ *                 all of the values are NULL
+ * @param[in] n The number of pairs in the arrays
+ *
+ * @retval -1 The function failed to allocate memory. The map is unchanged
+ * @retval 0 The map was successfully populated
+ */
+int cstl_map_build(cstl_map_t * map,
+                   const void * const * keys, void * const * vals,
+                   size_t n);
+
 /*!
  * @brief Find an element in the map with a matching key
  *
@@ -147,6 +486,36 @@ int cstl_map_insert(cstl_map_t * map,
 void cstl_map_find(const cstl_map_t * map, const void * key,
                    cstl_map_iterator_t * i);
 
+/*!
+ * @brief Find the first element in the map whose key is not less
+ *        than the supplied key
+ *
+ * @param[in] map A pointer to the map to be searched
+ * @param[in] key A pointer to the key that is sought
+ * @param[out] i A pointer to an iterator in which to return a pointer to
+ *               the found element. This parameter may not be NULL
+ *
+ * The @p i parameter will be "end" if every key in the map is
+ * less than @p key
+ */
+void cstl_map_lower_bound(const cstl_map_t * map, const void * key,
+                          cstl_map_iterator_t * i);
+
+/*!
+ * @brief Find the first element in the map whose key is greater
+ *        than the supplied key
+ *
+ * @param[in] map A pointer to the map to be searched
+ * @param[in] key A pointer to the key that is sought
+ * @param[out] i A pointer to an iterator in which to return a pointer to
+ *               the found element. This parameter may not be NULL
+ *
+ * The @p i parameter will be "end" if no key in the map is
+ * greater than @p key
+ */
+void cstl_map_upper_bound(const cstl_map_t * map, const void * key,
+                          cstl_map_iterator_t * i);
+
 /*!
  * @brief Erase the element with the supplied key from the map
  *
@@ -158,7 +527,8 @@ void cstl_map_find(const cstl_map_t * map, const void * key,
  * The @p i parameter will compare as equal with "end" upon return; however,
  * if an element with a matching key existed, the @p key and @p val members
  * will point to the key and value, respectively that we contained in the
- * element.
+ * element. If the map stores its keys inline, the element's copy of the
+ * key no longer exists, and the @p key member points to @p key instead.
  *
  * @retval 0 The element was found and removed
  * @retval -1 No matching element was found
@@ -174,6 +544,183 @@ int cstl_map_erase(cstl_map_t * map, const void * key,
  */
 void cstl_map_erase_iterator(cstl_map_t * map, cstl_map_iterator_t * i);
 
+/*!
+ * @brief Visit each element in the map, in order by key
+ *
+ * @param[in] map A pointer to the map
+ * @param[in] visit A pointer to a function to be called for each element
+ * @param[in] priv A pointer to be passed to each invocation of @p visit
+ *
+ * The first argument to the @p visit function will be a pointer to an
+ * iterator referring to the element being visited. The callee must not
+ * insert elements into or remove elements from the map.
+ *
+ * The function continues visiting elements in the map so long as the
+ * given @p visit function returns 0. If the @p visit function returns a
+ * non-zero value, no more elements are visited, and the function returns
+ * the non-zero value that halted visitations.
+ */
+int cstl_map_foreach(const cstl_map_t * map,
+                     cstl_visit_func_t * visit, void * priv);
+
+/*!
+ * @brief Visit, in order, each element in the map whose key
+ *        falls within a range
+ *
+ * @param[in] map A pointer to the map
+ * @param[in] lo A pointer to the (inclusive) lower bound of the range
+ * @param[in] hi A pointer to the (exclusive) upper bound of the range
+ * @param[in] visit A pointer to a function to be called for each element
+ * @param[in] priv A pointer to be passed to each invocation of @p visit
+ *
+ * Elements whose keys compare as greater than or equal to @p lo and less
+ * than @p hi are visited. The first element is located by a search of the
+ * map, after which the walk steps from one element to the next, so the
+ * cost of the operation is O(log n + k), where k is the number of
+ * elements visited, rather than O(n).
+ *
+ * The @p visit function is called as described for cstl_map_foreach().
+ *
+ * @return The value returned by the @p visit function that stopped the
+ *         walk, or 0 if all elements in the range were visited
+ */
+int cstl_map_foreach_range(const cstl_map_t * map,
+                           const void * lo, const void * hi,
+                           cstl_visit_func_t * visit, void * priv);
+
+/*!
+ * @name Order statistics
+ *
+ * The functions in this group may only be called on a map for which
+ * order statistics have been enabled via cstl_map_set_ranked(). Any
+ * attempt to call them on another map causes the program to abort.
+ *
+ * @{
+ */
+
+/*!
+ * @brief Count the elements whose keys are less than the supplied key
+ *
+ * @param[in] map A pointer to the map
+ * @param[in] key A pointer to the key, which need not be in the map
+ *
+ * @return The number of elements in the map whose keys are less than
+ *         @p key. If @p key is in the map, this is its (zero-based)
+ *         position in the map's order.
+ */
+size_t cstl_map_rank(const cstl_map_t * map, const void * key);
+
+/*!
+ * @brief Find the element at a given position in the map's order
+ *
+ * @param[in] map A pointer to the map
+ * @param[in] idx The zero-based position of the sought element
+ * @param[out] i A pointer to an iterator in which to return a pointer to
+ *               the element. This parameter may not be NULL
+ *
+ * The @p i parameter will be "end" if @p idx is not less than
+ * the number of elements in the map
+ */
+void cstl_map_select(const cstl_map_t * map, size_t idx,
+                     cstl_map_iterator_t * i);
+
+/*!
+ * @brief Count the elements whose keys are in the range [@p lo, @p hi)
+ *
+ * @param[in] map A pointer to the map
+ * @param[in] lo A pointer to the (inclusive) lower bound of the range
+ * @param[in] hi A pointer to the (exclusive) upper bound of the range
+ *
+ * @return The number of elements in the range
+ */
+size_t cstl_map_count_range(const cstl_map_t * map,
+                            const void * lo, const void * hi);
+
+/*!
+ * @}
+ */
+
+/*!
+ * @name Set operations
+ *
+ * These functions combine two maps, @p a and @p b, into a third, @p dst.
+ * Rather than looking up each element of one map in the other, they walk
+ * both maps in order, side by side, and build @p dst from the result. The
+ * cost is O(n + m), where n and m are the sizes of the two maps.
+ *
+ * All three maps must order their keys in the same way, and @p dst must
+ * be a different object from both @p a and @p b. @p dst must be empty when
+ * the function is called; otherwise the function will cause an abort. The
+ * keys and values placed in @p dst are the same pointers as those held
+ * by @p a and @p b (or produced by the combiner); they are not copied.
+ *
+ * Each function returns 0 on success. If the function fails to allocate
+ * memory, it returns -1 and leaves @p dst empty. In that case, values
+ * produced by the combiner are discarded.
+ *
+ * @{
+ */
+
+/*!
+ * @brief Type of function called to combine the values of elements
+ *        with equal keys in a set operation
+ *
+ * @param[in] key A pointer to the key from the first map
+ * @param[in] a A pointer to the value from the first map
+ * @param[in] b A pointer to the value from the second map
+ * @param[in] priv A pointer to private data belonging to the callee
+ *
+ * @return The value to be associated with the key in the destination map
+ */
+typedef void * cstl_map_combine_func_t(
+    const void * key, void * a, void * b, void * priv);
+
+/*!
+ * @brief Construct a map containing the elements of either of two maps
+ *
+ * @param[out] dst The map in which to place the result
+ * @param[in] a A pointer to the first map
+ * @param[in] b A pointer to the second map
+ * @param[in] comb A function to produce the value for a key that is
+ *                 present in both maps. If NULL, the value from @p a
+ *                 is used. In either case, the key from @p a is used
+ * @param[in] priv A pointer to be passed to each call to @p comb
+ */
+int cstl_map_union(cstl_map_t * dst,
+                   const cstl_map_t * a, const cstl_map_t * b,
+                   cstl_map_combine_func_t * comb, void * priv);
+
+/*!
+ * @brief Construct a map containing the elements whose keys are
+ *        present in both of two maps
+ *
+ * @param[out] dst The map in which to place the result
+ * @param[in] a A pointer to the first map
+ * @param[in] b A pointer to the second map
+ * @param[in] comb A function to produce the value for each key. If
+ *                 NULL, the value from @p a is used. In either case,
+ *                 the key from @p a is used
+ * @param[in] priv A pointer to be passed to each call to @p comb
+ */
+int cstl_map_intersection(cstl_map_t * dst,
+                          const cstl_map_t * a, const cstl_map_t * b,
+                          cstl_map_combine_func_t * comb, void * priv);
+
+/*!
+ * @brief Construct a map containing the elements of one map whose
+ *        keys are not present in another
+ *
+ * @param[out] dst The map in which to place the result
+ * @param[in] a A pointer to the map whose elements are selected
+ * @param[in] b A pointer to the map whose keys are excluded
+ */
+int cstl_map_difference(cstl_map_t * dst,
+                        const cstl_map_t * a, const cstl_map_t * b);
+
+/*!
+ * @}
+ */
+
 /*!
  * @brief Remove all elements from the map
  *
@@ -186,6 +733,12 @@ void cstl_map_erase_iterator(cstl_map_t * map, cstl_map_iterator_t * i);
  * undefined whether the element is still in the tree at the time that the
  * @p clr function is called, and the callee must not do anything with the
  * iterator except retrieve the key and value pointers.
+ *
+ * If the map allocates its nodes from a pool and no other object has
+ * nodes allocated from that pool, the pool is cleared as well. In that
+ * case, and if @p clr is NULL, the elements are not visited at all, and
+ * the cost of the operation is proportional to the number of slabs in
+ * the pool rather than the number of elements in the map.
  */
 void cstl_map_clear(cstl_map_t * map, cstl_xtor_func_t * clr, void * priv);
 
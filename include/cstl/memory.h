@@ -47,6 +47,7 @@
  */
 
 #include "cstl/common.h"
+#include "cstl/allocator.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -217,6 +218,10 @@ static inline void cstl_guarded_ptr_swap(
             .func = NULL,                               \
             .priv = NULL,                               \
         },                                              \
+        .mem = {                                        \
+            .a = NULL,                                  \
+            .len = 0,                                   \
+        },                                              \
     }
 /*!
  * @brief Declare and initialize a unique pointer
@@ -239,6 +244,12 @@ typedef struct
         cstl_xtor_func_t * func;
         void * priv;
     } clr;
+    /* the allocator and size of the managed memory, for freeing it */
+    struct
+    {
+        const cstl_allocator_t * a;
+        size_t len;
+    } mem;
 } cstl_unique_ptr_t;
 
 /*!
@@ -251,15 +262,39 @@ static inline void cstl_unique_ptr_init(cstl_unique_ptr_t * const up)
     cstl_guarded_ptr_set(&up->gp, NULL);
     up->clr.func = NULL;
     up->clr.priv = NULL;
+    up->mem.a = NULL;
+    up->mem.len = 0;
 }
 
 /*!
  * @brief Dynamically allocate memory to be managed by the unique pointer
  *
- * The function allocates the requested number of bytes via malloc(),
- * and stores the resulting pointer within the unique pointer object.
- * The caller may provide a "clear" function that will be called prior
- * to the memory being freed whin the unique pointer is reset.
+ * The function allocates the requested number of bytes via the given
+ * allocator and stores the resulting pointer within the unique pointer
+ * object. The caller may provide a "clear" function that will be called
+ * prior to the memory being freed when the unique pointer is reset.
+ *
+ * @param[in] up A pointer to a unique pointer object
+ * @param[in] len The number of bytes to allocate
+ * @param[in] clr A pointer to a function to call when the memory is freed.
+ *                This pointer may be NULL
+ * @param[in] priv A pointer to be passed to the @p clr function
+ * @param[in] a A pointer to the allocator from which to allocate (and
+ *              to which to eventually free) the memory. NULL selects
+ *              the process-wide default allocator
+ */
+void __cstl_unique_ptr_alloc(
+    cstl_unique_ptr_t * up, size_t len, cstl_xtor_func_t * clr, void * priv,
+    const cstl_allocator_t * a);
+
+/*!
+ * @brief Dynamically allocate memory to be managed by the unique pointer
+ *
+ * The function allocates the requested number of bytes via the
+ * process-wide default allocator and stores the resulting pointer
+ * within the unique pointer object. The caller may provide a "clear"
+ * function that will be called prior to the memory being freed when
+ * the unique pointer is reset.
  *
  * @param[in] up A pointer to a unique pointer object
  * @param[in] len The number of bytes to allocate
@@ -267,8 +302,12 @@ static inline void cstl_unique_ptr_init(cstl_unique_ptr_t * const up)
  *                This pointer may be NULL
  * @param[in] priv A pointer to be passed to the @p clr function
  */
-void cstl_unique_ptr_alloc(
-    cstl_unique_ptr_t * up, size_t len, cstl_xtor_func_t * clr, void * priv);
+static inline void cstl_unique_ptr_alloc(
+    cstl_unique_ptr_t * const up, const size_t len,
+    cstl_xtor_func_t * const clr, void * const priv)
+{
+    __cstl_unique_ptr_alloc(up, len, clr, priv, NULL);
+}
 
 /*!
  * @brief Get the pointer managed by the unique pointer object
@@ -293,10 +332,12 @@ static inline void * cstl_unique_ptr_get(cstl_unique_ptr_t * const up)
 /*!
  * @brief Stop a unique pointer object from managing a pointer
  *
- * The managed pointer is returned, and the clear function is also
- * returned via the parameter, if non-NULL. Upon return, the object
- * does not manage any pointer and the caller is responsible for
- * calling the associated clear function and freeing the memory.
+ * The managed pointer is returned, and the clear function, the
+ * allocator, and the number of bytes allocated are also returned via
+ * the parameters, if non-NULL. Upon return, the object does not manage
+ * any pointer and the caller is responsible for calling the associated
+ * clear function and freeing the memory, i.e. by passing the returned
+ * allocator and length to cstl_allocator_free().
  *
  * @param[in] up A pointer to a unique pointer object
  * @param[out] clr A pointer to a function pointer to receive a pointer
@@ -304,13 +345,20 @@ static inline void * cstl_unique_ptr_get(cstl_unique_ptr_t * const up)
  *                 be NULL
  * @param[out] priv A pointer that would have been passed to the @p clr
  *                  function
+ * @param[out] a A pointer to receive a pointer to the allocator from
+ *               which the memory was allocated. NULL is received if the
+ *               memory was allocated from the default allocator. This
+ *               parameter may be NULL
+ * @param[out] len A pointer to receive the number of bytes allocated.
+ *                 This parameter may be NULL
  *
  * @return The formerly managed pointer
  * @retval NULL The object was not managing a pointer
  */
-static inline void * cstl_unique_ptr_release(
+static inline void * __cstl_unique_ptr_release(
     cstl_unique_ptr_t * const up,
-    cstl_xtor_func_t ** const clr, void ** priv)
+    cstl_xtor_func_t ** const clr, void ** priv,
+    const cstl_allocator_t ** const a, size_t * const len)
 {
     void * const p = cstl_unique_ptr_get(up);
     if (clr != NULL) {
@@ -319,10 +367,46 @@ static inline void * cstl_unique_ptr_release(
     if (priv != NULL) {
         *priv = up->clr.priv;
     }
+    if (a != NULL) {
+        *a = up->mem.a;
+    }
+    if (len != NULL) {
+        *len = up->mem.len;
+    }
     cstl_unique_ptr_init(up);
     return p;
 }
 
+/*!
+ * @brief Stop a unique pointer object from managing a pointer
+ *
+ * The managed pointer is returned, and the clear function is also
+ * returned via the parameter, if non-NULL. Upon return, the object
+ * does not manage any pointer and the caller is responsible for
+ * calling the associated clear function and freeing the memory.
+ *
+ * Memory allocated via cstl_unique_ptr_alloc() is freed by passing a
+ * NULL allocator and the number of bytes that were requested to
+ * cstl_allocator_free(). If the allocator or the length is not known
+ * to the caller, use __cstl_unique_ptr_release() to retrieve them.
+ *
+ * @param[in] up A pointer to a unique pointer object
+ * @param[out] clr A pointer to a function pointer to receive a pointer
+ *                 to the associated clear function. This parameter may
+ *                 be NULL
+ * @param[out] priv A pointer that would have been passed to the @p clr
+ *                  function
+ *
+ * @return The formerly managed pointer
+ * @retval NULL The object was not managing a pointer
+ */
+static inline void * cstl_unique_ptr_release(
+    cstl_unique_ptr_t * const up,
+    cstl_xtor_func_t ** const clr, void ** priv)
+{
+    return __cstl_unique_ptr_release(up, clr, priv, NULL, NULL);
+}
+
 /*!
  * @brief Swap the objects pointed to by the parameters
  *
@@ -332,9 +416,10 @@ static inline void * cstl_unique_ptr_release(
 static inline void cstl_unique_ptr_swap(cstl_unique_ptr_t * const up1,
                                         cstl_unique_ptr_t * const up2)
 {
-    uint8_t t[sizeof(up1->clr)];
+    uint8_t t[CSTL_MAX_T(size_t, sizeof(up1->clr), sizeof(up1->mem))];
     cstl_guarded_ptr_swap(&up1->gp, &up2->gp);
-    cstl_swap(&up1->clr, &up2->clr, t, sizeof(t));
+    cstl_swap(&up1->clr, &up2->clr, t, sizeof(up1->clr));
+    cstl_swap(&up1->mem, &up2->mem, t, sizeof(up1->mem));
 }
 
 /*!
@@ -416,13 +501,38 @@ static inline void cstl_shared_ptr_init(cstl_shared_ptr_t * const sp)
  * The supplied shared pointer object must have already been initialized
  * and will be reset an preparation for the new allocation.
  *
+ * Both the requested memory and the object's internal bookkeeping
+ * data are allocated from the given allocator.
+ *
  * @param[in,out] sp A pointer to the shared pointer object
  * @param[in] sz The number of bytes to allocate
  * @param[in] clr A function to be called when the allocated memory is freed.
  *                This pointer may be NULL
+ * @param[in] a A pointer to the allocator from which to allocate the
+ *              memory. NULL selects the process-wide default allocator
  */
-void cstl_shared_ptr_alloc(
-    cstl_shared_ptr_t * sp, size_t sz, cstl_xtor_func_t * clr);
+void __cstl_shared_ptr_alloc(
+    cstl_shared_ptr_t * sp, size_t sz, cstl_xtor_func_t * clr,
+    const cstl_allocator_t * a);
+
+/*!
+ * @brief Dynamically allocated memory to be shared via the object
+ *
+ * The supplied shared pointer object must have already been initialized
+ * and will be reset an preparation for the new allocation. The memory
+ * is allocated from the process-wide default allocator.
+ *
+ * @param[in,out] sp A pointer to the shared pointer object
+ * @param[in] sz The number of bytes to allocate
+ * @param[in] clr A function to be called when the allocated memory is freed.
+ *                This pointer may be NULL
+ */
+static inline void cstl_shared_ptr_alloc(
+    cstl_shared_ptr_t * const sp, const size_t sz,
+    cstl_xtor_func_t * const clr)
+{
+    __cstl_shared_ptr_alloc(sp, sz, clr, NULL);
+}
 
 /*!
  * @brief Determine if a shared pointer uniquely owns the underlying memory
@@ -0,0 +1,135 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_MPMC_H
+#define CSTL_MPMC_H
+
+/*!
+ * @defgroup mpmc Multi-producer, multi-consumer ring buffer
+ * @ingroup highlevel
+ * @brief A bounded queue for passing records among any number of threads
+ *
+ * Like the @ref spsc, this ring buffer is a fixed-size, circular array
+ * of records that are copied in and out, but any number of threads may
+ * add records to it and remove records from it at the same time.
+ *
+ * Each slot in the buffer carries a sequence number that tells whether
+ * the slot is ready to be written or to be read, and for which pass
+ * around the buffer. A thread claims a slot (or a run of slots) with
+ * a single compare-and-swap on the shared index, copies its record(s),
+ * and then hands each slot on by updating its sequence number. Threads
+ * only contend with each other over the index; copying records in and
+ * out of claimed slots proceeds in parallel.
+ *
+ * The queue is FIFO: records leave in the order in which their slots
+ * were claimed. A record added by one thread before another record is
+ * added by the same thread is removed first, though the two may be
+ * removed by different threads.
+ */
+/*!
+ * @addtogroup mpmc
+ * @{
+ */
+
+#include "cstl/common.h"
+
+/*! @private */
+struct cstl_mpmc_ring;
+
+/*!
+ * @brief The ring buffer object
+ *
+ * The buffer must be initialized via cstl_mpmc_init() and
+ * cleared with cstl_mpmc_clear() to release the memory held by it.
+ */
+typedef struct
+{
+    /*! @privatesection */
+    struct cstl_mpmc_ring * r;
+} cstl_mpmc_t;
+
+/*!
+ * @brief Initialize a ring buffer
+ *
+ * @param[out] q A pointer to the buffer to be initialized
+ * @param[in] n The minimum number of records that the buffer should
+ *              hold. The number is rounded up to a power of two, and
+ *              to at least two. If it is zero, the function causes an
+ *              abort
+ * @param[in] sz The size of each record. If the size is zero, the
+ *               function causes an abort
+ *
+ * @retval 0 The buffer was initialized
+ * @retval -1 Memory for the buffer could not be allocated
+ */
+int cstl_mpmc_init(cstl_mpmc_t * q, size_t n, size_t sz);
+
+/*!
+ * @brief Get the number of records the buffer can hold
+ *
+ * @param[in] q A pointer to the buffer
+ *
+ * @return The number of records the buffer can hold
+ */
+size_t cstl_mpmc_capacity(const cstl_mpmc_t * q);
+
+/*!
+ * @brief Get the number of records in the buffer
+ *
+ * While other threads are using the buffer, the number is only a
+ * snapshot of a value that may be changing. It counts records whose
+ * slots have been claimed but which are still being copied in or out.
+ *
+ * @param[in] q A pointer to the buffer
+ *
+ * @return The number of records in the buffer
+ */
+size_t cstl_mpmc_size(const cstl_mpmc_t * q);
+
+/*!
+ * @brief Add records to the buffer
+ *
+ * The records are added as a single run of consecutive slots, as many
+ * as are free, up to the number given. A batch is therefore not broken
+ * up by records from other threads.
+ *
+ * @param[in] q A pointer to the buffer
+ * @param[in] e A pointer to an array of records to be added
+ * @param[in] n The number of records in the array
+ *
+ * @return The number of records, starting from the beginning of the
+ *         array, that were added
+ */
+size_t cstl_mpmc_push(cstl_mpmc_t * q, const void * e, size_t n);
+
+/*!
+ * @brief Remove records from the buffer
+ *
+ * Records are removed, oldest first, as a single run of consecutive
+ * slots, as many as are ready to be read, up to the number given.
+ *
+ * @param[in] q A pointer to the buffer
+ * @param[out] e A pointer to an array to receive the records
+ * @param[in] n The number of records that the array can hold
+ *
+ * @return The number of records removed from the buffer
+ */
+size_t cstl_mpmc_pop(cstl_mpmc_t * q, void * e, size_t n);
+
+/*!
+ * @brief Release the memory held by the buffer
+ *
+ * Any records in the buffer are discarded. The buffer must not be
+ * in use by any other thread, and it must be initialized again
+ * before it can be reused.
+ *
+ * @param[in] q A pointer to the buffer
+ */
+void cstl_mpmc_clear(cstl_mpmc_t * q);
+
+/*!
+ * @}
+ */
+
+#endif
@@ -0,0 +1,136 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_MQUEUE_H
+#define CSTL_MQUEUE_H
+
+/*!
+ * @defgroup mqueue Concurrent priority queue
+ * @ingroup highlevel
+ * @brief A priority queue that may be used by multiple threads at once
+ *
+ * The concurrent priority queue is a "MultiQueue": a number of
+ * @ref heap objects, each protected by its own lock. An object being
+ * inserted is added to a randomly chosen heap. To remove an object, a
+ * thread chooses two heaps at random and removes the higher valued of
+ * the objects at their tops.
+ *
+ * The ordering is therefore relaxed: the object removed is not
+ * necessarily the highest valued object in the queue, but it is likely
+ * to be among the highest valued, and an object at the top of any heap
+ * is unlikely to be passed over for long. In exchange, threads seldom
+ * contend for the same lock.
+ * If a lock is busy, the thread chooses another heap rather than
+ * waiting. With a few heaps per thread, e.g. two, insertions and removals
+ * by many threads proceed largely in parallel, where a single heap behind
+ * a single lock would serialize them.
+ *
+ * Like the @ref heap, the queue is intrusive: the objects inserted
+ * into it contain a @p cstl_heap_node, and the queue allocates no
+ * memory for them.
+ *
+ * Each operation takes a pointer to the calling thread's random state,
+ * an unsigned int that the thread keeps for its own use. The state may
+ * be initialized to any value, but threads should start with different
+ * values, e.g. derived from their ids.
+ */
+/*!
+ * @addtogroup mqueue
+ * @{
+ */
+
+#include "cstl/heap.h"
+
+/*! @private */
+struct cstl_mqueue_heap;
+
+/*!
+ * @brief The concurrent priority queue object
+ *
+ * The queue may be declared on the stack or allocated. In either
+ * case, it must be initialized via cstl_mqueue_init(). The queue must
+ * be cleared with cstl_mqueue_clear() to release the memory held by it.
+ */
+typedef struct
+{
+    /*! @privatesection */
+    struct cstl_mqueue_heap * h;
+    unsigned int n;
+    /* the allocation in which the heaps are aligned */
+    void * mem;
+} cstl_mqueue_t;
+
+/*!
+ * @brief Initialize a concurrent priority queue
+ *
+ * @param[out] mq A pointer to the queue to be initialized
+ * @param[in] n The number of heaps in the queue. A small multiple of
+ *              the number of threads that will use the queue is
+ *              recommended. If the number is zero, the function
+ *              causes an abort
+ * @param[in] cmp A function that can compare objects in the queue
+ * @param[in] priv A pointer to private data that will be
+ *                 passed to the @p cmp function
+ * @param[in] off The offset of the @p cstl_heap_node object within the
+ *                object(s) that will be stored in the queue
+ *
+ * @retval 0 The queue was initialized
+ * @retval -1 Memory for the heaps could not be allocated
+ */
+int cstl_mqueue_init(cstl_mqueue_t * mq, unsigned int n,
+                     cstl_compare_func_t * cmp, void * priv, size_t off);
+
+/*!
+ * @brief Get the number of objects in the queue
+ *
+ * While other threads are modifying the queue, the number is only
+ * a snapshot of a value that may be changing.
+ *
+ * @param[in] mq A pointer to the queue
+ *
+ * @return The number of objects in the queue
+ */
+size_t cstl_mqueue_size(const cstl_mqueue_t * mq);
+
+/*!
+ * @brief Insert an object into the queue
+ *
+ * @param[in] mq A pointer to the queue
+ * @param[in] e A pointer to the object to be inserted
+ * @param[in,out] r A pointer to the calling thread's random state
+ */
+void cstl_mqueue_push(cstl_mqueue_t * mq, void * e, unsigned int * r);
+
+/*!
+ * @brief Remove a high valued object from the queue
+ *
+ * The removed object is the higher valued of the objects at the tops
+ * of two of the queue's heaps, chosen at random.
+ *
+ * @param[in] mq A pointer to the queue
+ * @param[in,out] r A pointer to the calling thread's random state
+ *
+ * @return A pointer to the removed object
+ * @retval NULL The queue is empty
+ */
+void * cstl_mqueue_pop(cstl_mqueue_t * mq, unsigned int * r);
+
+/*!
+ * @brief Remove all objects from the queue and release its memory
+ *
+ * The queue must not be in use by any other thread. The @p clr
+ * function is called for each object that was in the queue, in an
+ * unspecified order. The queue must be initialized again before
+ * it can be reused.
+ *
+ * @param[in] mq A pointer to the queue
+ * @param[in] clr A pointer to a function to be called for each object
+ */
+void cstl_mqueue_clear(cstl_mqueue_t * mq, cstl_xtor_func_t * clr);
+
+/*!
+ * @}
+ */
+
+#endif
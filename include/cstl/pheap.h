@@ -0,0 +1,256 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_PHEAP_H
+#define CSTL_PHEAP_H
+
+/*!
+ * @defgroup pheap Pairing heap
+ * @ingroup bintrees
+ * @brief A heap that can be merged with another in constant time
+ *
+ * Like the @ref heap, the pairing heap keeps the highest valued object
+ * (as determined by the associated comparison function) at the top,
+ * where it can be found in constant time. Unlike that heap, whose shape
+ * is fixed, a pairing heap is a tree in which each node may have any
+ * number of children, none of which are greater than their parent.
+ * Two such trees are merged by making the root with the lesser value
+ * a child of the other root, so inserting an object, or "melding"
+ * an entire heap into another, takes constant time. The work of
+ * restoring the shape of the tree is deferred until the top of the
+ * heap is removed, which takes O(log n) amortized time.
+ *
+ * The tree is stored in the nodes of a binary tree: the left pointer
+ * of each node points to its first child, and the right pointer to its
+ * next sibling.
+ */
+/*!
+ * @addtogroup pheap
+ * @{
+ */
+
+#include "cstl/bintree.h"
+
+/*!
+ * @brief Node to anchor an element within a pairing heap
+ *
+ * Users of the heap object declare this object within another
+ * object as follows:
+ * @code{.c}
+ * struct object {
+ *     ...
+ *     struct cstl_pheap_node heap_node;
+ *     ...
+ * };
+ * @endcode
+ *
+ * When calling cstl_pheap_init(), the caller passes the offset of
+ * @p cstl_pheap_node within their object as the @p off parameter of
+ * that function, e.g.
+ * @code{.c}
+ * offsetof(struct object, heap_node)
+ * @endcode
+ */
+struct cstl_pheap_node
+{
+    /*! @privatesection */
+    struct cstl_bintree_node bn;
+};
+
+/*!
+ * @brief Pairing heap object
+ *
+ * Callers declare or allocate an object of this type to instantiate
+ * a heap. Users are encouraged to declare (and initialize) this
+ * object with the DECLARE_CSTL_PHEAP() macro. Any other declaration or
+ * allocation must be initialized via cstl_pheap_init().
+ */
+struct cstl_pheap
+{
+    /*! @privatesection */
+    struct cstl_bintree bt;
+};
+
+/*!
+ * @brief Constant initialization of a pairing heap object
+ *
+ * @param TYPE The type of object that the heap will hold
+ * @param MEMB The name of the @p cstl_pheap_node member within @p TYPE.
+ * @param CMP A pointer to a function of type @p cstl_compare_func_t that
+ *            will be used to compare elements in the heap
+ * @param PRIV A pointer to a private data structure that will be passed
+ *             to calls to the @p CMP function
+ *
+ * @see cstl_pheap_node for a description of the relationship between
+ *                @p TYPE and @p MEMB
+ */
+#define CSTL_PHEAP_INITIALIZER(TYPE, MEMB, CMP, PRIV)                   \
+    {                                                                   \
+        .bt = CSTL_BINTREE_INITIALIZER(TYPE, MEMB.bn, CMP, PRIV),       \
+    }
+/*!
+ * @brief (Statically) declare and initialize a pairing heap
+ *
+ * @param NAME The name of the variable being declared
+ * @param TYPE The type of object that the heap will hold
+ * @param MEMB The name of the @p cstl_pheap_node member within @p TYPE.
+ * @param CMP A pointer to a function of type @p cstl_compare_func_t that
+ *            will be used to compare elements in the heap
+ * @param PRIV A pointer to a private data structure that will be passed
+ *             to calls to the @p CMP function
+ *
+ * @see cstl_pheap_node for a description of the relationship between
+ *                @p TYPE and @p MEMB
+ */
+#define DECLARE_CSTL_PHEAP(NAME, TYPE, MEMB, CMP, PRIV) \
+    struct cstl_pheap NAME =                            \
+        CSTL_PHEAP_INITIALIZER(TYPE, MEMB, CMP, PRIV)
+
+/*!
+ * @brief Initialize a pairing heap object
+ *
+ * @param[in,out] h A pointer to the object to be initialized
+ * @param[in] cmp A function that can compare objects in the heap
+ * @param[in] priv A pointer to private data that will be
+ *                 passed to the @p cmp function
+ * @param[in] off The offset of the @p cstl_pheap_node object within the
+ *                object(s) that will be stored in the heap
+ */
+static inline void cstl_pheap_init(struct cstl_pheap * const h,
+                                   cstl_compare_func_t * const cmp,
+                                   void * const priv,
+                                   const size_t off)
+{
+    cstl_bintree_init(
+        &h->bt, cmp, priv, off + offsetof(struct cstl_pheap_node, bn));
+}
+
+/*!
+ * @brief Get the number of objects in the heap
+ *
+ * @param[in] h A pointer to the heap
+ *
+ * @return The number of objects in the heap
+ */
+static inline size_t cstl_pheap_size(const struct cstl_pheap * const h)
+{
+    return cstl_bintree_size(&h->bt);
+}
+
+/*!
+ * @brief Insert a new object into the heap
+ *
+ * The object is inserted in constant time.
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] e A pointer to the object to be inserted
+ *
+ * After insertion, the inserted object must not be modified (in such a
+ * way as to affect its comparison with other objects in the heap) except
+ * as described for cstl_pheap_update().
+ */
+void cstl_pheap_push(struct cstl_pheap * h, void * e);
+
+/*!
+ * @brief Get a pointer to the object at the top of the heap
+ *
+ * @param[in] h A pointer to the heap
+ *
+ * @return A pointer to the object at the top of the heap
+ * @retval NULL The heap is empty
+ */
+const void * cstl_pheap_get(const struct cstl_pheap * h);
+
+/*!
+ * @brief Remove the highest valued element from the heap
+ *
+ * @param[in] h A pointer to the heap
+ *
+ * @return The highest valued element in the heap
+ * @retval NULL The heap is empty
+ */
+void * cstl_pheap_pop(struct cstl_pheap * h);
+
+/*!
+ * @brief Restore an object's position in the heap after its value changes
+ *
+ * An object in the heap may be modified in a way that changes its
+ * comparison with other objects in the heap so long as this function
+ * is called after the modification, before any other operation on
+ * the heap.
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] e A pointer to an object in the heap
+ */
+void cstl_pheap_update(struct cstl_pheap * h, void * e);
+
+/*!
+ * @brief Remove an arbitrary object from the heap
+ *
+ * The caller regains ownership of the removed object. The behavior
+ * is undefined if the object is not in the heap.
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] e A pointer to the object to be removed
+ */
+void cstl_pheap_erase(struct cstl_pheap * h, void * e);
+
+/*!
+ * @brief Move all of the objects in one heap into another
+ *
+ * The objects are moved in constant time, regardless of the
+ * number of objects in either heap. The heaps must hold the same
+ * type of object, compared by the same function; otherwise, the
+ * function causes an abort.
+ *
+ * @param[in,out] h A pointer to the heap into which to move the objects
+ * @param[in,out] o A pointer to the heap whose objects are to be moved.
+ *                  The heap is empty upon return
+ */
+void cstl_pheap_meld(struct cstl_pheap * h, struct cstl_pheap * o);
+
+/*!
+ * @brief Remove all elements from the heap
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] clr A pointer to a function to be called for each
+ *                element in the tree
+ *
+ * All elements are removed from the heap and the @p clr function is
+ * called for each element that was in the heap. The order in which
+ * the elements are removed and @p clr is called is not specified, but
+ * the callee may take ownership of an element at the time that @p clr
+ * is called for that element and not before.
+ *
+ * Upon return from this function, the heap contains no elements, and
+ * is as it was immediately after being initialized. No further operations
+ * on the tree are necessary to make it ready to go out of scope or be
+ * destroyed.
+ */
+static inline void cstl_pheap_clear(struct cstl_pheap * const h,
+                                    cstl_xtor_func_t * const clr)
+{
+    cstl_bintree_clear(&h->bt, clr, NULL);
+}
+
+/*!
+ * @brief Swap the heap objects at the two given locations
+ *
+ * @param[in,out] a A pointer to a heap
+ * @param[in,out] b A pointer to a(nother) heap
+ *
+ * The heaps at the given locations will be swapped such that upon return,
+ * @p a will contain the heap previously pointed to by @p b and vice versa.
+ */
+static inline void cstl_pheap_swap(
+    struct cstl_pheap * const a, struct cstl_pheap * const b)
+{
+    cstl_bintree_swap(&a->bt, &b->bt);
+}
+
+/*!
+ * @}
+ */
+
+#endif
@@ -0,0 +1,222 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_PMAP_H
+#define CSTL_PMAP_H
+
+/*!
+ * @defgroup pmap Persistent map
+ * @ingroup highlevel
+ * @brief An ordered map whose versions share structure
+ *
+ * The persistent map is a container of key/value pairs with unique keys,
+ * ordered by key, like the @ref map. Unlike that map, a copy, or
+ * "snapshot", of a persistent map can be taken in constant time. The
+ * snapshot and the original are then independent maps: changes made
+ * to one are not visible in the other.
+ *
+ * Internally, the map is a (left-leaning) red-black tree whose nodes are
+ * reference counted. A snapshot simply shares the root of the tree with
+ * the original. When either version is modified, the nodes along the path
+ * from the root to the point of modification are copied, if they are
+ * shared, rather than modified, so an update allocates O(log n) nodes.
+ * Nodes that are not shared with any other version are modified in
+ * place, so a map that has never been snapshotted (or whose snapshots
+ * have all been cleared) behaves much like an ordinary map.
+ *
+ * The nodes are never modified while they are shared, and their
+ * reference counts are maintained atomically. Therefore, different
+ * versions of the map may be read, modified, and cleared by different
+ * threads at the same time without any additional synchronization. For
+ * example, a writer can give readers a consistent view of the map by
+ * handing each of them a snapshot. However, a snapshot reads the map from
+ * which it is taken, so taking the snapshot must be synchronized with
+ * any modification of that map, just as any other read must be.
+ *
+ * The map does not manage the memory for the keys and values that it
+ * holds. Because a pair may remain in a snapshot after it has been
+ * removed from the map (or vice versa), it is up to the caller to
+ * ensure that keys and values outlive every version that contains them.
+ */
+/*!
+ * @addtogroup pmap
+ * @{
+ */
+
+#include "cstl/common.h"
+#include "cstl/allocator.h"
+
+#include <stdbool.h>
+
+/*! @private */
+struct cstl_pmap_node;
+
+/*!
+ * @brief A key/value pair within the map
+ *
+ * The pair may be shared by multiple versions of the map
+ * and must not be modified.
+ */
+typedef struct
+{
+    /*! @brief Pointer to the key */
+    const void * key;
+    /*! @brief Pointer to the value associated with the key */
+    void * val;
+} cstl_pmap_elem_t;
+
+/*!
+ * @brief The persistent map object
+ *
+ * The map may be declared on the stack or allocated. In either
+ * case, it must be initialized via cstl_pmap_init(). The map must be
+ * cleared with cstl_pmap_clear() to release the memory held by it.
+ */
+typedef struct
+{
+    /*! @privatesection */
+    struct cstl_pmap_node * root;
+    size_t size;
+
+    struct
+    {
+        /*! @privatesection */
+        cstl_compare_func_t * f;
+        void * p;
+    } cmp;
+
+    /*
+     * nodes set aside so that an update never has to allocate
+     * once it has started modifying the tree
+     */
+    struct
+    {
+        /*! @privatesection */
+        struct cstl_pmap_node * head;
+        size_t count;
+    } spare;
+
+    /* the allocator from which the map's nodes are allocated */
+    const cstl_allocator_t * allocator;
+} cstl_pmap_t;
+
+/*!
+ * @brief Initialize a persistent map
+ *
+ * @param[out] pm A pointer to the map to be initialized
+ * @param[in] cmp A pointer to a function that will be used to compare keys
+ * @param[in] priv A pointer to be passed to each call to @p cmp
+ */
+void cstl_pmap_init(cstl_pmap_t * pm, cstl_compare_func_t * cmp, void * priv);
+
+/*!
+ * @brief Set the allocator from which the map's nodes are allocated
+ *
+ * Snapshots of the map use the same allocator. The map must be empty
+ * when this function is called; otherwise, the function will cause
+ * an abort.
+ *
+ * @param[in,out] pm A pointer to the map
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+void cstl_pmap_set_allocator(cstl_pmap_t * pm, const cstl_allocator_t * a);
+
+/*!
+ * @brief Return the number of elements in the map
+ *
+ * @param[in] pm A pointer to the map
+ *
+ * @return The number of elements in the map
+ */
+static inline size_t cstl_pmap_size(const cstl_pmap_t * const pm)
+{
+    return pm->size;
+}
+
+/*!
+ * @brief Make one map a snapshot of another
+ *
+ * Any elements in @p dst are first removed as if by cstl_pmap_clear().
+ * Then, @p dst is made to contain the same elements as @p src. The
+ * two maps share all of their memory until one or the other is modified,
+ * so, aside from clearing @p dst, the operation takes constant time.
+ *
+ * @param[in] src A pointer to the map to be copied
+ * @param[in,out] dst A pointer to the (initialized) map that receives
+ *                    the snapshot
+ */
+void cstl_pmap_snapshot(const cstl_pmap_t * src, cstl_pmap_t * dst);
+
+/*!
+ * @brief Insert a key/value pair into the map
+ *
+ * @param[in] pm A pointer to the map
+ * @param[in] key A pointer to the key
+ * @param[in] val A pointer to the value
+ *
+ * @retval -1 The function failed to allocate memory; the map is unchanged
+ * @retval 0 The pair was inserted
+ * @retval 1 An element with the same key already exists in the map.
+ *           The map is unchanged
+ */
+int cstl_pmap_insert(cstl_pmap_t * pm, const void * key, void * val);
+
+/*!
+ * @brief Find the value associated with a key
+ *
+ * @param[in] pm A pointer to the map
+ * @param[in] key A pointer to the key that is sought
+ *
+ * @return A pointer to the pair containing the key, which remains
+ *         valid until the map is next modified or cleared. Modifying
+ *         or clearing other versions of the map does not invalidate it
+ * @retval NULL The key is not in the map
+ */
+const cstl_pmap_elem_t * cstl_pmap_find(const cstl_pmap_t * pm,
+                                        const void * key);
+
+/*!
+ * @brief Remove the element with the supplied key from the map
+ *
+ * @param[in] pm A pointer to the map
+ * @param[in] key A pointer to the key to be removed
+ *
+ * @retval -1 The function failed to allocate memory; the map is unchanged
+ * @retval 0 The element was removed
+ * @retval 1 No element with the supplied key exists in the map
+ */
+int cstl_pmap_erase(cstl_pmap_t * pm, const void * key);
+
+/*!
+ * @brief Visit each element in the map, in order
+ *
+ * @param[in] pm A pointer to the map
+ * @param[in] visit A function to be called for each element. The first
+ *                  argument to the function is a pointer to a
+ *                  (const) @p cstl_pmap_elem_t
+ * @param[in] priv A pointer to be passed to each invocation of @p visit
+ *
+ * @return The value returned by the @p visit function that stopped the
+ *         walk, or 0 if all elements were visited
+ */
+int cstl_pmap_foreach(const cstl_pmap_t * pm,
+                      cstl_const_visit_func_t * visit, void * priv);
+
+/*!
+ * @brief Remove all elements from the map
+ *
+ * The map gives up its references to the nodes of the tree. Nodes that
+ * are not shared with any other version of the map are freed. Other
+ * versions of the map are unaffected.
+ *
+ * @param[in,out] pm A pointer to the map
+ */
+void cstl_pmap_clear(cstl_pmap_t * pm);
+
+/*!
+ * @}
+ */
+
+#endif
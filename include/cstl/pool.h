@@ -0,0 +1,216 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_POOL_H
+#define CSTL_POOL_H
+
+/*!
+ * @defgroup pool Object pool
+ * @ingroup allocators
+ * @brief Fixed-size objects carved out of contiguous slabs
+ *
+ * The pool hands out objects of a single, fixed size. Rather than
+ * allocating each object individually, the pool allocates "slabs"
+ * large enough to hold many objects and carves objects out of them.
+ * Objects returned to the pool are kept on a free list and are
+ * recycled by subsequent allocations. Memory is only returned to
+ * the system when the pool is cleared, at which point all slabs
+ * are released at once, regardless of how many objects they held.
+ */
+/*!
+ * @addtogroup pool
+ * @{
+ */
+
+#include "cstl/allocator.h"
+
+/*! @private */
+struct cstl_pool_slab;
+
+/*!
+ * @brief Pool object
+ *
+ * Callers declare or allocate an object of this type to instantiate
+ * a pool. Users are encouraged to declare (and initialize) this
+ * object with the DECLARE_CSTL_POOL() macro. Any other declaration or
+ * allocation must be initialized via cstl_pool_init().
+ */
+struct cstl_pool
+{
+    /*! @privatesection */
+    struct cstl_pool_slab * slab;
+    /*
+     * objects that have been returned to the pool,
+     * linked through their own first bytes
+     */
+    void * free;
+    /*
+     * the range of never-allocated objects in the newest
+     * slab. objects are handed out from this range only
+     * when the free list is empty.
+     */
+    void * next, * end;
+
+    /*
+     * size of each object and number of objects per slab.
+     * @used is the number of objects currently handed out
+     */
+    size_t size, count;
+    size_t used;
+
+    /* allocator from which slabs are obtained; NULL for the default */
+    const cstl_allocator_t * allocator;
+};
+
+/*!
+ * @brief Constant initialization of a pool object
+ *
+ * @param SIZE The size of the objects that the pool will hold
+ * @param COUNT The number of objects to allocate per slab. A value
+ *              of zero selects a default number of objects
+ */
+#define CSTL_POOL_INITIALIZER(SIZE, COUNT)      \
+    {                                           \
+        .slab = NULL,                           \
+        .free = NULL,                           \
+        .next = NULL,                           \
+        .end = NULL,                            \
+        .size = SIZE,                           \
+        .count = COUNT,                         \
+        .used = 0,                              \
+        .allocator = NULL,                      \
+    }
+/*!
+ * @brief (Statically) declare and initialize a pool
+ *
+ * @param NAME The name of the variable being declared
+ * @param SIZE The size of the objects that the pool will hold
+ * @param COUNT The number of objects to allocate per slab. A value
+ *              of zero selects a default number of objects
+ */
+#define DECLARE_CSTL_POOL(NAME, SIZE, COUNT)                    \
+    struct cstl_pool NAME = CSTL_POOL_INITIALIZER(SIZE, COUNT)
+
+/*!
+ * @brief Initialize a pool object
+ *
+ * @param[out] p A pointer to the object to be initialized
+ * @param[in] size The size of the objects that the pool will hold
+ * @param[in] count The number of objects to allocate per slab. A value
+ *                  of zero selects a default number of objects
+ */
+static inline void cstl_pool_init(struct cstl_pool * const p,
+                                  const size_t size, const size_t count)
+{
+    p->slab = NULL;
+    p->free = NULL;
+    p->next = NULL;
+    p->end = NULL;
+
+    p->size = size;
+    p->count = count;
+    p->used = 0;
+
+    p->allocator = NULL;
+}
+
+/*!
+ * @brief Set the allocator from which the pool obtains its slabs
+ *
+ * The allocator may only be changed while the pool holds no slabs,
+ * i.e. immediately after initialization or after the pool has been
+ * cleared. Any attempt to change the allocator at any other time
+ * causes the program to abort.
+ *
+ * @param[in,out] p A pointer to the pool
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+void cstl_pool_set_allocator(struct cstl_pool * p, const cstl_allocator_t * a);
+
+/*!
+ * @brief Get the number of objects allocated from the pool
+ *
+ * @param[in] p A pointer to the pool
+ *
+ * @return The number of objects currently allocated from the
+ *         pool and not yet returned to it
+ */
+static inline size_t cstl_pool_size(const struct cstl_pool * const p)
+{
+    return p->used;
+}
+
+/*!
+ * @brief Get the size of the objects held by the pool
+ *
+ * @param[in] p A pointer to the pool
+ *
+ * @return The size of the objects held by the pool, as
+ *         specified when the pool was initialized
+ */
+static inline size_t cstl_pool_object_size(const struct cstl_pool * const p)
+{
+    return p->size;
+}
+
+/*!
+ * @brief Allocate an object from the pool
+ *
+ * The returned memory is uninitialized and is suitably aligned
+ * for any type of object.
+ *
+ * @param[in] p A pointer to the pool
+ *
+ * @return A pointer to the allocated object
+ * @retval NULL The pool was unable to allocate a new slab
+ */
+void * cstl_pool_alloc(struct cstl_pool * p);
+
+/*!
+ * @brief Return an object to the pool
+ *
+ * @param[in] p A pointer to the pool from which the object was allocated
+ * @param[in] obj A pointer to the object to return to the pool. This
+ *                pointer may be NULL
+ *
+ * The object's memory is not released to the system. It is kept by
+ * the pool and will be handed out by a future call to cstl_pool_alloc().
+ */
+void cstl_pool_free(struct cstl_pool * p, void * obj);
+
+/*!
+ * @brief Release all memory held by the pool
+ *
+ * @param[in] p A pointer to the pool
+ *
+ * All slabs are released, including those containing objects that
+ * have not been returned to the pool. The cost of the operation is
+ * proportional to the number of slabs, not the number of objects.
+ * Any objects still outstanding are invalid upon return. The pool
+ * is as it was immediately after being initialized.
+ */
+void cstl_pool_clear(struct cstl_pool * p);
+
+/*!
+ * @brief Swap the pool objects at the two given locations
+ *
+ * @param[in,out] a A pointer to a pool
+ * @param[in,out] b A pointer to a(nother) pool
+ *
+ * The pools at the given locations will be swapped such that upon return,
+ * @p a will contain the pool previously pointed to by @p b and vice versa.
+ */
+static inline void cstl_pool_swap(struct cstl_pool * const a,
+                                  struct cstl_pool * const b)
+{
+    struct cstl_pool t;
+    cstl_swap(a, b, &t, sizeof(t));
+}
+
+/*!
+ * @}
+ */
+
+#endif
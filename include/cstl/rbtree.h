@@ -29,6 +29,8 @@
 
 #include "cstl/bintree.h"
 
+#include <stdbool.h>
+
 /*! @private */
 typedef enum
 {
@@ -59,10 +61,28 @@ typedef enum
 struct cstl_rbtree_node
 {
     /*! @privatesection */
-    cstl_rbtree_color_t c;
+    /* the node's color is kept in the flag bit of the binary tree node */
     struct cstl_bintree_node n;
 };
 
+/*!
+ * @brief Node to anchor an element within a ranked red-black tree
+ *
+ * The elements of a tree that maintains order statistics must be
+ * anchored by this node rather than by a cstl_rbtree_node. The node
+ * is declared and its offset passed to cstl_rbtree_init() (or to
+ * DECLARE_CSTL_RBTREE()) in the same way.
+ *
+ * @see cstl_rbtree_set_ranked
+ */
+struct cstl_rbtree_ranked_node
+{
+    /*! @privatesection */
+    struct cstl_rbtree_node n;
+    /* the number of nodes in the subtree rooted at this node */
+    size_t size;
+};
+
 /*!
  * @brief Red-black tree object
  *
@@ -77,6 +97,8 @@ struct cstl_rbtree
     struct cstl_bintree t;
 
     size_t off;
+    /* whether subtree sizes are maintained */
+    bool ranked;
 };
 
 /*!
@@ -92,10 +114,14 @@ struct cstl_rbtree
  * @see cstl_rbtree_node for a description of the relationship between
  *                  @p TYPE and @p MEMB
  */
-#define CSTL_RBTREE_INITIALIZER(TYPE, MEMB, CMP, PRIV)          \
-    {                                                           \
-        .t = CSTL_BINTREE_INITIALIZER(TYPE, MEMB.n, CMP, PRIV), \
-        .off = offsetof(TYPE, MEMB),                            \
+#define CSTL_RBTREE_INITIALIZER(TYPE, MEMB, CMP, PRIV)        \
+    {                                                         \
+        .t = _CSTL_BINTREE_INITIALIZER(                       \
+            offsetof(TYPE, MEMB)                              \
+            + offsetof(struct cstl_rbtree_node, n),           \
+            CMP, PRIV),                                       \
+        .off = offsetof(TYPE, MEMB),                          \
+        .ranked = false,                                      \
     }
 /*!
  * @brief (Statically) declare and initialize a red-black tree
@@ -133,8 +159,34 @@ static inline void cstl_rbtree_init(struct cstl_rbtree * const t,
     cstl_bintree_init(
         &t->t, cmp, priv, off + offsetof(struct cstl_rbtree_node, n));
     t->off = off;
+    t->ranked = false;
 }
 
+/*!
+ * @brief Enable or disable order statistics for a tree
+ *
+ * A ranked tree keeps track of the number of elements in each of its
+ * subtrees, which allows the position of an element within the tree
+ * to be determined, and the element at a given position to be found,
+ * in O(log n) time. Keeping the counts up to date adds a small, constant
+ * factor to the cost of insertion and removal.
+ *
+ * The elements of a ranked tree must be anchored by a
+ * cstl_rbtree_ranked_node, which has room for the count; the nodes
+ * of any other tree carry no such overhead.
+ *
+ * The mode may only be changed while the tree is empty. Any attempt to
+ * change it at any other time causes the program to abort.
+ *
+ * @param[in,out] t A pointer to the red-black tree
+ * @param[in] ranked Whether order statistics should be maintained
+ *
+ * @see cstl_rbtree_rank
+ * @see cstl_rbtree_select
+ * @see cstl_rbtree_count_range
+ */
+void cstl_rbtree_set_ranked(struct cstl_rbtree * t, bool ranked);
+
 /*!
  * @brief Get the number of objects in the tree
  *
@@ -168,6 +220,58 @@ static inline size_t cstl_rbtree_size(const struct cstl_rbtree * const t)
  */
 void cstl_rbtree_insert(struct cstl_rbtree * t, void * e, void * p);
 
+/*!
+ * @brief Build a tree from a sorted array of objects
+ *
+ * The tree is constructed directly, in O(n) time and without comparing
+ * any of the objects, rather than by inserting the objects one at a
+ * time. The resulting tree is as balanced as possible.
+ *
+ * The tree must be empty when this function is called; otherwise, the
+ * function will cause an abort. The objects must already be sorted in
+ * ascending order according to the tree's comparison function. If they
+ * are not, the behavior of subsequent operations on the tree is undefined.
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] e An array of pointers to the objects to be inserted
+ * @param[in] n The number of objects in the array
+ */
+void cstl_rbtree_build(struct cstl_rbtree * t, void * const * e, size_t n);
+
+/*!
+ * @brief Append a sorted array of objects to a tree
+ *
+ * The objects are built into a balanced subtree which is then joined
+ * to the existing tree. The cost of the operation is O(n + log m), where
+ * n is the number of objects being appended and m is the number of
+ * elements already in the tree, and no objects are compared.
+ *
+ * The objects must be sorted in ascending order according to the
+ * tree's comparison function, and the first of them must compare as
+ * greater than every element already in the tree. If these conditions
+ * are not met, the behavior of subsequent operations on the tree is
+ * undefined.
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] e An array of pointers to the objects to be inserted
+ * @param[in] n The number of objects in the array
+ */
+void cstl_rbtree_append(struct cstl_rbtree * t, void * const * e, size_t n);
+
+/*!
+ * @private
+ *
+ * A function that returns the next object to be appended to a tree
+ */
+typedef void * (__cstl_rbtree_pull_func_t)(void *);
+/*!
+ * @private
+ *
+ * Append @p n objects, obtained in order via @p pull, to the tree
+ */
+void __cstl_rbtree_append(struct cstl_rbtree *, size_t,
+                          __cstl_rbtree_pull_func_t *, void *);
+
 /*!
  * @brief Find an element within a tree
  *
@@ -191,6 +295,122 @@ static inline const void * cstl_rbtree_find(
     return cstl_bintree_find(&t->t, e, p);
 }
 
+/*!
+ * @brief Find the first element in the tree that is not less than
+ *        a given object
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] e A pointer to an object to compare to those in the tree
+ *
+ * @return A pointer to the left-most element in the tree that compares
+ *         as greater than or equal to @p e
+ * @retval NULL All elements in the tree are less than @p e
+ */
+static inline const void * cstl_rbtree_lower_bound(
+    const struct cstl_rbtree * const t, const void * const e)
+{
+    return cstl_bintree_lower_bound(&t->t, e);
+}
+
+/*!
+ * @brief Find the first element in the tree that is greater than
+ *        a given object
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] e A pointer to an object to compare to those in the tree
+ *
+ * @return A pointer to the left-most element in the tree that compares
+ *         as greater than @p e
+ * @retval NULL No element in the tree is greater than @p e
+ */
+static inline const void * cstl_rbtree_upper_bound(
+    const struct cstl_rbtree * const t, const void * const e)
+{
+    return cstl_bintree_upper_bound(&t->t, e);
+}
+
+/*!
+ * @brief Get the element that follows another in the tree
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] e A pointer to an element in the tree. If this pointer is
+ *              NULL, the first element in the tree is returned
+ *
+ * @return A pointer to the element immediately following @p e
+ * @retval NULL @p e is the last element in the tree (or the tree is empty)
+ */
+static inline const void * cstl_rbtree_next(
+    const struct cstl_rbtree * const t, const void * const e)
+{
+    return cstl_bintree_next(&t->t, e);
+}
+
+/*!
+ * @brief Get the element that precedes another in the tree
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] e A pointer to an element in the tree. If this pointer is
+ *              NULL, the last element in the tree is returned
+ *
+ * @return A pointer to the element immediately preceding @p e
+ * @retval NULL @p e is the first element in the tree (or the tree is empty)
+ */
+static inline const void * cstl_rbtree_prev(
+    const struct cstl_rbtree * const t, const void * const e)
+{
+    return cstl_bintree_prev(&t->t, e);
+}
+
+/*!
+ * @name Order statistics
+ *
+ * These functions may only be called on a ranked tree. Calling
+ * them on any other tree causes the program to abort.
+ *
+ * @see cstl_rbtree_set_ranked
+ * @{
+ */
+
+/*!
+ * @brief Determine the position that an object has (or would have)
+ *        within the tree
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] e A pointer to an object to compare to those in the tree
+ *
+ * @return The number of elements in the tree that are less than @p e
+ */
+size_t cstl_rbtree_rank(const struct cstl_rbtree * t, const void * e);
+
+/*!
+ * @brief Find the element at a given position within the tree
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] i The (zero-based) position of the desired element
+ *
+ * @return A pointer to the element that is preceded by @p i
+ *         other elements in the tree
+ * @retval NULL @p i is not less than the number of elements in the tree
+ */
+const void * cstl_rbtree_select(const struct cstl_rbtree * t, size_t i);
+
+/*!
+ * @brief Count the elements in the tree that fall within a range
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] lo A pointer to the (inclusive) lower bound of the range
+ * @param[in] hi A pointer to the (exclusive) upper bound of the range
+ *
+ * @return The number of elements that compare as greater than or
+ *         equal to @p lo and less than @p hi
+ */
+size_t cstl_rbtree_count_range(const struct cstl_rbtree * t,
+                               const void * lo, const void * hi);
+
+/*!
+ * @}
+ */
+
 /*!
  * @brief Remove an element from the tree
  *
@@ -250,8 +470,10 @@ static inline void cstl_rbtree_swap(
     struct cstl_rbtree * const a, struct cstl_rbtree * const b)
 {
     size_t t;
+    bool r;
     cstl_bintree_swap(&a->t, &b->t);
     cstl_swap(&a->off, &b->off, &t, sizeof(t));
+    cstl_swap(&a->ranked, &b->ranked, &r, sizeof(r));
 }
 
 /*!
@@ -280,6 +502,27 @@ int cstl_rbtree_foreach(const struct cstl_rbtree * const t,
     return cstl_bintree_foreach(&t->t, visit, priv, dir);
 }
 
+/*!
+ * @brief Visit each element in a tree, in order, calling a user-defined
+ *        function once for each element
+ *
+ * @param[in] t A pointer to the red-black tree
+ * @param[in] visit A pointer to a function to be called for each element
+ * @param[in] priv A pointer to a private data structure that will be passed
+ *                 to each call to @p visit
+ * @param[in] dir The direction in which to traverse the tree
+ *
+ * @see cstl_bintree_foreach_inorder
+ */
+static inline
+int cstl_rbtree_foreach_inorder(const struct cstl_rbtree * const t,
+                                cstl_bintree_const_visit_func_t * const visit,
+                                void * const priv,
+                                const cstl_bintree_foreach_dir_t dir)
+{
+    return cstl_bintree_foreach_inorder(&t->t, visit, priv, dir);
+}
+
 /*!
  * @brief Determine the maximum and minimum heights of a tree
  *
@@ -0,0 +1,192 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_RHEAP_H
+#define CSTL_RHEAP_H
+
+/*!
+ * @defgroup rheap Radix heap
+ * @ingroup lowlevel
+ * @brief A priority queue for integer keys that are removed in order
+ *
+ * A radix heap holds objects, each with an associated unsigned integer
+ * key, and removes them in order from the lowest key to the highest.
+ * The heap is "monotone": the key of an object being inserted may not
+ * be less than the key of the object most recently removed. Event
+ * simulations and shortest path searches, in which new objects are
+ * never scheduled in the past, obey this restriction.
+ *
+ * Rather than comparing objects with each other, the heap places each
+ * object into one of a number of lists, or "buckets", according to the
+ * highest bit in which its key differs from the most recently removed
+ * key. Objects are inserted in constant time. When the bucket of objects
+ * whose keys are equal to the last key runs dry, the lowest nonempty
+ * bucket is emptied into the buckets below it, relative to the lowest
+ * key within it. Each object can only move downward, at most once for
+ * each bit in the key, so the removal of an object takes O(log C)
+ * amortized time, where C is the largest difference between a key and
+ * the last key removed.
+ */
+/*!
+ * @addtogroup rheap
+ * @{
+ */
+
+#include "cstl/dlist.h"
+
+#include <limits.h>
+
+/*!
+ * @brief Node to anchor an element within a radix heap
+ *
+ * Users of the heap object declare this object within another
+ * object as follows:
+ * @code{.c}
+ * struct object {
+ *     ...
+ *     struct cstl_rheap_node heap_node;
+ *     ...
+ * };
+ * @endcode
+ *
+ * When calling cstl_rheap_init(), the caller passes the offset of
+ * @p cstl_rheap_node within their object as the @p off parameter of
+ * that function, e.g.
+ * @code{.c}
+ * offsetof(struct object, heap_node)
+ * @endcode
+ */
+struct cstl_rheap_node
+{
+    /*! @privatesection */
+    struct cstl_dlist_node ln;
+    unsigned long key;
+};
+
+/*!
+ * @brief Radix heap object
+ *
+ * Callers declare or allocate an object of this type to instantiate
+ * a heap. The object must be initialized via cstl_rheap_init().
+ */
+struct cstl_rheap
+{
+    /*!
+     * @privatesection
+     *
+     * bucket 0 holds objects whose keys are equal to the base
+     * key, @last. bucket i + 1 holds objects whose keys differ
+     * from the base first in bit i. the base is the key of the
+     * object most recently removed, unless a call to get() has
+     * since raised it to the lowest key in the heap
+     */
+    struct cstl_dlist b[sizeof(unsigned long) * CHAR_BIT + 1];
+    unsigned long last;
+    /* the key of the object most recently removed */
+    unsigned long floor;
+    size_t size;
+
+    size_t off;
+};
+
+/*!
+ * @brief Initialize a radix heap object
+ *
+ * @param[in,out] h A pointer to the object to be initialized
+ * @param[in] off The offset of the @p cstl_rheap_node object within the
+ *                object(s) that will be stored in the heap
+ */
+void cstl_rheap_init(struct cstl_rheap * h, size_t off);
+
+/*!
+ * @brief Get the number of objects in the heap
+ *
+ * @param[in] h A pointer to the heap
+ *
+ * @return The number of objects in the heap
+ */
+static inline size_t cstl_rheap_size(const struct cstl_rheap * const h)
+{
+    return h->size;
+}
+
+/*!
+ * @brief Insert a new object into the heap
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] e A pointer to the object to be inserted
+ * @param[in] key The key with which to associate the object. The key
+ *                must not be less than that of the object most recently
+ *                removed from the heap; otherwise, the function will
+ *                cause an abort
+ */
+void cstl_rheap_push(struct cstl_rheap * h, void * e, unsigned long key);
+
+/*!
+ * @brief Get a pointer to the object with the lowest key
+ *
+ * If more than one object has the lowest key, which one is
+ * returned is not specified, but it will be the one removed by
+ * a subsequent call to cstl_rheap_pop().
+ *
+ * Finding the object may require the objects in the heap to
+ * be rearranged; therefore, the heap is not const. Unlike removing
+ * the object, finding it doesn't restrict the keys that may
+ * subsequently be inserted into the heap.
+ *
+ * @param[in] h A pointer to the heap
+ * @param[out] key A pointer to a location in which to return the key
+ *                 associated with the object. The pointer may be NULL
+ *
+ * @return A pointer to the object with the lowest key
+ * @retval NULL The heap is empty
+ */
+void * cstl_rheap_get(struct cstl_rheap * h, unsigned long * key);
+
+/*!
+ * @brief Remove the object with the lowest key from the heap
+ *
+ * Removing the object establishes its key as the lowest key that
+ * may subsequently be inserted into the heap.
+ *
+ * @param[in] h A pointer to the heap
+ * @param[out] key A pointer to a location in which to return the key
+ *                 associated with the object. The pointer may be NULL
+ *
+ * @return A pointer to the removed object
+ * @retval NULL The heap is empty
+ */
+void * cstl_rheap_pop(struct cstl_rheap * h, unsigned long * key);
+
+/*!
+ * @brief Remove an arbitrary object from the heap
+ *
+ * The object is removed in constant time. The key of an object
+ * in the heap may be lowered, e.g. to shorten the tentative distance
+ * to a vertex in a shortest path search, by removing the object and
+ * inserting it again with the new key. The behavior is undefined if
+ * the object is not in the heap.
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] e A pointer to the object to be removed
+ */
+void cstl_rheap_erase(struct cstl_rheap * h, void * e);
+
+/*!
+ * @brief Remove all objects from the heap
+ *
+ * The @p clr function is called for each object that was in the heap,
+ * in an unspecified order. Upon return, the heap is as it was
+ * immediately after being initialized.
+ *
+ * @param[in] h A pointer to the heap
+ * @param[in] clr A pointer to a function to be called for each object
+ */
+void cstl_rheap_clear(struct cstl_rheap * h, cstl_xtor_func_t * clr);
+
+/*!
+ * @}
+ */
+
+#endif
@@ -0,0 +1,243 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_SKIPMAP_H
+#define CSTL_SKIPMAP_H
+
+/*!
+ * @defgroup skipmap Concurrent map
+ * @ingroup highlevel
+ * @brief An ordered map that may be used by multiple threads at once
+ *
+ * The concurrent map is a container of key/value pairs with unique keys,
+ * ordered by key, like the @ref map. Unlike that map, it may be searched
+ * and modified by any number of threads at the same time without any
+ * external locking.
+ *
+ * The map is a lock-free skip list. Searches never block and never write
+ * to shared memory; insertions and removals are made with atomic
+ * compare-and-swap operations on the links between elements, so threads
+ * only interfere with each other when they modify neighboring elements.
+ *
+ * Because a thread may be reading an element at the same time that
+ * another thread removes it, removed elements are not freed right away.
+ * Instead, the map uses epoch-based reclamation: each operation is
+ * performed within an "epoch", and memory removed during an epoch is
+ * freed once every thread that might have seen it has moved on to a
+ * later epoch. To take part, each thread attaches itself to the map,
+ * obtaining a handle through which it performs its operations. A handle
+ * must only be used by one thread at a time.
+ *
+ * The map does not manage the memory for the keys and values that it
+ * holds. Because other threads may still be reading a pair after it has
+ * been removed from the map, a caller that frees keys or values upon
+ * removal must arrange its own means of deferring that.
+ */
+/*!
+ * @addtogroup skipmap
+ * @{
+ */
+
+#include "cstl/common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/*!
+ * @brief The maximum number of levels in the skip list
+ *
+ * Each level holds, on average, one quarter of the elements in the
+ * level beneath it, so the limit is reached only when the map holds
+ * billions of elements.
+ */
+#define CSTL_SKIPMAP_MAX_LEVEL  16
+
+/*! @private */
+struct cstl_skipmap_handle;
+
+/*!
+ * @brief A thread's handle to a concurrent map
+ *
+ * @see cstl_skipmap_attach()
+ */
+typedef struct cstl_skipmap_handle cstl_skipmap_handle_t;
+
+/*!
+ * @brief A key/value pair within the map
+ */
+typedef struct
+{
+    /*! @brief Pointer to the key */
+    const void * key;
+    /*! @brief Pointer to the value associated with the key */
+    void * val;
+} cstl_skipmap_elem_t;
+
+/*!
+ * @brief The concurrent map object
+ *
+ * The map may be declared on the stack or allocated. In either
+ * case, it must be initialized via cstl_skipmap_init(). The map must
+ * be cleared with cstl_skipmap_clear() to release the memory held by it.
+ */
+typedef struct
+{
+    /*! @privatesection */
+    /* the first link in each level of the list */
+    atomic_uintptr_t head[CSTL_SKIPMAP_MAX_LEVEL];
+    atomic_size_t size;
+
+    struct
+    {
+        /*! @privatesection */
+        cstl_compare_func_t * f;
+        void * p;
+    } cmp;
+
+    /* the current epoch */
+    atomic_uint epoch;
+    /* a list of every handle ever attached to the map */
+    atomic_uintptr_t handles;
+} cstl_skipmap_t;
+
+/*!
+ * @brief Initialize a concurrent map
+ *
+ * @param[out] sm A pointer to the map to be initialized
+ * @param[in] cmp A pointer to a function that will be used to compare keys
+ * @param[in] priv A pointer to be passed to each call to @p cmp
+ */
+void cstl_skipmap_init(cstl_skipmap_t * sm,
+                       cstl_compare_func_t * cmp, void * priv);
+
+/*!
+ * @brief Get a handle through which the calling thread can use the map
+ *
+ * Handles are not freed when they are detached; instead, they are
+ * reused by later calls to this function, so a thread may attach
+ * and detach as often as is convenient.
+ *
+ * @param[in] sm A pointer to the map
+ *
+ * @return A pointer to a handle for use by the calling thread
+ * @retval NULL Memory for the handle could not be allocated
+ */
+cstl_skipmap_handle_t * cstl_skipmap_attach(cstl_skipmap_t * sm);
+
+/*!
+ * @brief Give up a handle obtained from cstl_skipmap_attach()
+ *
+ * The handle may not be used again by the caller. Memory that was
+ * removed via the handle and could not be freed yet is freed after
+ * the handle has been reused or when the map is cleared.
+ *
+ * @param[in] h A pointer to the handle
+ */
+void cstl_skipmap_detach(cstl_skipmap_handle_t * h);
+
+/*!
+ * @brief Return the number of elements in the map
+ *
+ * While other threads are modifying the map, the number is only
+ * a snapshot of a value that may be changing.
+ *
+ * @param[in] sm A pointer to the map
+ *
+ * @return The number of elements in the map
+ */
+static inline size_t cstl_skipmap_size(cstl_skipmap_t * const sm)
+{
+    return atomic_load(&sm->size);
+}
+
+/*!
+ * @brief Insert a key/value pair into the map
+ *
+ * @param[in] h A pointer to the calling thread's handle to the map
+ * @param[in] key A pointer to the key
+ * @param[in] val A pointer to the value
+ *
+ * @retval -1 The function failed to allocate memory
+ * @retval 0 The pair was inserted
+ * @retval 1 An element with the same key already exists in the map
+ */
+int cstl_skipmap_insert(cstl_skipmap_handle_t * h,
+                        const void * key, void * val);
+
+/*!
+ * @brief Find the value associated with a key
+ *
+ * @param[in] h A pointer to the calling thread's handle to the map
+ * @param[in] key A pointer to the key that is sought
+ * @param[out] val A pointer to receive the value associated with
+ *                 the key. The pointer may be NULL
+ *
+ * @retval true The key was found
+ * @retval false The key is not in the map
+ */
+bool cstl_skipmap_find(cstl_skipmap_handle_t * h,
+                       const void * key, void ** val);
+
+/*!
+ * @brief Remove the element with the supplied key from the map
+ *
+ * @param[in] h A pointer to the calling thread's handle to the map
+ * @param[in] key A pointer to the key to be removed
+ * @param[out] val A pointer to receive the value that was associated
+ *                 with the key. The pointer may be NULL
+ *
+ * @retval 0 The element was removed
+ * @retval 1 No element with the supplied key exists in the map
+ */
+int cstl_skipmap_erase(cstl_skipmap_handle_t * h,
+                       const void * key, void ** val);
+
+/*!
+ * @brief Visit, in order, each element in the map whose key
+ *        falls within a range
+ *
+ * Elements whose keys compare as greater than or equal to @p lo and less
+ * than @p hi are visited. Either bound may be NULL, in which case the
+ * range is unbounded at that end.
+ *
+ * The walk is not atomic with respect to other threads: an element
+ * inserted into or removed from the range while the walk is in progress
+ * may or may not be visited, but every element that is in the range for
+ * the duration of the walk is visited exactly once, in order.
+ *
+ * @param[in] h A pointer to the calling thread's handle to the map
+ * @param[in] lo A pointer to the (inclusive) lower bound of the range
+ * @param[in] hi A pointer to the (exclusive) upper bound of the range
+ * @param[in] visit A function to be called for each element. The first
+ *                  argument to the function is a pointer to a
+ *                  (const) @p cstl_skipmap_elem_t
+ * @param[in] priv A pointer to be passed to each invocation of @p visit
+ *
+ * @return The value returned by the @p visit function that stopped the
+ *         walk, or 0 if all elements in the range were visited
+ */
+int cstl_skipmap_foreach_range(cstl_skipmap_handle_t * h,
+                               const void * lo, const void * hi,
+                               cstl_const_visit_func_t * visit, void * priv);
+
+/*!
+ * @brief Remove all elements from the map and free all of its memory
+ *
+ * No other thread may be using the map, and all handles to the map
+ * are invalidated.
+ *
+ * @param[in,out] sm A pointer to the map
+ * @param[in] clr A function to be called for each element in the map.
+ *                The first argument to the function is a pointer to a
+ *                @p cstl_skipmap_elem_t. The pointer may be NULL
+ * @param[in] priv A pointer to be passed to each invocation of @p clr
+ */
+void cstl_skipmap_clear(cstl_skipmap_t * sm,
+                        cstl_xtor_func_t * clr, void * priv);
+
+/*!
+ * @}
+ */
+
+#endif
@@ -0,0 +1,135 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_SPSC_H
+#define CSTL_SPSC_H
+
+/*!
+ * @defgroup spsc Single-producer, single-consumer ring buffer
+ * @ingroup highlevel
+ * @brief A bounded queue for passing records from one thread to another
+ *
+ * The ring buffer is a fixed-size, circular array of records through
+ * which one thread, the producer, passes records to another, the
+ * consumer. Records are copied into the buffer by the producer and
+ * out of it by the consumer, and neither thread ever waits for the
+ * other: when the buffer is full (or empty), the producer (or
+ * consumer) is told so and may do something else, e.g. yield, before
+ * trying again.
+ *
+ * The buffer is lock-free and uses no atomic read-modify-write
+ * operations; each thread writes only its own index into the buffer,
+ * and the two indices are kept on separate cache lines. Each thread
+ * also keeps a private copy of the other thread's index and only reads
+ * the shared one, pulling its cache line away from the other thread,
+ * when the copy shows the buffer to be full (or empty).
+ *
+ * Records may be passed in batches; a batch costs the same
+ * synchronization as a single record.
+ */
+/*!
+ * @addtogroup spsc
+ * @{
+ */
+
+#include "cstl/common.h"
+
+/*! @private */
+struct cstl_spsc_ring;
+
+/*!
+ * @brief The ring buffer object
+ *
+ * The buffer must be initialized via cstl_spsc_init() and
+ * cleared with cstl_spsc_clear() to release the memory held by it.
+ */
+typedef struct
+{
+    /*! @privatesection */
+    struct cstl_spsc_ring * r;
+} cstl_spsc_t;
+
+/*!
+ * @brief Initialize a ring buffer
+ *
+ * @param[out] q A pointer to the buffer to be initialized
+ * @param[in] n The minimum number of records that the buffer should
+ *              hold. The number is rounded up to a power of two. If it
+ *              is zero, the function causes an abort
+ * @param[in] sz The size of each record. If the size is zero, the
+ *               function causes an abort
+ *
+ * @retval 0 The buffer was initialized
+ * @retval -1 Memory for the buffer could not be allocated
+ */
+int cstl_spsc_init(cstl_spsc_t * q, size_t n, size_t sz);
+
+/*!
+ * @brief Get the number of records the buffer can hold
+ *
+ * @param[in] q A pointer to the buffer
+ *
+ * @return The number of records the buffer can hold
+ */
+size_t cstl_spsc_capacity(const cstl_spsc_t * q);
+
+/*!
+ * @brief Get the number of records in the buffer
+ *
+ * When called by the producer, the number may be larger than the
+ * actual number; when called by the consumer, it may be smaller.
+ *
+ * @param[in] q A pointer to the buffer
+ *
+ * @return The number of records in the buffer
+ */
+size_t cstl_spsc_size(const cstl_spsc_t * q);
+
+/*!
+ * @brief Add records to the buffer
+ *
+ * The records are copied into the buffer, in order, until all have
+ * been added or the buffer is full. This function must only be
+ * called by the producer.
+ *
+ * @param[in] q A pointer to the buffer
+ * @param[in] e A pointer to an array of records to be added
+ * @param[in] n The number of records in the array
+ *
+ * @return The number of records, starting from the beginning of the
+ *         array, that were added
+ */
+size_t cstl_spsc_push(cstl_spsc_t * q, const void * e, size_t n);
+
+/*!
+ * @brief Remove records from the buffer
+ *
+ * Records are copied out of the buffer, oldest first, until the array
+ * is full or the buffer is empty. This function must only be called
+ * by the consumer.
+ *
+ * @param[in] q A pointer to the buffer
+ * @param[out] e A pointer to an array to receive the records
+ * @param[in] n The number of records that the array can hold
+ *
+ * @return The number of records removed from the buffer
+ */
+size_t cstl_spsc_pop(cstl_spsc_t * q, void * e, size_t n);
+
+/*!
+ * @brief Release the memory held by the buffer
+ *
+ * Any records in the buffer are discarded. The buffer must not be
+ * in use by any other thread, and it must be initialized again
+ * before it can be reused.
+ *
+ * @param[in] q A pointer to the buffer
+ */
+void cstl_spsc_clear(cstl_spsc_t * q);
+
+/*!
+ * @}
+ */
+
+#endif
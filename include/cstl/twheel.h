@@ -0,0 +1,210 @@
+/*!
+ * @file
+ */
+
+#ifndef CSTL_TWHEEL_H
+#define CSTL_TWHEEL_H
+
+/*!
+ * @defgroup twheel Timer wheel
+ * @ingroup lowlevel
+ * @brief A collection of timers that expire at future ticks of a clock
+ *
+ * The timer wheel holds objects, each scheduled to expire at a given
+ * tick of a clock whose unit is chosen by the caller, e.g. milliseconds.
+ * The clock is moved forward by the caller, and the objects whose ticks
+ * have been reached are removed and passed to a caller-supplied function.
+ *
+ * The wheel consists of several levels of lists, or "slots". Each slot
+ * in the lowest level holds the objects that expire at a single tick
+ * within the next 64 ticks. Each slot in each successive level covers
+ * 64 times as many ticks as a slot in the level below it. When the
+ * clock reaches the range of ticks covered by a higher slot, the objects
+ * in it are redistributed into the level below. Scheduling an object and
+ * cancelling it both take constant time, as does the removal of each
+ * expired object. The work of moving an object down through the levels,
+ * which is bounded by the number of levels, is only done for objects that
+ * are not cancelled before their slots are reached, and objects that are
+ * cancelled early, e.g. timeouts for network requests that complete, are
+ * never touched again.
+ */
+/*!
+ * @addtogroup twheel
+ * @{
+ */
+
+#include "cstl/dlist.h"
+
+#include <limits.h>
+#include <stdbool.h>
+
+/*! @private */
+#define CSTL_TWHEEL_BITS        6
+/*! @private */
+#define CSTL_TWHEEL_SLOTS       (1 << CSTL_TWHEEL_BITS)
+#if ULONG_MAX > 0xffffffffUL
+/*! @private */
+#define CSTL_TWHEEL_LEVELS      6
+#else
+#define CSTL_TWHEEL_LEVELS      5
+#endif
+
+/*!
+ * @brief Node to anchor an element within a timer wheel
+ *
+ * Users of the wheel object declare this object within another
+ * object as follows:
+ * @code{.c}
+ * struct object {
+ *     ...
+ *     struct cstl_twheel_node timer;
+ *     ...
+ * };
+ * @endcode
+ *
+ * When calling cstl_twheel_init(), the caller passes the offset of
+ * @p cstl_twheel_node within their object as the @p off parameter of
+ * that function, e.g.
+ * @code{.c}
+ * offsetof(struct object, timer)
+ * @endcode
+ */
+struct cstl_twheel_node
+{
+    /*! @privatesection */
+    struct cstl_dlist_node ln;
+    unsigned long expires;
+    /* the slot in which the object is held, if it's scheduled */
+    unsigned int slot;
+};
+
+/*!
+ * @brief Timer wheel object
+ *
+ * Callers declare or allocate an object of this type to instantiate
+ * a timer wheel. The object must be initialized via cstl_twheel_init().
+ */
+struct cstl_twheel
+{
+    /*! @privatesection */
+    struct cstl_dlist slot[CSTL_TWHEEL_LEVELS * CSTL_TWHEEL_SLOTS];
+    /* the number of objects in each level */
+    size_t count[CSTL_TWHEEL_LEVELS];
+    /* the next tick to be processed */
+    unsigned long tick;
+    size_t size;
+
+    size_t off;
+};
+
+/*!
+ * @brief The type of function called for each object that expires
+ *
+ * The object is no longer scheduled when the function is called, and
+ * the function may schedule it again. The function may also schedule
+ * and cancel other objects on the same wheel.
+ *
+ * @param[in] e A pointer to the object that expired
+ * @param[in] priv A pointer to private data passed to cstl_twheel_advance()
+ */
+typedef void cstl_twheel_expire_func_t(void * e, void * priv);
+
+/*!
+ * @brief Initialize a timer wheel
+ *
+ * @param[in,out] w A pointer to the wheel to be initialized
+ * @param[in] off The offset of the @p cstl_twheel_node object within the
+ *                object(s) that will be stored in the wheel
+ * @param[in] now The current tick of the clock; all objects scheduled
+ *                on the wheel expire at this tick or later
+ */
+void cstl_twheel_init(struct cstl_twheel * w, size_t off, unsigned long now);
+
+/*!
+ * @brief Get the number of objects scheduled on the wheel
+ *
+ * @param[in] w A pointer to the wheel
+ *
+ * @return The number of objects scheduled on the wheel
+ */
+static inline size_t cstl_twheel_size(const struct cstl_twheel * const w)
+{
+    return w->size;
+}
+
+/*!
+ * @brief Schedule an object to expire at a given tick
+ *
+ * The object must not already be scheduled. An object whose
+ * tick has already passed expires the next time the wheel is advanced.
+ *
+ * Ticks are counted in an unsigned long and are not expected to wrap.
+ * An object may be scheduled arbitrarily far into the future, but one
+ * beyond the range of the wheel (2^36 ticks where an unsigned long has
+ * 64 bits) is redistributed once for each range of ticks that passes
+ * until it's within range.
+ *
+ * @param[in] w A pointer to the wheel
+ * @param[in] e A pointer to the object to be scheduled
+ * @param[in] expires The tick at which the object should expire
+ */
+void cstl_twheel_schedule(struct cstl_twheel * w,
+                          void * e, unsigned long expires);
+
+/*!
+ * @brief Remove an object from the wheel before it expires
+ *
+ * The object must have been scheduled on the wheel at least once,
+ * but it may have since expired or been cancelled.
+ *
+ * @param[in] w A pointer to the wheel
+ * @param[in] e A pointer to the object to be cancelled
+ *
+ * @retval true The object was scheduled and has been removed
+ * @retval false The object was not scheduled
+ */
+bool cstl_twheel_cancel(struct cstl_twheel * w, void * e);
+
+/*!
+ * @brief Move the clock forward, expiring objects as their ticks arrive
+ *
+ * Each tick from the one following the last tick to which the wheel
+ * was advanced (or the tick at which it was initialized) through the
+ * given tick is processed in turn. The objects expiring at each tick are
+ * removed, and the @p f function is called for each one, before the
+ * next tick is processed. An object scheduled by @p f for a tick that
+ * is not in the future is considered to expire at the next tick.
+ *
+ * Ranges of ticks in which no objects can expire are skipped, so the
+ * cost of advancing the clock depends on the number of objects that
+ * expire rather than on the number of ticks.
+ *
+ * @param[in] w A pointer to the wheel
+ * @param[in] now The tick to which to advance the clock. If it isn't
+ *                later than the current tick, nothing happens
+ * @param[in] f A pointer to a function to be called for each
+ *              expired object
+ * @param[in] priv A pointer to private data passed to @p f
+ *
+ * @return The number of objects that expired
+ */
+size_t cstl_twheel_advance(struct cstl_twheel * w, unsigned long now,
+                           cstl_twheel_expire_func_t * f, void * priv);
+
+/*!
+ * @brief Remove all objects from the wheel
+ *
+ * The @p clr function is called for each object that was scheduled,
+ * in an unspecified order, after the object has been removed. The
+ * clock is not changed.
+ *
+ * @param[in] w A pointer to the wheel
+ * @param[in] clr A pointer to a function to be called for each object
+ */
+void cstl_twheel_clear(struct cstl_twheel * w, cstl_xtor_func_t * clr);
+
+/*!
+ * @}
+ */
+
+#endif
@@ -16,6 +16,7 @@
  */
 
 #include "cstl/common.h"
+#include "cstl/allocator.h"
 
 #include <sys/types.h>
 
@@ -44,6 +45,8 @@ typedef struct cstl_vector
         } xtor;
     } elem;
     size_t count, cap;
+
+    const cstl_allocator_t * allocator;
 } cstl_vector_t;
 
 /*!
@@ -64,6 +67,7 @@ typedef struct cstl_vector
         },                                      \
         .count = 0,                             \
         .cap = 0,                               \
+        .allocator = NULL,                      \
     }
 /*!
  * @brief (Statically) declare and initialize a vector
@@ -113,6 +117,8 @@ static inline void cstl_vector_init_complex(
 
     v->count = 0;
     v->cap = 0;
+
+    v->allocator = NULL;
 }
 
 /*!
@@ -128,6 +134,23 @@ static inline void cstl_vector_init(
     cstl_vector_init_complex(v, sz, NULL, NULL, NULL);
 }
 
+/*!
+ * @brief Set the allocator used by the vector
+ *
+ * The allocator may only be changed while the vector holds no memory,
+ * i.e. after initialization and before any elements have been added
+ * or any capacity reserved, or after the vector has been cleared. An
+ * attempt to change the allocator at any other time causes the
+ * program to abort. The allocator is retained when the vector is
+ * cleared.
+ *
+ * @param[in,out] v A pointer to the vector object
+ * @param[in] a A pointer to the allocator. NULL selects the
+ *              process-wide default allocator
+ */
+void cstl_vector_set_allocator(struct cstl_vector * v,
+                               const cstl_allocator_t * a);
+
 /*!
  * @brief Get the number of elements in the vector
  *
@@ -260,6 +283,156 @@ static inline void cstl_vector_sort(
     __cstl_vector_sort(v, cmp, priv, cstl_swap, CSTL_SORT_ALGORITHM_DEFAULT);
 }
 
+/*!
+ * @brief Partially order the vector around its n-th element
+ *
+ * @param[in] v A pointer to the vector
+ * @param[in] n The index of the element to be put in its sorted position
+ * @param[in] cmp A pointer to a function to use to compare elements
+ * @param[in] priv A pointer to be passed to each invocation
+ *            of the comparison function
+ * @param[in] swap A function to be used to swap elements within the vector.
+ *
+ * @see cstl_raw_array_nth_element()
+ */
+void __cstl_vector_nth_element(struct cstl_vector * v, size_t n,
+                               cstl_compare_func_t * cmp, void * priv,
+                               cstl_swap_func_t * swap);
+
+/*!
+ * @brief Partially order the vector around its n-th element
+ *
+ * @param[in] v A pointer to the vector
+ * @param[in] n The index of the element to be put in its sorted position
+ * @param[in] cmp A pointer to a function to use to compare elements
+ * @param[in] priv A pointer to be passed to each invocation
+ *            of the comparison function
+ *
+ * @note Elements within the vector will be rearranged via a "simple copy".
+ *
+ * @see cstl_raw_array_nth_element()
+ */
+static inline void cstl_vector_nth_element(
+    struct cstl_vector * const v, const size_t n,
+    cstl_compare_func_t * const cmp, void * const priv)
+{
+    __cstl_vector_nth_element(v, n, cmp, priv, cstl_swap);
+}
+
+/*!
+ * @brief Sort the least elements of the vector
+ *
+ * @param[in] v A pointer to the vector
+ * @param[in] k The number of (least) elements to be sorted
+ * @param[in] cmp A pointer to a function to use to compare elements
+ * @param[in] priv A pointer to be passed to each invocation
+ *            of the comparison function
+ * @param[in] swap A function to be used to swap elements within the vector.
+ *
+ * @see cstl_raw_array_partial_sort()
+ */
+void __cstl_vector_partial_sort(struct cstl_vector * v, size_t k,
+                                cstl_compare_func_t * cmp, void * priv,
+                                cstl_swap_func_t * swap);
+
+/*!
+ * @brief Sort the least elements of the vector
+ *
+ * @param[in] v A pointer to the vector
+ * @param[in] k The number of (least) elements to be sorted
+ * @param[in] cmp A pointer to a function to use to compare elements
+ * @param[in] priv A pointer to be passed to each invocation
+ *            of the comparison function
+ *
+ * @note Elements within the vector will be rearranged via a "simple copy".
+ *
+ * @see cstl_raw_array_partial_sort()
+ */
+static inline void cstl_vector_partial_sort(
+    struct cstl_vector * const v, const size_t k,
+    cstl_compare_func_t * const cmp, void * const priv)
+{
+    __cstl_vector_partial_sort(v, k, cmp, priv, cstl_swap);
+}
+
+/*!
+ * @brief Offer an element to a vector of (at most) the k least elements
+ *
+ * Until the vector holds @p k elements, it grows by one element,
+ * constructed as by cstl_vector_resize(), with each call, and the
+ * offered element is exchanged with the new one. After that, the
+ * offered element is exchanged with the greatest element in the vector
+ * if it is less than that element. Between calls, the vector is kept
+ * as a heap, so its elements should not otherwise be modified until
+ * the last one has been offered and the vector has been put in order
+ * with cstl_vector_top_k_sort().
+ *
+ * @param[in] v A pointer to the vector
+ * @param[in] k The maximum number of elements to be held in the vector
+ * @param[in,out] e A pointer to the offered element
+ * @param[in] cmp A pointer to a function to use to compare elements
+ * @param[in] priv A pointer to be passed to each invocation
+ *            of the comparison function
+ * @param[in] swap A function to be used to swap elements within the vector.
+ *
+ * @see cstl_raw_array_top_k_push()
+ */
+void __cstl_vector_top_k_push(struct cstl_vector * v,
+                              size_t k, void * e,
+                              cstl_compare_func_t * cmp, void * priv,
+                              cstl_swap_func_t * swap);
+
+/*!
+ * @brief Offer an element to a vector of (at most) the k least elements
+ *
+ * @param[in] v A pointer to the vector
+ * @param[in] k The maximum number of elements to be held in the vector
+ * @param[in,out] e A pointer to the offered element
+ * @param[in] cmp A pointer to a function to use to compare elements
+ * @param[in] priv A pointer to be passed to each invocation
+ *            of the comparison function
+ *
+ * @note Elements within the vector will be rearranged via a "simple copy".
+ *
+ * @see __cstl_vector_top_k_push()
+ */
+static inline void cstl_vector_top_k_push(
+    struct cstl_vector * const v, const size_t k, void * const e,
+    cstl_compare_func_t * const cmp, void * const priv)
+{
+    __cstl_vector_top_k_push(v, k, e, cmp, priv, cstl_swap);
+}
+
+/*!
+ * @brief Sort the elements collected by cstl_vector_top_k_push()
+ *
+ * @param[in] v A pointer to the vector
+ * @param[in] cmp A pointer to a function to use to compare elements
+ * @param[in] priv A pointer to be passed to each invocation
+ *            of the comparison function
+ * @param[in] swap A function to be used to swap elements within the vector.
+ */
+void __cstl_vector_top_k_sort(struct cstl_vector * v,
+                              cstl_compare_func_t * cmp, void * priv,
+                              cstl_swap_func_t * swap);
+
+/*!
+ * @brief Sort the elements collected by cstl_vector_top_k_push()
+ *
+ * @param[in] v A pointer to the vector
+ * @param[in] cmp A pointer to a function to use to compare elements
+ * @param[in] priv A pointer to be passed to each invocation
+ *            of the comparison function
+ *
+ * @note Elements within the vector will be rearranged via a "simple copy".
+ */
+static inline void cstl_vector_top_k_sort(
+    struct cstl_vector * const v,
+    cstl_compare_func_t * const cmp, void * const priv)
+{
+    __cstl_vector_top_k_sort(v, cmp, priv, cstl_swap);
+}
+
 /*!
  * @brief Perform a binary search of the vector
  *
@@ -331,6 +504,9 @@ void cstl_vector_swap(struct cstl_vector * a, struct cstl_vector * b);
  * @brief Return a vector to its initialized state
  *
  * @param[in] v A pointer to a vector
+ *
+ * The vector retains its element size, constructor and destructor,
+ * and allocator.
  */
 void cstl_vector_clear(struct cstl_vector * v);
 
@@ -4,6 +4,9 @@
 #include <check.h>
 #include <signal.h>
 #include <setjmp.h>
+#include <stdlib.h>
+
+#include "cstl/allocator.h"
 
 void ck_handle_signal(int, siginfo_t *, void *);
 
@@ -32,4 +35,64 @@ void ck_handle_signal(int, siginfo_t *, void *);
         }                                                               \
     } while (0)
 
+/*
+ * an allocator that keeps track of the number of bytes outstanding
+ * and the number of calls made into it. since the allocator's free
+ * and realloc functions are told the size of the memory, tests can
+ * verify that objects report sizes consistently by checking that
+ * the number of outstanding bytes returns to zero
+ */
+struct ck_counting_allocator
+{
+    cstl_allocator_t a;
+    size_t bytes;
+    unsigned int calls;
+};
+
+static inline void * ck_counting_alloc(const size_t sz, void * const priv)
+{
+    struct ck_counting_allocator * const ca = priv;
+    void * const p = malloc(sz);
+    if (p != NULL) {
+        ca->bytes += sz;
+    }
+    ca->calls++;
+    return p;
+}
+
+static inline void * ck_counting_realloc(void * const ptr,
+                                         const size_t osz, const size_t nsz,
+                                         void * const priv)
+{
+    struct ck_counting_allocator * const ca = priv;
+    void * const p = realloc(ptr, nsz);
+    if (p != NULL) {
+        ca->bytes -= osz;
+        ca->bytes += nsz;
+    }
+    ca->calls++;
+    return p;
+}
+
+static inline void ck_counting_free(void * const ptr, const size_t sz,
+                                    void * const priv)
+{
+    struct ck_counting_allocator * const ca = priv;
+    free(ptr);
+    ca->bytes -= sz;
+    ca->calls++;
+}
+
+static inline void ck_counting_allocator_init(
+    struct ck_counting_allocator * const ca)
+{
+    ca->a.alloc = ck_counting_alloc;
+    ca->a.realloc = ck_counting_realloc;
+    ca->a.free = ck_counting_free;
+    ca->a.priv = ca;
+
+    ca->bytes = 0;
+    ca->calls = 0;
+}
+
 #endif
@@ -0,0 +1,161 @@
+/*!
+ * @file
+ */
+
+#include "cstl/allocator.h"
+
+#include <stdlib.h>
+
+/*! @private */
+static void * cstl_allocator_std_alloc(const size_t sz, void * const priv)
+{
+    return malloc(sz);
+    (void)priv;
+}
+
+/*! @private */
+static void * cstl_allocator_std_realloc(void * const ptr,
+                                         const size_t osz, const size_t nsz,
+                                         void * const priv)
+{
+    return realloc(ptr, nsz);
+    (void)osz; (void)priv;
+}
+
+/*! @private */
+static void cstl_allocator_std_free(void * const ptr, const size_t sz,
+                                    void * const priv)
+{
+    free(ptr);
+    (void)sz; (void)priv;
+}
+
+/*!
+ * @private
+ *
+ * the allocator that is the default until/unless the caller
+ * changes it. it simply calls through to the standard library
+ */
+static const cstl_allocator_t cstl_allocator_std =
+    CSTL_ALLOCATOR_INITIALIZER(cstl_allocator_std_alloc,
+                               cstl_allocator_std_realloc,
+                               cstl_allocator_std_free,
+                               NULL);
+
+/*! @private */
+static const cstl_allocator_t * cstl_allocator_dflt = &cstl_allocator_std;
+
+const cstl_allocator_t * cstl_allocator_default(void)
+{
+    return cstl_allocator_dflt;
+}
+
+void cstl_allocator_set_default(const cstl_allocator_t * const a)
+{
+    if (a != NULL) {
+        cstl_allocator_dflt = a;
+    } else {
+        cstl_allocator_dflt = &cstl_allocator_std;
+    }
+}
+
+void * cstl_allocator_alloc(const cstl_allocator_t * a, const size_t sz)
+{
+    if (a == NULL) {
+        a = cstl_allocator_dflt;
+    }
+    return a->alloc(sz, a->priv);
+}
+
+void * cstl_allocator_realloc(const cstl_allocator_t * a,
+                              void * const ptr,
+                              const size_t osz, const size_t nsz)
+{
+    if (ptr == NULL) {
+        return cstl_allocator_alloc(a, nsz);
+    }
+
+    if (a == NULL) {
+        a = cstl_allocator_dflt;
+    }
+    return a->realloc(ptr, osz, nsz, a->priv);
+}
+
+void cstl_allocator_free(const cstl_allocator_t * a,
+                         void * const ptr, const size_t sz)
+{
+    if (ptr != NULL) {
+        if (a == NULL) {
+            a = cstl_allocator_dflt;
+        }
+        a->free(ptr, sz, a->priv);
+    }
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+START_TEST(dflt)
+{
+    void * p;
+
+    ck_assert_ptr_eq(cstl_allocator_default(), &cstl_allocator_std);
+
+    p = cstl_allocator_alloc(NULL, 16);
+    ck_assert_ptr_nonnull(p);
+    p = cstl_allocator_realloc(NULL, p, 16, 32);
+    ck_assert_ptr_nonnull(p);
+    cstl_allocator_free(NULL, p, 32);
+
+    p = cstl_allocator_realloc(NULL, NULL, 0, 8);
+    ck_assert_ptr_nonnull(p);
+    cstl_allocator_free(NULL, p, 8);
+    cstl_allocator_free(NULL, NULL, 0);
+}
+END_TEST
+
+START_TEST(counting)
+{
+    struct ck_counting_allocator ca;
+    void * p;
+
+    ck_counting_allocator_init(&ca);
+
+    cstl_allocator_set_default(&ca.a);
+    ck_assert_ptr_eq(cstl_allocator_default(), &ca.a);
+
+    p = cstl_allocator_alloc(NULL, 16);
+    ck_assert_uint_eq(ca.bytes, 16);
+    p = cstl_allocator_realloc(NULL, p, 16, 48);
+    ck_assert_uint_eq(ca.bytes, 48);
+    cstl_allocator_free(NULL, p, 48);
+    ck_assert_uint_eq(ca.bytes, 0);
+    ck_assert_uint_eq(ca.calls, 3);
+
+    cstl_allocator_set_default(NULL);
+    ck_assert_ptr_eq(cstl_allocator_default(), &cstl_allocator_std);
+
+    p = cstl_allocator_alloc(&ca.a, 8);
+    ck_assert_uint_eq(ca.bytes, 8);
+    cstl_allocator_free(&ca.a, p, 8);
+    ck_assert_uint_eq(ca.bytes, 0);
+}
+END_TEST
+
+Suite * allocator_suite(void)
+{
+    Suite * const s = suite_create("allocator");
+
+    TCase * tc;
+
+    tc = tcase_create("allocator");
+    tcase_add_test(tc, dflt);
+    tcase_add_test(tc, counting);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
@@ -0,0 +1,404 @@
+/*!
+ * @file
+ */
+
+#include "cstl/arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * @private
+ *
+ * a type whose alignment is (hopefully) as strict as
+ * any that the caller might want to store in the arena
+ */
+union cstl_arena_align
+{
+    void * p;
+    long l;
+    long long ll;
+    double d;
+    long double ld;
+};
+
+/*! @private */
+struct cstl_arena_chunk
+{
+    struct cstl_arena_chunk * next;
+    /* number of usable bytes in the chunk */
+    size_t size;
+    /* the usable memory follows immediately */
+    union cstl_arena_align mem[];
+};
+
+/*!
+ * @private
+ *
+ * round a request up so that the allocation that
+ * follows it will be correctly aligned. zero-sized
+ * requests are rounded up so that every allocation
+ * has a distinct address.
+ */
+static size_t cstl_arena_round(const size_t sz)
+{
+    const size_t a = sizeof(union cstl_arena_align);
+
+    if (sz == 0) {
+        return a;
+    } else if (sz > SIZE_MAX - a) {
+        return 0;
+    }
+
+    return ((sz + a - 1) / a) * a;
+}
+
+/*! @private */
+static size_t cstl_arena_chunk_size(const struct cstl_arena * const arena)
+{
+    if (arena->size == 0) {
+        return 64 * 1024;
+    }
+    return cstl_arena_round(arena->size);
+}
+
+/*! @private */
+static void cstl_arena_chunk_free(const struct cstl_arena * const arena,
+                                  struct cstl_arena_chunk * const c)
+{
+    cstl_allocator_free(arena->allocator, c, sizeof(*c) + c->size);
+}
+
+/*!
+ * @private
+ *
+ * allocate a chunk with at least @sz usable bytes. if the
+ * request is larger than a normal chunk, a dedicated chunk
+ * is allocated for it and placed behind the current chunk
+ * so that the space remaining in the current chunk is not
+ * abandoned. otherwise, the new chunk becomes current.
+ */
+static void * cstl_arena_grow(struct cstl_arena * const arena,
+                              const size_t sz)
+{
+    const size_t csz = cstl_arena_chunk_size(arena);
+    struct cstl_arena_chunk * c;
+
+    if (sz > csz && arena->chunk != NULL) {
+        c = cstl_allocator_alloc(arena->allocator, sizeof(*c) + sz);
+        if (c != NULL) {
+            c->size = sz;
+
+            c->next = arena->chunk->next;
+            arena->chunk->next = c;
+        }
+    } else {
+        const size_t usz = sz > csz ? sz : csz;
+
+        c = cstl_allocator_alloc(arena->allocator, sizeof(*c) + usz);
+        if (c != NULL) {
+            c->size = usz;
+
+            c->next = arena->chunk;
+            arena->chunk = c;
+
+            arena->next = (void *)((uintptr_t)c->mem + sz);
+            arena->end = (void *)((uintptr_t)c->mem + usz);
+        }
+    }
+
+    if (c == NULL) {
+        return NULL;
+    }
+
+    return c->mem;
+}
+
+/*!
+ * @private
+ *
+ * determine if the given pointer is the most recent
+ * allocation and resides within the current chunk
+ */
+static bool cstl_arena_is_last(const struct cstl_arena * const arena,
+                               const void * const ptr)
+{
+    return ptr != NULL && ptr == arena->last
+        && (uintptr_t)ptr >= (uintptr_t)arena->chunk->mem
+        && (uintptr_t)ptr < (uintptr_t)arena->end;
+}
+
+void * __cstl_arena_alloc(const size_t _sz, void * const priv)
+{
+    struct cstl_arena * const arena = priv;
+    const size_t sz = cstl_arena_round(_sz);
+    void * p;
+
+    if (sz == 0) {
+        return NULL;
+    }
+
+    if (sz <= (uintptr_t)arena->end - (uintptr_t)arena->next) {
+        p = arena->next;
+        arena->next = (void *)((uintptr_t)p + sz);
+    } else {
+        p = cstl_arena_grow(arena, sz);
+    }
+
+    if (p != NULL) {
+        arena->last = p;
+    }
+
+    return p;
+}
+
+void * __cstl_arena_realloc(void * const ptr,
+                            const size_t osz, const size_t _nsz,
+                            void * const priv)
+{
+    struct cstl_arena * const arena = priv;
+    const size_t nsz = cstl_arena_round(_nsz);
+    void * p;
+
+    if (nsz == 0) {
+        return NULL;
+    }
+
+    if (cstl_arena_is_last(arena, ptr)
+        && nsz <= (uintptr_t)arena->end - (uintptr_t)ptr) {
+        /*
+         * the most recent allocation from the current chunk
+         * can be grown or shrunk simply by moving the pointer
+         */
+        arena->next = (void *)((uintptr_t)ptr + nsz);
+        return ptr;
+    } else if (nsz <= cstl_arena_round(osz)) {
+        /* shrinking any other allocation is a no-op */
+        return ptr;
+    }
+
+    p = __cstl_arena_alloc(nsz, arena);
+    if (p != NULL) {
+        memcpy(p, ptr, osz);
+    }
+
+    return p;
+}
+
+void __cstl_arena_free(void * const ptr, const size_t sz, void * const priv)
+{
+    struct cstl_arena * const arena = priv;
+
+    if (cstl_arena_is_last(arena, ptr)) {
+        /* give the space back to the current chunk */
+        arena->next = ptr;
+        arena->last = NULL;
+    }
+
+    (void)sz;
+}
+
+void cstl_arena_set_allocator(struct cstl_arena * const arena,
+                              const cstl_allocator_t * const a)
+{
+    if (arena->chunk != NULL) {
+        abort();
+    }
+
+    arena->allocator = a;
+}
+
+void cstl_arena_reset(struct cstl_arena * const arena)
+{
+    struct cstl_arena_chunk * const c = arena->chunk;
+
+    if (c != NULL) {
+        struct cstl_arena_chunk * n, * t;
+
+        for (n = c->next; n != NULL; n = t) {
+            t = n->next;
+            cstl_arena_chunk_free(arena, n);
+        }
+
+        c->next = NULL;
+
+        arena->next = c->mem;
+        arena->end = (void *)((uintptr_t)c->mem + c->size);
+        arena->last = NULL;
+    }
+}
+
+void cstl_arena_clear(struct cstl_arena * const arena)
+{
+    const cstl_allocator_t * const a = arena->allocator;
+    struct cstl_arena_chunk * c, * n;
+
+    for (c = arena->chunk; c != NULL; c = n) {
+        n = c->next;
+        cstl_arena_chunk_free(arena, c);
+    }
+
+    cstl_arena_init(arena, arena->size);
+    arena->allocator = a;
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include "cstl/vector.h"
+#include "cstl/map.h"
+
+START_TEST(alloc)
+{
+    DECLARE_CSTL_ARENA(arena, 256);
+    struct ck_counting_allocator ca;
+    void * p[64];
+    unsigned int i, j;
+
+    ck_counting_allocator_init(&ca);
+    cstl_arena_set_allocator(&arena, &ca.a);
+
+    for (i = 0; i < 64; i++) {
+        p[i] = cstl_arena_alloc(&arena, i % 17);
+        ck_assert_ptr_nonnull(p[i]);
+        ck_assert_uint_eq(
+            (uintptr_t)p[i] % sizeof(union cstl_arena_align), 0);
+        memset(p[i], i, i % 17);
+    }
+
+    /* no allocation may overlap any other */
+    for (i = 0; i < 64; i++) {
+        for (j = 0; j < i % 17; j++) {
+            ck_assert_uint_eq(((unsigned char *)p[i])[j], i);
+        }
+    }
+    ck_assert_uint_gt(ca.calls, 1);
+
+    ck_assert_signal(SIGABRT, cstl_arena_set_allocator(&arena, NULL));
+
+    cstl_arena_clear(&arena);
+    ck_assert_uint_eq(ca.bytes, 0);
+    ck_assert_ptr_null(arena.chunk);
+    ck_assert_ptr_eq(arena.allocator, &ca.a);
+}
+END_TEST
+
+START_TEST(last)
+{
+    DECLARE_CSTL_ARENA(arena, 256);
+    const cstl_allocator_t * const a = cstl_arena_allocator(&arena);
+    void * p, * q;
+
+    p = cstl_allocator_alloc(a, 16);
+    q = cstl_allocator_realloc(a, p, 16, 64);
+    /* the most recent allocation grows in place */
+    ck_assert_ptr_eq(p, q);
+
+    q = cstl_allocator_alloc(a, 16);
+    ck_assert_ptr_ne(p, q);
+    /* the most recent allocation can be reclaimed */
+    cstl_allocator_free(a, q, 16);
+    ck_assert_ptr_eq(cstl_allocator_alloc(a, 16), q);
+
+    /* other allocations are moved when they grow */
+    memset(p, 0x5a, 64);
+    q = cstl_allocator_realloc(a, p, 64, 128);
+    ck_assert_ptr_ne(p, q);
+    ck_assert_uint_eq(((unsigned char *)q)[63], 0x5a);
+
+    /* but not when they shrink */
+    ck_assert_ptr_eq(cstl_allocator_realloc(a, p, 64, 32), p);
+
+    cstl_arena_clear(&arena);
+}
+END_TEST
+
+START_TEST(oversize)
+{
+    DECLARE_CSTL_ARENA(arena, 256);
+    void * p, * q, * r;
+
+    p = cstl_arena_alloc(&arena, 16);
+    q = cstl_arena_alloc(&arena, 1024);
+    ck_assert_ptr_nonnull(q);
+    memset(q, 0, 1024);
+
+    /* the oversized chunk didn't displace the current one */
+    r = cstl_arena_alloc(&arena, 16);
+    ck_assert_ptr_eq(r, (void *)((uintptr_t)p + cstl_arena_round(16)));
+
+    /* the oversized allocation can't be grown in place */
+    ck_assert_ptr_ne(__cstl_arena_realloc(q, 1024, 2048, &arena), q);
+
+    cstl_arena_reset(&arena);
+    ck_assert_ptr_null(arena.chunk->next);
+    ck_assert_ptr_eq(cstl_arena_alloc(&arena, 16), p);
+
+    cstl_arena_clear(&arena);
+}
+END_TEST
+
+static int arena_int_cmp(const void * const a, const void * const b,
+                         void * const p)
+{
+    (void)p;
+    return (intptr_t)a - (intptr_t)b;
+}
+
+START_TEST(containers)
+{
+    DECLARE_CSTL_ARENA(arena, 0);
+    struct ck_counting_allocator ca;
+    unsigned int i, j;
+
+    ck_counting_allocator_init(&ca);
+    cstl_arena_set_allocator(&arena, &ca.a);
+
+    for (j = 0; j < 4; j++) {
+        DECLARE_CSTL_VECTOR(v, int);
+        cstl_map_t m;
+
+        cstl_vector_set_allocator(&v, cstl_arena_allocator(&arena));
+        cstl_map_init(&m, arena_int_cmp, NULL);
+        cstl_map_set_allocator(&m, cstl_arena_allocator(&arena));
+
+        for (i = 0; i < 500; i++) {
+            cstl_vector_resize(&v, i + 1);
+            *(int *)cstl_vector_at(&v, i) = i;
+            ck_assert_int_eq(
+                cstl_map_insert(&m, (void *)(uintptr_t)i, NULL, NULL), 0);
+        }
+        ck_assert_int_eq(*(int *)cstl_vector_at(&v, 321), 321);
+        ck_assert_uint_eq(cstl_map_size(&m), 500);
+
+        /* throw away both containers without clearing them */
+        cstl_arena_reset(&arena);
+        ck_assert_ptr_null(arena.chunk->next);
+    }
+
+    cstl_arena_clear(&arena);
+    ck_assert_uint_eq(ca.bytes, 0);
+}
+END_TEST
+
+Suite * arena_suite(void)
+{
+    Suite * const s = suite_create("arena");
+
+    TCase * tc;
+
+    tc = tcase_create("arena");
+    tcase_add_test(tc, alloc);
+    tcase_add_test(tc, last);
+    tcase_add_test(tc, oversize);
+    tcase_add_test(tc, containers);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
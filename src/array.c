@@ -129,6 +129,42 @@ static size_t cstl_raw_array_qsort_p(
     return j;
 }
 
+/*!
+ * @private
+ *
+ * sort the first, middle, and last elements of the array with
+ * respect to each other and return the index of the middle one
+ */
+static size_t cstl_raw_array_med3(
+    void * const arr, const size_t count, const size_t size,
+    cstl_compare_func_t * const cmp, void * const priv,
+    cstl_swap_func_t * const swap, void * const tmp)
+{
+    const size_t p = (count - 1) / 2;
+    void * const beg = __cstl_raw_array_at(arr, size, 0);
+    void * const mid = __cstl_raw_array_at(arr, size, p);
+    void * const end = __cstl_raw_array_at(arr, size, count - 1);
+
+    /*
+     * there are six possibilities for the ordering of elements.
+     * one possibility is that they are already in order. the
+     * remaining possibilities require either one or two swaps.
+     * three of those require swapping the outer elements, and
+     * after doing so, two of those convert to one of the
+     * remaining two possibilities that only require one swap.
+     */
+    if (cmp(end, beg, priv) < 0) {
+        swap(end, beg, tmp, size);
+    }
+    if (cmp(mid, beg, priv) < 0) {
+        swap(mid, beg, tmp, size);
+    } else if (cmp(end, mid, priv) < 0) {
+        swap(end, mid, tmp, size);
+    }
+
+    return p;
+}
+
 /*! @private */
 static void cstl_raw_array_qsort(
     void * const arr, const size_t count, const size_t size,
@@ -168,29 +204,7 @@ static void cstl_raw_array_qsort(
              * version wins on speed because it avoids another
              * partitioning and recursion below.
              */
-            void * const beg = __cstl_raw_array_at(arr, size, 0);
-            void * const end = __cstl_raw_array_at(arr, size, count - 1);
-            void * mid;
-
-            p = (count - 1) / 2;
-            mid = __cstl_raw_array_at(arr, size, p);
-
-            /*
-             * there are six possibilities for the ordering of elements.
-             * one possibility is that they are already in order. the
-             * remaining possibilities require either one or two swaps.
-             * three of those require swapping the outer elements, and
-             * after doing so, two of those convert to one of the
-             * remaining two possibilities that only require one swap.
-             */
-            if (cmp(end, beg, priv) < 0) {
-                swap(end, beg, tmp, size);
-            }
-            if (cmp(mid, beg, priv) < 0) {
-                swap(mid, beg, tmp, size);
-            } else if (cmp(end, mid, priv) < 0) {
-                swap(end, mid, tmp, size);
-            }
+            p = cstl_raw_array_med3(arr, count, size, cmp, priv, swap, tmp);
         } else {
             /* basic quicksort; just use the first element */
             p = 0;
@@ -291,6 +305,59 @@ static void cstl_raw_array_hsort_b(
     } while (n != c);
 }
 
+/*!
+ * @private
+ *
+ * the opposite of hsort_b(); the element at n may be greater than its
+ * parent (but no other element is out of place). move it up toward the
+ * root until its parent is no less than it is
+ */
+static void cstl_raw_array_hsort_u(
+    void * const arr, const size_t size,
+    size_t n,
+    cstl_compare_func_t * const cmp, void * const priv,
+    cstl_swap_func_t * const swap, void * const tmp)
+{
+    while (n > 0) {
+        const size_t p = (n - 1) / 2;
+        void * const a = __cstl_raw_array_at(arr, size, n);
+        void * const b = __cstl_raw_array_at(arr, size, p);
+
+        if (cmp(a, b, priv) <= 0) {
+            break;
+        }
+
+        swap(a, b, tmp, size);
+        n = p;
+    }
+}
+
+/*!
+ * @private
+ *
+ * with the heap formed, the greatest element is at the front
+ * of the array. swap the front element with the last element. this
+ * has the effect of moving the greatest item into its correct,
+ * sorted position and invalidating the heap by placing a (likely)
+ * incorrect item at the top. shorten the array by one, and then
+ * fix the heap by pushing the new, incorrect root down to the
+ * correct position. the new heap is formed with one less item,
+ * at which point, the process repeats.
+ */
+static void cstl_raw_array_hsort_s(
+    void * const arr, const size_t count, const size_t size,
+    cstl_compare_func_t * const cmp, void * const priv,
+    cstl_swap_func_t * const swap, void * const tmp)
+{
+    size_t i;
+
+    for (i = count - 1; i > 0; i--) {
+        swap(arr, __cstl_raw_array_at(arr, size, i), tmp, size);
+        cstl_raw_array_hsort_b(
+            arr, i, size, 0, cmp, priv, swap, tmp);
+    }
+}
+
 /*! @private */
 void cstl_raw_array_hsort(
     void * const arr, const size_t count, const size_t size,
@@ -319,21 +386,7 @@ void cstl_raw_array_hsort(
                 arr, count, size, i, cmp, priv, swap, tmp);
         }
 
-        /*
-         * with the heap now formed, the greatest element is at the front
-         * of the array. swap the front element with the last element. this
-         * has the effect of moving the greatest item into its correct,
-         * sorted position and invalidating the heap by placing a (likely)
-         * incorrect item at the top. shorten the array by one, and then
-         * fix the heap by pushing the new, incorrect root down to the
-         * correct position. the new heap is formed with one less item,
-         * at which point, the process repeats.
-         */
-        for (i = count - 1; i > 0; i--) {
-            swap(arr, __cstl_raw_array_at(arr, size, i), tmp, size);
-            cstl_raw_array_hsort_b(
-                arr, i, size, 0, cmp, priv, swap, tmp);
-        }
+        cstl_raw_array_hsort_s(arr, count, size, cmp, priv, swap, tmp);
     }
 }
 
@@ -360,6 +413,136 @@ void cstl_raw_array_sort(
     }
 }
 
+/*!
+ * @private
+ *
+ * introselect: quickselect, partitioning around a median-of-three
+ * pivot and continuing into only the side that contains the n-th
+ * element. a run of bad pivots could make that quadratic, so the
+ * number of partitions is limited (to twice the log of the count,
+ * as introsort does). once the limit is reached, whatever remains
+ * is heapsorted, putting the n-th element in place in O(n log n)
+ * time regardless of the input
+ */
+static void cstl_raw_array_select(
+    void * arr, size_t count, const size_t size,
+    size_t n,
+    cstl_compare_func_t * const cmp, void * const priv,
+    cstl_swap_func_t * const swap, void * const tmp,
+    unsigned int depth)
+{
+    while (count > 3) {
+        size_t p, m;
+
+        if (depth == 0) {
+            cstl_raw_array_hsort(arr, count, size, cmp, priv, swap, tmp);
+            return;
+        }
+        depth--;
+
+        p = cstl_raw_array_med3(arr, count, size, cmp, priv, swap, tmp);
+        m = cstl_raw_array_qsort_p(
+            arr, count, size,
+            __cstl_raw_array_at(arr, size, p),
+            cmp, priv,
+            swap, tmp);
+
+        /*
+         * nothing at or before m is greater than anything after
+         * it. only the side containing n needs further work
+         */
+        if (n <= m) {
+            count = m + 1;
+        } else {
+            arr = __cstl_raw_array_at(arr, size, m + 1);
+            count -= m + 1;
+            n -= m + 1;
+        }
+    }
+
+    if (count > 1) {
+        /* putting three (or two) elements in order sorts them */
+        cstl_raw_array_med3(arr, count, size, cmp, priv, swap, tmp);
+    }
+}
+
+void cstl_raw_array_nth_element(
+    void * const arr, const size_t count, const size_t size,
+    const size_t n,
+    cstl_compare_func_t * const cmp, void * const priv,
+    cstl_swap_func_t * const swap, void * const tmp)
+{
+    if (n >= count) {
+        abort();
+    }
+
+    cstl_raw_array_select(arr, count, size, n,
+                          cmp, priv, swap, tmp,
+                          2 * cstl_fls(count));
+}
+
+void cstl_raw_array_partial_sort(
+    void * const arr, const size_t count, const size_t size,
+    const size_t k,
+    cstl_compare_func_t * const cmp, void * const priv,
+    cstl_swap_func_t * const swap, void * const tmp)
+{
+    if (k > count) {
+        abort();
+    }
+
+    if (k == count) {
+        cstl_raw_array_sort(
+            arr, count, size, cmp, priv, swap, tmp,
+            CSTL_SORT_ALGORITHM_DEFAULT);
+    } else if (k > 0) {
+        /*
+         * bring the k least elements to the front with the
+         * greatest of them last, and then sort the ones before it
+         */
+        cstl_raw_array_nth_element(
+            arr, count, size, k - 1, cmp, priv, swap, tmp);
+        cstl_raw_array_sort(
+            arr, k - 1, size, cmp, priv, swap, tmp,
+            CSTL_SORT_ALGORITHM_DEFAULT);
+    }
+}
+
+size_t cstl_raw_array_top_k_push(
+    void * const arr, const size_t count, const size_t size,
+    const size_t k, void * const e,
+    cstl_compare_func_t * const cmp, void * const priv,
+    cstl_swap_func_t * const swap, void * const tmp)
+{
+    /*
+     * the array is kept as a heap with the greatest of
+     * the elements kept so far at the front. that's the
+     * one to be displaced by a lesser, incoming element
+     */
+    if (count > k) {
+        abort();
+    } else if (count < k) {
+        swap(__cstl_raw_array_at(arr, size, count), e, tmp, size);
+        cstl_raw_array_hsort_u(arr, size, count, cmp, priv, swap, tmp);
+        return count + 1;
+    } else if (k > 0 && cmp(e, arr, priv) < 0) {
+        swap(arr, e, tmp, size);
+        cstl_raw_array_hsort_b(arr, count, size, 0, cmp, priv, swap, tmp);
+    }
+
+    return count;
+}
+
+void cstl_raw_array_top_k_sort(
+    void * const arr, const size_t count, const size_t size,
+    cstl_compare_func_t * const cmp, void * const priv,
+    cstl_swap_func_t * const swap, void * const tmp)
+{
+    if (count > 1) {
+        cstl_raw_array_hsort_s(arr, count, size, cmp, priv, swap, tmp);
+    }
+}
+
 /*! @private */
 struct cstl_raw_array
 {
@@ -594,6 +777,152 @@ START_TEST(invalid_slice)
 }
 END_TEST
 
+static int int_cmp(const void * const a, const void * const b,
+                   void * const p)
+{
+    (void)p;
+    return *(int *)a - *(int *)b;
+}
+
+/*
+ * check that the n-th element of arr is where it would be in the
+ * sorted array, srt, with nothing greater before it or less after it
+ */
+static void ck_assert_nth_element(const int * const arr,
+                                  const int * const srt,
+                                  const size_t count, const size_t n)
+{
+    size_t i;
+
+    ck_assert_int_eq(arr[n], srt[n]);
+    for (i = 0; i < n; i++) {
+        ck_assert_int_le(arr[i], arr[n]);
+    }
+    for (i = n + 1; i < count; i++) {
+        ck_assert_int_ge(arr[i], arr[n]);
+    }
+}
+
+START_TEST(nth_element)
+{
+    static const size_t count = 113;
+
+    int arr[113], srt[113], t;
+    size_t i, n;
+
+    for (n = 0; n < count; n++) {
+        for (i = 0; i < count; i++) {
+            /* plenty of duplicates */
+            arr[i] = srt[i] = rand() % (count / 4);
+        }
+        cstl_raw_array_sort(srt, count, sizeof(*srt),
+                            int_cmp, NULL, cstl_swap, &t,
+                            CSTL_SORT_ALGORITHM_DEFAULT);
+
+        cstl_raw_array_nth_element(arr, count, sizeof(*arr), n,
+                                   int_cmp, NULL, cstl_swap, &t);
+        ck_assert_nth_element(arr, srt, count, n);
+
+        /* and again with the heapsort fallback, right from the start */
+        cstl_raw_array_reverse(arr, count, sizeof(*arr), cstl_swap, &t);
+        cstl_raw_array_select(arr, count, sizeof(*arr), n,
+                              int_cmp, NULL, cstl_swap, &t, 0);
+        ck_assert_nth_element(arr, srt, count, n);
+    }
+
+    /* sorted and reverse sorted input */
+    for (i = 0; i < count; i++) {
+        arr[i] = i;
+    }
+    cstl_raw_array_nth_element(arr, count, sizeof(*arr), count / 3,
+                               int_cmp, NULL, cstl_swap, &t);
+    ck_assert_int_eq(arr[count / 3], count / 3);
+    for (i = 0; i < count; i++) {
+        arr[i] = count - i - 1;
+    }
+    cstl_raw_array_nth_element(arr, count, sizeof(*arr), count / 3,
+                               int_cmp, NULL, cstl_swap, &t);
+    ck_assert_int_eq(arr[count / 3], count / 3);
+
+    ck_assert_signal(SIGABRT,
+                     cstl_raw_array_nth_element(
+                         arr, count, sizeof(*arr), count,
+                         int_cmp, NULL, cstl_swap, &t));
+}
+END_TEST
+
+START_TEST(partial_sort)
+{
+    static const size_t count = 97;
+
+    int arr[97], srt[97], t;
+    size_t i, k;
+
+    for (k = 0; k <= count; k++) {
+        for (i = 0; i < count; i++) {
+            arr[i] = srt[i] = rand() % count;
+        }
+        cstl_raw_array_sort(srt, count, sizeof(*srt),
+                            int_cmp, NULL, cstl_swap, &t,
+                            CSTL_SORT_ALGORITHM_DEFAULT);
+
+        cstl_raw_array_partial_sort(arr, count, sizeof(*arr), k,
+                                    int_cmp, NULL, cstl_swap, &t);
+        for (i = 0; i < k; i++) {
+            ck_assert_int_eq(arr[i], srt[i]);
+        }
+        for (; i < count; i++) {
+            ck_assert_int_ge(arr[i], srt[k - (k > 0)]);
+        }
+    }
+
+    ck_assert_signal(SIGABRT,
+                     cstl_raw_array_partial_sort(
+                         arr, count, sizeof(*arr), count + 1,
+                         int_cmp, NULL, cstl_swap, &t));
+}
+END_TEST
+
+START_TEST(top_k)
+{
+    static const size_t count = 1000, k = 10;
+
+    int srt[1000], top[10], e, t;
+    size_t i, n;
+
+    for (i = 0; i < count; i++) {
+        srt[i] = rand() % count;
+    }
+
+    n = 0;
+    for (i = 0; i < count; i++) {
+        e = srt[i];
+        n = cstl_raw_array_top_k_push(top, n, sizeof(*top), k, &e,
+                                      int_cmp, NULL, cstl_swap, &t);
+        ck_assert_uint_eq(n, i < k ? i + 1 : k);
+    }
+    cstl_raw_array_top_k_sort(top, n, sizeof(*top),
+                              int_cmp, NULL, cstl_swap, &t);
+
+    cstl_raw_array_sort(srt, count, sizeof(*srt),
+                        int_cmp, NULL, cstl_swap, &t,
+                        CSTL_SORT_ALGORITHM_DEFAULT);
+    for (i = 0; i < k; i++) {
+        ck_assert_int_eq(top[i], srt[i]);
+    }
+
+    /* nothing is kept if k is zero */
+    ck_assert_uint_eq(
+        cstl_raw_array_top_k_push(top, 0, sizeof(*top), 0, &e,
+                                  int_cmp, NULL, cstl_swap, &t),
+        0);
+    ck_assert_signal(SIGABRT,
+                     cstl_raw_array_top_k_push(
+                         top, k, sizeof(*top), k - 1, &e,
+                         int_cmp, NULL, cstl_swap, &t));
+}
+END_TEST
+
 Suite * array_suite(void)
 {
     Suite * const s = suite_create("array");
@@ -608,6 +937,9 @@ Suite * array_suite(void)
     tcase_add_test(tc, access_after);
     tcase_add_test(tc, big_slice);
     tcase_add_test(tc, invalid_slice);
+    tcase_add_test(tc, nth_element);
+    tcase_add_test(tc, partial_sort);
+    tcase_add_test(tc, top_k);
 
     suite_add_tcase(s, tc);
 
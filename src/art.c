@@ -0,0 +1,1454 @@
+/*!
+ * @file
+ */
+
+#include "cstl/art.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define CSTL_ART_SSE2
+#endif
+
+/*
+ * the number of bytes of a node's prefix that are stored in the node.
+ * searches skip over the rest of a longer prefix without checking it;
+ * the key in the leaf that the search eventually reaches is compared
+ * in its entirety anyway. when the skipped bytes are needed, e.g. to
+ * split the prefix, they are read from the key of any leaf below the
+ * node, since all of those keys share the prefix.
+ */
+#define CSTL_ART_PREFIX_MAX     12
+
+typedef enum
+{
+    CSTL_ART_NODE4,
+    CSTL_ART_NODE16,
+    CSTL_ART_NODE48,
+    CSTL_ART_NODE256,
+} cstl_art_node_type_t;
+
+/*
+ * the tree refers to its leaves and interior nodes through untyped
+ * pointers. the low bit of the pointer is set if it points to a leaf
+ */
+struct cstl_art_leaf
+{
+    cstl_art_elem_t e;
+    unsigned char key[];
+};
+
+struct cstl_art_node
+{
+    /*
+     * the element whose key ends at this node, after the prefix.
+     * keys that are prefixes of other keys are stored here, rather
+     * than requiring that no key be a prefix of another
+     */
+    struct cstl_art_leaf * end;
+    /* the length of the prefix shared by all keys below this node */
+    size_t plen;
+    /* the number of children */
+    uint16_t n;
+    uint8_t type;
+    unsigned char prefix[CSTL_ART_PREFIX_MAX];
+};
+
+/* children are kept in order by key in the two smaller node types */
+struct cstl_art_node4
+{
+    struct cstl_art_node h;
+    unsigned char key[4];
+    void * c[4];
+};
+
+struct cstl_art_node16
+{
+    struct cstl_art_node h;
+    unsigned char key[16];
+    void * c[16];
+};
+
+struct cstl_art_node48
+{
+    struct cstl_art_node h;
+    /* one more than the index of the child for each key byte, or 0 */
+    unsigned char idx[256];
+    void * c[48];
+};
+
+struct cstl_art_node256
+{
+    struct cstl_art_node h;
+    void * c[256];
+};
+
+static const struct
+{
+    size_t size;
+    /* the maximum number of children */
+    unsigned int max;
+    /*
+     * the number of children at (or below) which the node is
+     * replaced by the next smaller type. the gap between this
+     * and the maximum of the smaller type prevents a node from
+     * being repeatedly replaced as a child is added and removed
+     */
+    unsigned int min;
+} cstl_art_node_info[] = {
+    [CSTL_ART_NODE4]   = { sizeof(struct cstl_art_node4),     4,  0 },
+    [CSTL_ART_NODE16]  = { sizeof(struct cstl_art_node16),   16,  3 },
+    [CSTL_ART_NODE48]  = { sizeof(struct cstl_art_node48),   48, 12 },
+    [CSTL_ART_NODE256] = { sizeof(struct cstl_art_node256), 256, 37 },
+};
+
+/*! @private */
+static inline size_t cstl_art_min(const size_t a, const size_t b)
+{
+    return a < b ? a : b;
+}
+
+/*! @private */
+static inline bool cstl_art_is_leaf(const void * const ref)
+{
+    return (uintptr_t)ref & 1;
+}
+
+/*! @private */
+static inline struct cstl_art_leaf * cstl_art_leaf(const void * const ref)
+{
+    return (void *)((uintptr_t)ref & ~(uintptr_t)1);
+}
+
+/*! @private */
+static inline void * cstl_art_leaf_ref(const struct cstl_art_leaf * const l)
+{
+    return (void *)((uintptr_t)l | 1);
+}
+
+/*! @private */
+static struct cstl_art_leaf * cstl_art_leaf_alloc(
+    cstl_art_t * const art,
+    const unsigned char * const key, const size_t len, void * const val)
+{
+    struct cstl_art_leaf * const l =
+        cstl_allocator_alloc(art->allocator, sizeof(*l) + len);
+
+    if (l != NULL) {
+        if (len > 0) {
+            memcpy(l->key, key, len);
+        }
+
+        l->e.key = l->key;
+        l->e.len = len;
+        l->e.val = val;
+    }
+
+    return l;
+}
+
+/*! @private */
+static void cstl_art_leaf_free(cstl_art_t * const art,
+                               struct cstl_art_leaf * const l)
+{
+    cstl_allocator_free(art->allocator, l, sizeof(*l) + l->e.len);
+}
+
+/*! @private */
+static bool cstl_art_leaf_matches(const struct cstl_art_leaf * const l,
+                                  const unsigned char * const key,
+                                  const size_t len)
+{
+    return l->e.len == len && (len == 0 || memcmp(l->key, key, len) == 0);
+}
+
+/*! @private */
+static struct cstl_art_node * cstl_art_node_alloc(
+    cstl_art_t * const art, const cstl_art_node_type_t type)
+{
+    const size_t sz = cstl_art_node_info[type].size;
+    struct cstl_art_node * const n = cstl_allocator_alloc(art->allocator, sz);
+
+    if (n != NULL) {
+        /* no children, no prefix, and no element */
+        memset(n, 0, sz);
+        n->type = type;
+    }
+
+    return n;
+}
+
+/*! @private */
+static void cstl_art_node_free(cstl_art_t * const art,
+                               struct cstl_art_node * const n)
+{
+    cstl_allocator_free(art->allocator, n, cstl_art_node_info[n->type].size);
+}
+
+/*!
+ * @private
+ *
+ * find the slot holding the child of the node for the given byte
+ */
+static void ** cstl_art_node_find(struct cstl_art_node * const n,
+                                  const unsigned char c)
+{
+    switch (n->type) {
+    case CSTL_ART_NODE4: {
+        struct cstl_art_node4 * const n4 = (void *)n;
+        unsigned int i;
+
+        for (i = 0; i < n->n; i++) {
+            if (n4->key[i] == c) {
+                return &n4->c[i];
+            }
+        }
+
+        break;
+    }
+    case CSTL_ART_NODE16: {
+        struct cstl_art_node16 * const n16 = (void *)n;
+#ifdef CSTL_ART_SSE2
+        /* compare all of the keys at once */
+        const __m128i eq = _mm_cmpeq_epi8(
+            _mm_set1_epi8((char)c),
+            _mm_loadu_si128((const __m128i *)n16->key));
+        const unsigned int m =
+            (unsigned int)_mm_movemask_epi8(eq) & ((1u << n->n) - 1);
+
+        if (m != 0) {
+            return &n16->c[__builtin_ctz(m)];
+        }
+#else
+        unsigned int i;
+
+        for (i = 0; i < n->n; i++) {
+            if (n16->key[i] == c) {
+                return &n16->c[i];
+            }
+        }
+#endif
+
+        break;
+    }
+    case CSTL_ART_NODE48: {
+        struct cstl_art_node48 * const n48 = (void *)n;
+
+        if (n48->idx[c] != 0) {
+            return &n48->c[n48->idx[c] - 1];
+        }
+
+        break;
+    }
+    case CSTL_ART_NODE256: {
+        struct cstl_art_node256 * const n256 = (void *)n;
+
+        if (n256->c[c] != NULL) {
+            return &n256->c[c];
+        }
+
+        break;
+    }
+    }
+
+    return NULL;
+}
+
+/*!
+ * @private
+ *
+ * find the slot holding the first child of the node whose position
+ * is at or after @p i, in order by key. the position of the child
+ * is returned in @p i and its key byte in @p c. to get the next
+ * child, the caller increments the position and calls again
+ */
+static void ** cstl_art_node_child(struct cstl_art_node * const n,
+                                   unsigned int * const i,
+                                   unsigned char * const c)
+{
+    switch (n->type) {
+    case CSTL_ART_NODE4: {
+        struct cstl_art_node4 * const n4 = (void *)n;
+
+        if (*i < n->n) {
+            *c = n4->key[*i];
+            return &n4->c[*i];
+        }
+
+        break;
+    }
+    case CSTL_ART_NODE16: {
+        struct cstl_art_node16 * const n16 = (void *)n;
+
+        if (*i < n->n) {
+            *c = n16->key[*i];
+            return &n16->c[*i];
+        }
+
+        break;
+    }
+    case CSTL_ART_NODE48: {
+        struct cstl_art_node48 * const n48 = (void *)n;
+
+        for (; *i < 256; (*i)++) {
+            if (n48->idx[*i] != 0) {
+                *c = *i;
+                return &n48->c[n48->idx[*i] - 1];
+            }
+        }
+
+        break;
+    }
+    case CSTL_ART_NODE256: {
+        struct cstl_art_node256 * const n256 = (void *)n;
+
+        for (; *i < 256; (*i)++) {
+            if (n256->c[*i] != NULL) {
+                *c = *i;
+                return &n256->c[*i];
+            }
+        }
+
+        break;
+    }
+    }
+
+    return NULL;
+}
+
+/*!
+ * @private
+ *
+ * add a child to a node that is known to have room for it
+ */
+static void cstl_art_node_put(struct cstl_art_node * const n,
+                              const unsigned char c, void * const child)
+{
+    unsigned char * key = NULL;
+    void ** cs = NULL;
+
+    switch (n->type) {
+    case CSTL_ART_NODE4:
+        key = ((struct cstl_art_node4 *)n)->key;
+        cs = ((struct cstl_art_node4 *)n)->c;
+        break;
+    case CSTL_ART_NODE16:
+        key = ((struct cstl_art_node16 *)n)->key;
+        cs = ((struct cstl_art_node16 *)n)->c;
+        break;
+    case CSTL_ART_NODE48: {
+        struct cstl_art_node48 * const n48 = (void *)n;
+        unsigned int i;
+
+        /* slots are vacated by removals, so look for an empty one */
+        for (i = 0; n48->c[i] != NULL; i++)
+            ;
+
+        n48->c[i] = child;
+        n48->idx[c] = i + 1;
+
+        break;
+    }
+    case CSTL_ART_NODE256:
+        ((struct cstl_art_node256 *)n)->c[c] = child;
+        break;
+    }
+
+    if (key != NULL) {
+        unsigned int i;
+
+        for (i = n->n; i > 0 && key[i - 1] > c; i--) {
+            key[i] = key[i - 1];
+            cs[i] = cs[i - 1];
+        }
+
+        key[i] = c;
+        cs[i] = child;
+    }
+
+    n->n++;
+}
+
+/*!
+ * @private
+ *
+ * replace a node with one of a different type, which must be
+ * large enough to hold all of the children of the original.
+ * the original node is freed unless the allocation fails
+ */
+static struct cstl_art_node * cstl_art_node_resize(
+    cstl_art_t * const art, struct cstl_art_node * const n,
+    const cstl_art_node_type_t type)
+{
+    struct cstl_art_node * const r = cstl_art_node_alloc(art, type);
+
+    if (r != NULL) {
+        unsigned int i;
+        unsigned char c;
+        void ** ch;
+
+        r->end = n->end;
+        r->plen = n->plen;
+        memcpy(r->prefix, n->prefix, sizeof(r->prefix));
+
+        for (i = 0; (ch = cstl_art_node_child(n, &i, &c)) != NULL; i++) {
+            cstl_art_node_put(r, c, *ch);
+        }
+
+        cstl_art_node_free(art, n);
+    }
+
+    return r;
+}
+
+/*!
+ * @private
+ *
+ * add a child to the node referred to by @p ref, replacing
+ * the node with a larger one if it is full
+ */
+static int cstl_art_node_add(cstl_art_t * const art, void ** const ref,
+                             const unsigned char c, void * const child)
+{
+    struct cstl_art_node * n = *ref;
+
+    if (n->n == cstl_art_node_info[n->type].max) {
+        n = cstl_art_node_resize(art, n, n->type + 1);
+        if (n == NULL) {
+            return -1;
+        }
+        *ref = n;
+    }
+
+    cstl_art_node_put(n, c, child);
+    return 0;
+}
+
+/*!
+ * @private
+ *
+ * store a leaf in a node whose keys (including the prefix) are
+ * @p d bytes long. the leaf either ends at the node or becomes
+ * a child of it. the node must have room for the child
+ */
+static void cstl_art_node_put_leaf(struct cstl_art_node * const n,
+                                   const size_t d,
+                                   struct cstl_art_leaf * const l)
+{
+    if (l->e.len == d) {
+        n->end = l;
+    } else {
+        cstl_art_node_put(n, l->key[d], cstl_art_leaf_ref(l));
+    }
+}
+
+/*!
+ * @private
+ *
+ * remove the child in the given slot from a node
+ */
+static void cstl_art_node_remove(struct cstl_art_node * const n,
+                                 const unsigned char c, void ** const ch)
+{
+    unsigned char * key = NULL;
+    void ** cs = NULL;
+
+    switch (n->type) {
+    case CSTL_ART_NODE4:
+        key = ((struct cstl_art_node4 *)n)->key;
+        cs = ((struct cstl_art_node4 *)n)->c;
+        break;
+    case CSTL_ART_NODE16:
+        key = ((struct cstl_art_node16 *)n)->key;
+        cs = ((struct cstl_art_node16 *)n)->c;
+        break;
+    case CSTL_ART_NODE48:
+        ((struct cstl_art_node48 *)n)->idx[c] = 0;
+        *ch = NULL;
+        break;
+    case CSTL_ART_NODE256:
+        *ch = NULL;
+        break;
+    }
+
+    n->n--;
+
+    if (key != NULL) {
+        const unsigned int i = ch - cs;
+
+        memmove(&key[i], &key[i + 1], n->n - i);
+        memmove(&cs[i], &cs[i + 1], (n->n - i) * sizeof(*cs));
+    }
+}
+
+/*!
+ * @private
+ *
+ * return a leaf from somewhere below the node
+ */
+static const struct cstl_art_leaf * cstl_art_node_leaf(
+    const struct cstl_art_node * n)
+{
+    while (n->end == NULL) {
+        unsigned int i = 0;
+        unsigned char c;
+        void * const ch =
+            *cstl_art_node_child((struct cstl_art_node *)n, &i, &c);
+
+        if (cstl_art_is_leaf(ch)) {
+            return cstl_art_leaf(ch);
+        }
+
+        n = ch;
+    }
+
+    return n->end;
+}
+
+/*!
+ * @private
+ *
+ * after an element has been removed from below the node referred to
+ * by @p ref, replace the node with a smaller one if it has few enough
+ * children. a node with only one child or element is removed entirely,
+ * its prefix being merged into that of its child
+ */
+static void cstl_art_node_shrink(cstl_art_t * const art, void ** const ref)
+{
+    struct cstl_art_node * const n = *ref;
+
+    if (n->n + (n->end != NULL) == 1) {
+        if (n->end != NULL) {
+            *ref = cstl_art_leaf_ref(n->end);
+        } else {
+            unsigned int i = 0;
+            unsigned char c;
+            void * const ch = *cstl_art_node_child(n, &i, &c);
+
+            if (!cstl_art_is_leaf(ch)) {
+                /*
+                 * the child's prefix becomes the node's
+                 * prefix, followed by the child's key byte,
+                 * followed by the child's original prefix
+                 */
+                struct cstl_art_node * const cn = ch;
+                unsigned char pfx[CSTL_ART_PREFIX_MAX];
+                size_t l = cstl_art_min(n->plen, CSTL_ART_PREFIX_MAX);
+
+                memcpy(pfx, n->prefix, l);
+                if (l < CSTL_ART_PREFIX_MAX) {
+                    pfx[l++] = c;
+                }
+                memcpy(pfx + l, cn->prefix,
+                       cstl_art_min(cn->plen, CSTL_ART_PREFIX_MAX - l));
+
+                cn->plen += n->plen + 1;
+                memcpy(cn->prefix, pfx,
+                       cstl_art_min(cn->plen, CSTL_ART_PREFIX_MAX));
+            }
+
+            *ref = ch;
+        }
+
+        cstl_art_node_free(art, n);
+    } else if (n->n <= cstl_art_node_info[n->type].min) {
+        /* if the allocation fails, just keep the larger node */
+        struct cstl_art_node * const r =
+            cstl_art_node_resize(art, n, n->type - 1);
+
+        if (r != NULL) {
+            *ref = r;
+        }
+    }
+}
+
+/*!
+ * @private
+ *
+ * compare the key, starting at depth @p d, with the bytes of the
+ * node's prefix that are stored in the node, returning the number
+ * of bytes that match
+ */
+static size_t cstl_art_prefix_check(const struct cstl_art_node * const n,
+                                    const unsigned char * const key,
+                                    const size_t len, const size_t d)
+{
+    const size_t max = cstl_art_min(
+        cstl_art_min(n->plen, CSTL_ART_PREFIX_MAX), len - d);
+    size_t i;
+
+    for (i = 0; i < max && n->prefix[i] == key[d + i]; i++)
+        ;
+
+    return i;
+}
+
+/*!
+ * @private
+ *
+ * compare the key, starting at depth @p d, with the whole of the
+ * node's prefix, returning the number of bytes that match
+ */
+static size_t cstl_art_prefix_mismatch(const struct cstl_art_node * const n,
+                                       const unsigned char * const key,
+                                       const size_t len, const size_t d)
+{
+    size_t i = cstl_art_prefix_check(n, key, len, d);
+
+    if (i == CSTL_ART_PREFIX_MAX && n->plen > CSTL_ART_PREFIX_MAX) {
+        const struct cstl_art_leaf * const l = cstl_art_node_leaf(n);
+        const size_t max = cstl_art_min(n->plen, len - d);
+
+        for (; i < max && l->key[d + i] == key[d + i]; i++)
+            ;
+    }
+
+    return i;
+}
+
+void cstl_art_init(cstl_art_t * const art)
+{
+    art->root = NULL;
+    art->size = 0;
+
+    art->allocator = NULL;
+}
+
+void cstl_art_set_allocator(cstl_art_t * const art,
+                            const cstl_allocator_t * const a)
+{
+    if (art->size != 0) {
+        abort();
+    }
+
+    art->allocator = a;
+}
+
+int cstl_art_insert(cstl_art_t * const art,
+                    const void * const _key, const size_t len,
+                    void * const val)
+{
+    const unsigned char * const key = _key;
+    struct cstl_art_leaf * const l =
+        cstl_art_leaf_alloc(art, key, len, val);
+    void ** ref = &art->root;
+    size_t d = 0;
+    int res = 0;
+
+    if (l == NULL) {
+        return -1;
+    }
+
+    for (;;) {
+        struct cstl_art_node * n;
+        void ** ch;
+
+        if (*ref == NULL) {
+            /* only the root can be empty */
+            *ref = cstl_art_leaf_ref(l);
+            break;
+        }
+
+        if (cstl_art_is_leaf(*ref)) {
+            struct cstl_art_leaf * const o = cstl_art_leaf(*ref);
+            size_t p;
+
+            if (cstl_art_leaf_matches(o, key, len)) {
+                res = 1;
+                break;
+            }
+
+            /*
+             * replace the existing leaf with a node holding both
+             * leaves, whose prefix is the rest of what the keys
+             * have in common
+             */
+            n = cstl_art_node_alloc(art, CSTL_ART_NODE4);
+            if (n == NULL) {
+                res = -1;
+                break;
+            }
+
+            for (p = d; p < len && p < o->e.len && o->key[p] == key[p]; p++)
+                ;
+
+            n->plen = p - d;
+            memcpy(n->prefix, &key[d],
+                   cstl_art_min(n->plen, CSTL_ART_PREFIX_MAX));
+            cstl_art_node_put_leaf(n, p, o);
+            cstl_art_node_put_leaf(n, p, l);
+
+            *ref = n;
+            break;
+        }
+
+        n = *ref;
+        if (n->plen > 0) {
+            const size_t p = cstl_art_prefix_mismatch(n, key, len, d);
+
+            if (p < n->plen) {
+                /*
+                 * the key diverges from the node's prefix. insert a
+                 * node above this one holding the part of the prefix
+                 * that matched, with this node and the new leaf as
+                 * its children. this node keeps whatever follows
+                 * the byte at which the keys diverge
+                 */
+                struct cstl_art_node * const s =
+                    cstl_art_node_alloc(art, CSTL_ART_NODE4);
+                unsigned char c;
+
+                if (s == NULL) {
+                    res = -1;
+                    break;
+                }
+
+                s->plen = p;
+                memcpy(s->prefix, n->prefix,
+                       cstl_art_min(p, CSTL_ART_PREFIX_MAX));
+
+                if (n->plen <= CSTL_ART_PREFIX_MAX) {
+                    c = n->prefix[p];
+                    n->plen -= p + 1;
+                    memmove(n->prefix, &n->prefix[p + 1], n->plen);
+                } else {
+                    const struct cstl_art_leaf * const m =
+                        cstl_art_node_leaf(n);
+
+                    c = m->key[d + p];
+                    n->plen -= p + 1;
+                    memcpy(n->prefix, &m->key[d + p + 1],
+                           cstl_art_min(n->plen, CSTL_ART_PREFIX_MAX));
+                }
+
+                cstl_art_node_put(s, c, n);
+                cstl_art_node_put_leaf(s, d + p, l);
+
+                *ref = s;
+                break;
+            }
+
+            d += n->plen;
+        }
+
+        if (d == len) {
+            if (n->end != NULL) {
+                res = 1;
+            } else {
+                n->end = l;
+            }
+            break;
+        }
+
+        ch = cstl_art_node_find(n, key[d]);
+        if (ch == NULL) {
+            res = cstl_art_node_add(art, ref, key[d], cstl_art_leaf_ref(l));
+            break;
+        }
+
+        ref = ch;
+        d++;
+    }
+
+    if (res != 0) {
+        cstl_art_leaf_free(art, l);
+    } else {
+        art->size++;
+    }
+
+    return res;
+}
+
+const cstl_art_elem_t * cstl_art_find(const cstl_art_t * const art,
+                                      const void * const _key,
+                                      const size_t len)
+{
+    const unsigned char * const key = _key;
+    const void * ref = art->root;
+    size_t d = 0;
+
+    while (ref != NULL && !cstl_art_is_leaf(ref)) {
+        const struct cstl_art_node * const n = ref;
+
+        if (n->plen > 0) {
+            if (cstl_art_prefix_check(n, key, len, d)
+                != cstl_art_min(n->plen, CSTL_ART_PREFIX_MAX)) {
+                return NULL;
+            }
+
+            d += n->plen;
+        }
+
+        if (d >= len) {
+            ref = NULL;
+            if (d == len && n->end != NULL) {
+                ref = cstl_art_leaf_ref(n->end);
+            }
+        } else {
+            void * const * const ch =
+                cstl_art_node_find((struct cstl_art_node *)n, key[d]);
+
+            ref = ch != NULL ? *ch : NULL;
+            d++;
+        }
+    }
+
+    if (ref != NULL) {
+        /*
+         * any part of the key that was skipped
+         * over on the way down is checked here
+         */
+        const struct cstl_art_leaf * const l = cstl_art_leaf(ref);
+
+        if (cstl_art_leaf_matches(l, key, len)) {
+            return &l->e;
+        }
+    }
+
+    return NULL;
+}
+
+int cstl_art_erase(cstl_art_t * const art,
+                   const void * const _key, const size_t len,
+                   void ** const val)
+{
+    const unsigned char * const key = _key;
+    struct cstl_art_leaf * l = NULL;
+    void ** ref = &art->root;
+    size_t d = 0;
+
+    while (*ref != NULL) {
+        struct cstl_art_node * n;
+        void ** ch;
+
+        if (cstl_art_is_leaf(*ref)) {
+            /* only the root leaf is reached this way */
+            if (cstl_art_leaf_matches(cstl_art_leaf(*ref), key, len)) {
+                l = cstl_art_leaf(*ref);
+                *ref = NULL;
+            }
+            break;
+        }
+
+        n = *ref;
+        if (n->plen > 0) {
+            if (cstl_art_prefix_check(n, key, len, d)
+                != cstl_art_min(n->plen, CSTL_ART_PREFIX_MAX)) {
+                break;
+            }
+
+            d += n->plen;
+        }
+
+        if (d >= len) {
+            if (d == len && n->end != NULL
+                && cstl_art_leaf_matches(n->end, key, len)) {
+                l = n->end;
+                n->end = NULL;
+                cstl_art_node_shrink(art, ref);
+            }
+            break;
+        }
+
+        ch = cstl_art_node_find(n, key[d]);
+        if (ch == NULL) {
+            break;
+        }
+
+        if (cstl_art_is_leaf(*ch)) {
+            if (cstl_art_leaf_matches(cstl_art_leaf(*ch), key, len)) {
+                l = cstl_art_leaf(*ch);
+                cstl_art_node_remove(n, key[d], ch);
+                cstl_art_node_shrink(art, ref);
+            }
+            break;
+        }
+
+        ref = ch;
+        d++;
+    }
+
+    if (l == NULL) {
+        return 1;
+    }
+
+    if (val != NULL) {
+        *val = l->e.val;
+    }
+
+    cstl_art_leaf_free(art, l);
+    art->size--;
+
+    return 0;
+}
+
+/*!
+ * @private
+ *
+ * visit every element below the node or leaf, in order. shorter keys
+ * come before longer ones, so the element that ends at a node is
+ * visited before those of its children. (the depth of the recursion
+ * is limited by the length of the keys.)
+ */
+static int cstl_art_foreach_ref(const void * const ref,
+                                cstl_const_visit_func_t * const visit,
+                                void * const priv)
+{
+    struct cstl_art_node * const n = (void *)ref;
+    unsigned int i;
+    unsigned char c;
+    void ** ch;
+    int res = 0;
+
+    if (cstl_art_is_leaf(ref)) {
+        return visit(&cstl_art_leaf(ref)->e, priv);
+    }
+
+    if (n->end != NULL) {
+        res = visit(&n->end->e, priv);
+    }
+
+    for (i = 0;
+         res == 0 && (ch = cstl_art_node_child(n, &i, &c)) != NULL;
+         i++) {
+        res = cstl_art_foreach_ref(*ch, visit, priv);
+    }
+
+    return res;
+}
+
+int cstl_art_foreach_prefix(const cstl_art_t * const art,
+                            const void * const _pfx, const size_t len,
+                            cstl_const_visit_func_t * const visit,
+                            void * const priv)
+{
+    const unsigned char * const pfx = _pfx;
+    const struct cstl_art_leaf * l;
+    const void * ref = art->root;
+    size_t d = 0;
+
+    /*
+     * find the highest node below which every key
+     * is at least as long as the prefix
+     */
+    while (ref != NULL && !cstl_art_is_leaf(ref)) {
+        const struct cstl_art_node * const n = ref;
+        void * const * ch;
+
+        if (cstl_art_prefix_check(n, pfx, len, d)
+            != cstl_art_min(cstl_art_min(n->plen, CSTL_ART_PREFIX_MAX),
+                            len - d)) {
+            return 0;
+        }
+
+        if (d + n->plen >= len) {
+            break;
+        }
+
+        d += n->plen;
+        ch = cstl_art_node_find((struct cstl_art_node *)n, pfx[d]);
+        ref = ch != NULL ? *ch : NULL;
+        d++;
+    }
+
+    if (ref == NULL) {
+        return 0;
+    }
+
+    /*
+     * the keys below the node all begin with the same bytes, at least
+     * as many as are in the prefix, but not all of those bytes have
+     * been checked. checking any one of the keys checks them all
+     */
+    if (cstl_art_is_leaf(ref)) {
+        l = cstl_art_leaf(ref);
+    } else {
+        l = cstl_art_node_leaf(ref);
+    }
+
+    if (l->e.len < len || (len > 0 && memcmp(l->key, pfx, len) != 0)) {
+        return 0;
+    }
+
+    return cstl_art_foreach_ref(ref, visit, priv);
+}
+
+/*! @private */
+static void cstl_art_clear_ref(cstl_art_t * const art, void * const ref,
+                               cstl_xtor_func_t * const clr, void * const priv)
+{
+    if (cstl_art_is_leaf(ref)) {
+        struct cstl_art_leaf * const l = cstl_art_leaf(ref);
+
+        if (clr != NULL) {
+            clr(&l->e, priv);
+        }
+        cstl_art_leaf_free(art, l);
+    } else {
+        struct cstl_art_node * const n = ref;
+        unsigned int i;
+        unsigned char c;
+        void ** ch;
+
+        if (n->end != NULL) {
+            cstl_art_clear_ref(art, cstl_art_leaf_ref(n->end), clr, priv);
+        }
+
+        for (i = 0; (ch = cstl_art_node_child(n, &i, &c)) != NULL; i++) {
+            cstl_art_clear_ref(art, *ch, clr, priv);
+        }
+
+        cstl_art_node_free(art, n);
+    }
+}
+
+void cstl_art_clear(cstl_art_t * const art,
+                    cstl_xtor_func_t * const clr, void * const priv)
+{
+    if (art->root != NULL) {
+        cstl_art_clear_ref(art, art->root, clr, priv);
+    }
+
+    art->root = NULL;
+    art->size = 0;
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include <stdio.h>
+
+/*
+ * check the structure of the subtree and return the number
+ * of elements in it. the keys below it are at least d bytes long
+ */
+static size_t art_verify_ref(const void * const ref, size_t d)
+{
+    struct cstl_art_node * const n = (void *)ref;
+    const struct cstl_art_leaf * l;
+    unsigned int i, kids;
+    unsigned char c;
+    size_t count;
+    void ** ch;
+    int prev;
+
+    if (cstl_art_is_leaf(ref)) {
+        l = cstl_art_leaf(ref);
+        ck_assert_uint_ge(l->e.len, d);
+        ck_assert_ptr_eq(l->e.key, l->key);
+        return 1;
+    }
+
+    ck_assert_uint_le(n->type, CSTL_ART_NODE256);
+
+    /* the stored part of the prefix matches the keys below */
+    l = cstl_art_node_leaf(n);
+    ck_assert_uint_ge(l->e.len, d + n->plen);
+    ck_assert_mem_eq(&l->key[d], n->prefix,
+                     cstl_art_min(n->plen, CSTL_ART_PREFIX_MAX));
+    d += n->plen;
+
+    count = 0;
+    if (n->end != NULL) {
+        ck_assert_uint_eq(n->end->e.len, d);
+        count++;
+    }
+
+    for (i = 0, kids = 0, prev = -1;
+         (ch = cstl_art_node_child(n, &i, &c)) != NULL;
+         i++, kids++) {
+        ck_assert_int_gt(c, prev);
+        prev = c;
+
+        if (cstl_art_is_leaf(*ch)) {
+            l = cstl_art_leaf(*ch);
+        } else {
+            l = cstl_art_node_leaf(*ch);
+        }
+        ck_assert_uint_gt(l->e.len, d);
+        ck_assert_uint_eq(l->key[d], c);
+
+        count += art_verify_ref(*ch, d + 1);
+    }
+
+    ck_assert_uint_eq(kids, n->n);
+    ck_assert_uint_le(kids, cstl_art_node_info[n->type].max);
+    ck_assert_uint_ge(kids + (n->end != NULL), 2);
+
+    return count;
+}
+
+static void art_verify(const cstl_art_t * const art)
+{
+    size_t count = 0;
+
+    if (art->root != NULL) {
+        count = art_verify_ref(art->root, 0);
+    }
+    ck_assert_uint_eq(count, cstl_art_size(art));
+}
+
+static int art_key_cmp(const void * const a, const size_t alen,
+                       const void * const b, const size_t blen)
+{
+    const int c = memcmp(a, b, cstl_art_min(alen, blen));
+
+    if (c != 0) {
+        return c;
+    }
+    return (alen > blen) - (alen < blen);
+}
+
+struct art_order_priv
+{
+    const cstl_art_elem_t * prev;
+    size_t count;
+};
+
+static int art_order_visit(const void * const e, void * const p)
+{
+    const cstl_art_elem_t * const elem = e;
+    struct art_order_priv * const op = p;
+
+    if (op->prev != NULL) {
+        ck_assert_int_lt(art_key_cmp(op->prev->key, op->prev->len,
+                                     elem->key, elem->len), 0);
+    }
+    op->prev = elem;
+    op->count++;
+
+    return 0;
+}
+
+static size_t art_prefix_count(const cstl_art_t * const art,
+                               const char * const pfx)
+{
+    struct art_order_priv op;
+
+    op.prev = NULL;
+    op.count = 0;
+    ck_assert_int_eq(
+        cstl_art_foreach_prefix(art, pfx, strlen(pfx),
+                                art_order_visit, &op), 0);
+
+    return op.count;
+}
+
+START_TEST(init)
+{
+    cstl_art_t art;
+
+    cstl_art_init(&art);
+    ck_assert_uint_eq(cstl_art_size(&art), 0);
+    ck_assert_ptr_null(cstl_art_find(&art, "", 0));
+    ck_assert_int_eq(cstl_art_erase(&art, "a", 1, NULL), 1);
+    ck_assert_uint_eq(art_prefix_count(&art, ""), 0);
+    cstl_art_clear(&art, NULL, NULL);
+}
+END_TEST
+
+START_TEST(strings)
+{
+    static const char * const words[] = {
+        "", "a", "ab", "abc", "abd", "b", "ba",
+        "/usr/local/share/doc/cstl/html/index.html",
+        "/usr/local/share/doc/cstl/html/map.html",
+        "/usr/local/share/doc/cstl/README",
+        "/usr/local/share/doc/cstl",
+        "/usr/local/share/doc/other/README",
+        "/usr/local/lib/libcstl.a",
+        "/usr/local/lib/libcstl.so",
+    };
+    static const unsigned int n = sizeof(words) / sizeof(*words);
+
+    DECLARE_CSTL_STRING(string, s);
+    struct art_order_priv op;
+    const cstl_art_elem_t * e;
+    cstl_art_t art;
+    unsigned int i;
+    void * val;
+
+    cstl_art_init(&art);
+    for (i = 0; i < n; i++) {
+        cstl_string_set_str(&s, words[i]);
+        ck_assert_int_eq(
+            cstl_art_insert_string(&art, &s, (void *)(uintptr_t)i), 0);
+        art_verify(&art);
+    }
+    for (i = 0; i < n; i++) {
+        ck_assert_int_eq(
+            cstl_art_insert(&art, words[i], strlen(words[i]), NULL), 1);
+
+        e = cstl_art_find(&art, words[i], strlen(words[i]));
+        ck_assert_ptr_nonnull(e);
+        ck_assert_uint_eq(e->len, strlen(words[i]));
+        ck_assert_mem_eq(e->key, words[i], e->len);
+        ck_assert_ptr_eq(e->val, (void *)(uintptr_t)i);
+    }
+    ck_assert_uint_eq(cstl_art_size(&art), n);
+
+    /* near misses */
+    ck_assert_ptr_null(cstl_art_find(&art, "abe", 3));
+    ck_assert_ptr_null(cstl_art_find(&art, "bb", 2));
+    ck_assert_ptr_null(cstl_art_find(&art, "/usr/local/share", 16));
+    ck_assert_ptr_null(
+        cstl_art_find(&art, "/usr/local/share/doc/cstl/", 26));
+    ck_assert_ptr_null(
+        cstl_art_find(&art, "/usr/local/share/doc/cstX", 25));
+    ck_assert_ptr_null(
+        cstl_art_find(&art, "/usr/locAl/share/doc/cstl", 25));
+
+    op.prev = NULL;
+    op.count = 0;
+    ck_assert_int_eq(cstl_art_foreach(&art, art_order_visit, &op), 0);
+    ck_assert_uint_eq(op.count, n);
+
+    ck_assert_uint_eq(art_prefix_count(&art, ""), n);
+    ck_assert_uint_eq(art_prefix_count(&art, "a"), 4);
+    ck_assert_uint_eq(art_prefix_count(&art, "ab"), 3);
+    ck_assert_uint_eq(art_prefix_count(&art, "abc"), 1);
+    ck_assert_uint_eq(art_prefix_count(&art, "abcd"), 0);
+    ck_assert_uint_eq(art_prefix_count(&art, "/usr/local/"), 7);
+    ck_assert_uint_eq(art_prefix_count(&art, "/usr/local/share/doc/"), 5);
+    ck_assert_uint_eq(art_prefix_count(&art, "/usr/local/share/doc/c"), 4);
+    ck_assert_uint_eq(art_prefix_count(&art, "/usr/local/shAre/doc/c"), 0);
+    ck_assert_uint_eq(art_prefix_count(&art, "/usr/local/lib/libcstl."), 2);
+
+    cstl_string_set_str(&s, "ab");
+    ck_assert_int_eq(cstl_art_erase_string(&art, &s, &val), 0);
+    ck_assert_ptr_eq(val, (void *)2);
+    ck_assert_ptr_null(cstl_art_find_string(&art, &s));
+    ck_assert_int_eq(cstl_art_erase_string(&art, &s, &val), 1);
+    ck_assert_uint_eq(art_prefix_count(&art, "ab"), 2);
+    art_verify(&art);
+
+    ck_assert_int_eq(cstl_art_erase(&art, "", 0, NULL), 0);
+    ck_assert_uint_eq(art_prefix_count(&art, ""), n - 2);
+    art_verify(&art);
+
+    cstl_art_clear(&art, NULL, NULL);
+    ck_assert_uint_eq(cstl_art_size(&art), 0);
+    cstl_string_clear(&s);
+}
+END_TEST
+
+/*
+ * generate a set of distinct keys, many of which share long prefixes
+ * or are prefixes of each other, along with enough keys that differ
+ * only in a single byte to fill the largest nodes
+ */
+static unsigned int art_keys(unsigned char (* const keys)[64],
+                             size_t * const lens, const unsigned int n)
+{
+    static const char * const pfx[] = {
+        "", "x", "/home/someone/projects/",
+        "/home/someone/projects/cstl/src/",
+    };
+    unsigned int i, k = 0;
+
+    for (i = 0; i < n - 256 * 3; i++, k++) {
+        lens[k] = sprintf((char *)keys[k], "%s%u",
+                          pfx[i % (sizeof(pfx) / sizeof(*pfx))], i);
+    }
+    for (i = 0; i < 256 * 3; i++, k++) {
+        keys[k][0] = 0xff;
+        keys[k][1] = i % 3;
+        keys[k][2] = i / 3;
+        lens[k] = 3;
+    }
+
+    return k;
+}
+
+static void art_shuffle(unsigned int * const order, const unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    for (i = n - 1; i > 0; i--) {
+        const unsigned int j = rand() % (i + 1);
+        const unsigned int t = order[i];
+
+        order[i] = order[j];
+        order[j] = t;
+    }
+}
+
+START_TEST(random)
+{
+    static const unsigned int n = 4000;
+
+    unsigned char (* const keys)[64] = malloc(n * sizeof(*keys));
+    size_t * const lens = malloc(n * sizeof(*lens));
+    unsigned int * const order = malloc(n * sizeof(*order));
+    unsigned char * const present = calloc(n, 1);
+    struct ck_counting_allocator ca;
+    cstl_art_t art;
+    unsigned int i, j;
+
+    ck_assert_uint_eq(art_keys(keys, lens, n), n);
+
+    ck_counting_allocator_init(&ca);
+    cstl_art_init(&art);
+    cstl_art_set_allocator(&art, &ca.a);
+
+    art_shuffle(order, n);
+    for (i = 0; i < n; i++) {
+        const unsigned int k = order[i];
+
+        ck_assert_int_eq(
+            cstl_art_insert(&art, keys[k], lens[k], &present[k]), 0);
+        present[k] = 1;
+
+        if (i % 499 == 0) {
+            art_verify(&art);
+        }
+    }
+    art_verify(&art);
+    ck_assert_uint_eq(art_prefix_count(&art, ""), n);
+    ck_assert_uint_eq(art_prefix_count(&art, "\xff"), 256 * 3);
+    ck_assert_uint_eq(art_prefix_count(&art, "\xff\x01"), 256);
+
+    ck_assert_signal(SIGABRT, cstl_art_set_allocator(&art, NULL));
+
+    /* remove the keys in a different order, a pass at a time */
+    for (j = 0; j < 2; j++) {
+        art_shuffle(order, n);
+        for (i = 0; i < n; i++) {
+            const unsigned int k = order[i];
+            void * val = NULL;
+
+            if (j == 0 && i % 2 == 0) {
+                continue;
+            }
+
+            ck_assert_int_eq(
+                cstl_art_erase(&art, keys[k], lens[k], &val), !present[k]);
+            if (present[k]) {
+                ck_assert_ptr_eq(val, &present[k]);
+                present[k] = 0;
+            }
+
+            if (i % 97 == 0) {
+                art_verify(&art);
+            }
+        }
+
+        art_verify(&art);
+        for (i = 0; i < n; i++) {
+            const cstl_art_elem_t * const e =
+                cstl_art_find(&art, keys[i], lens[i]);
+
+            if (present[i]) {
+                ck_assert_ptr_nonnull(e);
+                ck_assert_ptr_eq(e->val, &present[i]);
+            } else {
+                ck_assert_ptr_null(e);
+            }
+        }
+    }
+
+    ck_assert_uint_eq(cstl_art_size(&art), 0);
+    ck_assert_ptr_null(art.root);
+    ck_assert_uint_eq(ca.bytes, 0);
+
+    free(present);
+    free(order);
+    free(lens);
+    free(keys);
+}
+END_TEST
+
+/* an allocator that fails once a given number of calls have been made */
+struct art_limited_allocator
+{
+    struct ck_counting_allocator ca;
+    unsigned int limit;
+};
+
+static void * art_limited_alloc(const size_t sz, void * const priv)
+{
+    struct art_limited_allocator * const la = priv;
+
+    if (la->ca.calls >= la->limit) {
+        return NULL;
+    }
+    return ck_counting_alloc(sz, &la->ca);
+}
+
+START_TEST(nomem)
+{
+    static const unsigned int n = 1000;
+
+    unsigned char (* const keys)[64] = malloc(n * sizeof(*keys));
+    size_t * const lens = malloc(n * sizeof(*lens));
+    struct art_limited_allocator la;
+    cstl_art_t art;
+    unsigned int i, inserted = 0;
+
+    art_keys(keys, lens, n);
+
+    ck_counting_allocator_init(&la.ca);
+    la.ca.a.alloc = art_limited_alloc;
+    la.ca.a.priv = &la;
+    la.limit = 700;
+
+    cstl_art_init(&art);
+    cstl_art_set_allocator(&art, &la.ca.a);
+    for (i = 0; i < n; i++) {
+        const int res = cstl_art_insert(&art, keys[i], lens[i], NULL);
+
+        if (res == 0) {
+            inserted++;
+        } else {
+            ck_assert_int_eq(res, -1);
+            ck_assert_ptr_null(cstl_art_find(&art, keys[i], lens[i]));
+        }
+        ck_assert_uint_eq(cstl_art_size(&art), inserted);
+    }
+    ck_assert_uint_lt(inserted, n);
+    art_verify(&art);
+
+    /* removals never fail, even when nodes can't be shrunk */
+    for (i = 0; i < n; i++) {
+        cstl_art_erase(&art, keys[i], lens[i], NULL);
+        if (i % 50 == 0) {
+            art_verify(&art);
+        }
+    }
+    ck_assert_uint_eq(cstl_art_size(&art), 0);
+
+    cstl_art_clear(&art, NULL, NULL);
+    ck_assert_uint_eq(la.ca.bytes, 0);
+
+    free(lens);
+    free(keys);
+}
+END_TEST
+
+Suite * art_suite(void)
+{
+    Suite * const s = suite_create("art");
+
+    TCase * tc;
+
+    tc = tcase_create("art");
+    tcase_add_test(tc, init);
+    tcase_add_test(tc, strings);
+    tcase_add_test(tc, random);
+    tcase_add_test(tc, nomem);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
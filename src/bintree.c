@@ -5,6 +5,7 @@
 #include "cstl/bintree.h"
 
 #include <assert.h>
+#include <stdbool.h>
 
 /*!
  * @private
@@ -81,7 +82,8 @@ void cstl_bintree_insert(struct cstl_bintree * const bt,
         }
     }
 
-    bn->p = bp;
+    /* the node is new to the tree; clear the flag, too */
+    bn->p = (uintptr_t)bp;
     bn->l = NULL;
     bn->r = NULL;
 
@@ -183,11 +185,13 @@ static struct cstl_bintree_node * __cstl_bintree_adjacent(
          * condition is satisfied, indicating that the desired
          * value is not present in the tree
          */
-        while (bn->p != NULL && *l((struct cstl_bintree_node *)bn->p) == bn) {
-            bn = bn->p;
+        struct cstl_bintree_node * p;
+
+        while ((p = __cstl_bintree_parent(bn)) != NULL && *l(p) == bn) {
+            bn = p;
         }
 
-        bn = bn->p;
+        bn = p;
     }
 
     return (struct cstl_bintree_node *)bn;
@@ -219,6 +223,75 @@ static struct cstl_bintree_node * __cstl_bintree_prev(
                bn, __cstl_bintree_left, __cstl_bintree_right);
 }
 
+const void * cstl_bintree_next(const struct cstl_bintree * const bt,
+                               const void * const e)
+{
+    const struct cstl_bintree_node * bn = NULL;
+
+    if (e != NULL) {
+        bn = __cstl_bintree_next(__cstl_bintree_node(bt, e));
+    } else if (bt->root != NULL) {
+        bn = cstl_bintree_slide(bt->root, __cstl_bintree_left);
+    }
+
+    return bn != NULL ? cstl_bintree_element(bt, bn) : NULL;
+}
+
+const void * cstl_bintree_prev(const struct cstl_bintree * const bt,
+                               const void * const e)
+{
+    const struct cstl_bintree_node * bn = NULL;
+
+    if (e != NULL) {
+        bn = __cstl_bintree_prev(__cstl_bintree_node(bt, e));
+    } else if (bt->root != NULL) {
+        bn = cstl_bintree_slide(bt->root, __cstl_bintree_right);
+    }
+
+    return bn != NULL ? cstl_bintree_element(bt, bn) : NULL;
+}
+
+/*!
+ * @private
+ *
+ * find the left-most element in the tree that compares as greater than
+ * (if @upper is true) or greater than or equal to (if @upper is false)
+ * the given element. each time the search moves to the left, the node
+ * that it moves away from is the best candidate so far.
+ */
+static const void * cstl_bintree_bound(const struct cstl_bintree * const bt,
+                                       const void * const e,
+                                       const bool upper)
+{
+    const struct cstl_bintree_node * const be = __cstl_bintree_node(bt, e);
+    const struct cstl_bintree_node * bn = bt->root, * b = NULL;
+
+    while (bn != NULL) {
+        const int eq = __cstl_bintree_cmp(bt, be, bn);
+
+        if (eq < 0 || (eq == 0 && !upper)) {
+            b = bn;
+            bn = bn->l;
+        } else {
+            bn = bn->r;
+        }
+    }
+
+    return b != NULL ? cstl_bintree_element(bt, b) : NULL;
+}
+
+const void * cstl_bintree_lower_bound(const struct cstl_bintree * const bt,
+                                      const void * const e)
+{
+    return cstl_bintree_bound(bt, e, false);
+}
+
+const void * cstl_bintree_upper_bound(const struct cstl_bintree * const bt,
+                                      const void * const e)
+{
+    return cstl_bintree_bound(bt, e, true);
+}
+
 /*!
  * @private
  *
@@ -264,18 +337,18 @@ const struct cstl_bintree_node * __cstl_bintree_erase(
      * y's parent (x's former grandparent)
      */
     if (x != NULL) {
-        x->p = y->p;
+        __cstl_bintree_set_parent(x, __cstl_bintree_parent(y));
     }
 
     /*
      * replace y with x as one of y's parent's children
      */
-    if (y->p == NULL) {
+    if (__cstl_bintree_parent(y) == NULL) {
         bt->root = x;
-    } else if (y == y->p->l) {
-        y->p->l = x;
+    } else if (y == __cstl_bintree_parent(y)->l) {
+        __cstl_bintree_parent(y)->l = x;
     } else {
-        y->p->r = x;
+        __cstl_bintree_parent(y)->r = x;
     }
 
     /*
@@ -289,18 +362,19 @@ const struct cstl_bintree_node * __cstl_bintree_erase(
     if (y != bn) {
         /* save y's pointers */
         const struct cstl_bintree_node t = *y;
+        const bool f = __cstl_bintree_flag(bn);
 
         /*
          * make the parent of the node that was supposed to
          * be removed point to y is one of its children instead
          * of the desired node
          */
-        if (bn->p == NULL) {
+        if (__cstl_bintree_parent(bn) == NULL) {
             bt->root = y;
-        } else if (bn == bn->p->l) {
-            bn->p->l = y;
+        } else if (bn == __cstl_bintree_parent(bn)->l) {
+            __cstl_bintree_parent(bn)->l = y;
         } else {
-            bn->p->r = y;
+            __cstl_bintree_parent(bn)->r = y;
         }
 
         /*
@@ -308,10 +382,10 @@ const struct cstl_bintree_node * __cstl_bintree_erase(
          * to make y their new parent
          */
         if (bn->l != NULL) {
-            bn->l->p = y;
+            __cstl_bintree_set_parent(bn->l, y);
         }
         if (bn->r != NULL) {
-            bn->r->p = y;
+            __cstl_bintree_set_parent(bn->r, y);
         }
 
         /*
@@ -322,6 +396,13 @@ const struct cstl_bintree_node * __cstl_bintree_erase(
         *y = *bn;
         *bn = t;
 
+        /*
+         * the flags belong to the nodes, not to
+         * their positions in the tree; swap them back
+         */
+        __cstl_bintree_set_flag(y, __cstl_bintree_flag(&t));
+        __cstl_bintree_set_flag(bn, f);
+
         /*
          * it's possible that the (originally) removed node, y,
          * was a direct descendant of bn (the node the caller
@@ -329,8 +410,8 @@ const struct cstl_bintree_node * __cstl_bintree_erase(
          * y's) parent to be y to more accurately reflect the state
          * of things to the caller
          */
-        if (bn->p == bn) {
-            bn->p = y;
+        if (__cstl_bintree_parent(bn) == bn) {
+            __cstl_bintree_set_parent(bn, y);
         }
     }
 
@@ -377,20 +458,20 @@ void __cstl_bintree_rotate(struct cstl_bintree * const bt,
     /* y's left child becomes x's right child */
     *r(x) = *l(y);
     if (*l(y) != NULL) {
-        (*l(y))->p = x;
+        __cstl_bintree_set_parent(*l(y), x);
     }
     /* y moves into x's position in the tree */
-    y->p = x->p;
-    if (x->p == NULL) {
+    __cstl_bintree_set_parent(y, __cstl_bintree_parent(x));
+    if (__cstl_bintree_parent(x) == NULL) {
         bt->root = y;
-    } else if (x == *l(x->p)) {
-        *l(x->p) = y;
+    } else if (x == *l(__cstl_bintree_parent(x))) {
+        *l(__cstl_bintree_parent(x)) = y;
     } else {
-        *r(x->p) = y;
+        *r(__cstl_bintree_parent(x)) = y;
     }
     /* x becomes y's left child */
     *l(y) = x;
-    x->p = y;
+    __cstl_bintree_set_parent(x, y);
 }
 
 /*!
@@ -398,57 +479,229 @@ void __cstl_bintree_rotate(struct cstl_bintree * const bt,
  *
  * this version of the function operates on nodes rather than the tree,
  * so it could be used to treat any given node as the root of the tree
- * and walk the subtree rooted at that node. because of this property,
- * the function also lends itself to being called recursively, which it
- * is. whether the tree is traversed from left-to-right or right-to-left
- * is determined by the @l and @r functions.
+ * and walk the subtree rooted at that node. whether the tree is traversed
+ * from left-to-right or right-to-left is determined by the @l and @r
+ * functions. if @inorder is true, only the MID and LEAF visits are made.
+ *
+ * this walk is iterative, using the parent pointers to climb back up the
+ * tree, so it uses constant stack space regardless of the shape of the
+ * tree. when arriving at a node from its parent, the node is being
+ * visited for the first time; when arriving from its left child, the
+ * middle visit is due; and when arriving from its right child, the last
+ * visit is due. climbing back up re-reads nodes that a recursive walk
+ * would still have on the stack, so this walk is only used for the
+ * parts of a tree that are too deep to be walked recursively (see
+ * __cstl_bintree_foreach below).
+ *
+ * the parent of a node that was arrived at from above is already known,
+ * so it isn't read from the node. this keeps the address of the next
+ * node from depending on the contents of a node that may still be on
+ * its way from memory, allowing the processor to run ahead and start
+ * fetching the next node early. the parent of a node arrived at from
+ * below is read from that node, which has been visited recently.
+ *
+ * the children of a node are read before the node's last visit, after
+ * which the node is never touched again. this allows the callee to free
+ * the node on its last visit.
  */
-static int __cstl_bintree_foreach(
+static int __cstl_bintree_foreach_iter(
     const struct cstl_bintree_node * const _bn,
     int (* const visit)(const struct cstl_bintree_node *,
                         cstl_bintree_visit_order_t,
                         void *),
     void * const priv,
     __cstl_bintree_child_func_t * const l,
-    __cstl_bintree_child_func_t * const r)
+    __cstl_bintree_child_func_t * const r,
+    const bool inorder)
+{
+    const struct cstl_bintree_node * const top = __cstl_bintree_parent(_bn);
+    struct cstl_bintree_node * bn = (void *)_bn, * prev = (void *)top;
+    bool down = true;
+    int res = 0;
+
+    while (res == 0 && bn != top) {
+        struct cstl_bintree_node * const ln = *l(bn), * const rn = *r(bn);
+        struct cstl_bintree_node * const p =
+            down ? prev : __cstl_bintree_parent(bn);
+        struct cstl_bintree_node * next = p;
+
+        if (ln == NULL && rn == NULL) {
+            /* a leaf can only be reached from its parent */
+            res = visit(bn, CSTL_BINTREE_VISIT_ORDER_LEAF, priv);
+        } else if (down && ln != NULL) {
+            /* first visit; go visit the subtree rooted at the left child */
+            if (!inorder) {
+                res = visit(bn, CSTL_BINTREE_VISIT_ORDER_PRE, priv);
+            }
+            next = ln;
+        } else if (down || prev == ln) {
+            /*
+             * either arrived from the parent and there is no left
+             * child, or the left subtree has been visited. either
+             * way, the right subtree (if any) is next
+             */
+            if (down && !inorder) {
+                res = visit(bn, CSTL_BINTREE_VISIT_ORDER_PRE, priv);
+            }
+            if (res == 0) {
+                res = visit(bn, CSTL_BINTREE_VISIT_ORDER_MID, priv);
+            }
+            if (rn != NULL) {
+                next = rn;
+            } else if (res == 0 && !inorder) {
+                res = visit(bn, CSTL_BINTREE_VISIT_ORDER_POST, priv);
+            }
+        } else if (!inorder) {
+            /* the right subtree has been visited */
+            res = visit(bn, CSTL_BINTREE_VISIT_ORDER_POST, priv);
+        }
+
+        down = next != p;
+        prev = bn;
+        bn = next;
+    }
+
+    return res;
+}
+
+/*!
+ * @private
+ *
+ * the recursive walk, making all three visits to each node. @depth is
+ * the number of levels that the walk may still descend by recursing;
+ * a subtree found below that is walked by __cstl_bintree_foreach_iter().
+ *
+ * the children are read directly from the node, with @rev choosing
+ * which comes first, rather than through a pair of child functions:
+ * the function isn't inlined into its callers, and calls through
+ * those pointers would cost more than the rest of the visit.
+ *
+ * as with the iterative walk, the children of a node are read before
+ * any visit to the node, so the callee may free it on its last visit.
+ */
+static int __cstl_bintree_foreach_rec(
+    const struct cstl_bintree_node * const _bn,
+    int (* const visit)(const struct cstl_bintree_node *,
+                        cstl_bintree_visit_order_t,
+                        void *),
+    void * const priv,
+    const bool rev, const unsigned int depth)
 {
     struct cstl_bintree_node * const bn = (void *)_bn;
-    struct cstl_bintree_node * const ln = *l(bn), * const rn = *r(bn);
-    const int leaf = ln == NULL && rn == NULL;
+    struct cstl_bintree_node * const ln = rev ? bn->r : bn->l;
+    struct cstl_bintree_node * const rn = rev ? bn->l : bn->r;
     int res = 0;
 
-    if (res == 0 && leaf == 0) {
-        /* first visit to the current node (if it's a non-leaf) */
-        res = visit(bn, CSTL_BINTREE_VISIT_ORDER_PRE, priv);
+    if (depth == 0) {
+        return __cstl_bintree_foreach_iter(
+            bn, visit, priv,
+            rev ? __cstl_bintree_right : __cstl_bintree_left,
+            rev ? __cstl_bintree_left : __cstl_bintree_right,
+            false);
+    } else if (ln == NULL && rn == NULL) {
+        return visit(bn, CSTL_BINTREE_VISIT_ORDER_LEAF, priv);
     }
 
+    res = visit(bn, CSTL_BINTREE_VISIT_ORDER_PRE, priv);
     if (res == 0 && ln != NULL) {
-        /* visit the subtree rooted at the left child */
-        res = __cstl_bintree_foreach(ln, visit, priv, l, r);
+        res = __cstl_bintree_foreach_rec(ln, visit, priv, rev, depth - 1);
     }
-
     if (res == 0) {
-        /* visit the current node */
-        if (leaf != 0) {
-            res = visit(bn, CSTL_BINTREE_VISIT_ORDER_LEAF, priv);
-        } else {
-            res = visit(bn, CSTL_BINTREE_VISIT_ORDER_MID, priv);
-        }
+        res = visit(bn, CSTL_BINTREE_VISIT_ORDER_MID, priv);
     }
-
     if (res == 0 && rn != NULL) {
-        /* visit the subtree rooted at the right child */
-        res = __cstl_bintree_foreach(rn, visit, priv, l, r);
+        res = __cstl_bintree_foreach_rec(rn, visit, priv, rev, depth - 1);
     }
-
-    if (res == 0 && leaf == 0) {
-        /* last visit to the current node (if it's a non-leaf) */
+    if (res == 0) {
         res = visit(bn, CSTL_BINTREE_VISIT_ORDER_POST, priv);
     }
 
     return res;
 }
 
+/*!
+ * @private
+ *
+ * the recursive walk, making only the MID and LEAF visits. once the
+ * left subtree and the node itself have been visited, nothing remains
+ * to be done at the node, so the walk moves on to the right child
+ * without recursing. only descents to the left use the stack, and
+ * @depth limits them as for __cstl_bintree_foreach_rec().
+ */
+static int __cstl_bintree_foreach_inorder_rec(
+    const struct cstl_bintree_node * const _bn,
+    int (* const visit)(const struct cstl_bintree_node *,
+                        cstl_bintree_visit_order_t,
+                        void *),
+    void * const priv,
+    const bool rev, const unsigned int depth)
+{
+    struct cstl_bintree_node * bn = (void *)_bn;
+    int res = 0;
+
+    if (depth == 0) {
+        return __cstl_bintree_foreach_iter(
+            bn, visit, priv,
+            rev ? __cstl_bintree_right : __cstl_bintree_left,
+            rev ? __cstl_bintree_left : __cstl_bintree_right,
+            true);
+    }
+
+    do {
+        struct cstl_bintree_node * const ln = rev ? bn->r : bn->l;
+        struct cstl_bintree_node * const rn = rev ? bn->l : bn->r;
+
+        if (ln != NULL) {
+            res = __cstl_bintree_foreach_inorder_rec(
+                ln, visit, priv, rev, depth - 1);
+        }
+        if (res == 0) {
+            res = visit(bn,
+                        (ln == NULL && rn == NULL)
+                        ? CSTL_BINTREE_VISIT_ORDER_LEAF
+                        : CSTL_BINTREE_VISIT_ORDER_MID,
+                        priv);
+        }
+
+        bn = rn;
+    } while (res == 0 && bn != NULL);
+
+    return res;
+}
+
+/*!
+ * @private
+ *
+ * walk the subtree rooted at @bn, which belongs to a tree of @size
+ * nodes, in the direction given by @dir. recursion is the fastest way
+ * to walk a tree: the path back to the root stays on the stack, and
+ * nothing is read from a node after its last visit. the depth of the
+ * recursion is limited to twice the number of bits needed to represent
+ * the size of the tree, which a red-black tree never reaches (its
+ * height is at most 2*log2(n+1)). only the deeper parts of a
+ * degenerate tree are walked iteratively.
+ */
+static inline int __cstl_bintree_foreach(
+    const struct cstl_bintree_node * const bn,
+    const size_t size,
+    int (* const visit)(const struct cstl_bintree_node *,
+                        cstl_bintree_visit_order_t,
+                        void *),
+    void * const priv,
+    const cstl_bintree_foreach_dir_t dir,
+    const bool inorder)
+{
+    const bool rev = dir == CSTL_BINTREE_FOREACH_DIR_REV;
+    const unsigned int depth = 2 * (cstl_fls(size) + 1);
+
+    if (inorder) {
+        return __cstl_bintree_foreach_inorder_rec(
+            bn, visit, priv, rev, depth);
+    }
+
+    return __cstl_bintree_foreach_rec(bn, visit, priv, rev, depth);
+}
+
 struct cstl_bintree_foreach_priv
 {
     const struct cstl_bintree * bt;
@@ -472,10 +725,11 @@ static int cstl_bintree_foreach_visit(
     return bfp->visit(cstl_bintree_element(bfp->bt, bn), order, bfp->priv);
 }
 
-int cstl_bintree_foreach(const struct cstl_bintree * const bt,
-                         cstl_bintree_const_visit_func_t * const visit,
-                         void * const priv,
-                         const cstl_bintree_foreach_dir_t dir)
+/*! @private */
+static int cstl_bintree_foreach_dir(
+    const struct cstl_bintree * const bt,
+    cstl_bintree_const_visit_func_t * const visit, void * const priv,
+    const cstl_bintree_foreach_dir_t dir, const bool inorder)
 {
     int res = 0;
 
@@ -486,23 +740,30 @@ int cstl_bintree_foreach(const struct cstl_bintree * const bt,
         bfp.visit = visit;
         bfp.priv = priv;
 
-        switch (dir) {
-        case CSTL_BINTREE_FOREACH_DIR_FWD:
-            res = __cstl_bintree_foreach(
-                      bt->root, cstl_bintree_foreach_visit, &bfp,
-                      __cstl_bintree_left, __cstl_bintree_right);
-            break;
-        case CSTL_BINTREE_FOREACH_DIR_REV:
-            res = __cstl_bintree_foreach(
-                      bt->root, cstl_bintree_foreach_visit, &bfp,
-                      __cstl_bintree_right, __cstl_bintree_left);
-            break;
-        }
+        res = __cstl_bintree_foreach(
+                  bt->root, bt->size, cstl_bintree_foreach_visit, &bfp,
+                  dir, inorder);
     }
 
     return res;
 }
 
+int cstl_bintree_foreach(const struct cstl_bintree * const bt,
+                         cstl_bintree_const_visit_func_t * const visit,
+                         void * const priv,
+                         const cstl_bintree_foreach_dir_t dir)
+{
+    return cstl_bintree_foreach_dir(bt, visit, priv, dir, false);
+}
+
+int cstl_bintree_foreach_inorder(
+    const struct cstl_bintree * const bt,
+    cstl_bintree_const_visit_func_t * const visit, void * const priv,
+    const cstl_bintree_foreach_dir_t dir)
+{
+    return cstl_bintree_foreach_dir(bt, visit, priv, dir, true);
+}
+
 void cstl_bintree_swap(struct cstl_bintree * const a,
                        struct cstl_bintree * const b)
 {
@@ -515,57 +776,55 @@ void cstl_bintree_swap(struct cstl_bintree * const a,
      */
 }
 
-struct cstl_bintree_clear_priv
-{
-    struct cstl_bintree * bt;
-    cstl_xtor_func_t * clr;
-    void * priv;
-};
-
-/*!
- * @private
- *
- * call the user specified clear function for each node in the tree.
- * the call is only made for leaf nodes and on the last visit to non-leaf
- * nodes. this ensures that the node isn't visited again after the call
- * which means that the callee can modify the element however it wishes
- * when called.
+/*
+ * the tree is dismantled from the bottom up: descend to a leaf, detach
+ * it from its parent, and hand it to the caller. the parent then either
+ * has another child to descend into or has become a leaf itself. no
+ * stack is needed, and each node is passed through at most three times.
  */
-static int __cstl_bintree_clear_visit(
-    const struct cstl_bintree_node * const bn,
-    const cstl_bintree_visit_order_t order,
-    void * const p)
-{
-    if (order == CSTL_BINTREE_VISIT_ORDER_POST
-        || order == CSTL_BINTREE_VISIT_ORDER_LEAF) {
-        struct cstl_bintree_clear_priv * const bcp = p;
-        /*
-         * explicitly ignore the callee's return value,
-         * and proceed through the tree, regardless
-         */
-        (void)bcp->clr(__cstl_bintree_element(bcp->bt, bn), bcp->priv);
-    }
-
-    return 0;
-}
-
 void cstl_bintree_clear(struct cstl_bintree * const bt,
                         cstl_xtor_func_t * const clr,
                         void * const priv)
 {
-    if (bt->root != NULL) {
-        struct cstl_bintree_clear_priv bcp;
-
-        bcp.bt = bt;
-        bcp.clr = clr;
-        bcp.priv = priv;
-
-        __cstl_bintree_foreach(bt->root, __cstl_bintree_clear_visit, &bcp,
-                               __cstl_bintree_left, __cstl_bintree_right);
+    struct cstl_bintree_node * bn = bt->root, * p = NULL;
 
-        bt->root  = NULL;
-        bt->size = 0;
+    /*
+     * as with the foreach function, the parent of the current
+     * node is tracked on the way down rather than read from the
+     * node so that the processor can move on to the next node
+     * before the current one has arrived from memory
+     */
+    while (bn != NULL) {
+        if (bn->l != NULL) {
+            p = bn;
+            bn = bn->l;
+        } else if (bn->r != NULL) {
+            p = bn;
+            bn = bn->r;
+        } else {
+            if (p != NULL) {
+                if (p->l == bn) {
+                    p->l = NULL;
+                } else {
+                    p->r = NULL;
+                }
+            }
+
+            /*
+             * the node is no longer in the tree, and
+             * the callee may do with it as it wishes
+             */
+            clr(__cstl_bintree_element(bt, bn), priv);
+
+            bn = p;
+            if (bn != NULL) {
+                p = __cstl_bintree_parent(bn);
+            }
+        }
     }
+
+    bt->root = NULL;
+    bt->size = 0;
 }
 
 struct cstl_bintree_height_priv
@@ -590,7 +849,7 @@ static int __cstl_bintree_height(const struct cstl_bintree_node * bn,
     if (order == CSTL_BINTREE_VISIT_ORDER_LEAF) {
         size_t h;
 
-        for (h = 0; bn != NULL; h++, bn = bn->p)
+        for (h = 0; bn != NULL; h++, bn = __cstl_bintree_parent(bn))
             ;
 
         if (h < hp->min) {
@@ -617,8 +876,9 @@ void cstl_bintree_height(const struct cstl_bintree * const bt,
         hp.min = SIZE_MAX;
         hp.max = 0;
 
-        __cstl_bintree_foreach(bt->root, __cstl_bintree_height, &hp,
-                               __cstl_bintree_left, __cstl_bintree_right);
+        __cstl_bintree_foreach(bt->root, bt->size,
+                               __cstl_bintree_height, &hp,
+                               CSTL_BINTREE_FOREACH_DIR_FWD, false);
     }
 
     *min = hp.min;
@@ -652,8 +912,9 @@ static int __cstl_bintree_verify(const struct cstl_bintree_node * const bn,
 static void cstl_bintree_verify(const struct cstl_bintree * const bt)
 {
     if (bt->root != NULL) {
-        __cstl_bintree_foreach(bt->root, __cstl_bintree_verify, (void *)bt,
-                               __cstl_bintree_left, __cstl_bintree_right);
+        __cstl_bintree_foreach(bt->root, bt->size,
+                               __cstl_bintree_verify, (void *)bt,
+                               CSTL_BINTREE_FOREACH_DIR_FWD, true);
     }
 }
 
@@ -774,6 +1035,13 @@ START_TEST(walk_fwd)
     cstl_bintree_foreach(&bt,
                          __test__foreach_fwd_visit, &i,
                          CSTL_BINTREE_FOREACH_DIR_FWD);
+    ck_assert_uint_eq(i, n);
+
+    i = 0;
+    cstl_bintree_foreach_inorder(&bt,
+                                 __test__foreach_fwd_visit, &i,
+                                 CSTL_BINTREE_FOREACH_DIR_FWD);
+    ck_assert_uint_eq(i, n);
 
     node = cstl_bintree_slide(bt.root, __cstl_bintree_left);
     ck_assert_ptr_nonnull(node);
@@ -819,6 +1087,13 @@ START_TEST(walk_rev)
     cstl_bintree_foreach(&bt,
                          __test__foreach_rev_visit, &i,
                          CSTL_BINTREE_FOREACH_DIR_REV);
+    ck_assert_uint_eq(i, 0);
+
+    i = n;
+    cstl_bintree_foreach_inorder(&bt,
+                                 __test__foreach_rev_visit, &i,
+                                 CSTL_BINTREE_FOREACH_DIR_REV);
+    ck_assert_uint_eq(i, 0);
 
     node = cstl_bintree_slide(bt.root, __cstl_bintree_right);
     ck_assert_ptr_nonnull(node);
@@ -834,6 +1109,264 @@ START_TEST(walk_rev)
 }
 END_TEST
 
+struct __test__visit_log
+{
+    unsigned int n, stop;
+    struct
+    {
+        const void * e;
+        cstl_bintree_visit_order_t ord;
+    } v[400];
+};
+
+static int __test__visit_log(const void * const e,
+                             const cstl_bintree_visit_order_t ord,
+                             void * const p)
+{
+    struct __test__visit_log * const log = p;
+
+    log->v[log->n].e = e;
+    log->v[log->n].ord = ord;
+    log->n++;
+
+    return log->n == log->stop;
+}
+
+/*
+ * the straightforward, recursive traversal against
+ * which the iterative traversal is checked
+ */
+static int __test__visit_recursive(const struct cstl_bintree * const bt,
+                                   const struct cstl_bintree_node * const bn,
+                                   struct __test__visit_log * const log)
+{
+    const void * const e = __cstl_bintree_element(bt, bn);
+    int res = 0;
+
+    if (bn->l == NULL && bn->r == NULL) {
+        return __test__visit_log(e, CSTL_BINTREE_VISIT_ORDER_LEAF, log);
+    }
+
+    res = __test__visit_log(e, CSTL_BINTREE_VISIT_ORDER_PRE, log);
+    if (res == 0 && bn->l != NULL) {
+        res = __test__visit_recursive(bt, bn->l, log);
+    }
+    if (res == 0) {
+        res = __test__visit_log(e, CSTL_BINTREE_VISIT_ORDER_MID, log);
+    }
+    if (res == 0 && bn->r != NULL) {
+        res = __test__visit_recursive(bt, bn->r, log);
+    }
+    if (res == 0) {
+        res = __test__visit_log(e, CSTL_BINTREE_VISIT_ORDER_POST, log);
+    }
+
+    return res;
+}
+
+START_TEST(walk_order)
+{
+    static const size_t n = 100;
+
+    DECLARE_CSTL_BINTREE(bt, struct integer, bn, cmp_integer, NULL);
+    struct __test__visit_log * const a = malloc(sizeof(*a));
+    struct __test__visit_log * const b = malloc(sizeof(*b));
+    unsigned int i;
+
+    __test__cstl_bintree_fill(&bt, n);
+
+    /* stop at various points, including not at all */
+    for (i = 0; i < 4 * n; i += 37) {
+        unsigned int j;
+
+        a->n = b->n = 0;
+        a->stop = b->stop = i;
+
+        ck_assert_int_eq(
+            cstl_bintree_foreach(&bt, __test__visit_log, a,
+                                 CSTL_BINTREE_FOREACH_DIR_FWD),
+            __test__visit_recursive(&bt, bt.root, b));
+
+        ck_assert_uint_eq(a->n, b->n);
+        for (j = 0; j < a->n; j++) {
+            ck_assert_ptr_eq(a->v[j].e, b->v[j].e);
+            ck_assert_int_eq(a->v[j].ord, b->v[j].ord);
+        }
+    }
+
+    free(b);
+    free(a);
+
+    cstl_bintree_clear(&bt, __test_cstl_bintree_free, NULL);
+}
+END_TEST
+
+/*
+ * a tree with a balanced top and long chains below it. the chains are
+ * too deep to be walked recursively, so the walk switches methods in
+ * the middle of the tree and must pick up where it left off afterward
+ */
+START_TEST(walk_order_deep)
+{
+    static const unsigned int n = 100;
+
+    DECLARE_CSTL_BINTREE(bt, struct integer, bn, cmp_integer, NULL);
+    struct __test__visit_log * const a = malloc(sizeof(*a));
+    struct __test__visit_log * const b = malloc(sizeof(*b));
+    unsigned int i, j;
+
+    for (i = 0; i < n; i++) {
+        struct integer * const in = malloc(sizeof(*in));
+
+        /* 50 first, then 0 up through 49 and 99 down through 51 */
+        in->v = (i == 0) ? n / 2 : (i <= n / 2) ? i - 1 : n + n / 2 - i;
+        cstl_bintree_insert(&bt, in, NULL);
+    }
+
+    for (i = 0; i < 4 * n; i += 37) {
+        a->n = b->n = 0;
+        a->stop = b->stop = i;
+        ck_assert_int_eq(
+            cstl_bintree_foreach(&bt, __test__visit_log, a,
+                                 CSTL_BINTREE_FOREACH_DIR_FWD),
+            __test__visit_recursive(&bt, bt.root, b));
+        ck_assert_uint_eq(a->n, b->n);
+        for (j = 0; j < a->n; j++) {
+            ck_assert_ptr_eq(a->v[j].e, b->v[j].e);
+            ck_assert_int_eq(a->v[j].ord, b->v[j].ord);
+        }
+    }
+
+    /* the in-order walk makes the MID and LEAF visits, in the same order */
+    a->n = b->n = 0;
+    a->stop = b->stop = 0;
+    cstl_bintree_foreach_inorder(&bt, __test__visit_log, a,
+                                 CSTL_BINTREE_FOREACH_DIR_FWD);
+    __test__visit_recursive(&bt, bt.root, b);
+    ck_assert_uint_eq(a->n, n);
+    for (i = 0, j = 0; i < b->n; i++) {
+        if (b->v[i].ord == CSTL_BINTREE_VISIT_ORDER_MID
+            || b->v[i].ord == CSTL_BINTREE_VISIT_ORDER_LEAF) {
+            ck_assert_ptr_eq(a->v[j].e, b->v[i].e);
+            ck_assert_int_eq(a->v[j].ord, b->v[i].ord);
+            j++;
+        }
+    }
+    ck_assert_uint_eq(j, n);
+
+    free(b);
+    free(a);
+    cstl_bintree_clear(&bt, __test_cstl_bintree_free, NULL);
+}
+END_TEST
+
+static int __test__count_visit(const void * const e,
+                               const cstl_bintree_visit_order_t ord,
+                               void * const p)
+{
+    if (ord == CSTL_BINTREE_VISIT_ORDER_MID
+        || ord == CSTL_BINTREE_VISIT_ORDER_LEAF) {
+        (*(size_t *)p)++;
+    }
+    return 0;
+
+    (void)e;
+}
+
+static void __test__count_clear(void * const e, void * const p)
+{
+    (*(size_t *)p)++;
+    (void)e;
+}
+
+START_TEST(degenerate)
+{
+    /* deep enough to overflow the stack if walked recursively */
+    static const size_t n = 1 << 20;
+
+    DECLARE_CSTL_BINTREE(bt, struct integer, bn, cmp_integer, NULL);
+    struct integer * const in = malloc(n * sizeof(*in));
+    size_t i, c, min, max;
+
+    for (i = 0; i < n; i++) {
+        in[i].v = i;
+        cstl_bintree_insert(&bt, &in[i], i > 0 ? &in[i - 1] : NULL);
+    }
+
+    cstl_bintree_height(&bt, &min, &max);
+    ck_assert_uint_eq(min, n);
+    ck_assert_uint_eq(max, n);
+
+    c = 0;
+    cstl_bintree_foreach(&bt, __test__count_visit, &c,
+                         CSTL_BINTREE_FOREACH_DIR_REV);
+    ck_assert_uint_eq(c, n);
+
+    c = 0;
+    cstl_bintree_foreach_inorder(&bt, __test__count_visit, &c,
+                                 CSTL_BINTREE_FOREACH_DIR_FWD);
+    ck_assert_uint_eq(c, n);
+
+    c = 0;
+    cstl_bintree_clear(&bt, __test__count_clear, &c);
+    ck_assert_uint_eq(c, n);
+    ck_assert_uint_eq(cstl_bintree_size(&bt), 0);
+
+    free(in);
+}
+END_TEST
+
+START_TEST(bounds)
+{
+    static const size_t n = 100;
+
+    DECLARE_CSTL_BINTREE(bt, struct integer, bn, cmp_integer, NULL);
+    const struct integer * in;
+    struct integer f;
+
+    __test__cstl_bintree_fill(&bt, n);
+
+    /* the fill inserts 0 through n - 1; remove the odd ones */
+    for (f.v = 1; f.v < (int)n; f.v += 2) {
+        free(cstl_bintree_erase(&bt, &f));
+    }
+
+    f.v = 10;
+    in = cstl_bintree_lower_bound(&bt, &f);
+    ck_assert_int_eq(in->v, 10);
+    in = cstl_bintree_upper_bound(&bt, &f);
+    ck_assert_int_eq(in->v, 12);
+
+    f.v = 11;
+    in = cstl_bintree_lower_bound(&bt, &f);
+    ck_assert_int_eq(in->v, 12);
+    in = cstl_bintree_upper_bound(&bt, &f);
+    ck_assert_int_eq(in->v, 12);
+
+    in = cstl_bintree_next(&bt, in);
+    ck_assert_int_eq(in->v, 14);
+    in = cstl_bintree_prev(&bt, in);
+    ck_assert_int_eq(in->v, 12);
+
+    f.v = n - 2;
+    ck_assert_ptr_null(cstl_bintree_upper_bound(&bt, &f));
+    f.v = n;
+    ck_assert_ptr_null(cstl_bintree_lower_bound(&bt, &f));
+
+    /* a NULL element refers to the ends of the tree */
+    in = cstl_bintree_next(&bt, NULL);
+    ck_assert_int_eq(in->v, 0);
+    ck_assert_ptr_null(cstl_bintree_prev(&bt, in));
+    in = cstl_bintree_prev(&bt, NULL);
+    ck_assert_int_eq(in->v, n - 2);
+    ck_assert_ptr_null(cstl_bintree_next(&bt, in));
+
+    cstl_bintree_clear(&bt, __test_cstl_bintree_free, NULL);
+    ck_assert_ptr_null(cstl_bintree_next(&bt, NULL));
+    ck_assert_ptr_null(cstl_bintree_prev(&bt, NULL));
+}
+END_TEST
+
 START_TEST(random_empty)
 {
     static const size_t n = 100;
@@ -871,6 +1404,10 @@ Suite * bintree_suite(void)
     tcase_add_test(tc, fill);
     tcase_add_test(tc, walk_fwd);
     tcase_add_test(tc, walk_rev);
+    tcase_add_test(tc, walk_order);
+    tcase_add_test(tc, walk_order_deep);
+    tcase_add_test(tc, degenerate);
+    tcase_add_test(tc, bounds);
     tcase_add_test(tc, random_empty);
 
     suite_add_tcase(s, tc);
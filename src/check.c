@@ -25,16 +25,30 @@ int main(void)
     } while (0)
 
     SRUNNER_ADD_SUITE(sr, common);
+    SRUNNER_ADD_SUITE(sr, allocator);
     SRUNNER_ADD_SUITE(sr, memory);
+    SRUNNER_ADD_SUITE(sr, pool);
+    SRUNNER_ADD_SUITE(sr, arena);
     SRUNNER_ADD_SUITE(sr, bintree);
     SRUNNER_ADD_SUITE(sr, rbtree);
     SRUNNER_ADD_SUITE(sr, heap);
+    SRUNNER_ADD_SUITE(sr, dheap);
+    SRUNNER_ADD_SUITE(sr, pheap);
+    SRUNNER_ADD_SUITE(sr, rheap);
+    SRUNNER_ADD_SUITE(sr, twheel);
     SRUNNER_ADD_SUITE(sr, dlist);
     SRUNNER_ADD_SUITE(sr, slist);
     SRUNNER_ADD_SUITE(sr, hash);
     SRUNNER_ADD_SUITE(sr, vector);
+    SRUNNER_ADD_SUITE(sr, deque);
     SRUNNER_ADD_SUITE(sr, string);
     SRUNNER_ADD_SUITE(sr, map);
+    SRUNNER_ADD_SUITE(sr, pmap);
+    SRUNNER_ADD_SUITE(sr, skipmap);
+    SRUNNER_ADD_SUITE(sr, mqueue);
+    SRUNNER_ADD_SUITE(sr, spsc);
+    SRUNNER_ADD_SUITE(sr, mpmc);
+    SRUNNER_ADD_SUITE(sr, art);
     SRUNNER_ADD_SUITE(sr, array);
 
     srunner_run_all(sr, CK_ENV);
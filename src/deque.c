@@ -0,0 +1,602 @@
+/*!
+ * @file
+ */
+
+#include "cstl/deque.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * the (maximum) size of each block of elements. each block holds
+ * the greatest power of two number of elements that fits in this
+ * size, but no fewer than 2^CSTL_DEQUE_BLOCK_SHIFT elements
+ */
+#define CSTL_DEQUE_BLOCK_SIZE   4096
+#define CSTL_DEQUE_BLOCK_SHIFT  4
+
+/*! @private */
+static size_t cstl_deque_block_bytes(const struct cstl_deque * const d)
+{
+    return d->elem.size << d->shift;
+}
+
+/*!
+ * @private
+ *
+ * the elements are numbered from the start of the first block,
+ * so the block holding an element is found by a shift and the
+ * location within the block by a mask. the map is circular,
+ * so its index must also be masked
+ */
+static void * __cstl_deque_at(const struct cstl_deque * const d,
+                              const size_t i)
+{
+    const size_t p = d->off + i;
+    void * const b =
+        d->map.base[(d->map.beg + (p >> d->shift)) & (d->map.cap - 1)];
+
+    return (void *)((uintptr_t)b
+                    + (p & (((size_t)1 << d->shift) - 1)) * d->elem.size);
+}
+
+void cstl_deque_set_allocator(struct cstl_deque * const d,
+                              const cstl_allocator_t * const a)
+{
+    if (d->map.base != NULL || d->spare != NULL) {
+        abort();
+    }
+
+    d->allocator = a;
+}
+
+const void * cstl_deque_at_const(
+    const struct cstl_deque * const d, const size_t i)
+{
+    if (i >= d->count) {
+        abort();
+    }
+
+    return __cstl_deque_at(d, i);
+}
+
+void * cstl_deque_at(struct cstl_deque * const d, const size_t i)
+{
+    return (void *)cstl_deque_at_const(d, i);
+}
+
+void * cstl_deque_front(struct cstl_deque * const d)
+{
+    if (d->count == 0) {
+        return NULL;
+    }
+
+    return __cstl_deque_at(d, 0);
+}
+
+void * cstl_deque_back(struct cstl_deque * const d)
+{
+    if (d->count == 0) {
+        return NULL;
+    }
+
+    return __cstl_deque_at(d, d->count - 1);
+}
+
+/*!
+ * @private
+ *
+ * double the size of the map, copying the pointers to the blocks
+ * in use to the beginning of the new map, in order
+ */
+static int cstl_deque_grow_map(struct cstl_deque * const d)
+{
+    const size_t cap = d->map.cap > 0 ? 2 * d->map.cap : 8;
+    void ** const base =
+        cstl_allocator_alloc(d->allocator, cap * sizeof(*base));
+    size_t i;
+
+    if (base == NULL) {
+        return -1;
+    }
+
+    for (i = 0; i < d->map.count; i++) {
+        base[i] = d->map.base[(d->map.beg + i) & (d->map.cap - 1)];
+    }
+
+    if (d->map.base != NULL) {
+        cstl_allocator_free(d->allocator,
+                            d->map.base, d->map.cap * sizeof(*d->map.base));
+    }
+
+    d->map.base = base;
+    d->map.cap = cap;
+    d->map.beg = 0;
+
+    return 0;
+}
+
+/*!
+ * @private
+ *
+ * get an empty block, making sure that there is room for
+ * it in the map. the caller puts it into the map
+ */
+static void * cstl_deque_get_block(struct cstl_deque * const d)
+{
+    void * b;
+
+    if (d->map.count == d->map.cap && cstl_deque_grow_map(d) != 0) {
+        return NULL;
+    }
+
+    if (d->spare != NULL) {
+        b = d->spare;
+        d->spare = NULL;
+    } else {
+        if (d->shift == 0) {
+            /* the number of elements per block is decided once */
+            d->shift = CSTL_DEQUE_BLOCK_SHIFT;
+            if (d->elem.size <= (size_t)CSTL_DEQUE_BLOCK_SIZE >> d->shift) {
+                d->shift = cstl_fls(CSTL_DEQUE_BLOCK_SIZE / d->elem.size);
+            }
+        }
+
+        b = cstl_allocator_alloc(d->allocator, cstl_deque_block_bytes(d));
+    }
+
+    return b;
+}
+
+/*!
+ * @private
+ *
+ * one empty block is held back so that a deque whose size
+ * hovers around a block boundary, e.g. a fifo that is drained
+ * as fast as it's filled, doesn't allocate and free a block
+ * each time it crosses the boundary
+ */
+static void cstl_deque_put_block(struct cstl_deque * const d, void * const b)
+{
+    if (d->spare == NULL) {
+        d->spare = b;
+    } else {
+        cstl_allocator_free(d->allocator, b, cstl_deque_block_bytes(d));
+    }
+}
+
+/*!
+ * @private
+ *
+ * called when the last element has been removed. the
+ * remaining block(s) are released, and the elements will
+ * begin again at the start of the next block added
+ */
+static void cstl_deque_empty(struct cstl_deque * const d)
+{
+    while (d->map.count > 0) {
+        cstl_deque_put_block(d, d->map.base[d->map.beg]);
+        d->map.beg = (d->map.beg + 1) & (d->map.cap - 1);
+        d->map.count--;
+    }
+
+    d->map.beg = 0;
+    d->off = 0;
+}
+
+void * cstl_deque_push_front(struct cstl_deque * const d)
+{
+    void * e;
+
+    if (d->off == 0) {
+        /* the first block is full (or there isn't one) */
+        void * const b = cstl_deque_get_block(d);
+        if (b == NULL) {
+            return NULL;
+        }
+
+        d->map.beg = (d->map.beg - 1) & (d->map.cap - 1);
+        d->map.base[d->map.beg] = b;
+        d->map.count++;
+
+        d->off = (size_t)1 << d->shift;
+    }
+
+    d->off--;
+    d->count++;
+
+    e = __cstl_deque_at(d, 0);
+    if (d->elem.xtor.cons != NULL) {
+        d->elem.xtor.cons(e, d->elem.xtor.priv);
+    }
+
+    return e;
+}
+
+void * cstl_deque_push_back(struct cstl_deque * const d)
+{
+    void * e;
+
+    if (((d->off + d->count) >> d->shift) == d->map.count) {
+        /* the last block is full (or there isn't one) */
+        void * const b = cstl_deque_get_block(d);
+        if (b == NULL) {
+            return NULL;
+        }
+
+        d->map.base[(d->map.beg + d->map.count) & (d->map.cap - 1)] = b;
+        d->map.count++;
+    }
+
+    e = __cstl_deque_at(d, d->count++);
+    if (d->elem.xtor.cons != NULL) {
+        d->elem.xtor.cons(e, d->elem.xtor.priv);
+    }
+
+    return e;
+}
+
+void cstl_deque_pop_front(struct cstl_deque * const d)
+{
+    if (d->count == 0) {
+        abort();
+    }
+
+    if (d->elem.xtor.dest != NULL) {
+        d->elem.xtor.dest(__cstl_deque_at(d, 0), d->elem.xtor.priv);
+    }
+
+    d->off++;
+    d->count--;
+
+    if (d->count == 0) {
+        cstl_deque_empty(d);
+    } else if ((d->off >> d->shift) > 0) {
+        /* the first block is no longer in use */
+        cstl_deque_put_block(d, d->map.base[d->map.beg]);
+        d->map.beg = (d->map.beg + 1) & (d->map.cap - 1);
+        d->map.count--;
+
+        d->off = 0;
+    }
+}
+
+void cstl_deque_pop_back(struct cstl_deque * const d)
+{
+    if (d->count == 0) {
+        abort();
+    }
+
+    d->count--;
+    if (d->elem.xtor.dest != NULL) {
+        d->elem.xtor.dest(__cstl_deque_at(d, d->count), d->elem.xtor.priv);
+    }
+
+    if (d->count == 0) {
+        cstl_deque_empty(d);
+    } else if (((d->off + d->count) & (((size_t)1 << d->shift) - 1)) == 0) {
+        /* the last block is no longer in use */
+        d->map.count--;
+        cstl_deque_put_block(
+            d,
+            d->map.base[(d->map.beg + d->map.count) & (d->map.cap - 1)]);
+    }
+}
+
+void cstl_deque_swap(struct cstl_deque * const a,
+                     struct cstl_deque * const b)
+{
+    struct cstl_deque t;
+    cstl_swap(a, b, &t, sizeof(t));
+}
+
+void cstl_deque_clear(struct cstl_deque * const d)
+{
+    if (d->elem.xtor.dest != NULL) {
+        size_t i;
+
+        for (i = 0; i < d->count; i++) {
+            d->elem.xtor.dest(__cstl_deque_at(d, i), d->elem.xtor.priv);
+        }
+    }
+    d->count = 0;
+
+    cstl_deque_empty(d);
+    if (d->spare != NULL) {
+        cstl_allocator_free(
+            d->allocator, d->spare, cstl_deque_block_bytes(d));
+        d->spare = NULL;
+    }
+
+    if (d->map.base != NULL) {
+        cstl_allocator_free(d->allocator,
+                            d->map.base, d->map.cap * sizeof(*d->map.base));
+        d->map.base = NULL;
+        d->map.cap = 0;
+    }
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+START_TEST(fifo)
+{
+    static const int n = 3000;
+
+    DECLARE_CSTL_DEQUE(d, int);
+    int i, j;
+
+    ck_assert_ptr_null(cstl_deque_front(&d));
+    ck_assert_ptr_null(cstl_deque_back(&d));
+
+    for (i = 0; i < n; i++) {
+        *(int *)cstl_deque_push_back(&d) = i;
+        ck_assert_int_eq(*(int *)cstl_deque_back(&d), i);
+    }
+    ck_assert_uint_eq(cstl_deque_size(&d), n);
+    for (i = 0; i < n; i++) {
+        ck_assert_int_eq(*(int *)cstl_deque_at(&d, i), i);
+    }
+
+    /* drain half, then keep the queue at a steady depth */
+    for (i = 0; i < n / 2; i++) {
+        ck_assert_int_eq(*(int *)cstl_deque_front(&d), i);
+        cstl_deque_pop_front(&d);
+    }
+    for (j = n; j < 10 * n; j++, i++) {
+        *(int *)cstl_deque_push_back(&d) = j;
+        ck_assert_int_eq(*(int *)cstl_deque_front(&d), i);
+        cstl_deque_pop_front(&d);
+    }
+    ck_assert_uint_eq(cstl_deque_size(&d), n - n / 2);
+    for (; i < j; i++) {
+        ck_assert_int_eq(*(int *)cstl_deque_front(&d), i);
+        cstl_deque_pop_front(&d);
+    }
+    ck_assert_uint_eq(cstl_deque_size(&d), 0);
+    ck_assert_ptr_null(cstl_deque_front(&d));
+
+    cstl_deque_clear(&d);
+}
+END_TEST
+
+START_TEST(ends)
+{
+    static const int n = 2000;
+
+    /* a reference copy of the deque, growing outward from the middle */
+    int * const r = malloc(2 * n * sizeof(*r));
+    int beg = n, end = n;
+    DECLARE_CSTL_DEQUE(d, int);
+    int i;
+
+    for (i = 0; i < 20 * n; i++) {
+        const int op = rand() % 5;
+
+        if (op == 0 && end < 2 * n) {
+            *(int *)cstl_deque_push_back(&d) = r[end++] = i;
+        } else if (op == 1 && beg > 0) {
+            *(int *)cstl_deque_push_front(&d) = r[--beg] = i;
+        } else if (op == 2 && beg < end) {
+            ck_assert_int_eq(*(int *)cstl_deque_back(&d), r[--end]);
+            cstl_deque_pop_back(&d);
+        } else if (op == 3 && beg < end) {
+            ck_assert_int_eq(*(int *)cstl_deque_front(&d), r[beg++]);
+            cstl_deque_pop_front(&d);
+        } else if (beg < end) {
+            const int j = rand() % (end - beg);
+
+            ck_assert_int_eq(*(int *)cstl_deque_at(&d, j), r[beg + j]);
+        }
+
+        ck_assert_uint_eq(cstl_deque_size(&d), end - beg);
+        if (beg == end) {
+            /* recenter the reference */
+            beg = end = n;
+        }
+    }
+
+    ck_assert_signal(SIGABRT, cstl_deque_at(&d, end - beg));
+
+    /* empty the deque from the back */
+    while (beg < end) {
+        ck_assert_int_eq(*(int *)cstl_deque_back(&d), r[--end]);
+        cstl_deque_pop_back(&d);
+    }
+    ck_assert_ptr_null(cstl_deque_back(&d));
+    ck_assert_signal(SIGABRT, cstl_deque_pop_back(&d));
+    ck_assert_signal(SIGABRT, cstl_deque_pop_front(&d));
+
+    /* and fill it from the front */
+    for (i = 0; i < n; i++) {
+        *(int *)cstl_deque_push_front(&d) = i;
+    }
+    for (i = 0; i < n; i++) {
+        ck_assert_int_eq(*(int *)cstl_deque_at(&d, i), n - i - 1);
+    }
+
+    cstl_deque_clear(&d);
+    free(r);
+}
+END_TEST
+
+static void int_cons(void * const i, void * const p)
+{
+    (void)i;
+    (*(int *)p)++;
+}
+
+static void int_dest(void * const i, void * const p)
+{
+    (void)i;
+    (*(int *)p)--;
+}
+
+START_TEST(complex)
+{
+    struct cstl_deque d;
+    int live = 0, i;
+
+    cstl_deque_init_complex(&d, sizeof(int), int_cons, int_dest, &live);
+
+    for (i = 0; i < 1000; i++) {
+        cstl_deque_push_back(&d);
+        cstl_deque_push_front(&d);
+    }
+    ck_assert_int_eq(live, 2000);
+    for (i = 0; i < 300; i++) {
+        cstl_deque_pop_back(&d);
+        cstl_deque_pop_front(&d);
+    }
+    ck_assert_int_eq(live, 1400);
+
+    /* remaining elements are destroyed by the clear */
+    cstl_deque_clear(&d);
+    ck_assert_int_eq(live, 0);
+    ck_assert_uint_eq(cstl_deque_size(&d), 0);
+
+    /* the deque is reusable after a clear */
+    cstl_deque_push_back(&d);
+    ck_assert_int_eq(live, 1);
+    cstl_deque_clear(&d);
+    ck_assert_int_eq(live, 0);
+}
+END_TEST
+
+START_TEST(large)
+{
+    struct big
+    {
+        char c[1000];
+    };
+
+    DECLARE_CSTL_DEQUE(d, struct big);
+    DECLARE_CSTL_DEQUE(e, struct big);
+    int i;
+
+    /* big elements still get multiple elements per block */
+    for (i = 0; i < 100; i++) {
+        ((struct big *)cstl_deque_push_back(&d))->c[999] = i;
+    }
+    cstl_deque_swap(&d, &e);
+    ck_assert_uint_eq(cstl_deque_size(&d), 0);
+    ck_assert_uint_eq(cstl_deque_size(&e), 100);
+    for (i = 0; i < 100; i++) {
+        ck_assert_int_eq(
+            ((const struct big *)cstl_deque_at_const(&e, i))->c[999], i);
+    }
+
+    cstl_deque_clear(&e);
+    cstl_deque_clear(&d);
+}
+END_TEST
+
+struct deque_limited_allocator
+{
+    struct ck_counting_allocator ca;
+    /* the number of further allocations that succeed */
+    unsigned int allow;
+};
+
+static void * deque_limited_alloc(const size_t sz, void * const priv)
+{
+    struct deque_limited_allocator * const la = priv;
+
+    if (la->allow == 0) {
+        return NULL;
+    }
+    la->allow--;
+
+    return ck_counting_alloc(sz, &la->ca);
+}
+
+static void deque_limited_free(void * const ptr, const size_t sz,
+                               void * const priv)
+{
+    struct deque_limited_allocator * const la = priv;
+    ck_counting_free(ptr, sz, &la->ca);
+}
+
+START_TEST(allocator)
+{
+    DECLARE_CSTL_DEQUE(d, int);
+    struct deque_limited_allocator la;
+    int i;
+
+    ck_counting_allocator_init(&la.ca);
+    la.ca.a.alloc = deque_limited_alloc;
+    la.ca.a.free = deque_limited_free;
+    la.ca.a.priv = &la;
+    la.allow = 0;
+    cstl_deque_set_allocator(&d, &la.ca.a);
+
+    /* no room for the map */
+    ck_assert_ptr_null(cstl_deque_push_back(&d));
+    /* room for the map, but not the block */
+    la.allow = 1;
+    ck_assert_ptr_null(cstl_deque_push_front(&d));
+    ck_assert_uint_eq(cstl_deque_size(&d), 0);
+
+    la.allow = 1;
+    ck_assert_ptr_nonnull(cstl_deque_push_back(&d));
+    ck_assert_signal(SIGABRT, cstl_deque_set_allocator(&d, NULL));
+
+    /* fill the map with blocks; the next one can't be added */
+    la.allow = 7;
+    for (i = 1; i < 8 * 1024; i++) {
+        ck_assert_ptr_nonnull(cstl_deque_push_back(&d));
+    }
+    ck_assert_ptr_null(cstl_deque_push_back(&d));
+    ck_assert_ptr_null(cstl_deque_push_front(&d));
+    ck_assert_uint_eq(cstl_deque_size(&d), 8 * 1024);
+
+    /* a block emptied at one end is held back and reused at the other */
+    for (i = 0; i < 1024; i++) {
+        cstl_deque_pop_front(&d);
+    }
+    ck_assert_ptr_nonnull(cstl_deque_push_back(&d));
+
+    /* and the map can grow */
+    la.allow = 2;
+    ck_assert_ptr_nonnull(cstl_deque_push_front(&d));
+    ck_assert_uint_eq(cstl_deque_size(&d), 7 * 1024 + 2);
+    for (i = 0; i < 7 * 1024 + 2; i++) {
+        *(int *)cstl_deque_at(&d, i) = i;
+    }
+    cstl_deque_pop_back(&d);
+    cstl_deque_pop_front(&d);
+    ck_assert_int_eq(*(int *)cstl_deque_front(&d), 1);
+    ck_assert_int_eq(*(int *)cstl_deque_back(&d), 7 * 1024);
+
+    cstl_deque_clear(&d);
+    ck_assert_uint_eq(la.ca.bytes, 0);
+
+    /* the allocator is retained after the clear */
+    la.allow = 2;
+    ck_assert_ptr_nonnull(cstl_deque_push_back(&d));
+    ck_assert_uint_gt(la.ca.bytes, 0);
+    cstl_deque_clear(&d);
+    ck_assert_uint_eq(la.ca.bytes, 0);
+}
+END_TEST
+
+Suite * deque_suite(void)
+{
+    Suite * const s = suite_create("deque");
+
+    TCase * tc;
+
+    tc = tcase_create("deque");
+    tcase_add_test(tc, fifo);
+    tcase_add_test(tc, ends);
+    tcase_add_test(tc, complex);
+    tcase_add_test(tc, large);
+    tcase_add_test(tc, allocator);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
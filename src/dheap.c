@@ -0,0 +1,355 @@
+/*!
+ * @file
+ */
+
+#include "cstl/dheap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+ * @private
+ *
+ * return a pointer to the object at the given position in the heap.
+ * the top of the heap is at position 0, and the children of the
+ * object at position i are at positions d * i + 1 through d * i + d
+ */
+static inline void * cstl_dheap_at(const cstl_dheap_t * const h,
+                                   const size_t i)
+{
+    return (void *)((uintptr_t)h->v.elem.base
+                    + (h->off + i) * h->v.elem.size);
+}
+
+/*! @private */
+static inline int cstl_dheap_cmp(const cstl_dheap_t * const h,
+                                 const void * const a, const void * const b)
+{
+    return h->cmp.f(a, b, h->cmp.p);
+}
+
+/*!
+ * @private
+ *
+ * choose the number of unused elements at the front of the vector
+ * so that the first group of children, at position 1, begins on a
+ * cache line boundary. if each group fills a whole number of lines,
+ * every other group is then aligned as well. the objects are moved
+ * if the offset changes, which can only happen when the vector
+ * has been reallocated.
+ */
+static void cstl_dheap_align(cstl_dheap_t * const h)
+{
+    const size_t sz = h->v.elem.size;
+    const uintptr_t base = (uintptr_t)h->v.elem.base;
+    size_t off = 0;
+
+    if ((h->d * sz) % CSTL_CACHE_LINE == 0) {
+        size_t k;
+
+        for (k = 0; k < h->d; k++) {
+            if ((base + (k + 1) * sz) % CSTL_CACHE_LINE == 0) {
+                off = k;
+                break;
+            }
+        }
+    }
+
+    if (off != h->off) {
+        const size_t n = cstl_dheap_size(h);
+
+        memmove((void *)(base + off * sz),
+                (void *)(base + h->off * sz),
+                n * sz);
+
+        h->off = off;
+        cstl_vector_resize(&h->v, off + n);
+    }
+}
+
+void cstl_dheap_init(cstl_dheap_t * const h, const size_t sz,
+                     const unsigned int d,
+                     cstl_compare_func_t * const cmp, void * const priv)
+{
+    if (d < 2) {
+        abort();
+    }
+
+    cstl_vector_init(&h->v, sz);
+    h->d = d;
+    h->off = 0;
+
+    h->cmp.f = cmp;
+    h->cmp.p = priv;
+}
+
+void cstl_dheap_reserve(cstl_dheap_t * const h, const size_t n)
+{
+    const void * const base = h->v.elem.base;
+
+    /* leave room for the largest possible offset */
+    cstl_vector_reserve(&h->v, n + h->d);
+    if (h->v.elem.base != base) {
+        cstl_dheap_align(h);
+    }
+}
+
+void cstl_dheap_push(cstl_dheap_t * const h, const void * const e)
+{
+    size_t i = cstl_dheap_size(h);
+
+    if (h->off + i + 1 > cstl_vector_capacity(&h->v)) {
+        cstl_dheap_reserve(h, i < 8 ? 16 : 2 * i);
+    }
+    /* aborts if the memory couldn't be allocated */
+    cstl_vector_resize(&h->v, h->off + i + 1);
+
+    /*
+     * the new object starts in the hole at the end. move each
+     * lesser parent down into the hole until the object's
+     * position is found, and only then copy it in
+     */
+    while (i > 0) {
+        const size_t p = (i - 1) / h->d;
+        void * const pe = cstl_dheap_at(h, p);
+
+        if (cstl_dheap_cmp(h, pe, e) >= 0) {
+            break;
+        }
+
+        memcpy(cstl_dheap_at(h, i), pe, h->v.elem.size);
+        i = p;
+    }
+
+    memcpy(cstl_dheap_at(h, i), e, h->v.elem.size);
+}
+
+const void * cstl_dheap_get(const cstl_dheap_t * const h)
+{
+    if (cstl_dheap_size(h) == 0) {
+        return NULL;
+    }
+
+    return cstl_dheap_at(h, 0);
+}
+
+bool cstl_dheap_pop(cstl_dheap_t * const h, void * const e)
+{
+    size_t n = cstl_dheap_size(h);
+
+    if (n == 0) {
+        return false;
+    }
+
+    if (e != NULL) {
+        memcpy(e, cstl_dheap_at(h, 0), h->v.elem.size);
+    }
+
+    if (--n > 0) {
+        /*
+         * the last object fills the hole left at the top. it stays
+         * where it is, just past the end of the shortened heap,
+         * while the greatest child at each level is moved up into
+         * the hole, until the object's position is found
+         */
+        const void * const x = cstl_dheap_at(h, n);
+        size_t i = 0, c;
+
+        while ((c = h->d * i + 1) < n) {
+            const size_t end = c + h->d < n ? c + h->d : n;
+            void * ce = cstl_dheap_at(h, c);
+            size_t j;
+
+            for (j = c + 1; j < end; j++) {
+                void * const je = cstl_dheap_at(h, j);
+
+                if (cstl_dheap_cmp(h, je, ce) > 0) {
+                    c = j;
+                    ce = je;
+                }
+            }
+
+            if (cstl_dheap_cmp(h, ce, x) <= 0) {
+                break;
+            }
+
+            memcpy(cstl_dheap_at(h, i), ce, h->v.elem.size);
+            i = c;
+        }
+
+        memcpy(cstl_dheap_at(h, i), x, h->v.elem.size);
+    }
+
+    cstl_vector_resize(&h->v, h->off + n);
+
+    return true;
+}
+
+void cstl_dheap_clear(cstl_dheap_t * const h)
+{
+    cstl_vector_clear(&h->v);
+    h->off = 0;
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+static int int_cmp(const void * const a, const void * const b,
+                   void * const nil)
+{
+    return *(const int *)a - *(const int *)b;
+
+    (void)nil;
+}
+
+struct dheap_wide
+{
+    int64_t key;
+    int64_t seq;
+};
+
+static int wide_cmp(const void * const _a, const void * const _b,
+                    void * const nil)
+{
+    const struct dheap_wide * const a = _a;
+    const struct dheap_wide * const b = _b;
+
+    return (a->key > b->key) - (a->key < b->key);
+
+    (void)nil;
+}
+
+/* check that every object is no greater than its parent */
+static void dheap_verify(const cstl_dheap_t * const h)
+{
+    const size_t n = cstl_dheap_size(h);
+    size_t i;
+
+    for (i = 1; i < n; i++) {
+        ck_assert_int_le(
+            cstl_dheap_cmp(h,
+                           cstl_dheap_at(h, i),
+                           cstl_dheap_at(h, (i - 1) / h->d)), 0);
+    }
+}
+
+START_TEST(init)
+{
+    cstl_dheap_t h;
+
+    ck_assert_signal(SIGABRT, cstl_dheap_init(&h, sizeof(int), 1,
+                                              int_cmp, NULL));
+
+    cstl_dheap_init(&h, sizeof(int), 2, int_cmp, NULL);
+    ck_assert_uint_eq(cstl_dheap_size(&h), 0);
+    ck_assert_ptr_null(cstl_dheap_get(&h));
+    ck_assert(!cstl_dheap_pop(&h, NULL));
+    cstl_dheap_clear(&h);
+}
+END_TEST
+
+START_TEST(fill)
+{
+    static const unsigned int n = 5000;
+    unsigned int d;
+
+    for (d = 2; d <= 8; d++) {
+        cstl_dheap_t h;
+        unsigned int i;
+        int prev, v;
+
+        cstl_dheap_init(&h, sizeof(int), d, int_cmp, NULL);
+        for (i = 0; i < n; i++) {
+            v = rand() % 1000;
+            cstl_dheap_push(&h, &v);
+            ck_assert_int_ge(*(const int *)cstl_dheap_get(&h), v);
+        }
+        ck_assert_uint_eq(cstl_dheap_size(&h), n);
+        dheap_verify(&h);
+
+        /* mix pops and pushes */
+        for (i = 0; i < n / 2; i++) {
+            ck_assert(cstl_dheap_pop(&h, NULL));
+            v = rand() % 1000;
+            cstl_dheap_push(&h, &v);
+        }
+        dheap_verify(&h);
+
+        prev = 1000;
+        for (i = 0; i < n; i++) {
+            ck_assert(cstl_dheap_pop(&h, &v));
+            ck_assert_int_le(v, prev);
+            prev = v;
+        }
+        ck_assert_uint_eq(cstl_dheap_size(&h), 0);
+        ck_assert(!cstl_dheap_pop(&h, &v));
+
+        cstl_dheap_clear(&h);
+    }
+}
+END_TEST
+
+START_TEST(aligned)
+{
+    static const unsigned int n = 3000;
+
+    struct ck_counting_allocator ca;
+    cstl_dheap_t h;
+    unsigned int i;
+    struct dheap_wide w;
+
+    ck_counting_allocator_init(&ca);
+
+    /* four 16-byte children fill a cache line */
+    cstl_dheap_init(&h, sizeof(w), 4, wide_cmp, NULL);
+    cstl_dheap_set_allocator(&h, &ca.a);
+    for (i = 0; i < n; i++) {
+        w.key = rand() % 100;
+        w.seq = i;
+        cstl_dheap_push(&h, &w);
+
+        ck_assert_uint_eq(
+            (uintptr_t)cstl_dheap_at(&h, 1) % CSTL_CACHE_LINE, 0);
+    }
+    dheap_verify(&h);
+
+    cstl_dheap_reserve(&h, 4 * n);
+    ck_assert_uint_eq((uintptr_t)cstl_dheap_at(&h, 1) % CSTL_CACHE_LINE, 0);
+    ck_assert_uint_eq(cstl_dheap_size(&h), n);
+    dheap_verify(&h);
+
+    for (i = 0; i < n; i++) {
+        const struct dheap_wide * const top = cstl_dheap_get(&h);
+        const int64_t key = top->key;
+
+        ck_assert(cstl_dheap_pop(&h, &w));
+        ck_assert_int_eq(w.key, key);
+        if (i % 100 == 0) {
+            dheap_verify(&h);
+        }
+    }
+
+    cstl_dheap_clear(&h);
+    ck_assert_uint_eq(ca.bytes, 0);
+}
+END_TEST
+
+Suite * dheap_suite(void)
+{
+    Suite * const s = suite_create("dheap");
+
+    TCase * tc;
+
+    tc = tcase_create("dheap");
+    tcase_add_test(tc, init);
+    tcase_add_test(tc, fill);
+    tcase_add_test(tc, aligned);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
@@ -240,12 +240,24 @@ int cstl_hash_foreach_const(const struct cstl_hash * const h,
     return __cstl_hash_foreach(h, cstl_hash_foreach_visit, &hfvp);
 }
 
+void cstl_hash_set_allocator(struct cstl_hash * const h,
+                             const cstl_allocator_t * const a)
+{
+    if (h->bucket.at != NULL) {
+        abort();
+    }
+
+    h->allocator = a;
+}
+
 /*! @private */
 static void __cstl_hash_set_capacity(
     struct cstl_hash * const h, const size_t sz)
 {
     struct cstl_hash_bucket * const at =
-        realloc(h->bucket.at, sizeof(*at) * sz);
+        cstl_allocator_realloc(h->allocator, h->bucket.at,
+                               sizeof(*at) * h->bucket.capacity,
+                               sizeof(*at) * sz);
     if (at != NULL) {
         h->bucket.at = at;
         h->bucket.capacity = sz;
@@ -482,7 +494,8 @@ void cstl_hash_clear(struct cstl_hash * const h, cstl_xtor_func_t * const clr)
         __cstl_hash_foreach(h, cstl_hash_clear_visit, &hcp);
     }
 
-    free(h->bucket.at);
+    cstl_allocator_free(h->allocator, h->bucket.at,
+                        sizeof(*h->bucket.at) * h->bucket.capacity);
     h->bucket.at = NULL;
 
     h->bucket.count = 0;
@@ -672,6 +685,33 @@ START_TEST(resize)
     cstl_hash_clear(&h, __test_cstl_hash_free);
 }
 
+START_TEST(allocator)
+{
+    DECLARE_CSTL_HASH(h, struct integer, n);
+    struct ck_counting_allocator ca;
+
+    ck_counting_allocator_init(&ca);
+    cstl_hash_set_allocator(&h, &ca.a);
+
+    cstl_hash_resize(&h, 8, NULL);
+    __test__cstl_hash_fill(&h, 20);
+    ck_assert_uint_eq(ca.bytes, 8 * sizeof(*h.bucket.at));
+
+    cstl_hash_resize(&h, 32, NULL);
+    ck_assert_uint_eq(ca.bytes, 32 * sizeof(*h.bucket.at));
+
+    ck_assert_signal(SIGABRT, cstl_hash_set_allocator(&h, NULL));
+
+    cstl_hash_resize(&h, 16, NULL);
+    cstl_hash_shrink_to_fit(&h);
+    ck_assert_uint_eq(ca.bytes, 16 * sizeof(*h.bucket.at));
+
+    cstl_hash_clear(&h, __test_cstl_hash_free);
+    ck_assert_uint_eq(ca.bytes, 0);
+    ck_assert_uint_eq(ca.calls, 4);
+}
+END_TEST
+
 Suite * hash_suite(void)
 {
     Suite * const s = suite_create("hash");
@@ -683,6 +723,7 @@ Suite * hash_suite(void)
     tcase_add_test(tc, manual_clear);
     tcase_add_test(tc, bad_hash);
     tcase_add_test(tc, resize);
+    tcase_add_test(tc, allocator);
     suite_add_tcase(s, tc);
 
     return s;
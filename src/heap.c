@@ -57,7 +57,8 @@ static struct cstl_bintree_node * cstl_heap_find(
 static void cstl_heap_promote_child(struct cstl_heap * const h,
                                     struct cstl_bintree_node * const c)
 {
-    struct cstl_bintree_node * const p = c->p;
+    struct cstl_bintree_node * const p = __cstl_bintree_parent(c);
+    struct cstl_bintree_node * const g = __cstl_bintree_parent(p);
     struct cstl_bintree_node * t;
 
     assert(p != NULL);
@@ -65,36 +66,36 @@ static void cstl_heap_promote_child(struct cstl_heap * const h,
     /*
      * point p's parent to c as one of its children
      */
-    if (p->p == NULL) {
+    if (g == NULL) {
         h->bt.root = c;
-    } else if (p->p->l == p) {
-        p->p->l = c;
+    } else if (g->l == p) {
+        g->l = c;
     } else {
-        p->p->r = c;
+        g->r = c;
     }
 
     /* point c's children to p as their parent */
     if (c->l != NULL) {
-        c->l->p = p;
+        __cstl_bintree_set_parent(c->l, p);
     }
     if (c->r != NULL) {
-        c->r->p = p;
+        __cstl_bintree_set_parent(c->r, p);
     }
 
     /* point p's children to c as their parent */
     if (p->r != NULL) {
-        p->r->p = c;
+        __cstl_bintree_set_parent(p->r, c);
     }
     if (p->l != NULL) {
-        p->l->p = c;
+        __cstl_bintree_set_parent(p->l, c);
     }
 
     /*
      * p's old parent is c's new parent,
      * and c is p's new parent
      */
-    c->p = p->p;
-    p->p = c;
+    __cstl_bintree_set_parent(c, g);
+    __cstl_bintree_set_parent(p, c);
 
     /*
      * finally, fix the children of each node.
@@ -119,6 +120,62 @@ static void cstl_heap_promote_child(struct cstl_heap * const h,
     }
 }
 
+/*!
+ * @private
+ *
+ * while n is greater than its parent, swap parent and child
+ */
+static void cstl_heap_sift_up(struct cstl_heap * const h,
+                              struct cstl_bintree_node * const n)
+{
+    while (__cstl_bintree_parent(n) != NULL
+           && __cstl_bintree_cmp(
+               &h->bt, n, __cstl_bintree_parent(n)) > 0) {
+        cstl_heap_promote_child(h, n);
+    }
+}
+
+/*!
+ * @private
+ *
+ * while either of n's children is greater than n,
+ * swap n with the greater of the two children.
+ */
+static void cstl_heap_sift_down(struct cstl_heap * const h,
+                                struct cstl_bintree_node * const n)
+{
+    struct cstl_bintree_node * c = NULL;
+
+    do {
+        if (c != NULL) {
+            cstl_heap_promote_child(h, c);
+        }
+
+        c = n;
+        if (n->l != NULL
+            && __cstl_bintree_cmp(&h->bt, n->l, c) > 0) {
+            c = n->l;
+        }
+        if (n->r != NULL
+            && __cstl_bintree_cmp(&h->bt, n->r, c) > 0) {
+            c = n->r;
+        }
+    } while (n != c);
+}
+
+/*! @private */
+static void __cstl_heap_update(struct cstl_heap * const h,
+                               struct cstl_bintree_node * const n)
+{
+    const struct cstl_bintree_node * const p = __cstl_bintree_parent(n);
+
+    if (p != NULL && __cstl_bintree_cmp(&h->bt, n, p) > 0) {
+        cstl_heap_sift_up(h, n);
+    } else {
+        cstl_heap_sift_down(h, n);
+    }
+}
+
 void cstl_heap_push(struct cstl_heap * const h, void * const p)
 {
     struct cstl_bintree_node * const n = (void *)((uintptr_t)p + h->bt.off);
@@ -127,7 +184,7 @@ void cstl_heap_push(struct cstl_heap * const h, void * const p)
     n->r = NULL;
 
     if (h->bt.root == NULL) {
-        n->p = NULL;
+        n->p = (uintptr_t)NULL;
         h->bt.root = n;
     } else {
         /*
@@ -137,29 +194,109 @@ void cstl_heap_push(struct cstl_heap * const h, void * const p)
          */
 
         /* find the parent of the next open spot */
-        n->p = cstl_heap_find(h, (h->bt.size - 1) / 2);
+        struct cstl_bintree_node * const p =
+            cstl_heap_find(h, (h->bt.size - 1) / 2);
+
+        n->p = (uintptr_t)p;
 
         /*
          * left children have have odd numbers;
          * right children have even numbers
          */
         if (h->bt.size % 2 == 0) {
-            n->p->r = n;
+            p->r = n;
+        } else {
+            p->l = n;
+        }
+
+        cstl_heap_sift_up(h, n);
+    }
+
+    h->bt.size++;
+}
+
+/*!
+ * @private
+ *
+ * Floyd's construction: make each of n's subtrees a heap, and then
+ * move n down into place. n's children change as its subtrees are
+ * rearranged, so they're read only as each is needed
+ */
+static void cstl_heap_heapify(struct cstl_heap * const h,
+                              struct cstl_bintree_node * const n)
+{
+    if (n->l != NULL) {
+        cstl_heap_heapify(h, n->l);
+    }
+    if (n->r != NULL) {
+        cstl_heap_heapify(h, n->r);
+    }
+
+    cstl_heap_sift_down(h, n);
+}
+
+void cstl_heap_push_many(struct cstl_heap * const h,
+                         void * const * const e, const size_t n)
+{
+    const size_t sz = h->bt.size;
+    struct cstl_bintree_node * p = NULL;
+    size_t i;
+
+    /*
+     * link all of the new nodes into the open spots at the bottom
+     * of the tree without regard to their values. the parent of the
+     * node with id k is (k - 1) / 2; if that's one of the new nodes,
+     * it can be found in the array. otherwise, it must be searched
+     * for, but each parent is searched for only once
+     */
+    for (i = 0; i < n; i++) {
+        struct cstl_bintree_node * const c =
+            (void *)((uintptr_t)e[i] + h->bt.off);
+        const size_t k = sz + i;
+
+        c->l = NULL;
+        c->r = NULL;
+
+        if (k == 0) {
+            c->p = (uintptr_t)NULL;
+            h->bt.root = c;
+            continue;
+        }
+
+        if ((k - 1) / 2 >= sz) {
+            p = (void *)((uintptr_t)e[(k - 1) / 2 - sz] + h->bt.off);
+        } else if (k % 2 == 1 || p == NULL) {
+            p = cstl_heap_find(h, (k - 1) / 2);
+        }
+
+        c->p = (uintptr_t)p;
+        if (k % 2 == 0) {
+            p->r = c;
         } else {
-            n->p->l = n;
+            p->l = c;
         }
+    }
 
+    h->bt.size += n;
+
+    if (n >= sz) {
         /*
-         * while n is greater than its parent,
-         * swap parent and child
+         * the new nodes make up at least half of the tree,
+         * so rebuild the whole heap, in linear time
          */
-        while (n->p != NULL
-               && __cstl_bintree_cmp(&h->bt, n, n->p) > 0) {
-            cstl_heap_promote_child(h, n);
+        if (h->bt.root != NULL) {
+            cstl_heap_heapify(h, h->bt.root);
+        }
+    } else {
+        /*
+         * move each new node up into place, as if it had been
+         * pushed individually. the nodes at the bottom of the
+         * tree below it are carried along, untouched
+         */
+        for (i = 0; i < n; i++) {
+            cstl_heap_sift_up(h, (void *)((uintptr_t)e[i] + h->bt.off));
         }
     }
-
-    h->bt.size++;
 }
 
 const void * cstl_heap_get(const struct cstl_heap * const h)
@@ -171,71 +308,71 @@ const void * cstl_heap_get(const struct cstl_heap * const h)
     return NULL;
 }
 
-void * cstl_heap_pop(struct cstl_heap * const h)
+void cstl_heap_update(struct cstl_heap * const h, void * const e)
 {
-    void * const res = (void *)cstl_heap_get(h);
+    __cstl_heap_update(h, (void *)((uintptr_t)e + h->bt.off));
+}
 
-    if (res != NULL) {
-        struct cstl_bintree_node * n;
+void cstl_heap_erase(struct cstl_heap * const h, void * const e)
+{
+    struct cstl_bintree_node * const n = (void *)((uintptr_t)e + h->bt.off);
+    struct cstl_bintree_node * l, * p;
 
-        /*
-         * find the last node in the heap. because it's
-         * at the bottom, it will have no children
-         */
-        n = cstl_heap_find(h, h->bt.size - 1);
-        assert(n->l == NULL && n->r == NULL);
+    /*
+     * find the last node in the heap. because it's
+     * at the bottom, it will have no children
+     */
+    l = cstl_heap_find(h, h->bt.size - 1);
+    assert(l->l == NULL && l->r == NULL);
+
+    /*
+     * unlink l from its parent, which reduces
+     * the size of the heap by one
+     */
+    p = __cstl_bintree_parent(l);
+    if (p == NULL) {
+        h->bt.root = NULL;
+    } else if (p->l == l) {
+        p->l = NULL;
+    } else {
+        p->r = NULL;
+    }
+
+    h->bt.size--;
 
+    if (l != n) {
         /*
-         * unlink n from its parent, which reduces
-         * the size of the heap by one
+         * if l was not the node being removed, then
+         * l takes the removed node's place in the tree
+         * and is then moved up or down into position
          */
-        if (n->p == NULL) {
-            h->bt.root = NULL;
-        } else if (n->p->l == n) {
-            n->p->l = NULL;
+        p = __cstl_bintree_parent(n);
+        if (p == NULL) {
+            h->bt.root = l;
+        } else if (p->l == n) {
+            p->l = l;
         } else {
-            n->p->r = NULL;
+            p->r = l;
         }
 
-        h->bt.size--;
-
-        if (h->bt.root != NULL) {
-            struct cstl_bintree_node * c;
-
-            /*
-             * if n was not the root node, then
-             * replace the root node with n
-             */
-            *n = *h->bt.root;
-            if (n->l != NULL) {
-                n->l->p = n;
-            }
-            if (n->r != NULL) {
-                n->r->p = n;
-            }
-            h->bt.root = n;
-
-            /*
-             * while either of n's children is greater than n,
-             * swap n with the greater of the two children.
-             */
-            c = NULL;
-            do {
-                if (c != NULL) {
-                    cstl_heap_promote_child(h, c);
-                }
-
-                c = n;
-                if (n->l != NULL
-                    && __cstl_bintree_cmp(&h->bt, n->l, c) > 0) {
-                    c = n->l;
-                }
-                if (n->r != NULL
-                    && __cstl_bintree_cmp(&h->bt, n->r, c) > 0) {
-                    c = n->r;
-                }
-            } while (n != c);
+        *l = *n;
+        if (l->l != NULL) {
+            __cstl_bintree_set_parent(l->l, l);
+        }
+        if (l->r != NULL) {
+            __cstl_bintree_set_parent(l->r, l);
         }
+
+        __cstl_heap_update(h, l);
+    }
+}
+
+void * cstl_heap_pop(struct cstl_heap * const h)
+{
+    void * const res = (void *)cstl_heap_get(h);
+
+    if (res != NULL) {
+        cstl_heap_erase(h, res);
     }
 
     return res;
@@ -354,6 +491,156 @@ START_TEST(fill)
 }
 END_TEST
 
+START_TEST(update)
+{
+    static const size_t n = 100;
+
+    DECLARE_CSTL_HEAP(h, struct integer, hn, cmp_integer, NULL);
+    struct integer in[100];
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        in[i].v = rand() % n;
+        cstl_heap_push(&h, &in[i]);
+    }
+
+    for (i = 0; i < 4 * n; i++) {
+        struct integer * e = &in[rand() % n];
+
+        /* raise or lower the priority of a random element */
+        e->v += rand() % n - n / 2;
+        cstl_heap_update(&h, e);
+        cstl_heap_verify(&h);
+
+        /* and of the top element */
+        e = (struct integer *)cstl_heap_get(&h);
+        e->v -= rand() % n;
+        cstl_heap_update(&h, e);
+        cstl_heap_verify(&h);
+    }
+
+    ck_assert_uint_eq(cstl_heap_size(&h), n);
+    while (cstl_heap_pop(&h) != NULL) {
+        cstl_heap_verify(&h);
+    }
+}
+END_TEST
+
+START_TEST(erase)
+{
+    static const size_t n = 100;
+
+    DECLARE_CSTL_HEAP(h, struct integer, hn, cmp_integer, NULL);
+    struct integer in[100];
+    bool present[100];
+    unsigned int i;
+    int prev;
+
+    for (i = 0; i < n; i++) {
+        in[i].v = rand() % n;
+        cstl_heap_push(&h, &in[i]);
+        present[i] = true;
+    }
+
+    /* remove half of the elements in a random order */
+    for (i = 0; i < n / 2; i++) {
+        unsigned int j;
+
+        do {
+            j = rand() % n;
+        } while (!present[j]);
+
+        cstl_heap_erase(&h, &in[j]);
+        present[j] = false;
+
+        ck_assert_uint_eq(cstl_heap_size(&h), n - i - 1);
+        cstl_heap_verify(&h);
+    }
+
+    /* the remaining elements come out in order */
+    prev = INT_MAX;
+    for (i = 0; i < n / 2; i++) {
+        struct integer * const e = cstl_heap_pop(&h);
+
+        ck_assert(present[e - in]);
+        present[e - in] = false;
+        ck_assert_int_le(e->v, prev);
+        prev = e->v;
+    }
+    ck_assert_ptr_null(cstl_heap_pop(&h));
+
+    /* erasing the only element leaves the heap empty */
+    cstl_heap_push(&h, &in[0]);
+    cstl_heap_erase(&h, &in[0]);
+    ck_assert_ptr_null(cstl_heap_get(&h));
+    ck_assert_uint_eq(cstl_heap_size(&h), 0);
+}
+END_TEST
+
+START_TEST(push_many)
+{
+    static const size_t n = 1000;
+
+    struct integer * const in = malloc(n * sizeof(*in));
+    void ** const e = malloc(n * sizeof(*e));
+    unsigned int i, j;
+
+    for (i = 0; i < n; i++) {
+        e[i] = &in[i];
+    }
+
+    /* bulk construction of heaps of various sizes */
+    for (i = 0; i < 70; i++) {
+        DECLARE_CSTL_HEAP(h, struct integer, hn, cmp_integer, NULL);
+        int prev;
+
+        for (j = 0; j < i; j++) {
+            in[j].v = rand() % n;
+        }
+
+        cstl_heap_push_many(&h, e, i);
+        ck_assert_uint_eq(cstl_heap_size(&h), i);
+        cstl_heap_verify(&h);
+
+        prev = INT_MAX;
+        for (j = 0; j < i; j++) {
+            const struct integer * const x = cstl_heap_pop(&h);
+
+            ck_assert_int_le(x->v, prev);
+            prev = x->v;
+        }
+        ck_assert_ptr_null(cstl_heap_pop(&h));
+    }
+
+    /*
+     * batches added to a heap that's already populated,
+     * both smaller and larger than the heap
+     */
+    for (i = 1; i < 40; i++) {
+        DECLARE_CSTL_HEAP(h, struct integer, hn, cmp_integer, NULL);
+        const size_t b = i < 20 ? i : 10 * i;
+        size_t k;
+
+        for (j = 0; j < n; j++) {
+            in[j].v = rand() % n;
+        }
+
+        for (k = 0; k + b <= n; k += b) {
+            cstl_heap_push_many(&h, e + k, b);
+            ck_assert_uint_eq(cstl_heap_size(&h), k + b);
+            cstl_heap_verify(&h);
+        }
+
+        while (cstl_heap_pop(&h) != NULL) {
+            cstl_heap_verify(&h);
+        }
+    }
+
+    free(e);
+    free(in);
+}
+END_TEST
+
 Suite * heap_suite(void)
 {
     Suite * const s = suite_create("heap");
@@ -362,6 +649,9 @@ Suite * heap_suite(void)
 
     tc = tcase_create("heap");
     tcase_add_test(tc, fill);
+    tcase_add_test(tc, update);
+    tcase_add_test(tc, erase);
+    tcase_add_test(tc, push_many);
     suite_add_tcase(s, tc);
 
     return s;
@@ -5,19 +5,51 @@
 #include "cstl/map.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 struct cstl_map_node
 {
     const void * key;
     void * val;
 
+    /*
+     * in a ranked map, this is the first member of a
+     * cstl_rbtree_ranked_node, the rest of which follows
+     * the structure. any copy of the key comes after that
+     */
     struct cstl_rbtree_node n;
 };
 
+/*
+ * minimum degree of the B-tree. every node other than the root
+ * holds between CSTL_MAP_BTREE_T - 1 and CSTL_MAP_BTREE_MAX keys.
+ * internal nodes have one more child than they have keys.
+ */
+#define CSTL_MAP_BTREE_T        16
+#define CSTL_MAP_BTREE_MAX      (2 * CSTL_MAP_BTREE_T - 1)
+
+struct cstl_map_bnode
+{
+    struct cstl_map_bnode * p;
+    unsigned int n;
+    bool leaf;
+
+    /*
+     * keys and values are kept in separate arrays so that
+     * the keys examined during a search are contiguous
+     */
+    const void * key[CSTL_MAP_BTREE_MAX];
+    void * val[CSTL_MAP_BTREE_MAX];
+
+    /* only allocated for internal nodes */
+    struct cstl_map_bnode * c[];
+};
+
 const cstl_map_iterator_t * cstl_map_iterator_end(const cstl_map_t * const m)
 {
     static const cstl_map_iterator_t end = {
         ._ = NULL,
+        ._i = 0,
 
         .key = NULL,
         .val = NULL,
@@ -37,28 +69,147 @@ static void cstl_map_iterator_init(const cstl_map_t * const m,
         i->val = node->val;
 
         i->_ = node;
+        i->_i = 0;
+    } else {
+        *i = *cstl_map_iterator_end(m);
+    }
+}
+
+/*! @private */
+static void cstl_map_biterator_init(const cstl_map_t * const m,
+                                    cstl_map_iterator_t * const i,
+                                    struct cstl_map_bnode * const node,
+                                    const unsigned int idx)
+{
+    if (node != NULL) {
+        i->key = node->key[idx];
+        i->val = node->val[idx];
+
+        i->_ = node;
+        i->_i = idx;
     } else {
         *i = *cstl_map_iterator_end(m);
     }
 }
 
+/*!
+ * @private
+ *
+ * the offset of the copy of the key within a node
+ */
+static size_t cstl_map_node_key_off(const bool ranked)
+{
+    return offsetof(struct cstl_map_node, n)
+        + (ranked
+           ? sizeof(struct cstl_rbtree_ranked_node)
+           : sizeof(struct cstl_rbtree_node));
+}
+
+/*!
+ * @private
+ *
+ * the size of a node, including the space for
+ * a copy of the key if keys are stored inline
+ */
+static size_t cstl_map_node_size(const size_t ksize, const bool ranked)
+{
+    return cstl_map_node_key_off(ranked) + ksize;
+}
 
 /*! @private */
 static struct cstl_map_node * cstl_map_node_alloc(
-    const void * const key, void * const val)
+    cstl_map_t * const map, const void * const key, void * const val)
 {
-    struct cstl_map_node * const n = malloc(sizeof(*n));
+    struct cstl_map_node * n;
+
+    if (map->pool != NULL) {
+        n = cstl_pool_alloc(map->pool);
+    } else {
+        n = cstl_allocator_alloc(
+            map->allocator, cstl_map_node_size(map->key.size, map->t.ranked));
+    }
+
     if (n) {
-        n->key = key;
+        if (map->key.size != 0) {
+            /* the copy of the key follows the tree node */
+            n->key = memcpy(
+                (void *)((uintptr_t)n + cstl_map_node_key_off(map->t.ranked)),
+                key, map->key.size);
+        } else {
+            n->key = key;
+        }
         n->val = val;
     }
     return n;
 }
 
 /*! @private */
-static void cstl_map_node_free(void * const n)
+static void cstl_map_node_free(cstl_map_t * const map, void * const n)
+{
+    if (map->pool != NULL) {
+        cstl_pool_free(map->pool, n);
+    } else {
+        cstl_allocator_free(
+            map->allocator,
+            n, cstl_map_node_size(map->key.size, map->t.ranked));
+    }
+}
+
+/*!
+ * @private
+ *
+ * compare two integers of the given type, stored at
+ * possibly unaligned addresses, and return the result
+ */
+#define CSTL_MAP_KEY_CMP_AS(TYPE, A, B)                 \
+    do {                                                \
+        TYPE _a, _b;                                    \
+        memcpy(&_a, A, sizeof(_a));                     \
+        memcpy(&_b, B, sizeof(_b));                     \
+        return (_a > _b) - (_a < _b);                   \
+    } while (0)
+
+/*!
+ * @private
+ *
+ * the kind and size are passed separately from the map so
+ * that, when they're constants, the compiler can reduce the
+ * function to the single comparison that applies
+ */
+static inline int __cstl_map_key_cmp(const cstl_map_t * const map,
+                                     const cstl_map_key_kind_t kind,
+                                     const size_t size,
+                                     const void * const a,
+                                     const void * const b)
+{
+    switch (kind) {
+    case CSTL_MAP_KEY_INT:
+        switch (size) {
+        case 1:  CSTL_MAP_KEY_CMP_AS(int8_t, a, b);
+        case 2:  CSTL_MAP_KEY_CMP_AS(int16_t, a, b);
+        case 4:  CSTL_MAP_KEY_CMP_AS(int32_t, a, b);
+        default: CSTL_MAP_KEY_CMP_AS(int64_t, a, b);
+        }
+    case CSTL_MAP_KEY_UINT:
+        switch (size) {
+        case 1:  CSTL_MAP_KEY_CMP_AS(uint8_t, a, b);
+        case 2:  CSTL_MAP_KEY_CMP_AS(uint16_t, a, b);
+        case 4:  CSTL_MAP_KEY_CMP_AS(uint32_t, a, b);
+        default: CSTL_MAP_KEY_CMP_AS(uint64_t, a, b);
+        }
+    case CSTL_MAP_KEY_MEMCMP:
+        return memcmp(a, b, size);
+    case CSTL_MAP_KEY_CMP:
+    default:
+        return map->cmp.f(a, b, map->cmp.p);
+    }
+}
+
+/*! @private */
+static int cstl_map_key_cmp(const cstl_map_t * const map,
+                            const void * const a, const void * const b)
 {
-    free(n);
+    return __cstl_map_key_cmp(map, map->key.kind, map->key.size, a, b);
 }
 
 /*! @private */
@@ -70,7 +221,645 @@ static int cstl_map_node_cmp(const void * const _a, const void * const _b,
     const struct cstl_map_node * const a = _a;
     const struct cstl_map_node * const b = _b;
 
-    return m->cmp.f(a->key, b->key, m->cmp.p);
+    return cstl_map_key_cmp(m, a->key, b->key);
+}
+
+/*! @private */
+static size_t cstl_map_bnode_size(const bool leaf)
+{
+    size_t sz = sizeof(struct cstl_map_bnode);
+    if (!leaf) {
+        sz += (CSTL_MAP_BTREE_MAX + 1) * sizeof(struct cstl_map_bnode *);
+    }
+    return sz;
+}
+
+/*! @private */
+static struct cstl_map_bnode * cstl_map_bnode_alloc(
+    cstl_map_t * const map, const bool leaf)
+{
+    struct cstl_map_bnode * const n =
+        cstl_allocator_alloc(map->allocator, cstl_map_bnode_size(leaf));
+
+    if (n != NULL) {
+        n->p = NULL;
+        n->n = 0;
+        n->leaf = leaf;
+    }
+
+    return n;
+}
+
+/*! @private */
+static void cstl_map_bnode_free(cstl_map_t * const map,
+                                struct cstl_map_bnode * const n)
+{
+    cstl_allocator_free(map->allocator, n, cstl_map_bnode_size(n->leaf));
+}
+
+/*!
+ * @private
+ *
+ * binary search within a single node. the function returns the
+ * index of the first key in the node that is not less than the
+ * sought key and indicates whether that key is equal to it. for
+ * an internal node, the index is also that of the child in which
+ * to continue the search if the key was not found.
+ *
+ * the search doesn't stop early when it comes across an equal key.
+ * instead, each step moves the bottom of the range by an amount
+ * that depends on the comparison, which the compiler can do without
+ * a branch, and a single comparison at the end tells whether the
+ * key was found. an early exit saves less than one comparison on
+ * average but costs a mispredicted branch at almost every step.
+ *
+ * all of the lines holding the keys are requested up front so
+ * that they arrive from memory together rather than one per step
+ */
+static unsigned int cstl_map_bnode_search(
+    const cstl_map_t * const map, const struct cstl_map_bnode * const n,
+    const void * const key, bool * const found)
+{
+    unsigned int lo = 0, len = n->n;
+    int c;
+
+#ifdef __GNUC__
+    size_t off;
+
+    for (off = 0; off < sizeof(n->key); off += CSTL_CACHE_LINE) {
+        __builtin_prefetch((const char *)n->key + off);
+    }
+#endif
+
+    if (len == 0) {
+        *found = false;
+        return 0;
+    }
+
+    /* the index to be returned is in [lo, lo + len] */
+    while (len > 1) {
+        const unsigned int h = len / 2;
+
+        c = map->cmp.f(key, n->key[lo + h - 1], map->cmp.p);
+        lo += (c > 0) ? h : 0;
+        len -= h;
+    }
+
+    c = map->cmp.f(key, n->key[lo], map->cmp.p);
+    *found = (c == 0);
+    return lo + (c > 0);
+}
+
+/*!
+ * @private
+ *
+ * move @cnt key/value pairs from position @si in @sn to
+ * position @di in @dn. the source and destination may overlap
+ */
+static void cstl_map_bnode_move(struct cstl_map_bnode * const dn,
+                                const unsigned int di,
+                                const struct cstl_map_bnode * const sn,
+                                const unsigned int si,
+                                const unsigned int cnt)
+{
+    memmove(&dn->key[di], &sn->key[si], cnt * sizeof(*dn->key));
+    memmove(&dn->val[di], &sn->val[si], cnt * sizeof(*dn->val));
+}
+
+/*!
+ * @private
+ *
+ * move @cnt children from position @si in @sn to position
+ * @di in @dn, updating the parent pointers of the children
+ * if they are moving to a different node
+ */
+static void cstl_map_bnode_move_children(struct cstl_map_bnode * const dn,
+                                         const unsigned int di,
+                                         struct cstl_map_bnode * const sn,
+                                         const unsigned int si,
+                                         const unsigned int cnt)
+{
+    memmove(&dn->c[di], &sn->c[si], cnt * sizeof(*dn->c));
+    if (dn != sn) {
+        unsigned int j;
+
+        for (j = 0; j < cnt; j++) {
+            dn->c[di + j]->p = dn;
+        }
+    }
+}
+
+/*!
+ * @private
+ *
+ * split the full child at position @i within @x. the upper
+ * half of the child's keys move to a new node that becomes
+ * the child at @i + 1, and the median key moves up into @x
+ * which must not itself be full.
+ */
+static int cstl_map_bnode_split(cstl_map_t * const map,
+                                struct cstl_map_bnode * const x,
+                                const unsigned int i)
+{
+    struct cstl_map_bnode * const y = x->c[i];
+    struct cstl_map_bnode * const z = cstl_map_bnode_alloc(map, y->leaf);
+
+    if (z == NULL) {
+        return -1;
+    }
+
+    z->p = x;
+    z->n = CSTL_MAP_BTREE_T - 1;
+    cstl_map_bnode_move(z, 0, y, CSTL_MAP_BTREE_T, z->n);
+    if (!y->leaf) {
+        cstl_map_bnode_move_children(z, 0, y, CSTL_MAP_BTREE_T, z->n + 1);
+    }
+    y->n = CSTL_MAP_BTREE_T - 1;
+
+    cstl_map_bnode_move_children(x, i + 2, x, i + 1, x->n - i);
+    x->c[i + 1] = z;
+    cstl_map_bnode_move(x, i + 1, x, i, x->n - i);
+    x->key[i] = y->key[y->n];
+    x->val[i] = y->val[y->n];
+    x->n++;
+
+    return 0;
+}
+
+/*!
+ * @private
+ *
+ * merge the child at @i within @x, the key at @i, and the child
+ * at @i + 1 into a single node. if @x is the root and is left
+ * with no keys, the merged node becomes the new root. in either
+ * case, the merged node is returned.
+ */
+static struct cstl_map_bnode * cstl_map_bnode_merge(
+    cstl_map_t * const map,
+    struct cstl_map_bnode * const x, const unsigned int i)
+{
+    struct cstl_map_bnode * const y = x->c[i];
+    struct cstl_map_bnode * const z = x->c[i + 1];
+
+    y->key[y->n] = x->key[i];
+    y->val[y->n] = x->val[i];
+    cstl_map_bnode_move(y, y->n + 1, z, 0, z->n);
+    if (!y->leaf) {
+        cstl_map_bnode_move_children(y, y->n + 1, z, 0, z->n + 1);
+    }
+    y->n += z->n + 1;
+    cstl_map_bnode_free(map, z);
+
+    cstl_map_bnode_move(x, i, x, i + 1, x->n - i - 1);
+    cstl_map_bnode_move_children(x, i + 1, x, i + 2, x->n - i - 1);
+    x->n--;
+
+    if (x->n == 0) {
+        /* only the root is allowed to drop below the minimum */
+        map->b.root = y;
+        y->p = NULL;
+        cstl_map_bnode_free(map, x);
+    }
+
+    return y;
+}
+
+/*!
+ * @private
+ *
+ * ensure that the child at @i within @x has more than the minimum
+ * number of keys so that a key can be removed from its subtree. a
+ * key is borrowed from a sibling via @x if possible; otherwise, the
+ * child is merged with a sibling. the function returns the node
+ * that now holds the keys that were previously in the child.
+ */
+static struct cstl_map_bnode * cstl_map_bnode_fill(
+    cstl_map_t * const map,
+    struct cstl_map_bnode * const x, const unsigned int i)
+{
+    struct cstl_map_bnode * const y = x->c[i];
+
+    if (i > 0 && x->c[i - 1]->n >= CSTL_MAP_BTREE_T) {
+        struct cstl_map_bnode * const l = x->c[i - 1];
+
+        /* rotate the last key from the left sibling through @x */
+        cstl_map_bnode_move(y, 1, y, 0, y->n);
+        if (!y->leaf) {
+            cstl_map_bnode_move_children(y, 1, y, 0, y->n + 1);
+            y->c[0] = l->c[l->n];
+            y->c[0]->p = y;
+        }
+        y->key[0] = x->key[i - 1];
+        y->val[0] = x->val[i - 1];
+        y->n++;
+
+        l->n--;
+        x->key[i - 1] = l->key[l->n];
+        x->val[i - 1] = l->val[l->n];
+    } else if (i < x->n && x->c[i + 1]->n >= CSTL_MAP_BTREE_T) {
+        struct cstl_map_bnode * const r = x->c[i + 1];
+
+        /* rotate the first key from the right sibling through @x */
+        y->key[y->n] = x->key[i];
+        y->val[y->n] = x->val[i];
+        if (!y->leaf) {
+            y->c[y->n + 1] = r->c[0];
+            y->c[y->n + 1]->p = y;
+            cstl_map_bnode_move_children(r, 0, r, 1, r->n);
+        }
+        y->n++;
+
+        x->key[i] = r->key[0];
+        x->val[i] = r->val[0];
+        cstl_map_bnode_move(r, 0, r, 1, r->n - 1);
+        r->n--;
+    } else if (i < x->n) {
+        return cstl_map_bnode_merge(map, x, i);
+    } else {
+        return cstl_map_bnode_merge(map, x, i - 1);
+    }
+
+    return y;
+}
+
+/*! @private */
+static struct cstl_map_bnode * cstl_map_bnode_first(
+    struct cstl_map_bnode * n)
+{
+    while (!n->leaf) {
+        n = n->c[0];
+    }
+    return n;
+}
+
+/*!
+ * @private
+ *
+ * advance the node/index pair to the next key in order.
+ * the function returns false if there is no next key
+ */
+static bool cstl_map_bnode_next(struct cstl_map_bnode ** const _n,
+                                unsigned int * const _i)
+{
+    struct cstl_map_bnode * n = *_n;
+    unsigned int i = *_i;
+
+    if (!n->leaf) {
+        n = cstl_map_bnode_first(n->c[i + 1]);
+        i = 0;
+    } else if (i + 1 < n->n) {
+        i++;
+    } else {
+        /*
+         * climb until arriving at a parent from
+         * a child that is not its last child
+         */
+        do {
+            struct cstl_map_bnode * const p = n->p;
+
+            if (p == NULL) {
+                return false;
+            }
+
+            for (i = 0; p->c[i] != n; i++)
+                ;
+            n = p;
+        } while (i == n->n);
+    }
+
+    *_n = n;
+    *_i = i;
+
+    return true;
+}
+
+/*! @private */
+static struct cstl_map_bnode * cstl_map_bnode_last(
+    struct cstl_map_bnode * n)
+{
+    while (!n->leaf) {
+        n = n->c[n->n];
+    }
+    return n;
+}
+
+/*!
+ * @private
+ *
+ * move the node/index pair to the previous key in order.
+ * the function returns false if there is no previous key
+ */
+static bool cstl_map_bnode_prev(struct cstl_map_bnode ** const _n,
+                                unsigned int * const _i)
+{
+    struct cstl_map_bnode * n = *_n;
+    unsigned int i = *_i;
+
+    if (!n->leaf) {
+        n = cstl_map_bnode_last(n->c[i]);
+        i = n->n - 1;
+    } else if (i > 0) {
+        i--;
+    } else {
+        /*
+         * climb until arriving at a parent from
+         * a child that is not its first child
+         */
+        do {
+            struct cstl_map_bnode * const p = n->p;
+
+            if (p == NULL) {
+                return false;
+            }
+
+            for (i = 0; p->c[i] != n; i++)
+                ;
+            n = p;
+        } while (i == 0);
+
+        i--;
+    }
+
+    *_n = n;
+    *_i = i;
+
+    return true;
+}
+
+/*!
+ * @private
+ *
+ * find the first key that is greater than (if @upper is true) or
+ * not less than (if @upper is false) the given key. within each node,
+ * the keys in the child at the found index lie between the keys on
+ * either side of that index, so the best candidate so far is
+ * refined while descending.
+ */
+static bool cstl_map_btree_bound(const cstl_map_t * const map,
+                                 const void * const key, const bool upper,
+                                 struct cstl_map_bnode ** const _n,
+                                 unsigned int * const _i)
+{
+    struct cstl_map_bnode * n = map->b.root;
+    bool found = false;
+
+    while (n != NULL) {
+        unsigned int lo = 0, hi = n->n;
+
+        while (lo < hi) {
+            const unsigned int md = lo + (hi - lo) / 2;
+            const int c = map->cmp.f(key, n->key[md], map->cmp.p);
+
+            if (c < 0 || (c == 0 && !upper)) {
+                hi = md;
+            } else {
+                lo = md + 1;
+            }
+        }
+
+        if (lo < n->n) {
+            *_n = n;
+            *_i = lo;
+            found = true;
+        }
+
+        n = n->leaf ? NULL : n->c[lo];
+    }
+
+    return found;
+}
+
+/*! @private */
+static bool cstl_map_btree_find(const cstl_map_t * const map,
+                                const void * const key,
+                                struct cstl_map_bnode ** const _n,
+                                unsigned int * const _i)
+{
+    struct cstl_map_bnode * n = map->b.root;
+
+    while (n != NULL) {
+        bool found;
+        const unsigned int i = cstl_map_bnode_search(map, n, key, &found);
+
+        if (found) {
+            *_n = n;
+            *_i = i;
+            return true;
+        }
+
+        n = n->leaf ? NULL : n->c[i];
+    }
+
+    return false;
+}
+
+/*!
+ * @private
+ *
+ * insert the key/value pair at position @i within the leaf @x. the
+ * caller must ensure that the leaf is not full and that the key
+ * belongs at that position
+ */
+static void cstl_map_bnode_insert_at(cstl_map_t * const map,
+                                     struct cstl_map_bnode * const x,
+                                     const unsigned int i,
+                                     const void * const key, void * const val)
+{
+    cstl_map_bnode_move(x, i + 1, x, i, x->n - i);
+    x->key[i] = key;
+    x->val[i] = val;
+    x->n++;
+
+    map->b.size++;
+}
+
+/*!
+ * @private
+ *
+ * insertion proceeds from the root down to a leaf, splitting any
+ * full node along the way so that the key can be added to the leaf
+ * without having to revisit any of the nodes above it.
+ */
+static int cstl_map_btree_insert(cstl_map_t * const map,
+                                 const void * const key, void * const val,
+                                 struct cstl_map_bnode ** const _n,
+                                 unsigned int * const _i)
+{
+    struct cstl_map_bnode * x = map->b.root;
+    unsigned int i;
+
+    if (x == NULL) {
+        x = cstl_map_bnode_alloc(map, true);
+        if (x == NULL) {
+            return -1;
+        }
+        map->b.root = x;
+    } else if (x->n == CSTL_MAP_BTREE_MAX) {
+        struct cstl_map_bnode * const s = cstl_map_bnode_alloc(map, false);
+
+        if (s == NULL) {
+            return -1;
+        }
+
+        s->c[0] = x;
+        x->p = s;
+        if (cstl_map_bnode_split(map, s, 0) != 0) {
+            x->p = NULL;
+            cstl_map_bnode_free(map, s);
+            return -1;
+        }
+
+        map->b.root = x = s;
+    }
+
+    for (;;) {
+        bool found;
+
+        i = cstl_map_bnode_search(map, x, key, &found);
+        if (found) {
+            *_n = x;
+            *_i = i;
+            return 1;
+        } else if (x->leaf) {
+            break;
+        }
+
+        if (x->c[i]->n == CSTL_MAP_BTREE_MAX) {
+            int c;
+
+            if (cstl_map_bnode_split(map, x, i) != 0) {
+                return -1;
+            }
+
+            /* the median of the split child moved up to @i */
+            c = map->cmp.f(key, x->key[i], map->cmp.p);
+            if (c == 0) {
+                *_n = x;
+                *_i = i;
+                return 1;
+            } else if (c > 0) {
+                i++;
+            }
+        }
+
+        x = x->c[i];
+    }
+
+    cstl_map_bnode_insert_at(map, x, i, key, val);
+
+    *_n = x;
+    *_i = i;
+
+    return 0;
+}
+
+/*!
+ * @private
+ *
+ * like insertion, removal proceeds from the root down, making sure
+ * that each node that is descended into has more than the minimum
+ * number of keys. that way, a key can be removed from a leaf (or
+ * two nodes merged) without the need to revisit nodes above it.
+ *
+ * a key in an internal node is replaced by its predecessor or
+ * successor, which is then removed from the subtree in which it
+ * resides, or the key is pushed down into a merged child.
+ */
+static int cstl_map_btree_erase(cstl_map_t * const map,
+                                const void * key,
+                                const void ** const k, void ** const v)
+{
+    struct cstl_map_bnode * x = map->b.root;
+    bool first = true;
+
+    while (x != NULL) {
+        bool found;
+        const unsigned int i = cstl_map_bnode_search(map, x, key, &found);
+
+        if (found && first) {
+            /* remember the element being removed */
+            *k = x->key[i];
+            *v = x->val[i];
+            first = false;
+        }
+
+        if (found && x->leaf) {
+            cstl_map_bnode_move(x, i, x, i + 1, x->n - i - 1);
+            x->n--;
+
+            if (x->n == 0) {
+                /* only the root is allowed to become empty */
+                cstl_map_bnode_free(map, x);
+                map->b.root = NULL;
+            }
+
+            map->b.size--;
+            return 0;
+        } else if (found) {
+            struct cstl_map_bnode * n;
+
+            if (x->c[i]->n >= CSTL_MAP_BTREE_T) {
+                n = x->c[i];
+                while (!n->leaf) {
+                    n = n->c[n->n];
+                }
+
+                x->key[i] = n->key[n->n - 1];
+                x->val[i] = n->val[n->n - 1];
+                x = x->c[i];
+            } else if (x->c[i + 1]->n >= CSTL_MAP_BTREE_T) {
+                n = cstl_map_bnode_first(x->c[i + 1]);
+
+                x->key[i] = n->key[0];
+                x->val[i] = n->val[0];
+                x = x->c[i + 1];
+            } else {
+                x = cstl_map_bnode_merge(map, x, i);
+                continue;
+            }
+
+            /* go remove the key that was just copied up */
+            key = x->p->key[i];
+        } else if (x->leaf) {
+            break;
+        } else if (x->c[i]->n < CSTL_MAP_BTREE_T) {
+            x = cstl_map_bnode_fill(map, x, i);
+        } else {
+            x = x->c[i];
+        }
+    }
+
+    return -1;
+}
+
+/*! @private */
+static void cstl_map_bnode_clear(cstl_map_t * const map,
+                                 struct cstl_map_bnode * const n,
+                                 cstl_xtor_func_t * const clr,
+                                 void * const priv)
+{
+    unsigned int i;
+
+    for (i = 0; i < n->n; i++) {
+        if (!n->leaf) {
+            cstl_map_bnode_clear(map, n->c[i], clr, priv);
+        }
+
+        if (clr != NULL) {
+            cstl_map_iterator_t it;
+
+            cstl_map_biterator_init(map, &it, n, i);
+            it._ = NULL;
+
+            clr(&it, priv);
+        }
+    }
+
+    if (!n->leaf) {
+        cstl_map_bnode_clear(map, n->c[i], clr, priv);
+    }
+
+    cstl_map_bnode_free(map, n);
 }
 
 /*! @private */
@@ -79,6 +868,11 @@ struct cmc_priv
     cstl_map_t * map;
     cstl_xtor_func_t * clr;
     void * priv;
+    /*
+     * whether the node should be returned
+     * to the pool or heap after being cleared
+     */
+    bool free;
 };
 
 /*! @private */
@@ -96,7 +890,9 @@ static void __cstl_map_node_clear(void * const n, void * const p)
         cmc->clr(&i, cmc->priv);
     }
 
-    cstl_map_node_free(node);
+    if (cmc->free) {
+        cstl_map_node_free(cmc->map, node);
+    }
 }
 
 void cstl_map_clear(cstl_map_t * const map,
@@ -104,22 +900,249 @@ void cstl_map_clear(cstl_map_t * const map,
 {
     struct cmc_priv cmc;
 
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        if (map->b.root != NULL) {
+            cstl_map_bnode_clear(map, map->b.root, clr, priv);
+        }
+
+        map->b.root = NULL;
+        map->b.size = 0;
+
+        return;
+    }
+
     cmc.map = map;
     cmc.clr = clr;
     cmc.priv = priv;
+    cmc.free = true;
+
+    if (map->pool != NULL
+        && cstl_pool_size(map->pool) == cstl_map_size(map)) {
+        /*
+         * every node allocated from the pool belongs to this
+         * map. rather than return each node to the pool, just
+         * empty the pool, freeing entire slabs at a time
+         */
+        cmc.free = false;
+
+        if (clr == NULL) {
+            const bool ranked = map->t.ranked;
+
+            /*
+             * no need to visit the nodes at all;
+             * just forget about them
+             */
+            cstl_rbtree_init(&map->t,
+                             cstl_map_node_cmp, map,
+                             offsetof(struct cstl_map_node, n));
+            cstl_rbtree_set_ranked(&map->t, ranked);
+        }
+    }
+
+    cstl_rbtree_clear(&map->t, __cstl_map_node_clear, &cmc);
+
+    if (!cmc.free) {
+        cstl_pool_clear(map->pool);
+    }
+}
+
+/*! @private */
+struct cstl_map_foreach_priv
+{
+    const cstl_map_t * map;
+    cstl_visit_func_t * visit;
+    void * priv;
+};
+
+/*! @private */
+static int cstl_map_foreach_visit(const void * const e,
+                                  const cstl_bintree_visit_order_t ord,
+                                  void * const p)
+{
+    struct cstl_map_foreach_priv * const mfp = p;
+    cstl_map_iterator_t i;
+
+    cstl_map_iterator_init(mfp->map, &i, (void *)e);
+    return mfp->visit(&i, mfp->priv);
+
+    (void)ord;
+}
+
+int cstl_map_foreach(const cstl_map_t * const map,
+                     cstl_visit_func_t * const visit, void * const priv)
+{
+    int res = 0;
+
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        if (map->b.root != NULL) {
+            struct cstl_map_bnode * n = cstl_map_bnode_first(map->b.root);
+            unsigned int i = 0;
+
+            do {
+                cstl_map_iterator_t it;
+
+                cstl_map_biterator_init(map, &it, n, i);
+                res = visit(&it, priv);
+            } while (res == 0 && cstl_map_bnode_next(&n, &i));
+        }
+    } else {
+        struct cstl_map_foreach_priv mfp;
 
-    cstl_rbtree_clear(&((cstl_map_t *)map)->t, __cstl_map_node_clear, &cmc);
+        mfp.map = map;
+        mfp.visit = visit;
+        mfp.priv = priv;
+
+        res = cstl_rbtree_foreach_inorder(&map->t,
+                                          cstl_map_foreach_visit, &mfp,
+                                          CSTL_BINTREE_FOREACH_DIR_FWD);
+    }
+
+    return res;
 }
 
-void cstl_map_init(cstl_map_t * const map,
-                   cstl_compare_func_t * const cmp, void * const priv)
+void __cstl_map_init(cstl_map_t * const map,
+                     cstl_compare_func_t * const cmp, void * const priv,
+                     const cstl_map_backend_t backend)
 {
+    map->backend = backend;
+
     map->cmp.f = cmp;
     map->cmp.p = priv;
 
+    map->key.size = 0;
+    map->key.kind = CSTL_MAP_KEY_CMP;
+
     cstl_rbtree_init(&map->t,
                      cstl_map_node_cmp, map,
                      offsetof(struct cstl_map_node, n));
+
+    map->b.root = NULL;
+    map->b.size = 0;
+
+    map->pool = NULL;
+    map->allocator = NULL;
+}
+
+void cstl_map_pool_init(struct cstl_pool * const pool, const size_t count)
+{
+    cstl_map_inline_pool_init(pool, 0, count);
+}
+
+void cstl_map_inline_pool_init(struct cstl_pool * const pool,
+                               const size_t ksize, const size_t count)
+{
+    /* the nodes have room for order statistics, whether used or not */
+    cstl_pool_init(pool, cstl_map_node_size(ksize, true), count);
+}
+
+void cstl_map_set_pool(cstl_map_t * const map, struct cstl_pool * const pool)
+{
+    if (cstl_map_size(map) != 0
+        || (pool != NULL
+            && (map->backend != CSTL_MAP_BACKEND_RBTREE
+                || cstl_pool_object_size(pool)
+                < cstl_map_node_size(map->key.size, map->t.ranked)))) {
+        abort();
+    }
+
+    map->pool = pool;
+}
+
+void cstl_map_set_allocator(cstl_map_t * const map,
+                            const cstl_allocator_t * const a)
+{
+    if (cstl_map_size(map) != 0) {
+        abort();
+    }
+
+    map->allocator = a;
+}
+
+void cstl_map_set_ranked(cstl_map_t * const map, const bool ranked)
+{
+    if (ranked
+        && (map->backend != CSTL_MAP_BACKEND_RBTREE
+            || (map->pool != NULL
+                && cstl_pool_object_size(map->pool)
+                < cstl_map_node_size(map->key.size, true)))) {
+        abort();
+    }
+
+    /* aborts if the map is not empty */
+    cstl_rbtree_set_ranked(&map->t, ranked);
+}
+
+void cstl_map_set_inline_keys(cstl_map_t * const map,
+                              const size_t size,
+                              const cstl_map_key_kind_t kind)
+{
+    bool ok;
+
+    switch (kind) {
+    case CSTL_MAP_KEY_CMP:
+        ok = true;
+        break;
+    case CSTL_MAP_KEY_INT:
+    case CSTL_MAP_KEY_UINT:
+        ok = size == 1 || size == 2 || size == 4 || size == 8;
+        break;
+    case CSTL_MAP_KEY_MEMCMP:
+        ok = size != 0;
+        break;
+    default:
+        ok = false;
+        break;
+    }
+
+    if (!ok
+        || cstl_map_size(map) != 0
+        || map->backend != CSTL_MAP_BACKEND_RBTREE
+        || (map->pool != NULL
+            && cstl_pool_object_size(map->pool)
+            < cstl_map_node_size(size, map->t.ranked))) {
+        abort();
+    }
+
+    map->key.size = size;
+    map->key.kind = kind;
+}
+
+/*! @private */
+static inline struct cstl_map_node * cstl_map_descend(
+    const cstl_map_t * const map, const void * const key,
+    struct cstl_map_node ** const p,
+    const cstl_map_key_kind_t kind, const size_t size)
+{
+    /*
+     * this is the same search as cstl_rbtree_find(), but
+     * it compares the keys directly rather than calling
+     * through the tree's comparison function
+     */
+    const struct cstl_bintree_node * bn = map->t.t.root;
+    struct cstl_map_node * n = NULL, * par = NULL;
+
+    while (bn != NULL) {
+        int c;
+
+        n = (void *)((uintptr_t)bn - offsetof(struct cstl_map_node, n.n));
+        c = __cstl_map_key_cmp(map, kind, size, key, n->key);
+        if (c == 0) {
+            break;
+        }
+
+        par = n;
+        if (c < 0) {
+            bn = bn->l;
+        } else {
+            bn = bn->r;
+        }
+    }
+
+    if (p != NULL) {
+        *p = par;
+    }
+
+    return bn != NULL ? n : NULL;
 }
 
 /*! @private */
@@ -127,18 +1150,180 @@ static struct cstl_map_node * __cstl_map_find(
     const cstl_map_t * const map, const void * const key,
     struct cstl_map_node ** const p)
 {
-    struct cstl_map_node node;
+    const size_t size = map->key.size;
 
-    node.key = key;
-    return (void *)cstl_rbtree_find(&map->t, &node, (void *)p);
+    /*
+     * choose the comparison once, outside of the
+     * search, rather than at every level of the tree
+     */
+    switch (map->key.kind) {
+    case CSTL_MAP_KEY_INT:
+        switch (size) {
+        case 1:  return cstl_map_descend(map, key, p, CSTL_MAP_KEY_INT, 1);
+        case 2:  return cstl_map_descend(map, key, p, CSTL_MAP_KEY_INT, 2);
+        case 4:  return cstl_map_descend(map, key, p, CSTL_MAP_KEY_INT, 4);
+        default: return cstl_map_descend(map, key, p, CSTL_MAP_KEY_INT, 8);
+        }
+    case CSTL_MAP_KEY_UINT:
+        switch (size) {
+        case 1:  return cstl_map_descend(map, key, p, CSTL_MAP_KEY_UINT, 1);
+        case 2:  return cstl_map_descend(map, key, p, CSTL_MAP_KEY_UINT, 2);
+        case 4:  return cstl_map_descend(map, key, p, CSTL_MAP_KEY_UINT, 4);
+        default: return cstl_map_descend(map, key, p, CSTL_MAP_KEY_UINT, 8);
+        }
+    case CSTL_MAP_KEY_MEMCMP:
+        return cstl_map_descend(map, key, p, CSTL_MAP_KEY_MEMCMP, size);
+    case CSTL_MAP_KEY_CMP:
+    default:
+        return cstl_map_descend(map, key, p, CSTL_MAP_KEY_CMP, size);
+    }
 }
 
 void cstl_map_find(const cstl_map_t * const map,
                    const void * const key,
                    cstl_map_iterator_t * const i)
+{
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        struct cstl_map_bnode * n = NULL;
+        unsigned int idx = 0;
+
+        (void)cstl_map_btree_find(map, key, &n, &idx);
+        cstl_map_biterator_init(map, i, n, idx);
+    } else {
+        cstl_map_iterator_init(
+            map, i, __cstl_map_find(map, key, NULL));
+    }
+}
+
+/*! @private */
+static void cstl_map_bound(const cstl_map_t * const map,
+                           const void * const key, const bool upper,
+                           cstl_map_iterator_t * const i)
+{
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        struct cstl_map_bnode * n = NULL;
+        unsigned int idx = 0;
+
+        (void)cstl_map_btree_bound(map, key, upper, &n, &idx);
+        cstl_map_biterator_init(map, i, n, idx);
+    } else {
+        struct cstl_map_node node;
+
+        node.key = key;
+        cstl_map_iterator_init(
+            map, i,
+            (void *)(upper ?
+                     cstl_rbtree_upper_bound(&map->t, &node) :
+                     cstl_rbtree_lower_bound(&map->t, &node)));
+    }
+}
+
+void cstl_map_lower_bound(const cstl_map_t * const map,
+                          const void * const key,
+                          cstl_map_iterator_t * const i)
+{
+    cstl_map_bound(map, key, false, i);
+}
+
+void cstl_map_upper_bound(const cstl_map_t * const map,
+                          const void * const key,
+                          cstl_map_iterator_t * const i)
+{
+    cstl_map_bound(map, key, true, i);
+}
+
+/*!
+ * @private
+ *
+ * step the iterator in the direction indicated by @fwd. an
+ * iterator at the end steps onto the first or last element
+ */
+static void cstl_map_iterator_step(const cstl_map_t * const map,
+                                   cstl_map_iterator_t * const i,
+                                   const bool fwd)
+{
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        struct cstl_map_bnode * n = i->_;
+        unsigned int idx = i->_i;
+
+        if (n != NULL) {
+            if (!(fwd ?
+                  cstl_map_bnode_next(&n, &idx) :
+                  cstl_map_bnode_prev(&n, &idx))) {
+                n = NULL;
+            }
+        } else if (map->b.root != NULL) {
+            if (fwd) {
+                n = cstl_map_bnode_first(map->b.root);
+                idx = 0;
+            } else {
+                n = cstl_map_bnode_last(map->b.root);
+                idx = n->n - 1;
+            }
+        }
+
+        cstl_map_biterator_init(map, i, n, idx);
+    } else {
+        cstl_map_iterator_init(
+            map, i,
+            (void *)(fwd ?
+                     cstl_rbtree_next(&map->t, i->_) :
+                     cstl_rbtree_prev(&map->t, i->_)));
+    }
+}
+
+void cstl_map_iterator_next(const cstl_map_t * const map,
+                            cstl_map_iterator_t * const i)
+{
+    cstl_map_iterator_step(map, i, true);
+}
+
+void cstl_map_iterator_prev(const cstl_map_t * const map,
+                            cstl_map_iterator_t * const i)
+{
+    cstl_map_iterator_step(map, i, false);
+}
+
+int cstl_map_foreach_range(const cstl_map_t * const map,
+                           const void * const lo, const void * const hi,
+                           cstl_visit_func_t * const visit,
+                           void * const priv)
+{
+    cstl_map_iterator_t i;
+    int res = 0;
+
+    for (cstl_map_lower_bound(map, lo, &i);
+         res == 0 && i._ != NULL && cstl_map_key_cmp(map, i.key, hi) < 0;
+         cstl_map_iterator_next(map, &i)) {
+        res = visit(&i, priv);
+    }
+
+    return res;
+}
+
+size_t cstl_map_rank(const cstl_map_t * const map, const void * const key)
+{
+    struct cstl_map_node node;
+
+    node.key = key;
+    return cstl_rbtree_rank(&map->t, &node);
+}
+
+void cstl_map_select(const cstl_map_t * const map, const size_t idx,
+                     cstl_map_iterator_t * const i)
 {
     cstl_map_iterator_init(
-        map, i, __cstl_map_find(map, key, NULL));
+        map, i, (void *)cstl_rbtree_select(&map->t, idx));
+}
+
+size_t cstl_map_count_range(const cstl_map_t * const map,
+                            const void * const lo, const void * const hi)
+{
+    struct cstl_map_node l, h;
+
+    l.key = lo;
+    h.key = hi;
+    return cstl_rbtree_count_range(&map->t, &l, &h);
 }
 
 int cstl_map_erase(cstl_map_t * const map, const void * const key,
@@ -148,15 +1333,25 @@ int cstl_map_erase(cstl_map_t * const map, const void * const key,
     int err;
 
     err = -1;
-    cstl_map_find(map, key, &i);
-    if (i._ != NULL) {
-        cstl_map_erase_iterator(map, &i);
-        err = 0;
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        i = *cstl_map_iterator_end(map);
+        err = cstl_map_btree_erase(map, key, &i.key, &i.val);
+    } else {
+        cstl_map_find(map, key, &i);
+        if (i._ != NULL) {
+            cstl_map_erase_iterator(map, &i);
+            if (map->key.size != 0) {
+                /* the node's copy of the key is gone */
+                i.key = key;
+            }
+            err = 0;
+        }
     }
 
     if (_i != NULL) {
         *_i = i;
         _i->_ = NULL;
+        _i->_i = 0;
     }
 
     return err;
@@ -165,9 +1360,18 @@ int cstl_map_erase(cstl_map_t * const map, const void * const key,
 void cstl_map_erase_iterator(cstl_map_t * const map,
                              cstl_map_iterator_t * const i)
 {
-    struct cstl_map_node * const n = i->_;
-    __cstl_rbtree_erase(&map->t, &n->n);
-    cstl_map_node_free(n);
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        /*
+         * removing a key from the B-tree may require that the
+         * tree be restructured from the root down, regardless of
+         * where the key is located. just remove it by its key
+         */
+        (void)cstl_map_btree_erase(map, i->key, &i->key, &i->val);
+    } else {
+        struct cstl_map_node * const n = i->_;
+        __cstl_rbtree_erase(&map->t, &n->n);
+        cstl_map_node_free(map, n);
+    }
 }
 
 int cstl_map_insert(cstl_map_t * const map,
@@ -177,28 +1381,377 @@ int cstl_map_insert(cstl_map_t * const map,
     struct cstl_map_node * node, * p;
     int err;
 
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        struct cstl_map_bnode * n = NULL;
+        unsigned int idx = 0;
+
+        err = cstl_map_btree_insert(map, key, val, &n, &idx);
+        if (i != NULL) {
+            cstl_map_biterator_init(map, i, err >= 0 ? n : NULL, idx);
+        }
+
+        return err;
+    }
+
     err = 1;
     node = __cstl_map_find(map, key, &p);
     if (node == NULL) {
         /* no existing node in the map, carry on */
         err = -1;
-        node = cstl_map_node_alloc(key, val);
+        node = cstl_map_node_alloc(map, key, val);
         if (node != NULL) {
             cstl_rbtree_insert(&map->t, node, p);
             err = 0;
         }
     }
 
-    if (i != NULL) {
-        cstl_map_iterator_init(map, i, node);
+    if (i != NULL) {
+        cstl_map_iterator_init(map, i, node);
+    }
+
+    return err;
+}
+
+int cstl_map_insert_hint(cstl_map_t * const map,
+                         const cstl_map_iterator_t * const hint,
+                         const void * const key, void * const val,
+                         cstl_map_iterator_t * const i)
+{
+    cstl_map_iterator_t pv, nx;
+    int c;
+
+    /*
+     * find the elements that would precede and follow the
+     * new key if it were inserted immediately after or
+     * immediately before the hint
+     */
+    c = -1;
+    if (hint->_ != NULL) {
+        c = cstl_map_key_cmp(map, key, hint->key);
+        if (c == 0) {
+            if (i != NULL) {
+                *i = *hint;
+            }
+            return 1;
+        }
+    }
+
+    if (c > 0) {
+        pv = nx = *hint;
+        cstl_map_iterator_next(map, &nx);
+        c = nx._ == NULL || cstl_map_key_cmp(map, key, nx.key) < 0;
+    } else {
+        pv = nx = *hint;
+        cstl_map_iterator_prev(map, &pv);
+        if (pv._ != NULL) {
+            c = cstl_map_key_cmp(map, pv.key, key) < 0;
+        } else {
+            /*
+             * the hint is the first element. if the hint is
+             * the end, the map is empty, and the key can
+             * just be inserted normally
+             */
+            c = nx._ != NULL;
+        }
+    }
+
+    if (c) {
+        /*
+         * the key belongs between @pv and @nx. as they are
+         * adjacent, either @pv has no right child (or is at
+         * the end of its leaf) or @nx has no left child (or
+         * is at the start of its leaf)
+         */
+        if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+            struct cstl_map_bnode * x;
+            unsigned int idx;
+
+            if (pv._ != NULL && ((struct cstl_map_bnode *)pv._)->leaf) {
+                x = pv._;
+                idx = pv._i + 1;
+            } else {
+                x = nx._;
+                idx = nx._i;
+            }
+
+            if (x->n < CSTL_MAP_BTREE_MAX) {
+                cstl_map_bnode_insert_at(map, x, idx, key, val);
+                if (i != NULL) {
+                    cstl_map_biterator_init(map, i, x, idx);
+                }
+                return 0;
+            }
+        } else {
+            struct cstl_map_node * const node =
+                cstl_map_node_alloc(map, key, val);
+            struct cstl_map_node * p = pv._;
+
+            if (node == NULL) {
+                return -1;
+            }
+
+            if (p == NULL || p->n.n.r != NULL) {
+                p = nx._;
+            }
+
+            cstl_rbtree_insert(&map->t, node, p);
+            if (i != NULL) {
+                cstl_map_iterator_init(map, i, node);
+            }
+            return 0;
+        }
+    }
+
+    /* the hint was no good */
+    return cstl_map_insert(map, key, val, i);
+}
+
+/*!
+ * @private
+ *
+ * a list of nodes waiting to be appended to the red-black tree.
+ * the nodes are chained together, in order, via their (as yet
+ * unused) left child pointers
+ */
+struct cstl_map_chain
+{
+    struct cstl_bintree_node * head, ** tail;
+    size_t n;
+};
+
+/*! @private */
+static void cstl_map_chain_init(struct cstl_map_chain * const ch)
+{
+    ch->head = NULL;
+    ch->tail = &ch->head;
+    ch->n = 0;
+}
+
+/*! @private */
+static int cstl_map_chain_add(cstl_map_t * const map,
+                              struct cstl_map_chain * const ch,
+                              const void * const key, void * const val)
+{
+    struct cstl_map_node * const node = cstl_map_node_alloc(map, key, val);
+
+    if (node == NULL) {
+        return -1;
+    }
+
+    node->n.n.l = NULL;
+    *ch->tail = &node->n.n;
+    ch->tail = &node->n.n.l;
+    ch->n++;
+
+    return 0;
+}
+
+/*! @private */
+static void * cstl_map_chain_pull(void * const p)
+{
+    struct cstl_map_chain * const ch = p;
+    struct cstl_bintree_node * const bn = ch->head;
+
+    ch->head = bn->l;
+    return (void *)((uintptr_t)bn - offsetof(struct cstl_map_node, n.n));
+}
+
+/*! @private */
+static void cstl_map_chain_free(cstl_map_t * const map,
+                                struct cstl_map_chain * const ch)
+{
+    while (ch->head != NULL) {
+        cstl_map_node_free(map, cstl_map_chain_pull(ch));
+    }
+}
+
+/*! @private */
+static void cstl_map_chain_append(cstl_map_t * const map,
+                                  struct cstl_map_chain * const ch)
+{
+    __cstl_rbtree_append(&map->t, ch->n, cstl_map_chain_pull, ch);
+}
+
+int cstl_map_append(cstl_map_t * const map,
+                    const void * const * const keys, void * const * const vals,
+                    const size_t n)
+{
+    size_t i;
+
+    if (map->backend == CSTL_MAP_BACKEND_BTREE) {
+        for (i = 0; i < n; i++) {
+            if (cstl_map_insert(map, keys[i],
+                                vals != NULL ? vals[i] : NULL, NULL) < 0) {
+                /* back out the pairs that were inserted */
+                while (i-- > 0) {
+                    cstl_map_erase(map, keys[i], NULL);
+                }
+
+                return -1;
+            }
+        }
+    } else {
+        struct cstl_map_chain ch;
+
+        /*
+         * allocate all of the nodes up front, so that a failure
+         * can be handled before the tree has been touched
+         */
+        cstl_map_chain_init(&ch);
+        for (i = 0; i < n; i++) {
+            if (cstl_map_chain_add(map, &ch, keys[i],
+                                   vals != NULL ? vals[i] : NULL) != 0) {
+                cstl_map_chain_free(map, &ch);
+                return -1;
+            }
+        }
+
+        cstl_map_chain_append(map, &ch);
+    }
+
+    return 0;
+}
+
+int cstl_map_build(cstl_map_t * const map,
+                   const void * const * const keys, void * const * const vals,
+                   const size_t n)
+{
+    if (cstl_map_size(map) != 0) {
+        abort();
+    }
+
+    return cstl_map_append(map, keys, vals, n);
+}
+
+/*! @private */
+typedef enum
+{
+    CSTL_MAP_SETOP_UNION,
+    CSTL_MAP_SETOP_INTERSECTION,
+    CSTL_MAP_SETOP_DIFFERENCE,
+} cstl_map_setop_t;
+
+/*!
+ * @private
+ *
+ * walk @a and @b in order, side by side, and append the elements
+ * selected by @op to @dst. the elements arrive in order, so the
+ * red-black tree can be built all at once at the end
+ */
+static int cstl_map_setop(cstl_map_t * const dst,
+                          const cstl_map_t * const a,
+                          const cstl_map_t * const b,
+                          const cstl_map_setop_t op,
+                          cstl_map_combine_func_t * const comb,
+                          void * const priv)
+{
+    struct cstl_map_chain ch;
+    cstl_map_iterator_t i, j;
+    int err;
+
+    if (cstl_map_size(dst) != 0) {
+        abort();
+    }
+
+    cstl_map_chain_init(&ch);
+
+    i = *cstl_map_iterator_end(a);
+    cstl_map_iterator_next(a, &i);
+    j = *cstl_map_iterator_end(b);
+    cstl_map_iterator_next(b, &j);
+
+    err = 0;
+    while (err == 0
+           && (op == CSTL_MAP_SETOP_UNION ?
+               i._ != NULL || j._ != NULL :
+               i._ != NULL && (j._ != NULL
+                               || op == CSTL_MAP_SETOP_DIFFERENCE))) {
+        const void * key = NULL;
+        void * val = NULL;
+        bool emit = false;
+        int c;
+
+        if (i._ == NULL) {
+            c = 1;
+        } else if (j._ == NULL) {
+            c = -1;
+        } else {
+            c = cstl_map_key_cmp(a, i.key, j.key);
+        }
+
+        if (c < 0) {
+            if (op != CSTL_MAP_SETOP_INTERSECTION) {
+                key = i.key;
+                val = i.val;
+                emit = true;
+            }
+            cstl_map_iterator_next(a, &i);
+        } else if (c > 0) {
+            if (op == CSTL_MAP_SETOP_UNION) {
+                key = j.key;
+                val = j.val;
+                emit = true;
+            }
+            cstl_map_iterator_next(b, &j);
+        } else {
+            if (op != CSTL_MAP_SETOP_DIFFERENCE) {
+                key = i.key;
+                val = comb != NULL ? comb(i.key, i.val, j.val, priv) : i.val;
+                emit = true;
+            }
+            cstl_map_iterator_next(a, &i);
+            cstl_map_iterator_next(b, &j);
+        }
+
+        if (emit) {
+            if (dst->backend == CSTL_MAP_BACKEND_BTREE) {
+                if (cstl_map_insert_hint(dst, cstl_map_iterator_end(dst),
+                                         key, val, NULL) < 0) {
+                    err = -1;
+                }
+            } else {
+                err = cstl_map_chain_add(dst, &ch, key, val);
+            }
+        }
+    }
+
+    if (err != 0) {
+        cstl_map_chain_free(dst, &ch);
+        cstl_map_clear(dst, NULL, NULL);
+    } else if (ch.n > 0) {
+        cstl_map_chain_append(dst, &ch);
     }
 
     return err;
 }
 
+int cstl_map_union(cstl_map_t * const dst,
+                   const cstl_map_t * const a, const cstl_map_t * const b,
+                   cstl_map_combine_func_t * const comb, void * const priv)
+{
+    return cstl_map_setop(dst, a, b, CSTL_MAP_SETOP_UNION, comb, priv);
+}
+
+int cstl_map_intersection(cstl_map_t * const dst,
+                          const cstl_map_t * const a,
+                          const cstl_map_t * const b,
+                          cstl_map_combine_func_t * const comb,
+                          void * const priv)
+{
+    return cstl_map_setop(
+        dst, a, b, CSTL_MAP_SETOP_INTERSECTION, comb, priv);
+}
+
+int cstl_map_difference(cstl_map_t * const dst,
+                        const cstl_map_t * const a, const cstl_map_t * const b)
+{
+    return cstl_map_setop(
+        dst, a, b, CSTL_MAP_SETOP_DIFFERENCE, NULL, NULL);
+}
+
 #ifdef __cfg_test__
 // GCOV_EXCL_START
-#include <check.h>
+#include "internal/check.h"
 
 #include "cstl/string.h"
 
@@ -218,6 +1771,14 @@ static int map_key_cmp(const void * const a, const void * const b,
     (void)nil;
 }
 
+static int int_key_cmp(const void * const a, const void * const b,
+                       void * const nil)
+{
+    return (intptr_t)a - (intptr_t)b;
+
+    (void)nil;
+}
+
 static void map_elem_clear(void * const e, void * const nil)
 {
     cstl_map_iterator_t * const i = e;
@@ -373,6 +1934,920 @@ START_TEST(erase)
     cstl_string_clear(&s);
 }
 
+START_TEST(pool)
+{
+    struct cstl_pool pool;
+    cstl_map_t m1, m2;
+    cstl_map_iterator_t i;
+    unsigned int j;
+
+    cstl_map_pool_init(&pool, 4);
+
+    cstl_map_init(&m1, map_key_cmp, NULL);
+    cstl_map_set_pool(&m1, &pool);
+    fill_map(&m1);
+    ck_assert_uint_eq(cstl_pool_size(&pool), cstl_map_size(&m1));
+
+    /* a map can't switch to a pool after elements are inserted */
+    ck_assert_signal(SIGABRT, cstl_map_set_pool(&m1, NULL));
+
+    cstl_map_init(&m2, int_key_cmp, NULL);
+    cstl_map_set_pool(&m2, &pool);
+    for (j = 0; j < 50; j++) {
+        ck_assert_int_eq(
+            cstl_map_insert(&m2, (void *)(uintptr_t)j, NULL, NULL), 0);
+    }
+    ck_assert_uint_eq(cstl_pool_size(&pool), 26 + 50);
+
+    /* nodes erased from the map go back to the pool */
+    for (j = 0; j < 50; j += 2) {
+        ck_assert_int_eq(
+            cstl_map_erase(&m2, (void *)(uintptr_t)j, &i), 0);
+    }
+    ck_assert_uint_eq(cstl_pool_size(&pool), 26 + 25);
+
+    /* the pool is shared, so nodes are returned individually */
+    cstl_map_clear(&m1, map_elem_clear, NULL);
+    ck_assert_uint_eq(cstl_pool_size(&pool), 25);
+    ck_assert_ptr_nonnull(pool.slab);
+
+    /* the remaining map owns the whole pool, which is released */
+    cstl_map_clear(&m2, NULL, NULL);
+    ck_assert_uint_eq(cstl_map_size(&m2), 0);
+    ck_assert_uint_eq(cstl_pool_size(&pool), 0);
+    ck_assert_ptr_null(pool.slab);
+
+    /* maps remain usable after being cleared */
+    ck_assert_int_eq(cstl_map_insert(&m2, (void *)1, NULL, NULL), 0);
+    cstl_map_find(&m2, (void *)1, &i);
+    ck_assert(!cstl_map_iterator_eq(&i, cstl_map_iterator_end(&m2)));
+    cstl_map_clear(&m2, NULL, NULL);
+
+    cstl_pool_clear(&pool);
+}
+END_TEST
+
+START_TEST(allocator)
+{
+    struct ck_counting_allocator ca;
+    cstl_map_t m;
+    unsigned int j;
+
+    ck_counting_allocator_init(&ca);
+
+    cstl_map_init(&m, int_key_cmp, NULL);
+    cstl_map_set_allocator(&m, &ca.a);
+    for (j = 0; j < 50; j++) {
+        ck_assert_int_eq(
+            cstl_map_insert(&m, (void *)(uintptr_t)j, NULL, NULL), 0);
+    }
+    ck_assert_uint_eq(ca.calls, 50);
+    ck_assert_uint_gt(ca.bytes, 0);
+
+    ck_assert_signal(SIGABRT, cstl_map_set_allocator(&m, NULL));
+
+    ck_assert_int_eq(cstl_map_erase(&m, (void *)7, NULL), 0);
+    ck_assert_uint_eq(ca.calls, 51);
+
+    cstl_map_clear(&m, NULL, NULL);
+    ck_assert_uint_eq(ca.calls, 100);
+    ck_assert_uint_eq(ca.bytes, 0);
+}
+END_TEST
+
+START_TEST(btree)
+{
+    DECLARE_CSTL_STRING(string, s);
+    cstl_map_t map;
+    cstl_map_iterator_t i;
+
+    __cstl_map_init(&map, map_key_cmp, NULL, CSTL_MAP_BACKEND_BTREE);
+    fill_map(&map);
+    ck_assert_uint_eq(cstl_map_size(&map), 26);
+
+    /* a B-tree map can't use a pool */
+    ck_assert_signal(SIGABRT, cstl_map_set_pool(&map, NULL));
+
+    cstl_string_set_str(&s, "j");
+    cstl_map_find(&map, &s, &i);
+    ck_assert(!cstl_map_iterator_eq(&i, cstl_map_iterator_end(&map)));
+    ck_assert_int_eq(*(int *)i.val, 9);
+    cstl_map_erase_iterator(&map, &i);
+    map_elem_clear(&i, NULL);
+    cstl_map_find(&map, &s, &i);
+    ck_assert(cstl_map_iterator_eq(&i, cstl_map_iterator_end(&map)));
+
+    cstl_string_set_str(&s, "m");
+    ck_assert_int_eq(cstl_map_erase(&map, &s, &i), 0);
+    ck_assert_int_eq(*(int *)i.val, 12);
+    map_elem_clear(&i, NULL);
+    ck_assert_int_eq(cstl_map_erase(&map, &s, &i), -1);
+    ck_assert_uint_eq(cstl_map_size(&map), 24);
+
+    cstl_string_set_str(&s, "z");
+    cstl_map_find(&map, &s, &i);
+    ck_assert_int_eq(*(int *)i.val, 25);
+
+    cstl_map_clear(&map, map_elem_clear, NULL);
+    cstl_string_clear(&s);
+}
+END_TEST
+
+/*
+ * verify the structure of the B-tree rooted at @n, returning
+ * its height. @lo and @hi are bounds (exclusive) on the keys
+ * that may appear in the subtree; -1 indicates no bound
+ */
+static unsigned int btree_check(const struct cstl_map_bnode * const n,
+                                const struct cstl_map_bnode * const p,
+                                const intptr_t lo, const intptr_t hi,
+                                size_t * const count)
+{
+    unsigned int j, h = 0;
+
+    ck_assert_ptr_eq(n->p, p);
+    ck_assert_uint_le(n->n, CSTL_MAP_BTREE_MAX);
+    if (p != NULL) {
+        ck_assert_uint_ge(n->n, CSTL_MAP_BTREE_T - 1);
+    } else {
+        ck_assert_uint_ge(n->n, 1);
+    }
+
+    for (j = 0; j < n->n; j++) {
+        const intptr_t k = (intptr_t)n->key[j];
+
+        ck_assert(lo < 0 || k > lo);
+        ck_assert(hi < 0 || k < hi);
+        if (j > 0) {
+            ck_assert_int_lt((intptr_t)n->key[j - 1], k);
+        }
+        ck_assert_ptr_eq(n->val[j], n->key[j]);
+    }
+    *count += n->n;
+
+    if (!n->leaf) {
+        for (j = 0; j <= n->n; j++) {
+            const unsigned int ch = btree_check(
+                n->c[j], n,
+                j > 0 ? (intptr_t)n->key[j - 1] : lo,
+                j < n->n ? (intptr_t)n->key[j] : hi,
+                count);
+
+            /* all leaves must be at the same depth */
+            if (j == 0) {
+                h = ch;
+            } else {
+                ck_assert_uint_eq(ch, h);
+            }
+        }
+    }
+
+    return h + 1;
+}
+
+static void btree_verify(const cstl_map_t * const m)
+{
+    size_t count = 0;
+
+    if (m->b.root != NULL) {
+        btree_check(m->b.root, NULL, -1, -1, &count);
+    }
+    ck_assert_uint_eq(count, cstl_map_size(m));
+}
+
+START_TEST(btree_random)
+{
+    static const unsigned int n = 4000;
+
+    struct ck_counting_allocator ca;
+    cstl_map_t m;
+    unsigned char * present;
+    size_t size = 0;
+    unsigned int j;
+
+    ck_counting_allocator_init(&ca);
+    present = calloc(n, 1);
+    ck_assert_ptr_nonnull(present);
+
+    __cstl_map_init(&m, int_key_cmp, NULL, CSTL_MAP_BACKEND_BTREE);
+    cstl_map_set_allocator(&m, &ca.a);
+
+    for (j = 0; j < 8 * n; j++) {
+        const uintptr_t k = rand() % n;
+        cstl_map_iterator_t i;
+
+        /* favor insertion early on, removal later */
+        if (rand() % (8 * n) >= j) {
+            ck_assert_int_eq(
+                cstl_map_insert(&m, (void *)k, (void *)k, &i),
+                present[k] ? 1 : 0);
+            ck_assert_ptr_eq(i.key, (void *)k);
+            if (!present[k]) {
+                present[k] = 1;
+                size++;
+            }
+        } else {
+            ck_assert_int_eq(cstl_map_erase(&m, (void *)k, &i),
+                             present[k] ? 0 : -1);
+            if (present[k]) {
+                ck_assert_ptr_eq(i.key, (void *)k);
+                ck_assert_ptr_eq(i.val, (void *)k);
+                present[k] = 0;
+                size--;
+            }
+        }
+
+        ck_assert_uint_eq(cstl_map_size(&m), size);
+        if (j % 256 == 0) {
+            btree_verify(&m);
+        }
+    }
+    btree_verify(&m);
+
+    for (j = 0; j < n; j++) {
+        cstl_map_iterator_t i;
+
+        cstl_map_find(&m, (void *)(uintptr_t)j, &i);
+        ck_assert(cstl_map_iterator_eq(&i, cstl_map_iterator_end(&m))
+                  == !present[j]);
+    }
+
+    /* remove everything; the tree should give back all of its memory */
+    for (j = 0; j < n; j++) {
+        if (present[j]) {
+            ck_assert_int_eq(
+                cstl_map_erase(&m, (void *)(uintptr_t)j, NULL), 0);
+        }
+    }
+    ck_assert_uint_eq(cstl_map_size(&m), 0);
+    ck_assert_ptr_null(m.b.root);
+    ck_assert_uint_eq(ca.bytes, 0);
+
+    for (j = 0; j < n; j++) {
+        cstl_map_insert(&m, (void *)(uintptr_t)j, (void *)(uintptr_t)j, NULL);
+    }
+    btree_verify(&m);
+    cstl_map_clear(&m, NULL, NULL);
+    ck_assert_uint_eq(ca.bytes, 0);
+
+    free(present);
+}
+END_TEST
+
+static int map_foreach_visit(void * const e, void * const p)
+{
+    const cstl_map_iterator_t * const i = e;
+    intptr_t * const last = p;
+
+    ck_assert_int_gt((intptr_t)i->key, *last);
+    *last = (intptr_t)i->key;
+
+    return *last == 600 ? 1 : 0;
+}
+
+START_TEST(foreach)
+{
+    unsigned int b;
+
+    for (b = 0; b < 2; b++) {
+        cstl_map_t m;
+        intptr_t last;
+        unsigned int j;
+
+        __cstl_map_init(&m, int_key_cmp, NULL,
+                        b ? CSTL_MAP_BACKEND_BTREE : CSTL_MAP_BACKEND_RBTREE);
+
+        last = -1;
+        ck_assert_int_eq(cstl_map_foreach(&m, map_foreach_visit, &last), 0);
+        ck_assert_int_eq(last, -1);
+
+        for (j = 0; j < 500; j++) {
+            const uintptr_t k = (j * 7919) % 500;
+            cstl_map_insert(&m, (void *)k, NULL, NULL);
+        }
+
+        last = -1;
+        ck_assert_int_eq(cstl_map_foreach(&m, map_foreach_visit, &last), 0);
+        ck_assert_int_eq(last, 499);
+
+        /* a non-zero return from the visitor stops the walk */
+        for (j = 500; j < 1000; j++) {
+            cstl_map_insert(&m, (void *)(uintptr_t)j, NULL, NULL);
+        }
+        last = -1;
+        ck_assert_int_eq(cstl_map_foreach(&m, map_foreach_visit, &last), 1);
+        ck_assert_int_eq(last, 600);
+
+        cstl_map_clear(&m, NULL, NULL);
+    }
+}
+END_TEST
+
+static int map_range_visit(void * const e, void * const p)
+{
+    const cstl_map_iterator_t * const i = e;
+    intptr_t * const next = p;
+
+    ck_assert_int_eq((intptr_t)i->key, *next);
+    *next += 3;
+
+    return 0;
+}
+
+START_TEST(range)
+{
+    unsigned int b;
+
+    for (b = 0; b < 2; b++) {
+        cstl_map_iterator_t i;
+        cstl_map_t m;
+        intptr_t next;
+        unsigned int j;
+
+        __cstl_map_init(&m, int_key_cmp, NULL,
+                        b ? CSTL_MAP_BACKEND_BTREE : CSTL_MAP_BACKEND_RBTREE);
+
+        /* the end iterator wraps around, even in an empty map */
+        i = *cstl_map_iterator_end(&m);
+        cstl_map_iterator_next(&m, &i);
+        ck_assert(cstl_map_iterator_eq(&i, cstl_map_iterator_end(&m)));
+
+        /* keys are multiples of 3 from 0 through 2997 */
+        for (j = 0; j < 1000; j++) {
+            const uintptr_t k = ((j * 7919) % 1000) * 3;
+            cstl_map_insert(&m, (void *)k, NULL, NULL);
+        }
+
+        cstl_map_lower_bound(&m, (void *)300, &i);
+        ck_assert_int_eq((intptr_t)i.key, 300);
+        cstl_map_upper_bound(&m, (void *)300, &i);
+        ck_assert_int_eq((intptr_t)i.key, 303);
+        cstl_map_lower_bound(&m, (void *)301, &i);
+        ck_assert_int_eq((intptr_t)i.key, 303);
+        cstl_map_upper_bound(&m, (void *)2997, &i);
+        ck_assert(cstl_map_iterator_eq(&i, cstl_map_iterator_end(&m)));
+        cstl_map_lower_bound(&m, (void *)2998, &i);
+        ck_assert(cstl_map_iterator_eq(&i, cstl_map_iterator_end(&m)));
+
+        /* step all the way through the map in both directions */
+        cstl_map_iterator_next(&m, &i);
+        for (j = 0; j < 1000; j++) {
+            ck_assert_int_eq((intptr_t)i.key, j * 3);
+            cstl_map_iterator_next(&m, &i);
+        }
+        ck_assert(cstl_map_iterator_eq(&i, cstl_map_iterator_end(&m)));
+
+        cstl_map_iterator_prev(&m, &i);
+        for (j = 1000; j > 0; j--) {
+            ck_assert_int_eq((intptr_t)i.key, (j - 1) * 3);
+            cstl_map_iterator_prev(&m, &i);
+        }
+        ck_assert(cstl_map_iterator_eq(&i, cstl_map_iterator_end(&m)));
+
+        next = 300;
+        ck_assert_int_eq(
+            cstl_map_foreach_range(&m, (void *)299, (void *)600,
+                                   map_range_visit, &next), 0);
+        ck_assert_int_eq(next, 600);
+
+        next = 2700;
+        cstl_map_foreach_range(&m, (void *)2700, (void *)5000,
+                               map_range_visit, &next);
+        ck_assert_int_eq(next, 3000);
+
+        /* an empty range visits nothing */
+        next = 0;
+        cstl_map_foreach_range(&m, (void *)301, (void *)302,
+                               map_range_visit, &next);
+        ck_assert_int_eq(next, 0);
+
+        cstl_map_clear(&m, NULL, NULL);
+    }
+}
+END_TEST
+
+START_TEST(ranked)
+{
+    struct cstl_pool pool;
+    cstl_map_iterator_t i;
+    cstl_map_t m;
+    unsigned int j;
+
+    __cstl_map_init(&m, int_key_cmp, NULL, CSTL_MAP_BACKEND_BTREE);
+    ck_assert_signal(SIGABRT, cstl_map_set_ranked(&m, true));
+
+    cstl_map_pool_init(&pool, 64);
+    cstl_map_init(&m, int_key_cmp, NULL);
+    ck_assert_signal(SIGABRT, cstl_map_rank(&m, NULL));
+    cstl_map_set_pool(&m, &pool);
+    cstl_map_set_ranked(&m, true);
+
+    /* keys are multiples of 3 from 0 through 2997 */
+    for (j = 0; j < 1000; j++) {
+        const uintptr_t k = ((j * 7919) % 1000) * 3;
+        cstl_map_insert(&m, (void *)k, NULL, NULL);
+    }
+    ck_assert_signal(SIGABRT, cstl_map_set_ranked(&m, false));
+
+    ck_assert_uint_eq(cstl_map_rank(&m, (void *)0), 0);
+    ck_assert_uint_eq(cstl_map_rank(&m, (void *)300), 100);
+    ck_assert_uint_eq(cstl_map_rank(&m, (void *)301), 101);
+    ck_assert_uint_eq(cstl_map_rank(&m, (void *)5000), 1000);
+
+    cstl_map_select(&m, 100, &i);
+    ck_assert_int_eq((intptr_t)i.key, 300);
+    cstl_map_select(&m, 999, &i);
+    ck_assert_int_eq((intptr_t)i.key, 2997);
+    cstl_map_select(&m, 1000, &i);
+    ck_assert(cstl_map_iterator_eq(&i, cstl_map_iterator_end(&m)));
+
+    ck_assert_uint_eq(cstl_map_count_range(&m, (void *)299, (void *)600), 100);
+    ck_assert_uint_eq(cstl_map_count_range(&m, (void *)600, (void *)299), 0);
+
+    /* removals are reflected in the statistics */
+    for (j = 0; j < 100; j++) {
+        cstl_map_erase(&m, (void *)(uintptr_t)(j * 6), NULL);
+    }
+    ck_assert_uint_eq(cstl_map_rank(&m, (void *)300), 50);
+    cstl_map_select(&m, 50, &i);
+    ck_assert_int_eq((intptr_t)i.key, 303);
+
+    /* fast clear of the pool retains the setting */
+    cstl_map_clear(&m, NULL, NULL);
+    cstl_map_insert(&m, (void *)(uintptr_t)7, NULL, NULL);
+    ck_assert_uint_eq(cstl_map_rank(&m, (void *)8), 1);
+
+    cstl_map_clear(&m, NULL, NULL);
+    cstl_pool_clear(&pool);
+
+    /* the subtree sizes sit between the tree node and the key */
+    cstl_map_init(&m, NULL, NULL);
+    cstl_map_set_inline_keys(&m, sizeof(j), CSTL_MAP_KEY_UINT);
+    cstl_map_set_ranked(&m, true);
+    for (j = 100; j > 0; j--) {
+        ck_assert_int_eq(cstl_map_insert(&m, &j, NULL, NULL), 0);
+    }
+    cstl_map_select(&m, 41, &i);
+    ck_assert_uint_eq(*(const unsigned int *)i.key, 42);
+    ck_assert_uint_eq(cstl_map_rank(&m, &(unsigned int){ 42 }), 41);
+    cstl_map_clear(&m, NULL, NULL);
+}
+END_TEST
+
+/* an allocator that fails once a given number of calls have been made */
+struct map_limited_allocator
+{
+    struct ck_counting_allocator ca;
+    unsigned int limit;
+};
+
+static void * map_limited_alloc(const size_t sz, void * const priv)
+{
+    struct map_limited_allocator * const la = priv;
+
+    if (la->ca.calls >= la->limit) {
+        return NULL;
+    }
+    return ck_counting_alloc(sz, &la->ca);
+}
+
+START_TEST(build)
+{
+    static const unsigned int n = 1000;
+
+    const void ** const keys = malloc(n * sizeof(*keys));
+    void ** const vals = malloc(n * sizeof(*vals));
+    struct map_limited_allocator la;
+    unsigned int b, j;
+
+    for (j = 0; j < n; j++) {
+        keys[j] = (void *)(uintptr_t)(j * 3);
+        vals[j] = (void *)(uintptr_t)(j + 1);
+    }
+
+    for (b = 0; b < 2; b++) {
+        cstl_map_iterator_t i;
+        cstl_map_t m;
+        size_t sz;
+
+        __cstl_map_init(&m, int_key_cmp, NULL,
+                        b ? CSTL_MAP_BACKEND_BTREE : CSTL_MAP_BACKEND_RBTREE);
+
+        ck_assert_int_eq(cstl_map_build(&m, keys, vals, n / 2), 0);
+        ck_assert_signal(SIGABRT, cstl_map_build(&m, keys, vals, n / 2));
+        for (j = n / 2; j < n; j += 100) {
+            ck_assert_int_eq(cstl_map_append(&m, keys + j, vals + j, 100), 0);
+        }
+        ck_assert_uint_eq(cstl_map_size(&m), n);
+
+        i = *cstl_map_iterator_end(&m);
+        for (j = 0; j < n; j++) {
+            cstl_map_iterator_next(&m, &i);
+            ck_assert_ptr_eq(i.key, keys[j]);
+            ck_assert_ptr_eq(i.val, vals[j]);
+        }
+
+        cstl_map_find(&m, (void *)300, &i);
+        ck_assert_ptr_eq(i.val, (void *)101);
+        cstl_map_insert(&m, (void *)301, NULL, NULL);
+        cstl_map_erase(&m, (void *)600, NULL);
+        cstl_map_lower_bound(&m, (void *)298, &i);
+        ck_assert_int_eq((intptr_t)i.key, 300);
+        cstl_map_iterator_next(&m, &i);
+        ck_assert_int_eq((intptr_t)i.key, 301);
+
+        cstl_map_clear(&m, NULL, NULL);
+
+        /* a failed append leaves the map as it was */
+        ck_counting_allocator_init(&la.ca);
+        la.ca.a.alloc = map_limited_alloc;
+        la.limit = -1;
+
+        __cstl_map_init(&m, int_key_cmp, NULL,
+                        b ? CSTL_MAP_BACKEND_BTREE : CSTL_MAP_BACKEND_RBTREE);
+        cstl_map_set_allocator(&m, &la.ca.a);
+        ck_assert_int_eq(cstl_map_build(&m, keys, NULL, n / 2), 0);
+
+        sz = la.ca.bytes;
+        la.limit = la.ca.calls + 5;
+        ck_assert_int_eq(cstl_map_append(&m, keys + n / 2, NULL, n / 2), -1);
+        ck_assert_uint_eq(cstl_map_size(&m), n / 2);
+        if (!b) {
+            ck_assert_uint_eq(la.ca.bytes, sz);
+        }
+        cstl_map_upper_bound(&m, keys[n / 2 - 1], &i);
+        ck_assert(cstl_map_iterator_eq(&i, cstl_map_iterator_end(&m)));
+
+        cstl_map_clear(&m, NULL, NULL);
+        ck_assert_uint_eq(la.ca.bytes, 0);
+    }
+
+    free(vals);
+    free(keys);
+}
+END_TEST
+
+static int counting_key_cmp(const void * const a, const void * const b,
+                            void * const p)
+{
+    (*(unsigned int *)p)++;
+    return (intptr_t)a - (intptr_t)b;
+}
+
+START_TEST(hint)
+{
+    static const unsigned int n = 5000;
+    unsigned int b;
+
+    for (b = 0; b < 2; b++) {
+        cstl_map_iterator_t i, h;
+        unsigned int cmps, j;
+        cstl_map_t m;
+
+        __cstl_map_init(&m, counting_key_cmp, &cmps,
+                        b ? CSTL_MAP_BACKEND_BTREE : CSTL_MAP_BACKEND_RBTREE);
+
+        /* in order, using the end as the hint */
+        cmps = 0;
+        for (j = 0; j < n; j += 2) {
+            void * const k = (void *)(uintptr_t)(j * 2);
+
+            ck_assert_int_eq(
+                cstl_map_insert_hint(&m, cstl_map_iterator_end(&m),
+                                     k, k, NULL), 0);
+        }
+        ck_assert_uint_le(cmps, 2 * n);
+
+        /* nearly in order, using the previous insertion as the hint */
+        h = *cstl_map_iterator_end(&m);
+        for (j = 1; j < n; j += 2) {
+            const uintptr_t k = (j % 7 == 0) ? (j * 2 + 5) : (j * 2);
+
+            ck_assert_int_eq(
+                cstl_map_insert_hint(&m, &h, (void *)k, (void *)k, &h), 0);
+            ck_assert_int_eq((intptr_t)h.key, k);
+        }
+
+        /* a hint equal to the key finds the existing element */
+        ck_assert_int_eq(cstl_map_insert_hint(&m, &h, h.key, NULL, &i), 1);
+        ck_assert_ptr_eq(i.key, h.key);
+
+        /* bad hints still work */
+        cstl_map_find(&m, (void *)8, &h);
+        ck_assert_int_eq(
+            cstl_map_insert_hint(&m, &h, (void *)(uintptr_t)(4 * n + 1),
+                                 (void *)(uintptr_t)(4 * n + 1), &i), 0);
+        cstl_map_find(&m, (void *)8, &h);
+        ck_assert_int_eq(
+            cstl_map_insert_hint(&m, &h, (void *)(uintptr_t)(4 * n + 1),
+                                 NULL, &i), 1);
+        ck_assert_int_eq(
+            cstl_map_insert_hint(&m, &h, (void *)3, (void *)3, &i), 0);
+        cstl_map_iterator_next(&m, &i);
+        ck_assert_int_eq((intptr_t)i.key, 4);
+
+        if (b) {
+            btree_verify(&m);
+        }
+
+        /* everything is still in order */
+        i = *cstl_map_iterator_end(&m);
+        cstl_map_iterator_next(&m, &i);
+        for (j = 1; j < cstl_map_size(&m); j++) {
+            const intptr_t k = (intptr_t)i.key;
+
+            cstl_map_iterator_next(&m, &i);
+            ck_assert_int_lt(k, (intptr_t)i.key);
+        }
+        ck_assert_uint_eq(cstl_map_size(&m), n + 2);
+
+        cstl_map_clear(&m, NULL, NULL);
+    }
+}
+END_TEST
+
+static void * map_sum_combine(const void * const key,
+                              void * const a, void * const b,
+                              void * const priv)
+{
+    (*(unsigned int *)priv)++;
+    return (void *)((uintptr_t)a + (uintptr_t)b);
+
+    (void)key;
+}
+
+START_TEST(setops)
+{
+    static const unsigned int n = 3000;
+    unsigned int b;
+
+    for (b = 0; b < 8; b++) {
+        const cstl_map_backend_t be[] = {
+            CSTL_MAP_BACKEND_RBTREE, CSTL_MAP_BACKEND_BTREE,
+        };
+        cstl_map_t ma, mb, u, x, d;
+        cstl_map_iterator_t i;
+        unsigned int j, calls;
+        unsigned char in[3000];
+        size_t nu, nx, nd;
+
+        __cstl_map_init(&ma, int_key_cmp, NULL, be[b & 1]);
+        __cstl_map_init(&mb, int_key_cmp, NULL, be[(b >> 1) & 1]);
+
+        /*
+         * key k is in a if bit 0 of in[k] is set and in b if
+         * bit 1 is set. a's values are k, and b's are 2k
+         */
+        nu = nx = nd = 0;
+        for (j = 0; j < n; j++) {
+            in[j] = rand() % 4;
+            if (in[j] & 1) {
+                cstl_map_insert(&ma, (void *)(uintptr_t)j,
+                                (void *)(uintptr_t)j, NULL);
+            }
+            if (in[j] & 2) {
+                cstl_map_insert(&mb, (void *)(uintptr_t)j,
+                                (void *)(uintptr_t)(2 * j), NULL);
+            }
+            nu += in[j] != 0;
+            nx += in[j] == 3;
+            nd += in[j] == 1;
+        }
+
+        __cstl_map_init(&u, int_key_cmp, NULL, be[(b >> 2) & 1]);
+        __cstl_map_init(&x, int_key_cmp, NULL, be[(b >> 2) & 1]);
+        __cstl_map_init(&d, int_key_cmp, NULL, be[(b >> 2) & 1]);
+
+        calls = 0;
+        ck_assert_int_eq(cstl_map_union(&u, &ma, &mb, map_sum_combine, &calls),
+                         0);
+        ck_assert_uint_eq(calls, nx);
+        ck_assert_int_eq(cstl_map_intersection(&x, &ma, &mb, NULL, NULL), 0);
+        ck_assert_int_eq(cstl_map_difference(&d, &ma, &mb), 0);
+        ck_assert_signal(SIGABRT, cstl_map_difference(&d, &ma, &mb));
+
+        ck_assert_uint_eq(cstl_map_size(&u), nu);
+        ck_assert_uint_eq(cstl_map_size(&x), nx);
+        ck_assert_uint_eq(cstl_map_size(&d), nd);
+
+        for (j = 0; j < n; j++) {
+            const uintptr_t k = j;
+
+            cstl_map_find(&u, (void *)k, &i);
+            if (in[j] == 0) {
+                ck_assert_ptr_null(i._);
+            } else {
+                ck_assert_uint_eq((uintptr_t)i.val,
+                                  ((in[j] & 1) ? k : 0)
+                                  + ((in[j] & 2) ? 2 * k : 0));
+            }
+
+            cstl_map_find(&x, (void *)k, &i);
+            if (in[j] == 3) {
+                ck_assert_uint_eq((uintptr_t)i.val, k);
+            } else {
+                ck_assert_ptr_null(i._);
+            }
+
+            cstl_map_find(&d, (void *)k, &i);
+            ck_assert(in[j] == 1 ? i._ != NULL : i._ == NULL);
+        }
+
+        if (be[(b >> 2) & 1] == CSTL_MAP_BACKEND_BTREE) {
+            btree_verify(&x);
+        }
+
+        cstl_map_clear(&u, NULL, NULL);
+        cstl_map_clear(&x, NULL, NULL);
+        cstl_map_clear(&d, NULL, NULL);
+
+        /* an operation with an empty map */
+        ck_assert_int_eq(cstl_map_intersection(&x, &ma, &d, NULL, NULL), 0);
+        ck_assert_uint_eq(cstl_map_size(&x), 0);
+        ck_assert_int_eq(cstl_map_union(&u, &d, &mb, NULL, NULL), 0);
+        ck_assert_uint_eq(cstl_map_size(&u), cstl_map_size(&mb));
+
+        cstl_map_clear(&u, NULL, NULL);
+        cstl_map_clear(&ma, NULL, NULL);
+        cstl_map_clear(&mb, NULL, NULL);
+    }
+}
+END_TEST
+
+START_TEST(setops_nomem)
+{
+    unsigned int b;
+
+    for (b = 0; b < 2; b++) {
+        struct map_limited_allocator la;
+        cstl_map_t ma, mb, u;
+        uintptr_t j;
+
+        cstl_map_init(&ma, int_key_cmp, NULL);
+        cstl_map_init(&mb, int_key_cmp, NULL);
+        for (j = 0; j < 200; j++) {
+            cstl_map_insert(j % 2 ? &ma : &mb, (void *)j, (void *)j, NULL);
+        }
+
+        ck_counting_allocator_init(&la.ca);
+        la.ca.a.alloc = map_limited_alloc;
+        la.limit = 5;
+
+        __cstl_map_init(&u, int_key_cmp, NULL,
+                        b ? CSTL_MAP_BACKEND_BTREE : CSTL_MAP_BACKEND_RBTREE);
+        cstl_map_set_allocator(&u, &la.ca.a);
+
+        ck_assert_int_eq(cstl_map_union(&u, &ma, &mb, NULL, NULL), -1);
+        ck_assert_uint_eq(cstl_map_size(&u), 0);
+        ck_assert_uint_eq(la.ca.bytes, 0);
+
+        cstl_map_clear(&ma, NULL, NULL);
+        cstl_map_clear(&mb, NULL, NULL);
+    }
+}
+END_TEST
+
+static int inline_key_cmp(const void * const a, const void * const b,
+                          void * const nil)
+{
+    int x, y;
+
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+
+    return (x > y) - (x < y);
+
+    (void)nil;
+}
+
+START_TEST(inline_keys)
+{
+    struct ck_counting_allocator ca;
+    struct cstl_pool pool;
+    cstl_map_t m;
+    cstl_map_iterator_t i;
+    int64_t k, prev;
+    int j;
+
+    /* signed integers, compared without calling a function */
+    ck_counting_allocator_init(&ca);
+    cstl_map_init(&m, NULL, NULL);
+    cstl_map_set_allocator(&m, &ca.a);
+    cstl_map_set_inline_keys(&m, sizeof(k), CSTL_MAP_KEY_INT);
+    for (j = 0; j < 1000; j++) {
+        /* the keys are overwritten; the map must keep its own copies */
+        k = ((j * 389) % 1000) - 500;
+        ck_assert_int_eq(
+            cstl_map_insert(&m, &k, (void *)(intptr_t)j, &i), 0);
+        ck_assert_ptr_ne(i.key, &k);
+    }
+    k = 17;
+    ck_assert_int_eq(cstl_map_insert(&m, &k, NULL, NULL), 1);
+    ck_assert_uint_eq(cstl_map_size(&m), 1000);
+
+    prev = -501;
+    k = INT64_MIN;
+    for (cstl_map_lower_bound(&m, &k, &i);
+         i._ != NULL;
+         cstl_map_iterator_next(&m, &i)) {
+        int64_t c;
+
+        memcpy(&c, i.key, sizeof(c));
+        ck_assert_int_eq(c, prev + 1);
+        prev = c;
+    }
+    ck_assert_int_eq(prev, 499);
+
+    k = -500;
+    cstl_map_find(&m, &k, &i);
+    ck_assert_ptr_nonnull(i._);
+    ck_assert_int_eq(*(const int64_t *)i.key, -500);
+    k = 500;
+    cstl_map_find(&m, &k, &i);
+    ck_assert_ptr_null(i._);
+
+    /* the erased key refers to the caller's copy */
+    k = 3;
+    ck_assert_int_eq(cstl_map_erase(&m, &k, &i), 0);
+    ck_assert_ptr_eq(i.key, &k);
+    ck_assert_int_eq(cstl_map_erase(&m, &k, &i), -1);
+
+    ck_assert_signal(SIGABRT,
+                     cstl_map_set_inline_keys(&m, 0, CSTL_MAP_KEY_CMP));
+    cstl_map_clear(&m, NULL, NULL);
+    ck_assert_uint_eq(ca.bytes, 0);
+
+    /* unsigned integers order differently than signed ones */
+    cstl_map_init(&m, NULL, NULL);
+    cstl_map_set_inline_keys(&m, sizeof(uint16_t), CSTL_MAP_KEY_UINT);
+    for (j = 0; j < 4; j++) {
+        const uint16_t u = j % 2 ? 0xffff - j : j;
+        ck_assert_int_eq(cstl_map_insert(&m, &u, NULL, NULL), 0);
+    }
+    cstl_map_lower_bound(&m, &(uint16_t){0}, &i);
+    ck_assert_uint_eq(*(const uint16_t *)i.key, 0);
+    cstl_map_upper_bound(&m, &(uint16_t){2}, &i);
+    ck_assert_uint_eq(*(const uint16_t *)i.key, 0xffff - 3);
+    cstl_map_clear(&m, NULL, NULL);
+
+    /* arrays of bytes, allocated from a pool */
+    cstl_map_pool_init(&pool, 0);
+    cstl_map_init(&m, NULL, NULL);
+    cstl_map_set_pool(&m, &pool);
+    /* the pool's nodes have no room for the keys */
+    ck_assert_signal(SIGABRT,
+                     cstl_map_set_inline_keys(&m, 16, CSTL_MAP_KEY_MEMCMP));
+    cstl_map_set_pool(&m, NULL);
+    cstl_pool_clear(&pool);
+
+    cstl_map_inline_pool_init(&pool, 16, 0);
+    cstl_map_set_inline_keys(&m, 16, CSTL_MAP_KEY_MEMCMP);
+    cstl_map_set_pool(&m, &pool);
+    for (j = 0; j < 2; j++) {
+        int l;
+
+        /* insert the keys; then do it again after the fast clear */
+        for (l = 0; l < 256; l++) {
+            unsigned char key[16];
+
+            memset(key, 0, sizeof(key));
+            key[0] = 255 - l;
+            key[15] = l;
+            ck_assert_int_eq(cstl_map_insert(&m, key, NULL, NULL), 0);
+        }
+        ck_assert_uint_eq(cstl_pool_size(&pool), 256);
+
+        cstl_map_lower_bound(&m, (unsigned char[16]){ 0 }, &i);
+        ck_assert_uint_eq(((const unsigned char *)i.key)[15], 255);
+
+        cstl_map_clear(&m, NULL, NULL);
+        ck_assert_uint_eq(cstl_pool_size(&pool), 0);
+    }
+    cstl_pool_clear(&pool);
+
+    /* copied keys compared by the map's function */
+    cstl_map_init(&m, inline_key_cmp, NULL);
+    cstl_map_set_inline_keys(&m, sizeof(int), CSTL_MAP_KEY_CMP);
+    for (j = 10; j > 0; j--) {
+        ck_assert_int_eq(cstl_map_insert(&m, &j, NULL, NULL), 0);
+    }
+    j = 5;
+    ck_assert_int_eq(cstl_map_insert(&m, &j, NULL, NULL), 1);
+    cstl_map_lower_bound(&m, &(int){0}, &i);
+    ck_assert_int_eq(*(const int *)i.key, 1);
+    cstl_map_clear(&m, NULL, NULL);
+
+    /* combinations that make no sense */
+    ck_assert_signal(SIGABRT,
+                     cstl_map_set_inline_keys(&m, 3, CSTL_MAP_KEY_INT));
+    ck_assert_signal(SIGABRT,
+                     cstl_map_set_inline_keys(&m, 0, CSTL_MAP_KEY_MEMCMP));
+    __cstl_map_init(&m, NULL, NULL, CSTL_MAP_BACKEND_BTREE);
+    ck_assert_signal(SIGABRT,
+                     cstl_map_set_inline_keys(&m, 8, CSTL_MAP_KEY_UINT));
+}
+END_TEST
+
 Suite * map_suite(void)
 {
     Suite * const s = suite_create("map");
@@ -384,6 +2859,18 @@ Suite * map_suite(void)
     tcase_add_test(tc, fill);
     tcase_add_test(tc, find);
     tcase_add_test(tc, erase);
+    tcase_add_test(tc, pool);
+    tcase_add_test(tc, allocator);
+    tcase_add_test(tc, btree);
+    tcase_add_test(tc, btree_random);
+    tcase_add_test(tc, foreach);
+    tcase_add_test(tc, range);
+    tcase_add_test(tc, ranked);
+    tcase_add_test(tc, build);
+    tcase_add_test(tc, hint);
+    tcase_add_test(tc, setops);
+    tcase_add_test(tc, setops_nomem);
+    tcase_add_test(tc, inline_keys);
 
     suite_add_tcase(s, tc);
 
@@ -36,18 +36,27 @@ struct cstl_shared_ptr_data
      * unique pointer.
      */
     cstl_unique_ptr_t up;
+    /*
+     * the allocator from which this structure was allocated.
+     * it can't be taken from the unique pointer because the
+     * unique pointer is reset before this structure is freed
+     */
+    const cstl_allocator_t * allocator;
 };
 
-void cstl_unique_ptr_alloc(cstl_unique_ptr_t * const up, const size_t sz,
-                           cstl_xtor_func_t * const clr, void * const priv)
+void __cstl_unique_ptr_alloc(cstl_unique_ptr_t * const up, const size_t sz,
+                             cstl_xtor_func_t * const clr, void * const priv,
+                             const cstl_allocator_t * const a)
 {
     cstl_unique_ptr_reset(up);
     if (sz > 0) {
-        void * const ptr = malloc(sz);
+        void * const ptr = cstl_allocator_alloc(a, sz);
         if (ptr != NULL) {
             cstl_guarded_ptr_set(&up->gp, ptr);
             up->clr.func = clr;
             up->clr.priv = priv;
+            up->mem.a = a;
+            up->mem.len = sz;
         }
     }
 }
@@ -58,33 +67,36 @@ void cstl_unique_ptr_reset(cstl_unique_ptr_t * const up)
     if (up->clr.func != NULL) {
         up->clr.func(ptr, up->clr.priv);
     }
-    free(ptr);
+    cstl_allocator_free(up->mem.a, ptr, up->mem.len);
     cstl_unique_ptr_init(up);
 }
 
-void cstl_shared_ptr_alloc(cstl_shared_ptr_t * const sp, const size_t sz,
-                           cstl_xtor_func_t * const clr)
+void __cstl_shared_ptr_alloc(cstl_shared_ptr_t * const sp, const size_t sz,
+                             cstl_xtor_func_t * const clr,
+                             const cstl_allocator_t * const a)
 {
     cstl_shared_ptr_reset(sp);
 
     if (sz > 0) {
         struct cstl_shared_ptr_data * data;
 
-        data = malloc(sizeof(*data));
+        data = cstl_allocator_alloc(a, sizeof(*data));
         if (data != NULL) {
             atomic_init(&data->ref.hard, 1);
             atomic_init(&data->ref.soft, 1);
             atomic_flag_clear(&data->ref.lock);
 
+            data->allocator = a;
+
             cstl_unique_ptr_init(&data->up);
-            cstl_unique_ptr_alloc(&data->up, sz, clr, NULL);
+            __cstl_unique_ptr_alloc(&data->up, sz, clr, NULL, a);
 
             if (cstl_unique_ptr_get(&data->up) != NULL) {
                 cstl_guarded_ptr_set(&sp->data, data);
                 data = NULL;
             }
 
-            free(data);
+            cstl_allocator_free(a, data, sizeof(*data));
         }
     }
 }
@@ -221,7 +233,7 @@ void cstl_weak_ptr_reset(cstl_weak_ptr_t * const wp)
         cstl_guarded_ptr_set(&wp->data, NULL);
 
         if (atomic_fetch_sub(&data->ref.soft, 1) == 1) {
-            free(data);
+            cstl_allocator_free(data->allocator, data, sizeof(*data));
         }
     }
 }
@@ -330,6 +342,57 @@ START_TEST(weak)
 }
 END_TEST
 
+START_TEST(allocator)
+{
+    DECLARE_CSTL_UNIQUE_PTR(up1);
+    DECLARE_CSTL_UNIQUE_PTR(up2);
+    DECLARE_CSTL_SHARED_PTR(sp1);
+    DECLARE_CSTL_SHARED_PTR(sp2);
+    DECLARE_CSTL_WEAK_PTR(wp);
+    struct ck_counting_allocator ca;
+    const cstl_allocator_t * a;
+    size_t len;
+    void * p;
+
+    ck_counting_allocator_init(&ca);
+
+    __cstl_unique_ptr_alloc(&up1, 64, NULL, NULL, &ca.a);
+    ck_assert_uint_eq(ca.bytes, 64);
+
+    /* the allocator follows the memory when swapped */
+    cstl_unique_ptr_swap(&up1, &up2);
+    cstl_unique_ptr_reset(&up1);
+    ck_assert_uint_eq(ca.bytes, 64);
+    cstl_unique_ptr_reset(&up2);
+    ck_assert_uint_eq(ca.bytes, 0);
+
+    /* released memory is freed by the caller, to the same allocator */
+    __cstl_unique_ptr_alloc(&up1, 32, NULL, NULL, &ca.a);
+    p = __cstl_unique_ptr_release(&up1, NULL, NULL, &a, &len);
+    ck_assert_ptr_null(cstl_unique_ptr_get(&up1));
+    ck_assert_ptr_eq(a, &ca.a);
+    ck_assert_uint_eq(len, 32);
+    cstl_allocator_free(a, p, len);
+    ck_assert_uint_eq(ca.bytes, 0);
+
+    __cstl_shared_ptr_alloc(&sp1, 128, NULL, &ca.a);
+    ck_assert_uint_gt(ca.bytes, 128);
+    cstl_shared_ptr_share(&sp1, &sp2);
+    cstl_weak_ptr_from(&wp, &sp2);
+
+    cstl_shared_ptr_reset(&sp1);
+    ck_assert_uint_gt(ca.bytes, 128);
+    cstl_shared_ptr_reset(&sp2);
+    /* the data is freed, but the weak pointer keeps the bookkeeping */
+    ck_assert_uint_gt(ca.bytes, 0);
+    ck_assert_uint_lt(ca.bytes, 128);
+
+    cstl_weak_ptr_reset(&wp);
+    ck_assert_uint_eq(ca.bytes, 0);
+    ck_assert_uint_eq(ca.calls, 8);
+}
+END_TEST
+
 Suite * memory_suite(void)
 {
     Suite * const s = suite_create("memory");
@@ -341,6 +404,7 @@ Suite * memory_suite(void)
     tcase_add_test(tc, unique);
     tcase_add_test(tc, shared);
     tcase_add_test(tc, weak);
+    tcase_add_test(tc, allocator);
     suite_add_tcase(s, tc);
 
     return s;
@@ -0,0 +1,472 @@
+/*!
+ * @file
+ */
+
+#include "cstl/mpmc.h"
+#include "cstl/allocator.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+ * @private
+ *
+ * each slot holds a sequence number followed by a record. the slot
+ * for position p is free to be written by the producer that claims p
+ * when its sequence number is p, and it holds the record for position
+ * p, ready to be read, when its number is p + 1. the consumer that
+ * reads it sets the number to p + capacity, making it free for the
+ * position that maps to the same slot on the next pass around the
+ * buffer. the producers' index and the consumers' are padded out to
+ * separate cache lines.
+ */
+struct cstl_mpmc_ring
+{
+    /* fixed at initialization; only read afterward */
+    union
+    {
+        struct
+        {
+            size_t mask, size, stride;
+        } s;
+        char pad[CSTL_CACHE_LINE];
+    } shr;
+
+    /* the next position to be claimed by a producer */
+    union
+    {
+        atomic_size_t pos;
+        char pad[CSTL_CACHE_LINE];
+    } enq;
+
+    /* the next position to be claimed by a consumer */
+    union
+    {
+        atomic_size_t pos;
+        char pad[CSTL_CACHE_LINE];
+    } deq;
+
+    unsigned char buf[];
+};
+
+/*! @private */
+static size_t cstl_mpmc_bytes(const size_t cap, const size_t stride)
+{
+    return sizeof(struct cstl_mpmc_ring) + cap * stride;
+}
+
+/*! @private */
+static inline atomic_size_t * cstl_mpmc_seq(
+    struct cstl_mpmc_ring * const r, const size_t pos)
+{
+    return (atomic_size_t *)&r->buf[(pos & r->shr.s.mask) * r->shr.s.stride];
+}
+
+/*! @private */
+static inline void * cstl_mpmc_rec(
+    struct cstl_mpmc_ring * const r, const size_t pos)
+{
+    return cstl_mpmc_seq(r, pos) + 1;
+}
+
+int cstl_mpmc_init(cstl_mpmc_t * const q, const size_t n, const size_t sz)
+{
+    struct cstl_mpmc_ring * r;
+    size_t cap, stride, i;
+
+    if (n == 0 || sz == 0) {
+        abort();
+    }
+
+    /*
+     * with a single slot, a full slot's sequence number would
+     * be the same as that of the slot free for the next pass
+     */
+    for (cap = 2; cap < n; cap <<= 1)
+        ;
+
+    /* keep the sequence number in each slot aligned */
+    stride = sizeof(atomic_size_t) + sz;
+    stride += sizeof(atomic_size_t) - 1;
+    stride -= stride % sizeof(atomic_size_t);
+
+    r = cstl_allocator_alloc(NULL, cstl_mpmc_bytes(cap, stride));
+    if (r == NULL) {
+        return -1;
+    }
+
+    r->shr.s.mask = cap - 1;
+    r->shr.s.size = sz;
+    r->shr.s.stride = stride;
+
+    atomic_init(&r->enq.pos, 0);
+    atomic_init(&r->deq.pos, 0);
+
+    for (i = 0; i < cap; i++) {
+        atomic_init(cstl_mpmc_seq(r, i), i);
+    }
+
+    q->r = r;
+
+    return 0;
+}
+
+size_t cstl_mpmc_capacity(const cstl_mpmc_t * const q)
+{
+    return q->r->shr.s.mask + 1;
+}
+
+size_t cstl_mpmc_size(const cstl_mpmc_t * const q)
+{
+    struct cstl_mpmc_ring * const r = q->r;
+    /*
+     * the loads are relaxed, so nothing orders the consumers'
+     * index behind the producers': the value read for the
+     * producers' index may be older than the one read for the
+     * consumers'. the difference would then wrap around, so the
+     * ring is reported as empty instead
+     */
+    const size_t deq =
+        atomic_load_explicit(&r->deq.pos, memory_order_relaxed);
+    const size_t enq =
+        atomic_load_explicit(&r->enq.pos, memory_order_relaxed);
+
+    return (enq > deq) ? enq - deq : 0;
+}
+
+size_t cstl_mpmc_push(cstl_mpmc_t * const q,
+                      const void * const e, const size_t n)
+{
+    struct cstl_mpmc_ring * const r = q->r;
+    const size_t sz = r->shr.s.size;
+    size_t pos, k, i;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    pos = atomic_load_explicit(&r->enq.pos, memory_order_relaxed);
+    for (;;) {
+        size_t seq = pos;
+
+        /*
+         * count the free slots beginning at pos. a free slot stays
+         * free until the position for which it is free is claimed,
+         * so if the index is still at pos, all of them can be
+         * claimed at once
+         */
+        for (k = 0; k < n; k++) {
+            seq = atomic_load_explicit(cstl_mpmc_seq(r, pos + k),
+                                       memory_order_acquire);
+            if (seq != pos + k) {
+                break;
+            }
+        }
+
+        if (k > 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &r->enq.pos, &pos, pos + k,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if ((intptr_t)(seq - pos) < 0) {
+            /* the slot still holds a record from the previous pass */
+            return 0;
+        } else {
+            /* another producer claimed the position */
+            pos = atomic_load_explicit(&r->enq.pos, memory_order_relaxed);
+        }
+    }
+
+    for (i = 0; i < k; i++) {
+        memcpy(cstl_mpmc_rec(r, pos + i),
+               (const unsigned char *)e + i * sz, sz);
+        atomic_store_explicit(cstl_mpmc_seq(r, pos + i), pos + i + 1,
+                              memory_order_release);
+    }
+
+    return k;
+}
+
+size_t cstl_mpmc_pop(cstl_mpmc_t * const q, void * const e, const size_t n)
+{
+    struct cstl_mpmc_ring * const r = q->r;
+    const size_t sz = r->shr.s.size;
+    size_t pos, k, i;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    pos = atomic_load_explicit(&r->deq.pos, memory_order_relaxed);
+    for (;;) {
+        size_t seq = pos + 1;
+
+        /* count the slots that are ready to be read, as above */
+        for (k = 0; k < n; k++) {
+            seq = atomic_load_explicit(cstl_mpmc_seq(r, pos + k),
+                                       memory_order_acquire);
+            if (seq != pos + k + 1) {
+                break;
+            }
+        }
+
+        if (k > 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &r->deq.pos, &pos, pos + k,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if ((intptr_t)(seq - (pos + 1)) < 0) {
+            /* the slot's record hasn't been written yet */
+            return 0;
+        } else {
+            /* another consumer claimed the position */
+            pos = atomic_load_explicit(&r->deq.pos, memory_order_relaxed);
+        }
+    }
+
+    for (i = 0; i < k; i++) {
+        memcpy((unsigned char *)e + i * sz, cstl_mpmc_rec(r, pos + i), sz);
+        atomic_store_explicit(cstl_mpmc_seq(r, pos + i),
+                              pos + i + r->shr.s.mask + 1,
+                              memory_order_release);
+    }
+
+    return k;
+}
+
+void cstl_mpmc_clear(cstl_mpmc_t * const q)
+{
+    cstl_allocator_free(NULL, q->r,
+                        cstl_mpmc_bytes(q->r->shr.s.mask + 1,
+                                        q->r->shr.s.stride));
+    q->r = NULL;
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+START_TEST(simple)
+{
+    cstl_mpmc_t q;
+    int e[16], i;
+
+    ck_assert_signal(SIGABRT, cstl_mpmc_init(&q, 0, sizeof(int)));
+    ck_assert_signal(SIGABRT, cstl_mpmc_init(&q, 5, 0));
+
+    ck_assert_int_eq(cstl_mpmc_init(&q, 1, sizeof(int)), 0);
+    ck_assert_uint_eq(cstl_mpmc_capacity(&q), 2);
+    cstl_mpmc_clear(&q);
+
+    ck_assert_int_eq(cstl_mpmc_init(&q, 5, sizeof(int)), 0);
+    ck_assert_uint_eq(cstl_mpmc_capacity(&q), 8);
+    ck_assert_uint_eq(cstl_mpmc_pop(&q, e, 16), 0);
+
+    for (i = 0; i < 16; i++) {
+        e[i] = i;
+    }
+
+    ck_assert_uint_eq(cstl_mpmc_push(&q, e, 0), 0);
+    ck_assert_uint_eq(cstl_mpmc_push(&q, e, 10), 8);
+    ck_assert_uint_eq(cstl_mpmc_size(&q), 8);
+    ck_assert_uint_eq(cstl_mpmc_push(&q, &e[8], 2), 0);
+
+    ck_assert_uint_eq(cstl_mpmc_pop(&q, e, 0), 0);
+    ck_assert_uint_eq(cstl_mpmc_pop(&q, e, 3), 3);
+    ck_assert_int_eq(e[0], 0);
+    ck_assert_int_eq(e[2], 2);
+
+    e[0] = 8; e[1] = 9; e[2] = 10;
+    ck_assert_uint_eq(cstl_mpmc_push(&q, e, 3), 3);
+    ck_assert_uint_eq(cstl_mpmc_size(&q), 8);
+
+    ck_assert_uint_eq(cstl_mpmc_pop(&q, e, 16), 8);
+    for (i = 0; i < 8; i++) {
+        ck_assert_int_eq(e[i], i + 3);
+    }
+    ck_assert_uint_eq(cstl_mpmc_size(&q), 0);
+    ck_assert_uint_eq(cstl_mpmc_pop(&q, e, 1), 0);
+
+    cstl_mpmc_clear(&q);
+}
+END_TEST
+
+static void * mpmc_fail_alloc(const size_t sz, void * const priv)
+{
+    (void)sz; (void)priv;
+    return NULL;
+}
+
+START_TEST(nomem)
+{
+    const cstl_allocator_t * const def = cstl_allocator_default();
+    cstl_allocator_t a = *def;
+    cstl_mpmc_t q;
+
+    a.alloc = mpmc_fail_alloc;
+    cstl_allocator_set_default(&a);
+    ck_assert_int_eq(cstl_mpmc_init(&q, 5, sizeof(int)), -1);
+    cstl_allocator_set_default(def);
+}
+END_TEST
+
+#define MPMC_THREADS            4
+#define MPMC_THREAD_COUNT       50000
+
+/* a record identifies its producer and its place in that producer's order */
+struct mpmc_rec
+{
+    unsigned int id;
+    unsigned long seq;
+};
+
+/* whether each producer's records have been received */
+static atomic_uchar mpmc_seen[MPMC_THREADS][MPMC_THREAD_COUNT];
+
+struct mpmc_thread
+{
+    cstl_mpmc_t * q;
+    atomic_ulong * popped;
+    unsigned int id;
+
+    /* the number of records received from each producer */
+    unsigned long count[MPMC_THREADS];
+};
+
+static void * mpmc_producer(void * const arg)
+{
+    struct mpmc_thread * const t = arg;
+    unsigned int seed = t->id + 1;
+    struct mpmc_rec e[17];
+    unsigned long i = 0;
+
+    while (i < MPMC_THREAD_COUNT) {
+        size_t n = rand_r(&seed) % 17 + 1, j;
+
+        if (n > MPMC_THREAD_COUNT - i) {
+            n = MPMC_THREAD_COUNT - i;
+        }
+        for (j = 0; j < n; j++) {
+            e[j].id = t->id;
+            e[j].seq = i + j;
+        }
+
+        n = cstl_mpmc_push(t->q, e, n);
+        if (n == 0) {
+            sched_yield();
+        }
+        i += n;
+    }
+
+    return NULL;
+}
+
+/*
+ * a consumer's pops are claimed in order, so the records
+ * that it receives from each producer are in that producer's
+ * order, though others may be missing from the sequence
+ */
+static void * mpmc_consumer(void * const arg)
+{
+    struct mpmc_thread * const t = arg;
+    unsigned int seed = t->id + 100;
+    long last[MPMC_THREADS];
+    struct mpmc_rec e[13];
+    unsigned int i;
+
+    for (i = 0; i < MPMC_THREADS; i++) {
+        last[i] = -1;
+        t->count[i] = 0;
+    }
+
+    while (atomic_load(t->popped) < MPMC_THREADS * MPMC_THREAD_COUNT) {
+        const size_t n = cstl_mpmc_pop(t->q, e, rand_r(&seed) % 13 + 1);
+        size_t j;
+
+        if (n == 0) {
+            sched_yield();
+        }
+        for (j = 0; j < n; j++) {
+            ck_assert_int_gt((long)e[j].seq, last[e[j].id]);
+            ck_assert_uint_eq(
+                atomic_fetch_add(&mpmc_seen[e[j].id][e[j].seq], 1), 0);
+            last[e[j].id] = e[j].seq;
+            t->count[e[j].id]++;
+        }
+        atomic_fetch_add(t->popped, n);
+    }
+
+    return NULL;
+}
+
+START_TEST(threads)
+{
+    struct mpmc_thread p[MPMC_THREADS], c[MPMC_THREADS];
+    pthread_t pth[MPMC_THREADS], cth[MPMC_THREADS];
+    atomic_ulong popped;
+    cstl_mpmc_t q;
+    unsigned int i, j;
+
+    ck_assert_int_eq(cstl_mpmc_init(&q, 64, sizeof(struct mpmc_rec)), 0);
+    atomic_init(&popped, 0);
+    for (i = 0; i < MPMC_THREADS; i++) {
+        for (j = 0; j < MPMC_THREAD_COUNT; j++) {
+            atomic_init(&mpmc_seen[i][j], 0);
+        }
+    }
+
+    for (i = 0; i < MPMC_THREADS; i++) {
+        p[i].q = c[i].q = &q;
+        p[i].popped = c[i].popped = &popped;
+        p[i].id = c[i].id = i;
+
+        ck_assert_int_eq(
+            pthread_create(&cth[i], NULL, mpmc_consumer, &c[i]), 0);
+        ck_assert_int_eq(
+            pthread_create(&pth[i], NULL, mpmc_producer, &p[i]), 0);
+    }
+
+    for (i = 0; i < MPMC_THREADS; i++) {
+        pthread_join(pth[i], NULL);
+        pthread_join(cth[i], NULL);
+    }
+
+    /* every record was received, and none were received twice */
+    for (i = 0; i < MPMC_THREADS; i++) {
+        unsigned long n = 0;
+
+        for (j = 0; j < MPMC_THREADS; j++) {
+            n += c[j].count[i];
+        }
+        ck_assert_uint_eq(n, MPMC_THREAD_COUNT);
+    }
+    ck_assert_uint_eq(cstl_mpmc_size(&q), 0);
+
+    cstl_mpmc_clear(&q);
+}
+END_TEST
+
+Suite * mpmc_suite(void)
+{
+    Suite * const s = suite_create("mpmc");
+
+    TCase * tc;
+
+    tc = tcase_create("mpmc");
+    tcase_add_test(tc, simple);
+    tcase_add_test(tc, nomem);
+    tcase_add_test(tc, threads);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
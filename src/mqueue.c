@@ -0,0 +1,434 @@
+/*!
+ * @file
+ */
+
+#include "cstl/mqueue.h"
+#include "cstl/allocator.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*!
+ * @private
+ *
+ * each heap, with its lock, is padded to a cache line and the array
+ * of heaps is aligned to a line boundary, so that threads using
+ * neighboring heaps don't contend for the same line
+ */
+struct cstl_mqueue_heap
+{
+    union
+    {
+        struct
+        {
+            atomic_flag lock;
+            /*
+             * the number of objects in the heap, readable without
+             * the lock so that empty heaps can be passed over
+             */
+            atomic_size_t size;
+            struct cstl_heap h;
+        } q;
+        char pad[CSTL_CACHE_LINE];
+    } u;
+};
+
+/*!
+ * @private
+ *
+ * choose a heap at random. the random state is advanced with
+ * the constants of the classic rand() implementation, and the
+ * upper bits, which are the most random, select the heap
+ */
+static inline struct cstl_mqueue_heap * cstl_mqueue_rand(
+    const cstl_mqueue_t * const mq, unsigned int * const r)
+{
+    *r = *r * 1103515245 + 12345;
+    return &mq->h[((*r >> 16) & 0x7fff) % mq->n];
+}
+
+/*! @private */
+static inline bool cstl_mqueue_trylock(struct cstl_mqueue_heap * const h)
+{
+    return !atomic_flag_test_and_set_explicit(&h->u.q.lock,
+                                              memory_order_acquire);
+}
+
+/*! @private */
+static inline void cstl_mqueue_unlock(struct cstl_mqueue_heap * const h)
+{
+    atomic_flag_clear_explicit(&h->u.q.lock, memory_order_release);
+}
+
+/*! @private */
+static inline size_t cstl_mqueue_heap_size(
+    const struct cstl_mqueue_heap * const h)
+{
+    return atomic_load_explicit(&h->u.q.size, memory_order_relaxed);
+}
+
+/*! @private */
+static size_t cstl_mqueue_bytes(const unsigned int n)
+{
+    return n * sizeof(struct cstl_mqueue_heap) + CSTL_CACHE_LINE - 1;
+}
+
+int cstl_mqueue_init(cstl_mqueue_t * const mq, const unsigned int n,
+                     cstl_compare_func_t * const cmp, void * const priv,
+                     const size_t off)
+{
+    unsigned int i;
+
+    if (n == 0) {
+        abort();
+    }
+
+    /*
+     * the allocator doesn't guarantee alignment to a cache line,
+     * so allocate enough extra to be able to align the array
+     */
+    mq->mem = cstl_allocator_alloc(NULL, cstl_mqueue_bytes(n));
+    if (mq->mem == NULL) {
+        return -1;
+    }
+    mq->h = (void *)(((uintptr_t)mq->mem + CSTL_CACHE_LINE - 1)
+                     & ~(uintptr_t)(CSTL_CACHE_LINE - 1));
+    mq->n = n;
+
+    for (i = 0; i < n; i++) {
+        struct cstl_mqueue_heap * const h = &mq->h[i];
+
+        atomic_flag_clear(&h->u.q.lock);
+        atomic_init(&h->u.q.size, 0);
+        cstl_heap_init(&h->u.q.h, cmp, priv, off);
+    }
+
+    return 0;
+}
+
+size_t cstl_mqueue_size(const cstl_mqueue_t * const mq)
+{
+    size_t size = 0;
+    unsigned int i;
+
+    for (i = 0; i < mq->n; i++) {
+        size += cstl_mqueue_heap_size(&mq->h[i]);
+    }
+
+    return size;
+}
+
+void cstl_mqueue_push(cstl_mqueue_t * const mq,
+                      void * const e, unsigned int * const r)
+{
+    struct cstl_mqueue_heap * h;
+
+    /* rather than wait for a busy heap, try another */
+    do {
+        h = cstl_mqueue_rand(mq, r);
+    } while (!cstl_mqueue_trylock(h));
+
+    cstl_heap_push(&h->u.q.h, e);
+    atomic_store_explicit(&h->u.q.size,
+                          cstl_heap_size(&h->u.q.h), memory_order_relaxed);
+
+    cstl_mqueue_unlock(h);
+}
+
+void * cstl_mqueue_pop(cstl_mqueue_t * const mq, unsigned int * const r)
+{
+    for (;;) {
+        struct cstl_mqueue_heap * a = cstl_mqueue_rand(mq, r);
+        struct cstl_mqueue_heap * b = cstl_mqueue_rand(mq, r);
+        const void * ta, * tb;
+        void * e;
+
+        if (cstl_mqueue_heap_size(a) == 0 && cstl_mqueue_heap_size(b) == 0) {
+            /*
+             * both heaps are empty. if they all are,
+             * give up; otherwise, choose again
+             */
+            if (cstl_mqueue_size(mq) == 0) {
+                return NULL;
+            }
+            continue;
+        }
+
+        /*
+         * lock the heaps in a consistent order. if either lock
+         * is busy, start over with another pair
+         */
+        if (a > b) {
+            struct cstl_mqueue_heap * const t = a;
+            a = b;
+            b = t;
+        }
+        if (!cstl_mqueue_trylock(a)) {
+            continue;
+        }
+        if (b != a && !cstl_mqueue_trylock(b)) {
+            cstl_mqueue_unlock(a);
+            continue;
+        }
+
+        ta = cstl_heap_get(&a->u.q.h);
+        tb = cstl_heap_get(&b->u.q.h);
+        if (ta == NULL
+            || (tb != NULL
+                && a->u.q.h.bt.cmp.func(tb, ta, a->u.q.h.bt.cmp.priv) > 0)) {
+            /* b's top is the higher valued of the two (or the only one) */
+            struct cstl_mqueue_heap * const t = a;
+            a = b;
+            b = t;
+        }
+
+        e = cstl_heap_pop(&a->u.q.h);
+        if (e != NULL) {
+            atomic_store_explicit(&a->u.q.size,
+                                  cstl_heap_size(&a->u.q.h),
+                                  memory_order_relaxed);
+        }
+
+        if (b != a) {
+            cstl_mqueue_unlock(b);
+        }
+        cstl_mqueue_unlock(a);
+
+        if (e != NULL) {
+            return e;
+        }
+    }
+}
+
+void cstl_mqueue_clear(cstl_mqueue_t * const mq,
+                       cstl_xtor_func_t * const clr)
+{
+    unsigned int i;
+
+    for (i = 0; i < mq->n; i++) {
+        cstl_heap_clear(&mq->h[i].u.q.h, clr);
+    }
+
+    cstl_allocator_free(NULL, mq->mem, cstl_mqueue_bytes(mq->n));
+    mq->mem = NULL;
+    mq->h = NULL;
+    mq->n = 0;
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include <pthread.h>
+
+struct job
+{
+    int prio;
+    struct cstl_heap_node hn;
+};
+
+static int job_cmp(const void * const a, const void * const b,
+                   void * const p)
+{
+    (void)p;
+    return ((const struct job *)a)->prio - ((const struct job *)b)->prio;
+}
+
+static void job_clr(void * const e, void * const p)
+{
+    (void)p;
+    ((struct job *)e)->prio = -1;
+}
+
+START_TEST(single)
+{
+    static const unsigned int n = 1000;
+
+    struct job * const j = malloc(n * sizeof(*j));
+    cstl_mqueue_t mq;
+    unsigned int i, r = 1;
+    int prev;
+
+    /* with a single heap, the order is exact */
+    ck_assert_int_eq(
+        cstl_mqueue_init(&mq, 1, job_cmp, NULL, offsetof(struct job, hn)),
+        0);
+    ck_assert_ptr_null(cstl_mqueue_pop(&mq, &r));
+
+    for (i = 0; i < n; i++) {
+        j[i].prio = rand() % n;
+        cstl_mqueue_push(&mq, &j[i], &r);
+    }
+    ck_assert_uint_eq(cstl_mqueue_size(&mq), n);
+
+    prev = n;
+    for (i = 0; i < n; i++) {
+        const struct job * const e = cstl_mqueue_pop(&mq, &r);
+
+        ck_assert_int_le(e->prio, prev);
+        prev = e->prio;
+    }
+    ck_assert_ptr_null(cstl_mqueue_pop(&mq, &r));
+    ck_assert_uint_eq(cstl_mqueue_size(&mq), 0);
+
+    cstl_mqueue_clear(&mq, job_clr);
+    free(j);
+}
+END_TEST
+
+START_TEST(relaxed)
+{
+    static const unsigned int n = 10000;
+
+    struct job * const j = malloc(n * sizeof(*j));
+    cstl_mqueue_t mq;
+    unsigned int i, r = 1, inversions;
+
+    ck_assert_signal(SIGABRT, cstl_mqueue_init(&mq, 0, job_cmp, NULL, 0));
+
+    ck_assert_int_eq(
+        cstl_mqueue_init(&mq, 8, job_cmp, NULL, offsetof(struct job, hn)),
+        0);
+    /* each heap occupies a cache line of its own */
+    ck_assert_uint_eq(sizeof(*mq.h), CSTL_CACHE_LINE);
+    ck_assert_uint_eq((uintptr_t)mq.h % CSTL_CACHE_LINE, 0);
+
+    for (i = 0; i < n; i++) {
+        j[i].prio = i;
+        cstl_mqueue_push(&mq, &j[i], &r);
+    }
+
+    /*
+     * the objects come out roughly in order. count the number
+     * that come out far (more than a few times the number of
+     * heaps) from where they would have been in a true heap
+     */
+    inversions = 0;
+    for (i = 0; i < n; i++) {
+        const struct job * const e = cstl_mqueue_pop(&mq, &r);
+
+        ck_assert_ptr_nonnull(e);
+        if ((int)(n - 1 - i) - e->prio > 8 * 8) {
+            inversions++;
+        }
+    }
+    ck_assert_uint_lt(inversions, n / 100);
+    ck_assert_ptr_null(cstl_mqueue_pop(&mq, &r));
+
+    /* objects left in the queue are passed to the clear function */
+    for (i = 0; i < 100; i++) {
+        cstl_mqueue_push(&mq, &j[i], &r);
+    }
+    cstl_mqueue_clear(&mq, job_clr);
+    for (i = 0; i < 100; i++) {
+        ck_assert_int_eq(j[i].prio, -1);
+    }
+
+    free(j);
+}
+END_TEST
+
+struct mqueue_thread
+{
+    cstl_mqueue_t * mq;
+    struct job * j;
+    unsigned int n;
+    unsigned int r;
+
+    unsigned long popped;
+};
+
+/*
+ * each thread pushes its own jobs, popping one
+ * for every two that it pushes, and then drains
+ * whatever it can find once it's done pushing
+ */
+static void * mqueue_thread(void * const arg)
+{
+    struct mqueue_thread * const t = arg;
+    unsigned int i;
+    struct job * e;
+
+    for (i = 0; i < t->n; i++) {
+        cstl_mqueue_push(t->mq, &t->j[i], &t->r);
+        if (i % 2 == 1 && (e = cstl_mqueue_pop(t->mq, &t->r)) != NULL) {
+            e->prio = -e->prio - 1;
+            t->popped++;
+        }
+    }
+
+    while ((e = cstl_mqueue_pop(t->mq, &t->r)) != NULL) {
+        e->prio = -e->prio - 1;
+        t->popped++;
+    }
+
+    return NULL;
+}
+
+START_TEST(threads)
+{
+    static const unsigned int nthreads = 4, n = 20000;
+
+    struct mqueue_thread t[4];
+    pthread_t th[4];
+    struct job * const j = malloc(nthreads * n * sizeof(*j));
+    cstl_mqueue_t mq;
+    unsigned long popped;
+    unsigned int i;
+
+    ck_assert_int_eq(
+        cstl_mqueue_init(&mq, 2 * nthreads,
+                         job_cmp, NULL, offsetof(struct job, hn)),
+        0);
+
+    for (i = 0; i < nthreads * n; i++) {
+        j[i].prio = rand() % 1000;
+    }
+
+    for (i = 0; i < nthreads; i++) {
+        t[i].mq = &mq;
+        t[i].j = &j[i * n];
+        t[i].n = n;
+        t[i].r = i + 1;
+        t[i].popped = 0;
+
+        ck_assert_int_eq(
+            pthread_create(&th[i], NULL, mqueue_thread, &t[i]), 0);
+    }
+
+    popped = 0;
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(th[i], NULL);
+        popped += t[i].popped;
+    }
+
+    /* every job was popped exactly once */
+    ck_assert_uint_eq(popped, nthreads * n);
+    ck_assert_uint_eq(cstl_mqueue_size(&mq), 0);
+    for (i = 0; i < nthreads * n; i++) {
+        ck_assert_int_lt(j[i].prio, 0);
+    }
+
+    cstl_mqueue_clear(&mq, job_clr);
+    free(j);
+}
+END_TEST
+
+Suite * mqueue_suite(void)
+{
+    Suite * const s = suite_create("mqueue");
+
+    TCase * tc;
+
+    tc = tcase_create("mqueue");
+    tcase_add_test(tc, single);
+    tcase_add_test(tc, relaxed);
+    tcase_add_test(tc, threads);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
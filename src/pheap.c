@@ -0,0 +1,463 @@
+/*!
+ * @file
+ */
+
+#include "cstl/pheap.h"
+
+#include <stdlib.h>
+
+/*
+ * each node's left pointer points to its first child and its right
+ * pointer to its next sibling. the parent pointer is the node's parent
+ * in the binary tree formed by those pointers, i.e. the node's previous
+ * sibling or, if the node is the first child, its parent in the heap.
+ * the root never has siblings, and its parent pointer is NULL
+ */
+
+/*! @private */
+static inline struct cstl_bintree_node * cstl_pheap_node(
+    const struct cstl_pheap * const h, void * const e)
+{
+    return (void *)((uintptr_t)e + h->bt.off);
+}
+
+/*!
+ * @private
+ *
+ * combine two heaps, neither of which may have siblings, by making
+ * the lesser root the first child of the greater one. the greater
+ * root is returned; its parent pointer is left for the caller to set
+ */
+static struct cstl_bintree_node * cstl_pheap_link(
+    struct cstl_pheap * const h,
+    struct cstl_bintree_node * a, struct cstl_bintree_node * b)
+{
+    if (__cstl_bintree_cmp(&h->bt, b, a) > 0) {
+        struct cstl_bintree_node * const t = a;
+        a = b;
+        b = t;
+    }
+
+    b->r = a->l;
+    if (b->r != NULL) {
+        __cstl_bintree_set_parent(b->r, b);
+    }
+    a->l = b;
+    __cstl_bintree_set_parent(b, a);
+
+    return a;
+}
+
+/*!
+ * @private
+ *
+ * combine a list of siblings into a single heap and return its root.
+ *
+ * the siblings are linked in pairs from left to right, and the
+ * resulting heaps are then linked into one from right to left. it's
+ * this two-pass combination that gives the pop operation its
+ * amortized O(log n) bound
+ */
+static struct cstl_bintree_node * cstl_pheap_merge_pairs(
+    struct cstl_pheap * const h, struct cstl_bintree_node * a)
+{
+    struct cstl_bintree_node * l = NULL;
+
+    /*
+     * first pass: link pairs of siblings, pushing the
+     * result of each onto a list that is threaded through
+     * the right pointers, in the reverse order
+     */
+    while (a != NULL) {
+        struct cstl_bintree_node * const b = a->r;
+        struct cstl_bintree_node * n = NULL;
+
+        a->r = NULL;
+        if (b != NULL) {
+            n = b->r;
+            b->r = NULL;
+            a = cstl_pheap_link(h, a, b);
+        }
+
+        a->r = l;
+        l = a;
+        a = n;
+    }
+
+    /*
+     * second pass: link each heap in the list into
+     * the one formed by those to its right
+     */
+    a = l;
+    l = a->r;
+    a->r = NULL;
+    while (l != NULL) {
+        struct cstl_bintree_node * const n = l->r;
+
+        l->r = NULL;
+        a = cstl_pheap_link(h, a, l);
+        l = n;
+    }
+
+    __cstl_bintree_set_parent(a, NULL);
+    return a;
+}
+
+/*!
+ * @private
+ *
+ * make the given heap, whose root has no siblings, part of the heap
+ */
+static void cstl_pheap_meld_root(struct cstl_pheap * const h,
+                                 struct cstl_bintree_node * const n)
+{
+    if (h->bt.root == NULL) {
+        h->bt.root = n;
+    } else {
+        h->bt.root = cstl_pheap_link(h, h->bt.root, n);
+    }
+    __cstl_bintree_set_parent(h->bt.root, NULL);
+}
+
+void cstl_pheap_push(struct cstl_pheap * const h, void * const e)
+{
+    struct cstl_bintree_node * const n = cstl_pheap_node(h, e);
+
+    n->p = (uintptr_t)NULL;
+    n->l = NULL;
+    n->r = NULL;
+
+    cstl_pheap_meld_root(h, n);
+    h->bt.size++;
+}
+
+const void * cstl_pheap_get(const struct cstl_pheap * const h)
+{
+    if (h->bt.root != NULL) {
+        return (void *)((uintptr_t)h->bt.root - h->bt.off);
+    }
+
+    return NULL;
+}
+
+void cstl_pheap_erase(struct cstl_pheap * const h, void * const e)
+{
+    struct cstl_bintree_node * const n = cstl_pheap_node(h, e);
+    struct cstl_bintree_node * const c = n->l;
+
+    if (n == h->bt.root) {
+        h->bt.root = NULL;
+    } else {
+        /*
+         * unlink the node from its siblings, or from
+         * its parent if the node is the first child
+         */
+        struct cstl_bintree_node * const p = __cstl_bintree_parent(n);
+
+        if (p->l == n) {
+            p->l = n->r;
+        } else {
+            p->r = n->r;
+        }
+        if (n->r != NULL) {
+            __cstl_bintree_set_parent(n->r, p);
+        }
+    }
+
+    /*
+     * the node's children form a heap of their own,
+     * which is then merged back into the remaining heap
+     */
+    if (c != NULL) {
+        cstl_pheap_meld_root(h, cstl_pheap_merge_pairs(h, c));
+    }
+
+    h->bt.size--;
+}
+
+void * cstl_pheap_pop(struct cstl_pheap * const h)
+{
+    void * const res = (void *)cstl_pheap_get(h);
+
+    if (res != NULL) {
+        cstl_pheap_erase(h, res);
+    }
+
+    return res;
+}
+
+void cstl_pheap_update(struct cstl_pheap * const h, void * const e)
+{
+    cstl_pheap_erase(h, e);
+    cstl_pheap_push(h, e);
+}
+
+void cstl_pheap_meld(struct cstl_pheap * const h, struct cstl_pheap * const o)
+{
+    if (h->bt.off != o->bt.off || h->bt.cmp.func != o->bt.cmp.func) {
+        abort();
+    }
+
+    if (o->bt.root != NULL) {
+        cstl_pheap_meld_root(h, o->bt.root);
+        h->bt.size += o->bt.size;
+
+        o->bt.root = NULL;
+        o->bt.size = 0;
+    }
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include <limits.h>
+
+struct integer
+{
+    int v;
+    struct cstl_pheap_node hn;
+};
+
+static int cmp_integer(const void * const a, const void * const b,
+                       void * const p)
+{
+    (void)p;
+    return ((struct integer *)a)->v - ((struct integer *)b)->v;
+}
+
+/*
+ * check that no child is greater than its parent and that
+ * the links back through the parent pointers are consistent.
+ * returns the number of nodes in the heap rooted at n
+ */
+static size_t __cstl_pheap_verify(const struct cstl_pheap * const h,
+                                  const struct cstl_bintree_node * const n)
+{
+    const struct cstl_bintree_node * c, * p;
+    size_t sz = 1;
+
+    for (p = n, c = n->l; c != NULL; p = c, c = c->r) {
+        ck_assert_ptr_eq(__cstl_bintree_parent(c), p);
+        ck_assert_int_le(__cstl_bintree_cmp(&h->bt, c, n), 0);
+
+        sz += __cstl_pheap_verify(h, c);
+    }
+
+    return sz;
+}
+
+static void cstl_pheap_verify(const struct cstl_pheap * const h)
+{
+    if (h->bt.root == NULL) {
+        ck_assert_uint_eq(cstl_pheap_size(h), 0);
+    } else {
+        ck_assert_ptr_null(__cstl_bintree_parent(h->bt.root));
+        ck_assert_ptr_null(h->bt.root->r);
+        ck_assert_uint_eq(__cstl_pheap_verify(h, h->bt.root),
+                          cstl_pheap_size(h));
+    }
+}
+
+static void __test__cstl_pheap_fill(struct cstl_pheap * const h,
+                                    struct integer * const in,
+                                    const size_t n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        in[i].v = rand() % n;
+
+        cstl_pheap_push(h, &in[i]);
+        ck_assert_uint_eq(i + 1, cstl_pheap_size(h));
+    }
+}
+
+static void __test__cstl_pheap_drain(struct cstl_pheap * const h)
+{
+    int prev = INT_MAX;
+    size_t sz;
+
+    while ((sz = cstl_pheap_size(h)) > 0) {
+        const struct integer * const in = cstl_pheap_pop(h);
+
+        ck_assert_int_le(in->v, prev);
+        prev = in->v;
+
+        ck_assert_uint_eq(sz - 1, cstl_pheap_size(h));
+        cstl_pheap_verify(h);
+    }
+
+    ck_assert_ptr_null(h->bt.root);
+    ck_assert_ptr_null(cstl_pheap_get(h));
+    ck_assert_ptr_null(cstl_pheap_pop(h));
+}
+
+START_TEST(fill)
+{
+    static const size_t n = 500;
+
+    DECLARE_CSTL_PHEAP(h, struct integer, hn, cmp_integer, NULL);
+    struct integer in[500];
+
+    __test__cstl_pheap_fill(&h, in, n);
+    cstl_pheap_verify(&h);
+    __test__cstl_pheap_drain(&h);
+}
+END_TEST
+
+START_TEST(meld)
+{
+    static const size_t n = 300;
+
+    DECLARE_CSTL_PHEAP(a, struct integer, hn, cmp_integer, NULL);
+    DECLARE_CSTL_PHEAP(b, struct integer, hn, cmp_integer, NULL);
+    struct integer x[300], y[300];
+    struct cstl_pheap c;
+
+    /* melding an empty heap changes nothing */
+    cstl_pheap_meld(&a, &b);
+    ck_assert_uint_eq(cstl_pheap_size(&a), 0);
+
+    __test__cstl_pheap_fill(&b, x, n);
+    cstl_pheap_meld(&a, &b);
+    ck_assert_uint_eq(cstl_pheap_size(&a), n);
+    ck_assert_uint_eq(cstl_pheap_size(&b), 0);
+    ck_assert_ptr_null(cstl_pheap_get(&b));
+    cstl_pheap_verify(&a);
+
+    /* pop some, so that the heap isn't just a list of the roots */
+    ck_assert_ptr_nonnull(cstl_pheap_pop(&a));
+    ck_assert_ptr_nonnull(cstl_pheap_pop(&a));
+
+    __test__cstl_pheap_fill(&b, y, n);
+    ck_assert_ptr_nonnull(cstl_pheap_pop(&b));
+    cstl_pheap_meld(&a, &b);
+    ck_assert_uint_eq(cstl_pheap_size(&a), 2 * n - 3);
+    cstl_pheap_verify(&a);
+
+    /* heaps of different objects can't be melded */
+    cstl_pheap_init(&c, cmp_integer, NULL, 0);
+    ck_assert_signal(SIGABRT, cstl_pheap_meld(&a, &c));
+    cstl_pheap_init(&c, NULL, NULL, offsetof(struct integer, hn));
+    ck_assert_signal(SIGABRT, cstl_pheap_meld(&a, &c));
+
+    __test__cstl_pheap_drain(&a);
+}
+END_TEST
+
+START_TEST(erase)
+{
+    static const size_t n = 300;
+
+    DECLARE_CSTL_PHEAP(h, struct integer, hn, cmp_integer, NULL);
+    struct integer in[300];
+    bool present[300];
+    unsigned int i;
+
+    __test__cstl_pheap_fill(&h, in, n);
+    for (i = 0; i < n; i++) {
+        present[i] = true;
+    }
+
+    /* shape the heap by removing the top a few times */
+    for (i = 0; i < 10; i++) {
+        const struct integer * const e = cstl_pheap_pop(&h);
+        present[e - in] = false;
+    }
+    cstl_pheap_verify(&h);
+
+    for (i = 0; i < n / 2; i++) {
+        unsigned int j;
+
+        do {
+            j = rand() % n;
+        } while (!present[j]);
+
+        cstl_pheap_erase(&h, &in[j]);
+        present[j] = false;
+
+        ck_assert_uint_eq(cstl_pheap_size(&h), n - 10 - i - 1);
+        cstl_pheap_verify(&h);
+    }
+
+    __test__cstl_pheap_drain(&h);
+}
+END_TEST
+
+START_TEST(update)
+{
+    static const size_t n = 300;
+
+    DECLARE_CSTL_PHEAP(h, struct integer, hn, cmp_integer, NULL);
+    struct integer in[300];
+    unsigned int i;
+
+    __test__cstl_pheap_fill(&h, in, n);
+
+    for (i = 0; i < 4 * n; i++) {
+        struct integer * e = &in[rand() % n];
+
+        /* raise or lower the priority of a random element */
+        e->v += rand() % n - n / 2;
+        cstl_pheap_update(&h, e);
+        cstl_pheap_verify(&h);
+
+        /* and of the top element */
+        e = (struct integer *)cstl_pheap_get(&h);
+        e->v -= rand() % n;
+        cstl_pheap_update(&h, e);
+        cstl_pheap_verify(&h);
+    }
+
+    ck_assert_uint_eq(cstl_pheap_size(&h), n);
+    __test__cstl_pheap_drain(&h);
+}
+END_TEST
+
+static size_t __test__cstl_pheap_clear_count;
+
+static void __test__cstl_pheap_clear(void * const e, void * const p)
+{
+    (void)e;
+    (void)p;
+    __test__cstl_pheap_clear_count++;
+}
+
+START_TEST(clear)
+{
+    static const size_t n = 100;
+
+    DECLARE_CSTL_PHEAP(h, struct integer, hn, cmp_integer, NULL);
+    struct integer in[100];
+
+    __test__cstl_pheap_fill(&h, in, n);
+    ck_assert_ptr_nonnull(cstl_pheap_pop(&h));
+
+    __test__cstl_pheap_clear_count = 0;
+    cstl_pheap_clear(&h, __test__cstl_pheap_clear);
+    ck_assert_uint_eq(__test__cstl_pheap_clear_count, n - 1);
+    ck_assert_uint_eq(cstl_pheap_size(&h), 0);
+    ck_assert_ptr_null(cstl_pheap_get(&h));
+}
+END_TEST
+
+Suite * pheap_suite(void)
+{
+    Suite * const s = suite_create("pheap");
+
+    TCase * tc;
+
+    tc = tcase_create("pheap");
+    tcase_add_test(tc, fill);
+    tcase_add_test(tc, meld);
+    tcase_add_test(tc, erase);
+    tcase_add_test(tc, update);
+    tcase_add_test(tc, clear);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
@@ -0,0 +1,810 @@
+/*!
+ * @file
+ */
+
+#include "cstl/pmap.h"
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <limits.h>
+
+/*
+ * the tree is a left-leaning red-black tree (Sedgewick). a red node
+ * is always the left child of its parent, which means that insertion
+ * and removal can be expressed as a walk down the tree followed by a
+ * series of local fixes on the way back up. that suits path copying:
+ * there are no parent pointers to maintain, and every node that is
+ * modified is either on the path or a child of a node on the path.
+ */
+struct cstl_pmap_node
+{
+    cstl_pmap_elem_t e;
+    struct cstl_pmap_node * l, * r;
+
+    /*
+     * the number of references to this node from other nodes
+     * and from the roots of the various versions of the map
+     */
+    atomic_size_t refs;
+    bool red;
+};
+
+/*
+ * an upper bound on the height of the tree. the height of a
+ * red-black tree is no more than twice the base-2 log of the
+ * number of nodes in it
+ */
+#define CSTL_PMAP_MAX_HEIGHT    (2 * sizeof(size_t) * CHAR_BIT)
+
+/*!
+ * @private
+ *
+ * the number of spare nodes needed to be sure that an update to a
+ * map of the given size doesn't need to allocate. in the worst case,
+ * an update copies the node at each level of the path, along with up
+ * to four other nodes around it, plus the node being inserted
+ */
+static size_t cstl_pmap_spare_needed(size_t n)
+{
+    size_t h;
+
+    for (h = 1; n > 0; n /= 2) {
+        h++;
+    }
+
+    return 6 * (2 * h) + 1;
+}
+
+/*!
+ * @private
+ *
+ * make sure that the map has enough spare nodes for an update
+ */
+static int cstl_pmap_reserve(cstl_pmap_t * const pm)
+{
+    const size_t need = cstl_pmap_spare_needed(pm->size + 1);
+
+    while (pm->spare.count < need) {
+        struct cstl_pmap_node * const n =
+            cstl_allocator_alloc(pm->allocator, sizeof(*n));
+
+        if (n == NULL) {
+            return -1;
+        }
+
+        n->l = pm->spare.head;
+        pm->spare.head = n;
+        pm->spare.count++;
+    }
+
+    return 0;
+}
+
+/*! @private */
+static struct cstl_pmap_node * cstl_pmap_node_alloc(cstl_pmap_t * const pm)
+{
+    struct cstl_pmap_node * const n = pm->spare.head;
+
+    /* the caller guaranteed that spares were available */
+    pm->spare.head = n->l;
+    pm->spare.count--;
+
+    atomic_init(&n->refs, 1);
+
+    return n;
+}
+
+/*!
+ * @private
+ *
+ * give up a reference to a node. if it was the last
+ * reference, the node is freed along with its references
+ * to its children. (the depth of the recursion is limited
+ * by the height of the tree.)
+ */
+static void cstl_pmap_node_release(const cstl_pmap_t * const pm,
+                                   struct cstl_pmap_node * const n)
+{
+    if (n != NULL && atomic_fetch_sub(&n->refs, 1) == 1) {
+        cstl_pmap_node_release(pm, n->l);
+        cstl_pmap_node_release(pm, n->r);
+        cstl_allocator_free(pm->allocator, n, sizeof(*n));
+    }
+}
+
+/*!
+ * @private
+ *
+ * get a version of the node that belongs exclusively to the map
+ * being modified and can therefore be changed. the reference to
+ * the node held by the caller (i.e. by the node's parent or the root
+ * of the map) is consumed, and the caller must replace that reference
+ * with the returned node.
+ *
+ * if the map holds the only reference to the node, i.e. the caller
+ * has exclusive access to its parent and the count is one, the node
+ * is already exclusive. otherwise, the node is copied. the copy refers
+ * to the same children as the original, so their counts go up.
+ */
+static struct cstl_pmap_node * cstl_pmap_own(
+    cstl_pmap_t * const pm, struct cstl_pmap_node * const n)
+{
+    struct cstl_pmap_node * c;
+
+    if (n == NULL || atomic_load(&n->refs) == 1) {
+        return n;
+    }
+
+    c = cstl_pmap_node_alloc(pm);
+
+    c->e = n->e;
+    c->red = n->red;
+
+    c->l = n->l;
+    if (c->l != NULL) {
+        atomic_fetch_add(&c->l->refs, 1);
+    }
+    c->r = n->r;
+    if (c->r != NULL) {
+        atomic_fetch_add(&c->r->refs, 1);
+    }
+
+    cstl_pmap_node_release(pm, n);
+
+    return c;
+}
+
+/*! @private */
+static inline bool cstl_pmap_is_red(const struct cstl_pmap_node * const n)
+{
+    return n != NULL && n->red;
+}
+
+/*
+ * the functions below are the usual left-leaning red-black
+ * tree operations. each one is given a node that belongs to
+ * the map being modified and makes any other node that it
+ * modifies belong to that map, too, before changing it.
+ */
+
+/*! @private */
+static struct cstl_pmap_node * cstl_pmap_rotate_left(
+    cstl_pmap_t * const pm, struct cstl_pmap_node * const h)
+{
+    struct cstl_pmap_node * const x = cstl_pmap_own(pm, h->r);
+
+    h->r = x->l;
+    x->l = h;
+    x->red = h->red;
+    h->red = true;
+
+    return x;
+}
+
+/*! @private */
+static struct cstl_pmap_node * cstl_pmap_rotate_right(
+    cstl_pmap_t * const pm, struct cstl_pmap_node * const h)
+{
+    struct cstl_pmap_node * const x = cstl_pmap_own(pm, h->l);
+
+    h->l = x->r;
+    x->r = h;
+    x->red = h->red;
+    h->red = true;
+
+    return x;
+}
+
+/*! @private */
+static void cstl_pmap_flip(cstl_pmap_t * const pm,
+                           struct cstl_pmap_node * const h)
+{
+    h->l = cstl_pmap_own(pm, h->l);
+    h->r = cstl_pmap_own(pm, h->r);
+
+    h->red = !h->red;
+    h->l->red = !h->l->red;
+    h->r->red = !h->r->red;
+}
+
+/*!
+ * @private
+ *
+ * restore the left-leaning red-black properties at @h
+ * on the way back up the tree after an update
+ */
+static struct cstl_pmap_node * cstl_pmap_fix(
+    cstl_pmap_t * const pm, struct cstl_pmap_node * h)
+{
+    if (cstl_pmap_is_red(h->r) && !cstl_pmap_is_red(h->l)) {
+        h = cstl_pmap_rotate_left(pm, h);
+    }
+    if (cstl_pmap_is_red(h->l) && cstl_pmap_is_red(h->l->l)) {
+        h = cstl_pmap_rotate_right(pm, h);
+    }
+    if (cstl_pmap_is_red(h->l) && cstl_pmap_is_red(h->r)) {
+        cstl_pmap_flip(pm, h);
+    }
+
+    return h;
+}
+
+/*!
+ * @private
+ *
+ * make sure that the left child of @h, or one of its children,
+ * is red before descending to the left during a removal
+ */
+static struct cstl_pmap_node * cstl_pmap_move_red_left(
+    cstl_pmap_t * const pm, struct cstl_pmap_node * h)
+{
+    cstl_pmap_flip(pm, h);
+    if (cstl_pmap_is_red(h->r->l)) {
+        h->r = cstl_pmap_rotate_right(pm, h->r);
+        h = cstl_pmap_rotate_left(pm, h);
+        cstl_pmap_flip(pm, h);
+    }
+
+    return h;
+}
+
+/*! @private */
+static struct cstl_pmap_node * cstl_pmap_move_red_right(
+    cstl_pmap_t * const pm, struct cstl_pmap_node * h)
+{
+    cstl_pmap_flip(pm, h);
+    if (cstl_pmap_is_red(h->l->l)) {
+        h = cstl_pmap_rotate_right(pm, h);
+        cstl_pmap_flip(pm, h);
+    }
+
+    return h;
+}
+
+/*! @private */
+static struct cstl_pmap_node * cstl_pmap_insert_at(
+    cstl_pmap_t * const pm, struct cstl_pmap_node * const h,
+    const void * const key, void * const val)
+{
+    if (h == NULL) {
+        struct cstl_pmap_node * const n = cstl_pmap_node_alloc(pm);
+
+        n->e.key = key;
+        n->e.val = val;
+        n->l = n->r = NULL;
+        n->red = true;
+
+        return n;
+    }
+
+    if (pm->cmp.f(key, h->e.key, pm->cmp.p) < 0) {
+        h->l = cstl_pmap_insert_at(pm, cstl_pmap_own(pm, h->l), key, val);
+    } else {
+        h->r = cstl_pmap_insert_at(pm, cstl_pmap_own(pm, h->r), key, val);
+    }
+
+    return cstl_pmap_fix(pm, h);
+}
+
+/*!
+ * @private
+ *
+ * remove the smallest element in the subtree rooted at @h
+ */
+static struct cstl_pmap_node * cstl_pmap_erase_min(
+    cstl_pmap_t * const pm, struct cstl_pmap_node * h)
+{
+    if (h->l == NULL) {
+        /* a node with no left child has no children at all */
+        cstl_pmap_node_release(pm, h);
+        return NULL;
+    }
+
+    if (!cstl_pmap_is_red(h->l) && !cstl_pmap_is_red(h->l->l)) {
+        h = cstl_pmap_move_red_left(pm, h);
+    }
+
+    h->l = cstl_pmap_erase_min(pm, cstl_pmap_own(pm, h->l));
+
+    return cstl_pmap_fix(pm, h);
+}
+
+/*!
+ * @private
+ *
+ * remove @key, which must be present, from the subtree rooted at @h
+ */
+static struct cstl_pmap_node * cstl_pmap_erase_at(
+    cstl_pmap_t * const pm, struct cstl_pmap_node * h,
+    const void * const key)
+{
+    if (pm->cmp.f(key, h->e.key, pm->cmp.p) < 0) {
+        if (!cstl_pmap_is_red(h->l) && !cstl_pmap_is_red(h->l->l)) {
+            h = cstl_pmap_move_red_left(pm, h);
+        }
+        h->l = cstl_pmap_erase_at(pm, cstl_pmap_own(pm, h->l), key);
+    } else {
+        if (cstl_pmap_is_red(h->l)) {
+            h = cstl_pmap_rotate_right(pm, h);
+        }
+
+        if (h->r == NULL
+            && pm->cmp.f(key, h->e.key, pm->cmp.p) == 0) {
+            cstl_pmap_node_release(pm, h);
+            return NULL;
+        }
+
+        if (!cstl_pmap_is_red(h->r) && !cstl_pmap_is_red(h->r->l)) {
+            h = cstl_pmap_move_red_right(pm, h);
+        }
+
+        if (pm->cmp.f(key, h->e.key, pm->cmp.p) == 0) {
+            /*
+             * replace the element with its successor
+             * and remove the successor instead
+             */
+            const struct cstl_pmap_node * m;
+
+            for (m = h->r; m->l != NULL; m = m->l)
+                ;
+            h->e = m->e;
+
+            h->r = cstl_pmap_erase_min(pm, cstl_pmap_own(pm, h->r));
+        } else {
+            h->r = cstl_pmap_erase_at(pm, cstl_pmap_own(pm, h->r), key);
+        }
+    }
+
+    return cstl_pmap_fix(pm, h);
+}
+
+void cstl_pmap_init(cstl_pmap_t * const pm,
+                    cstl_compare_func_t * const cmp, void * const priv)
+{
+    pm->root = NULL;
+    pm->size = 0;
+
+    pm->cmp.f = cmp;
+    pm->cmp.p = priv;
+
+    pm->spare.head = NULL;
+    pm->spare.count = 0;
+
+    pm->allocator = NULL;
+}
+
+void cstl_pmap_set_allocator(cstl_pmap_t * const pm,
+                             const cstl_allocator_t * const a)
+{
+    if (pm->size != 0) {
+        abort();
+    }
+
+    /* spares came from the old allocator */
+    cstl_pmap_clear(pm);
+    pm->allocator = a;
+}
+
+void cstl_pmap_snapshot(const cstl_pmap_t * const src,
+                        cstl_pmap_t * const dst)
+{
+    if (src != dst) {
+        cstl_pmap_clear(dst);
+
+        dst->root = src->root;
+        if (dst->root != NULL) {
+            atomic_fetch_add(&dst->root->refs, 1);
+        }
+        dst->size = src->size;
+
+        dst->cmp = src->cmp;
+        dst->allocator = src->allocator;
+    }
+}
+
+const cstl_pmap_elem_t * cstl_pmap_find(const cstl_pmap_t * const pm,
+                                        const void * const key)
+{
+    const struct cstl_pmap_node * n = pm->root;
+
+    while (n != NULL) {
+        const int c = pm->cmp.f(key, n->e.key, pm->cmp.p);
+
+        if (c == 0) {
+            return &n->e;
+        }
+
+        n = (c < 0) ? n->l : n->r;
+    }
+
+    return NULL;
+}
+
+int cstl_pmap_insert(cstl_pmap_t * const pm,
+                     const void * const key, void * const val)
+{
+    /*
+     * the tree is only modified once the key is known not to be
+     * present; otherwise, the path to it would be copied for nothing
+     */
+    if (cstl_pmap_find(pm, key) != NULL) {
+        return 1;
+    } else if (cstl_pmap_reserve(pm) != 0) {
+        return -1;
+    }
+
+    pm->root = cstl_pmap_insert_at(pm, cstl_pmap_own(pm, pm->root), key, val);
+    pm->root->red = false;
+    pm->size++;
+
+    return 0;
+}
+
+int cstl_pmap_erase(cstl_pmap_t * const pm, const void * const key)
+{
+    if (cstl_pmap_find(pm, key) == NULL) {
+        return 1;
+    } else if (cstl_pmap_reserve(pm) != 0) {
+        return -1;
+    }
+
+    pm->root = cstl_pmap_erase_at(pm, cstl_pmap_own(pm, pm->root), key);
+    if (pm->root != NULL) {
+        pm->root->red = false;
+    }
+    pm->size--;
+
+    return 0;
+}
+
+int cstl_pmap_foreach(const cstl_pmap_t * const pm,
+                      cstl_const_visit_func_t * const visit,
+                      void * const priv)
+{
+    const struct cstl_pmap_node * stk[CSTL_PMAP_MAX_HEIGHT];
+    const struct cstl_pmap_node * n = pm->root;
+    unsigned int sp = 0;
+    int res = 0;
+
+    /* there are no parent pointers; keep track of the path instead */
+    while (res == 0 && (n != NULL || sp > 0)) {
+        if (n != NULL) {
+            stk[sp++] = n;
+            n = n->l;
+        } else {
+            n = stk[--sp];
+            res = visit(&n->e, priv);
+            n = n->r;
+        }
+    }
+
+    return res;
+}
+
+void cstl_pmap_clear(cstl_pmap_t * const pm)
+{
+    cstl_pmap_node_release(pm, pm->root);
+    pm->root = NULL;
+    pm->size = 0;
+
+    while (pm->spare.head != NULL) {
+        struct cstl_pmap_node * const n = pm->spare.head;
+
+        pm->spare.head = n->l;
+        cstl_allocator_free(pm->allocator, n, sizeof(*n));
+    }
+    pm->spare.count = 0;
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static int int_key_cmp(const void * const a, const void * const b,
+                       void * const nil)
+{
+    return (intptr_t)a - (intptr_t)b;
+
+    (void)nil;
+}
+
+/*
+ * check the left-leaning red-black properties of the subtree and
+ * return its black height. keys must lie in the range (lo, hi)
+ */
+static unsigned int cstl_pmap_verify_at(const cstl_pmap_t * const pm,
+                                        const struct cstl_pmap_node * const n,
+                                        const intptr_t lo, const intptr_t hi,
+                                        size_t * const size)
+{
+    unsigned int lh, rh;
+
+    if (n == NULL) {
+        return 1;
+    }
+
+    ck_assert_int_gt((intptr_t)n->e.key, lo);
+    ck_assert_int_lt((intptr_t)n->e.key, hi);
+    ck_assert_uint_gt(atomic_load(&n->refs), 0);
+
+    ck_assert(!cstl_pmap_is_red(n->r));
+    ck_assert(!(n->red && cstl_pmap_is_red(n->l)));
+
+    lh = cstl_pmap_verify_at(pm, n->l, lo, (intptr_t)n->e.key, size);
+    rh = cstl_pmap_verify_at(pm, n->r, (intptr_t)n->e.key, hi, size);
+    ck_assert_uint_eq(lh, rh);
+
+    (*size)++;
+
+    return lh + !n->red;
+}
+
+static void cstl_pmap_verify(const cstl_pmap_t * const pm)
+{
+    size_t size = 0;
+
+    ck_assert(!cstl_pmap_is_red(pm->root));
+    cstl_pmap_verify_at(pm, pm->root, INTPTR_MIN, INTPTR_MAX, &size);
+    ck_assert_uint_eq(size, cstl_pmap_size(pm));
+}
+
+struct pmap_contents
+{
+    const unsigned char * present;
+    intptr_t next;
+    size_t count;
+};
+
+/* check that a map holds exactly the keys marked as present */
+static int pmap_contents_visit(const void * const e, void * const priv)
+{
+    const cstl_pmap_elem_t * const pe = e;
+    struct pmap_contents * const pc = priv;
+
+    while (!pc->present[pc->next]) {
+        pc->next++;
+    }
+
+    ck_assert_int_eq((intptr_t)pe->key, pc->next);
+    ck_assert_int_eq((intptr_t)pe->val, pc->next + 1);
+
+    pc->next++;
+    pc->count++;
+
+    return 0;
+}
+
+static void pmap_contents_check(const cstl_pmap_t * const pm,
+                                const unsigned char * const present)
+{
+    struct pmap_contents pc;
+
+    pc.present = present;
+    pc.next = 0;
+    pc.count = 0;
+
+    cstl_pmap_verify(pm);
+    ck_assert_int_eq(cstl_pmap_foreach(pm, pmap_contents_visit, &pc), 0);
+    ck_assert_uint_eq(pc.count, cstl_pmap_size(pm));
+}
+
+START_TEST(init)
+{
+    cstl_pmap_t pm;
+
+    cstl_pmap_init(&pm, int_key_cmp, NULL);
+    ck_assert_uint_eq(cstl_pmap_size(&pm), 0);
+    ck_assert_ptr_null(cstl_pmap_find(&pm, (void *)1));
+    ck_assert_int_eq(cstl_pmap_erase(&pm, (void *)1), 1);
+    cstl_pmap_clear(&pm);
+}
+END_TEST
+
+START_TEST(fill)
+{
+    static const unsigned int n = 1000;
+
+    unsigned char * const present = calloc(n + 1, 1);
+    struct ck_counting_allocator ca;
+    cstl_pmap_t pm;
+    unsigned int i;
+
+    ck_counting_allocator_init(&ca);
+
+    cstl_pmap_init(&pm, int_key_cmp, NULL);
+    cstl_pmap_set_allocator(&pm, &ca.a);
+
+    for (i = 0; i < n; i++) {
+        const intptr_t k = rand() % n;
+        const int res = cstl_pmap_insert(&pm, (void *)k, (void *)(k + 1));
+
+        ck_assert_int_eq(res, present[k]);
+        present[k] = 1;
+    }
+    pmap_contents_check(&pm, present);
+
+    for (i = 0; i < n; i++) {
+        const cstl_pmap_elem_t * const e =
+            cstl_pmap_find(&pm, (void *)(intptr_t)i);
+
+        if (present[i]) {
+            ck_assert_ptr_nonnull(e);
+            ck_assert_int_eq((intptr_t)e->val, i + 1);
+        } else {
+            ck_assert_ptr_null(e);
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        const intptr_t k = rand() % n;
+
+        ck_assert_int_eq(cstl_pmap_erase(&pm, (void *)k), !present[k]);
+        present[k] = 0;
+
+        cstl_pmap_verify(&pm);
+    }
+    pmap_contents_check(&pm, present);
+
+    ck_assert_signal(SIGABRT, cstl_pmap_set_allocator(&pm, NULL));
+
+    cstl_pmap_clear(&pm);
+    ck_assert_uint_eq(ca.bytes, 0);
+
+    free(present);
+}
+END_TEST
+
+START_TEST(snapshot)
+{
+    static const unsigned int n = 500;
+    static const unsigned int versions = 8;
+
+    unsigned char * const present = calloc(versions * (n + 1), 1);
+    struct ck_counting_allocator ca;
+    cstl_pmap_t * const pm = malloc(versions * sizeof(*pm));
+    unsigned int i, v;
+
+    ck_counting_allocator_init(&ca);
+
+    for (v = 0; v < versions; v++) {
+        cstl_pmap_init(&pm[v], int_key_cmp, NULL);
+    }
+    cstl_pmap_set_allocator(&pm[0], &ca.a);
+
+    /*
+     * each version is a snapshot of the previous one, which
+     * is then modified further. none of the changes made to
+     * a version may be visible in the earlier versions
+     */
+    for (v = 0; v < versions; v++) {
+        unsigned char * const p = &present[v * (n + 1)];
+
+        if (v > 0) {
+            cstl_pmap_snapshot(&pm[v - 1], &pm[v]);
+            memcpy(p, p - (n + 1), n + 1);
+        }
+
+        for (i = 0; i < n / 2; i++) {
+            const intptr_t k = rand() % n;
+
+            if (rand() % 3 != 0) {
+                ck_assert_int_eq(
+                    cstl_pmap_insert(&pm[v], (void *)k, (void *)(k + 1)),
+                    p[k]);
+                p[k] = 1;
+            } else {
+                ck_assert_int_eq(cstl_pmap_erase(&pm[v], (void *)k), !p[k]);
+                p[k] = 0;
+            }
+        }
+
+        for (i = 0; i <= v; i++) {
+            pmap_contents_check(&pm[i], &present[i * (n + 1)]);
+        }
+    }
+
+    /* an update to an old version doesn't affect the newer ones */
+    for (i = 0; i < n; i++) {
+        cstl_pmap_erase(&pm[0], (void *)(intptr_t)i);
+    }
+    ck_assert_uint_eq(cstl_pmap_size(&pm[0]), 0);
+    for (v = 1; v < versions; v++) {
+        pmap_contents_check(&pm[v], &present[v * (n + 1)]);
+    }
+
+    /* versions can be cleared in any order */
+    for (v = 0; v < versions; v++) {
+        cstl_pmap_clear(&pm[(v * 3) % versions]);
+    }
+    ck_assert_uint_eq(ca.bytes, 0);
+
+    free(pm);
+    free(present);
+}
+END_TEST
+
+/* an allocator that fails once a given number of calls have been made */
+struct pmap_limited_allocator
+{
+    struct ck_counting_allocator ca;
+    unsigned int limit;
+};
+
+static void * pmap_limited_alloc(const size_t sz, void * const priv)
+{
+    struct pmap_limited_allocator * const la = priv;
+
+    if (la->ca.calls >= la->limit) {
+        return NULL;
+    }
+    return ck_counting_alloc(sz, &la->ca);
+}
+
+START_TEST(nomem)
+{
+    static const unsigned int n = 200;
+
+    unsigned char * const present = calloc(n + 1, 1);
+    struct pmap_limited_allocator la;
+    cstl_pmap_t pm, snap;
+    unsigned int i;
+    int fails = 0;
+
+    ck_counting_allocator_init(&la.ca);
+    la.ca.a.alloc = pmap_limited_alloc;
+    la.ca.a.priv = &la;
+    la.limit = 100;
+
+    cstl_pmap_init(&pm, int_key_cmp, NULL);
+    cstl_pmap_init(&snap, int_key_cmp, NULL);
+    cstl_pmap_set_allocator(&pm, &la.ca.a);
+
+    for (i = 0; i < n; i++) {
+        const intptr_t k = rand() % n;
+        int res;
+
+        /* force every update to copy its path */
+        cstl_pmap_snapshot(&pm, &snap);
+
+        res = cstl_pmap_insert(&pm, (void *)k, (void *)(k + 1));
+        if (res < 0) {
+            fails++;
+        } else {
+            ck_assert_int_eq(res, present[k]);
+            present[k] = 1;
+        }
+
+        pmap_contents_check(&pm, present);
+    }
+    ck_assert_int_gt(fails, 0);
+
+    cstl_pmap_clear(&snap);
+    cstl_pmap_clear(&pm);
+    ck_assert_uint_eq(la.ca.bytes, 0);
+
+    free(present);
+}
+END_TEST
+
+Suite * pmap_suite(void)
+{
+    Suite * const s = suite_create("pmap");
+
+    TCase * tc;
+
+    tc = tcase_create("pmap");
+    tcase_add_test(tc, init);
+    tcase_add_test(tc, fill);
+    tcase_add_test(tc, snapshot);
+    tcase_add_test(tc, nomem);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
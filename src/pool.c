@@ -0,0 +1,320 @@
+/*!
+ * @file
+ */
+
+#include "cstl/pool.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/*!
+ * @private
+ *
+ * a type whose alignment is (hopefully) as strict as
+ * any that the caller might want to store in the pool
+ */
+union cstl_pool_align
+{
+    void * p;
+    long l;
+    long long ll;
+    double d;
+    long double ld;
+};
+
+/*! @private */
+struct cstl_pool_slab
+{
+    struct cstl_pool_slab * next;
+    /* the objects in the slab follow immediately */
+    union cstl_pool_align obj[];
+};
+
+/*!
+ * @private
+ *
+ * the number of bytes occupied by each object in a slab.
+ * objects that are free are linked together through their
+ * first bytes, so the object must be large enough to hold
+ * a pointer, and objects must be spaced such that each is
+ * aligned correctly.
+ */
+static size_t cstl_pool_stride(const struct cstl_pool * const p)
+{
+    const size_t a = sizeof(union cstl_pool_align);
+    size_t sz = p->size;
+
+    if (sz < sizeof(void *)) {
+        sz = sizeof(void *);
+    }
+
+    return ((sz + a - 1) / a) * a;
+}
+
+/*!
+ * @private
+ *
+ * the number of objects to allocate per slab when
+ * the caller didn't specify a number. the default
+ * targets slabs of (approximately) 4KiB
+ */
+static size_t cstl_pool_count(const struct cstl_pool * const p)
+{
+    size_t n = p->count;
+
+    if (n == 0) {
+        n = 4096 / cstl_pool_stride(p);
+        if (n == 0) {
+            n = 1;
+        }
+    }
+
+    return n;
+}
+
+/*!
+ * @private
+ *
+ * allocate a new slab and make its objects available
+ * for allocation. the objects in the slab are not put
+ * on the free list. instead, they are handed out, in
+ * order, by advancing the @next pointer.
+ */
+static int cstl_pool_grow(struct cstl_pool * const p)
+{
+    const size_t stride = cstl_pool_stride(p);
+    const size_t count = cstl_pool_count(p);
+    struct cstl_pool_slab * s;
+
+    /*
+     * the size of the slab can't be represented if the object size
+     * and/or the number of objects requested by the caller is too
+     * large. the stride wraps around if the object size is too large
+     */
+    if (stride < p->size
+        || count > (SIZE_MAX - sizeof(*s)) / stride) {
+        return -1;
+    }
+
+    s = cstl_allocator_alloc(p->allocator, sizeof(*s) + stride * count);
+    if (s == NULL) {
+        return -1;
+    }
+
+    s->next = p->slab;
+    p->slab = s;
+
+    p->next = s->obj;
+    p->end = (void *)((uintptr_t)s->obj + stride * count);
+
+    return 0;
+}
+
+void * cstl_pool_alloc(struct cstl_pool * const p)
+{
+    void * obj = p->free;
+
+    if (obj != NULL) {
+        /* pop the object from the front of the free list */
+        p->free = *(void **)obj;
+    } else if (p->next != p->end || cstl_pool_grow(p) == 0) {
+        obj = p->next;
+        p->next = (void *)((uintptr_t)p->next + cstl_pool_stride(p));
+    }
+
+    if (obj != NULL) {
+        p->used++;
+    }
+
+    return obj;
+}
+
+void cstl_pool_free(struct cstl_pool * const p, void * const obj)
+{
+    if (obj != NULL) {
+        *(void **)obj = p->free;
+        p->free = obj;
+
+        p->used--;
+    }
+}
+
+void cstl_pool_set_allocator(struct cstl_pool * const p,
+                             const cstl_allocator_t * const a)
+{
+    if (p->slab != NULL) {
+        abort();
+    }
+
+    p->allocator = a;
+}
+
+void cstl_pool_clear(struct cstl_pool * const p)
+{
+    const cstl_allocator_t * const a = p->allocator;
+    const size_t sz =
+        sizeof(struct cstl_pool_slab)
+        + cstl_pool_stride(p) * cstl_pool_count(p);
+    struct cstl_pool_slab * s, * n;
+
+    for (s = p->slab; s != NULL; s = n) {
+        n = s->next;
+        cstl_allocator_free(a, s, sz);
+    }
+
+    cstl_pool_init(p, p->size, p->count);
+    p->allocator = a;
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+START_TEST(init)
+{
+    DECLARE_CSTL_POOL(p, sizeof(int), 0);
+
+    ck_assert_uint_eq(cstl_pool_size(&p), 0);
+    ck_assert_uint_eq(cstl_pool_object_size(&p), sizeof(int));
+    ck_assert_uint_ge(cstl_pool_stride(&p), sizeof(void *));
+    ck_assert_uint_gt(cstl_pool_count(&p), 0);
+
+    cstl_pool_clear(&p);
+}
+END_TEST
+
+START_TEST(alloc)
+{
+    static const size_t n = 100;
+
+    DECLARE_CSTL_POOL(p, 24, 7);
+    unsigned int i, j;
+    void * obj[100];
+
+    for (i = 0; i < n; i++) {
+        obj[i] = cstl_pool_alloc(&p);
+        ck_assert_ptr_nonnull(obj[i]);
+        ck_assert_uint_eq(
+            (uintptr_t)obj[i] % sizeof(union cstl_pool_align), 0);
+        memset(obj[i], i, 24);
+
+        ck_assert_uint_eq(cstl_pool_size(&p), i + 1);
+    }
+
+    /* no object may overlap any other */
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < 24; j++) {
+            ck_assert_uint_eq(((unsigned char *)obj[i])[j], i);
+        }
+    }
+
+    cstl_pool_clear(&p);
+    ck_assert_uint_eq(cstl_pool_size(&p), 0);
+    ck_assert_ptr_null(p.slab);
+}
+END_TEST
+
+START_TEST(recycle)
+{
+    DECLARE_CSTL_POOL(p, 40, 4);
+    void * a, * b, * c;
+    struct cstl_pool_slab * s;
+
+    a = cstl_pool_alloc(&p);
+    b = cstl_pool_alloc(&p);
+    s = p.slab;
+
+    cstl_pool_free(&p, a);
+    cstl_pool_free(&p, NULL);
+    ck_assert_uint_eq(cstl_pool_size(&p), 1);
+
+    /* the most recently freed object is recycled first */
+    c = cstl_pool_alloc(&p);
+    ck_assert_ptr_eq(a, c);
+    ck_assert_ptr_eq(p.slab, s);
+
+    cstl_pool_free(&p, b);
+    cstl_pool_free(&p, c);
+    ck_assert_uint_eq(cstl_pool_size(&p), 0);
+
+    cstl_pool_clear(&p);
+}
+END_TEST
+
+START_TEST(allocator)
+{
+    DECLARE_CSTL_POOL(p, 32, 8);
+    struct ck_counting_allocator ca;
+    void * obj[20];
+    unsigned int i;
+
+    ck_counting_allocator_init(&ca);
+    cstl_pool_set_allocator(&p, &ca.a);
+
+    for (i = 0; i < 20; i++) {
+        obj[i] = cstl_pool_alloc(&p);
+    }
+    /* 20 objects at 8 per slab requires 3 slabs */
+    ck_assert_uint_eq(ca.calls, 3);
+    ck_assert_uint_gt(ca.bytes, 0);
+
+    ck_assert_signal(SIGABRT, cstl_pool_set_allocator(&p, NULL));
+
+    for (i = 0; i < 20; i++) {
+        cstl_pool_free(&p, obj[i]);
+    }
+    ck_assert_uint_eq(ca.calls, 3);
+
+    cstl_pool_clear(&p);
+    ck_assert_uint_eq(ca.calls, 6);
+    ck_assert_uint_eq(ca.bytes, 0);
+
+    /* the allocator survives the clear */
+    ck_assert_ptr_eq(p.allocator, &ca.a);
+    cstl_pool_set_allocator(&p, NULL);
+}
+END_TEST
+
+START_TEST(overflow)
+{
+    struct ck_counting_allocator ca;
+    struct cstl_pool p;
+
+    ck_counting_allocator_init(&ca);
+
+    /* a slab of this many objects can't be represented */
+    cstl_pool_init(&p, 32, SIZE_MAX / 16);
+    cstl_pool_set_allocator(&p, &ca.a);
+    ck_assert_ptr_null(cstl_pool_alloc(&p));
+    ck_assert_uint_eq(cstl_pool_size(&p), 0);
+    ck_assert_uint_eq(ca.calls, 0);
+    cstl_pool_clear(&p);
+
+    /* nor can an object of this size */
+    cstl_pool_init(&p, SIZE_MAX - 1, 1);
+    cstl_pool_set_allocator(&p, &ca.a);
+    ck_assert_ptr_null(cstl_pool_alloc(&p));
+    ck_assert_uint_eq(ca.calls, 0);
+    cstl_pool_clear(&p);
+}
+END_TEST
+
+Suite * pool_suite(void)
+{
+    Suite * const s = suite_create("pool");
+
+    TCase * tc;
+
+    tc = tcase_create("pool");
+    tcase_add_test(tc, init);
+    tcase_add_test(tc, alloc);
+    tcase_add_test(tc, recycle);
+    tcase_add_test(tc, allocator);
+    tcase_add_test(tc, overflow);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
@@ -5,6 +5,7 @@
 #include "cstl/rbtree.h"
 
 #include <assert.h>
+#include <stdlib.h>
 
 /*! @private */
 static inline struct cstl_rbtree_node * __cstl_rbtree_node(
@@ -13,17 +14,78 @@ static inline struct cstl_rbtree_node * __cstl_rbtree_node(
     return (void *)((uintptr_t)e + t->off);
 }
 
+/*!
+ * @private
+ *
+ * Given a pointer to a binary tree node, get the red-black tree
+ * node's color. The color is kept in the flag bit of the binary
+ * tree node's parent pointer, with black nodes having the bit set
+ */
+static inline cstl_rbtree_color_t BN_COLOR(
+    const struct cstl_bintree_node * const bn)
+{
+    return __cstl_bintree_flag(bn) ? CSTL_RBTREE_COLOR_B : CSTL_RBTREE_COLOR_R;
+}
+
 /*!
  * @private
  *
  * Given a pointer to a binary tree node,
- * get a pointer to the red-black tree node's color
+ * set the red-black tree node's color
  */
-static inline cstl_rbtree_color_t * BN_COLOR(
+static inline void BN_SET_COLOR(struct cstl_bintree_node * const bn,
+                                const cstl_rbtree_color_t c)
+{
+    __cstl_bintree_set_flag(bn, c == CSTL_RBTREE_COLOR_B);
+}
+
+/*!
+ * @private
+ *
+ * Given a pointer to a binary tree node, get a pointer to the
+ * red-black tree node's subtree size. Only valid in a ranked tree,
+ * where every node is part of a cstl_rbtree_ranked_node
+ */
+static inline size_t * BN_SIZE(const struct cstl_bintree_node * const bn)
+{
+    return &((struct cstl_rbtree_ranked_node *)(
+                 (uintptr_t)bn
+                 - offsetof(struct cstl_rbtree_node, n)
+                 - offsetof(struct cstl_rbtree_ranked_node, n)))->size;
+}
+
+/*!
+ * @private
+ *
+ * Get the size of the subtree rooted at the given node,
+ * which may be NULL. Only valid in a ranked tree
+ */
+static inline size_t cstl_rbtree_subtree_size(
     const struct cstl_bintree_node * const bn)
 {
-    return &((struct cstl_rbtree_node *)(
-                 (uintptr_t)bn - offsetof(struct cstl_rbtree_node, n)))->c;
+    return bn != NULL ? *BN_SIZE(bn) : 0;
+}
+
+/*!
+ * @private
+ *
+ * rotate the tree about x (see __cstl_bintree_rotate). in a ranked
+ * tree, x and the child that takes its place are the only nodes whose
+ * subtrees change. the child's subtree now contains exactly what x's
+ * used to, and x's size is recomputed from its new children.
+ */
+static void cstl_rbtree_rotate(struct cstl_rbtree * const t,
+                               struct cstl_bintree_node * const x,
+                               __cstl_bintree_child_func_t * const l,
+                               __cstl_bintree_child_func_t * const r)
+{
+    __cstl_bintree_rotate(&t->t, x, l, r);
+
+    if (t->ranked) {
+        *BN_SIZE(__cstl_bintree_parent(x)) = *BN_SIZE(x);
+        *BN_SIZE(x) = cstl_rbtree_subtree_size(x->l)
+            + cstl_rbtree_subtree_size(x->r) + 1;
+    }
 }
 
 /*!
@@ -39,11 +101,13 @@ static inline cstl_rbtree_color_t * BN_COLOR(
  * child, the @l and @r parameters must be reversed
  */
 static struct cstl_bintree_node * cstl_rbtree_fix_insertion(
-    struct cstl_bintree * const t, struct cstl_bintree_node * x,
+    struct cstl_rbtree * const t, struct cstl_bintree_node * x,
     __cstl_bintree_child_func_t * const l,
     __cstl_bintree_child_func_t * const r)
 {
-    struct cstl_bintree_node * const y = *r(x->p->p);
+    struct cstl_bintree_node * p = __cstl_bintree_parent(x);
+    struct cstl_bintree_node * const g = __cstl_bintree_parent(p);
+    struct cstl_bintree_node * const y = *r(g);
 
     /*
      * if the tree is not violating any of the red-black
@@ -51,7 +115,7 @@ static struct cstl_bintree_node * cstl_rbtree_fix_insertion(
      * red, then x's grandparent is guaranteed to be black.
      */
 
-    if (y != NULL && *BN_COLOR(y) == CSTL_RBTREE_COLOR_R) {
+    if (y != NULL && BN_COLOR(y) == CSTL_RBTREE_COLOR_R) {
         /*
          * if x's parent's sibling is also red, then
          * the parent and the sibling can be changed to
@@ -59,12 +123,12 @@ static struct cstl_bintree_node * cstl_rbtree_fix_insertion(
          * red-red violation (if one exists) is between
          * x's grandparent and great grandparent
          */
-        *BN_COLOR(x->p) = CSTL_RBTREE_COLOR_B;
-        *BN_COLOR(y) = CSTL_RBTREE_COLOR_B;
-        *BN_COLOR(x->p->p) = CSTL_RBTREE_COLOR_R;
-        x = x->p->p;
+        BN_SET_COLOR(p, CSTL_RBTREE_COLOR_B);
+        BN_SET_COLOR(y, CSTL_RBTREE_COLOR_B);
+        BN_SET_COLOR(g, CSTL_RBTREE_COLOR_R);
+        x = g;
     } else {
-        if (x == *r(x->p)) {
+        if (x == *r(p)) {
             /*
              * x is the right child. rotate such that
              * x's parent becomes x's left child and
@@ -73,8 +137,9 @@ static struct cstl_bintree_node * cstl_rbtree_fix_insertion(
              * note that x is moved down to point at
              * its former parent (now its left child)
              */
-            x = x->p;
-            __cstl_bintree_rotate(t, x, l, r);
+            x = p;
+            cstl_rbtree_rotate(t, x, l, r);
+            p = __cstl_bintree_parent(x);
         }
 
         /*
@@ -87,51 +152,76 @@ static struct cstl_bintree_node * cstl_rbtree_fix_insertion(
          * by the grandparent black with two red children
          */
 
-        *BN_COLOR(x->p) = CSTL_RBTREE_COLOR_B;
-        *BN_COLOR(x->p->p) = CSTL_RBTREE_COLOR_R;
-        __cstl_bintree_rotate(t, x->p->p, r, l);
+        BN_SET_COLOR(p, CSTL_RBTREE_COLOR_B);
+        BN_SET_COLOR(g, CSTL_RBTREE_COLOR_R);
+        cstl_rbtree_rotate(t, g, r, l);
     }
 
     return x;
 }
 
-void cstl_rbtree_insert(struct cstl_rbtree * const t,
-                        void * const e, void * const p)
+/*!
+ * @private
+ *
+ * restore the red-black properties after the red node x has been
+ * linked into the tree, possibly beneath another red node
+ */
+static void cstl_rbtree_fix_red(struct cstl_rbtree * const t,
+                                struct cstl_bintree_node * x)
 {
-    struct cstl_rbtree_node * const n = __cstl_rbtree_node(t, e);
-    struct cstl_bintree_node * x;
-
-    /*
-     * insert as normal, with the new node colored
-     */
-    cstl_bintree_insert(&t->t, e, p);
-    n->c = CSTL_RBTREE_COLOR_R;
+    struct cstl_bintree_node * p;
 
-    /*
-     * it's possible that the new node's parent is red,
-     * which is a violation of the "red nodes can only
-     * have black children" property
-     */
-    x = &n->n;
-    while (x->p != NULL && *BN_COLOR(x->p) == CSTL_RBTREE_COLOR_R) {
+    while ((p = __cstl_bintree_parent(x)) != NULL
+           && BN_COLOR(p) == CSTL_RBTREE_COLOR_R) {
         /*
          * if has a parent (i.e. is not the root) and is
          * red, then x must have a grandparent because
          * the root is always black
          */
 
-        if (x->p == x->p->p->l) {
+        if (p == __cstl_bintree_parent(p)->l) {
             x = cstl_rbtree_fix_insertion(
-                    &t->t, x,
+                    t, x,
                     __cstl_bintree_left, __cstl_bintree_right);
         } else {
             x = cstl_rbtree_fix_insertion(
-                    &t->t, x,
+                    t, x,
                     __cstl_bintree_right, __cstl_bintree_left);
         }
     }
 
-    *BN_COLOR(t->t.root) = CSTL_RBTREE_COLOR_B;
+    BN_SET_COLOR(t->t.root, CSTL_RBTREE_COLOR_B);
+}
+
+void cstl_rbtree_insert(struct cstl_rbtree * const t,
+                        void * const e, void * const p)
+{
+    struct cstl_rbtree_node * const n = __cstl_rbtree_node(t, e);
+
+    /*
+     * insert as normal, with the new node colored
+     */
+    cstl_bintree_insert(&t->t, e, p);
+    BN_SET_COLOR(&n->n, CSTL_RBTREE_COLOR_R);
+
+    if (t->ranked) {
+        struct cstl_bintree_node * a;
+
+        /* every ancestor of the new node gained a descendant */
+        *BN_SIZE(&n->n) = 1;
+        for (a = __cstl_bintree_parent(&n->n);
+             a != NULL;
+             a = __cstl_bintree_parent(a)) {
+            (*BN_SIZE(a))++;
+        }
+    }
+
+    /*
+     * it's possible that the new node's parent is red,
+     * which is a violation of the "red nodes can only
+     * have black children" property
+     */
+    cstl_rbtree_fix_red(t, &n->n);
 }
 
 /*!
@@ -145,10 +235,11 @@ void cstl_rbtree_insert(struct cstl_rbtree * const t,
  * parameters
  */
 static struct cstl_bintree_node * cstl_rbtree_fix_deletion(
-    struct cstl_bintree * const t, struct cstl_bintree_node * x,
+    struct cstl_rbtree * const t, struct cstl_bintree_node * x,
     __cstl_bintree_child_func_t * const l,
     __cstl_bintree_child_func_t * const r)
 {
+    struct cstl_bintree_node * const p = __cstl_bintree_parent(x);
     struct cstl_bintree_node * w;
 
     /*
@@ -158,10 +249,12 @@ static struct cstl_bintree_node * cstl_rbtree_fix_deletion(
      * x's (w) sibling must be non-NULL, otherwise, the path
      * to the sibling would have the same number of blacks
      * as the path to x.
+     *
+     * note that none of the rotations below changes x's parent
      */
-    w = *r(x->p);
+    w = *r(p);
 
-    if (*BN_COLOR(w) == CSTL_RBTREE_COLOR_R) {
+    if (BN_COLOR(w) == CSTL_RBTREE_COLOR_R) {
         /*
          * if the sibling is red, it must have black children.
          *
@@ -170,28 +263,28 @@ static struct cstl_bintree_node * cstl_rbtree_fix_deletion(
          * to maintain the current red-black status quo. one of
          * the conditions below now applies
          */
-        *BN_COLOR(w) = CSTL_RBTREE_COLOR_B;
-        *BN_COLOR(x->p) = CSTL_RBTREE_COLOR_R;
-        __cstl_bintree_rotate(t, x->p, l, r);
-        w = *r(x->p);
+        BN_SET_COLOR(w, CSTL_RBTREE_COLOR_B);
+        BN_SET_COLOR(p, CSTL_RBTREE_COLOR_R);
+        cstl_rbtree_rotate(t, p, l, r);
+        w = *r(p);
     }
 
     /*
      * based on the case above, x's sibling was either black
      * or it was transformed so that x's sibling is now black.
      */
-    if ((*l(w) == NULL || *BN_COLOR(*l(w)) == CSTL_RBTREE_COLOR_B)
-        && (*r(w) == NULL || *BN_COLOR(*r(w)) == CSTL_RBTREE_COLOR_B)) {
+    if ((*l(w) == NULL || BN_COLOR(*l(w)) == CSTL_RBTREE_COLOR_B)
+        && (*r(w) == NULL || BN_COLOR(*r(w)) == CSTL_RBTREE_COLOR_B)) {
         /* if w has two black children, then make it red */
-        *BN_COLOR(w) = CSTL_RBTREE_COLOR_R;
+        BN_SET_COLOR(w, CSTL_RBTREE_COLOR_R);
         /*
          * the tree is good up to this point,
          * move x further up the tree
          */
-        x = x->p;
+        x = p;
     } else {
         /* else w has at least one red child */
-        if (*r(w) == NULL || *BN_COLOR(*r(w)) == CSTL_RBTREE_COLOR_B) {
+        if (*r(w) == NULL || BN_COLOR(*r(w)) == CSTL_RBTREE_COLOR_B) {
             /*
              * if w's right child is black, then the left has
              * to be red. the case looks something like the first
@@ -200,10 +293,10 @@ static struct cstl_bintree_node * cstl_rbtree_fix_deletion(
              * as before and x's new sibling (w) has a red right
              * child
              */
-            *BN_COLOR(*l(w)) = CSTL_RBTREE_COLOR_B;
-            *BN_COLOR(w) = CSTL_RBTREE_COLOR_R;
-            __cstl_bintree_rotate(t, w, r, l);
-            w = *r(x->p);
+            BN_SET_COLOR(*l(w), CSTL_RBTREE_COLOR_B);
+            BN_SET_COLOR(w, CSTL_RBTREE_COLOR_R);
+            cstl_rbtree_rotate(t, w, r, l);
+            w = *r(p);
         }
 
         /*
@@ -218,17 +311,17 @@ static struct cstl_bintree_node * cstl_rbtree_fix_deletion(
          * be restored
          */
 
-        *BN_COLOR(w) = *BN_COLOR(x->p);
-        *BN_COLOR(x->p) = CSTL_RBTREE_COLOR_B;
-        *BN_COLOR(*r(w)) = CSTL_RBTREE_COLOR_B;
-        __cstl_bintree_rotate(t, x->p, l, r);
+        BN_SET_COLOR(w, BN_COLOR(p));
+        BN_SET_COLOR(p, CSTL_RBTREE_COLOR_B);
+        BN_SET_COLOR(*r(w), CSTL_RBTREE_COLOR_B);
+        cstl_rbtree_rotate(t, p, l, r);
 
         /*
          * setting x to be the root tells the caller to
          * stop fixing since there is no further up the
          * tree to move
          */
-        x = t->root;
+        x = t->t.root;
     }
 
     return x;
@@ -238,8 +331,31 @@ static struct cstl_bintree_node * cstl_rbtree_fix_deletion(
 void __cstl_rbtree_erase(struct cstl_rbtree * const t,
                          struct cstl_rbtree_node * const n)
 {
-    const struct cstl_bintree_node * const y =
-        __cstl_bintree_erase(&t->t, &n->n);
+    const struct cstl_bintree_node * y;
+    cstl_rbtree_color_t c;
+
+    if (t->ranked) {
+        struct cstl_bintree_node * a = &n->n;
+
+        /*
+         * the node that is physically unlinked from the tree is
+         * either the given node or, if it has two children, its
+         * successor (see __cstl_bintree_erase). every ancestor
+         * of that node loses a descendant
+         */
+        if (a->l != NULL && a->r != NULL) {
+            for (a = a->r; a->l != NULL; a = a->l)
+                ;
+        }
+
+        for (a = __cstl_bintree_parent(a);
+             a != NULL;
+             a = __cstl_bintree_parent(a)) {
+            (*BN_SIZE(a))--;
+        }
+    }
+
+    y = __cstl_bintree_erase(&t->t, &n->n);
 
     /*
      * y points to the location in the tree from where the
@@ -247,14 +363,18 @@ void __cstl_rbtree_erase(struct cstl_rbtree * const t,
      * captures the color that was *supposed* to be removed
      * from the tree.
      */
-    const cstl_rbtree_color_t c = *BN_COLOR(y);
+    c = BN_COLOR(y);
     /*
      * restore the correct color to the node that remains
      * in the tree. (note that if the node that was *supposed*
      * to be removed *was* removed, then this line has no
      * effect because y == n
      */
-    *BN_COLOR(y) = n->c;
+    BN_SET_COLOR((struct cstl_bintree_node *)y, BN_COLOR(&n->n));
+    /* the same goes for the size of its subtree */
+    if (t->ranked) {
+        *BN_SIZE(y) = *BN_SIZE(&n->n);
+    }
 
     /*
      * if the color of the removed node was black, it's
@@ -266,7 +386,7 @@ void __cstl_rbtree_erase(struct cstl_rbtree * const t,
      */
     if (c == CSTL_RBTREE_COLOR_B) {
         struct cstl_rbtree_node _x;
-        struct cstl_bintree_node * x;
+        struct cstl_bintree_node * x, * p;
 
         /*
          * the removed node can only have had 0 or 1
@@ -286,15 +406,15 @@ void __cstl_rbtree_erase(struct cstl_rbtree * const t,
         } else {
             x = &_x.n;
 
-            x->p = n->n.p;
-            *BN_COLOR(x) = CSTL_RBTREE_COLOR_B;
+            x->p = (uintptr_t)__cstl_bintree_parent(&n->n);
+            BN_SET_COLOR(x, CSTL_RBTREE_COLOR_B);
         }
 
         /*
          * x's parent is the removed node's parent,
          * x's former grandparent
          */
-        assert(x->p == n->n.p);
+        assert(__cstl_bintree_parent(x) == __cstl_bintree_parent(&n->n));
 
         /*
          * any path to x has 1 too few black nodes in
@@ -303,14 +423,15 @@ void __cstl_rbtree_erase(struct cstl_rbtree * const t,
          * to restore red-black properties
          */
 
-        while (x->p != NULL && *BN_COLOR(x) == CSTL_RBTREE_COLOR_B) {
-            if (x == x->p->l || (x == &_x.n && x->p->l == NULL)) {
+        while ((p = __cstl_bintree_parent(x)) != NULL
+               && BN_COLOR(x) == CSTL_RBTREE_COLOR_B) {
+            if (x == p->l || (x == &_x.n && p->l == NULL)) {
                 x = cstl_rbtree_fix_deletion(
-                        &t->t, x,
+                        t, x,
                         __cstl_bintree_left, __cstl_bintree_right);
             } else {
                 x = cstl_rbtree_fix_deletion(
-                        &t->t, x,
+                        t, x,
                         __cstl_bintree_right, __cstl_bintree_left);
             }
         }
@@ -320,7 +441,7 @@ void __cstl_rbtree_erase(struct cstl_rbtree * const t,
          * black fixes the number of black nodes on
          * the path to x
          */
-        *BN_COLOR(x) = CSTL_RBTREE_COLOR_B;
+        BN_SET_COLOR(x, CSTL_RBTREE_COLOR_B);
     }
 }
 
@@ -333,15 +454,301 @@ void * cstl_rbtree_erase(struct cstl_rbtree * const t, const void * const _p)
     return p;
 }
 
+/*!
+ * @private
+ *
+ * build a balanced subtree from the next @n elements produced by @pull.
+ * the left subtree is built before its root is pulled and the right
+ * subtree after, so the elements are consumed in order.
+ *
+ * the sizes of sibling subtrees differ by at most one, so the leaves
+ * are all at depth @red or @red - 1, where @red is the depth of the
+ * deepest level. coloring the nodes at that level red and all others
+ * black gives every path the same number of black nodes, and no red
+ * node has any children.
+ */
+static struct cstl_bintree_node * cstl_rbtree_build_subtree(
+    const struct cstl_rbtree * const t, const size_t n,
+    const unsigned int d, const unsigned int red,
+    __cstl_rbtree_pull_func_t * const pull, void * const priv)
+{
+    struct cstl_bintree_node * l, * r;
+    struct cstl_rbtree_node * x;
+
+    if (n == 0) {
+        return NULL;
+    }
+
+    l = cstl_rbtree_build_subtree(t, n / 2, d + 1, red, pull, priv);
+    x = __cstl_rbtree_node(t, pull(priv));
+    r = cstl_rbtree_build_subtree(t, n - n / 2 - 1, d + 1, red, pull, priv);
+
+    if (t->ranked) {
+        *BN_SIZE(&x->n) = n;
+    }
+
+    x->n.p = (uintptr_t)NULL;
+    BN_SET_COLOR(&x->n, (d == red) ? CSTL_RBTREE_COLOR_R : CSTL_RBTREE_COLOR_B);
+    x->n.l = l;
+    x->n.r = r;
+    if (l != NULL) {
+        __cstl_bintree_set_parent(l, &x->n);
+    }
+    if (r != NULL) {
+        __cstl_bintree_set_parent(r, &x->n);
+    }
+
+    return &x->n;
+}
+
+/*! @private */
+static unsigned int cstl_rbtree_depth(size_t n)
+{
+    unsigned int d;
+
+    for (d = 0; n > 1; n /= 2) {
+        d++;
+    }
+
+    return d;
+}
+
+/*!
+ * @private
+ *
+ * count the black nodes on the path from @bn to a leaf. the
+ * count is the same on every path, so the left-most is used
+ */
+static unsigned int cstl_rbtree_black_height(
+    const struct cstl_bintree_node * bn)
+{
+    unsigned int h;
+
+    for (h = 0; bn != NULL; bn = bn->l) {
+        if (BN_COLOR(bn) == CSTL_RBTREE_COLOR_B) {
+            h++;
+        }
+    }
+
+    return h;
+}
+
+/*!
+ * @private
+ *
+ * join the tree with the subtree rooted at @r via the node @k. every
+ * element in the tree must be less than @k, and @k must be less than
+ * every element in @r.
+ *
+ * the taller of the two trees is descended, along its right spine if
+ * it is the existing tree or its left spine if it is @r, to a black
+ * node whose black height matches that of the shorter tree. @k, colored
+ * red, takes that node's place, with the node and the shorter tree as
+ * its children. the black heights along every path are unchanged, and
+ * the only possible violation is between @k and its new parent, which
+ * is fixed as it would be after an insertion. the cost is proportional
+ * to the height of the taller tree.
+ */
+static void cstl_rbtree_join(struct cstl_rbtree * const t,
+                             struct cstl_bintree_node * const k,
+                             struct cstl_bintree_node * const r)
+{
+    struct cstl_bintree_node * const l = t->t.root;
+    struct cstl_bintree_node ** y, * p;
+    unsigned int hl, hr;
+    size_t add;
+
+    if (r != NULL) {
+        BN_SET_COLOR(r, CSTL_RBTREE_COLOR_B);
+    }
+
+    hl = cstl_rbtree_black_height(l);
+    hr = cstl_rbtree_black_height(r);
+
+    p = NULL;
+    if (hl >= hr) {
+        y = &t->t.root;
+        while (hl > hr
+               || (*y != NULL && BN_COLOR(*y) == CSTL_RBTREE_COLOR_R)) {
+            if (BN_COLOR(*y) == CSTL_RBTREE_COLOR_B) {
+                hl--;
+            }
+            p = *y;
+            y = &p->r;
+        }
+
+        k->l = *y;
+        k->r = r;
+        add = t->ranked ? cstl_rbtree_subtree_size(r) + 1 : 0;
+    } else {
+        t->t.root = r;
+
+        y = &t->t.root;
+        while (hr > hl || BN_COLOR(*y) == CSTL_RBTREE_COLOR_R) {
+            if (BN_COLOR(*y) == CSTL_RBTREE_COLOR_B) {
+                hr--;
+            }
+            p = *y;
+            y = &p->l;
+        }
+
+        k->l = l;
+        k->r = *y;
+        add = t->ranked ? cstl_rbtree_subtree_size(l) + 1 : 0;
+    }
+
+    k->p = (uintptr_t)p;
+    if (k->l != NULL) {
+        __cstl_bintree_set_parent(k->l, k);
+    }
+    if (k->r != NULL) {
+        __cstl_bintree_set_parent(k->r, k);
+    }
+    *y = k;
+
+    BN_SET_COLOR(k, CSTL_RBTREE_COLOR_R);
+    if (t->ranked) {
+        *BN_SIZE(k) = cstl_rbtree_subtree_size(k->l)
+            + cstl_rbtree_subtree_size(k->r) + 1;
+        for (; p != NULL; p = __cstl_bintree_parent(p)) {
+            *BN_SIZE(p) += add;
+        }
+    }
+
+    cstl_rbtree_fix_red(t, k);
+}
+
+void __cstl_rbtree_append(struct cstl_rbtree * const t, const size_t n,
+                          __cstl_rbtree_pull_func_t * const pull,
+                          void * const priv)
+{
+    if (n == 0) {
+        return;
+    }
+
+    if (t->t.root == NULL) {
+        t->t.root = cstl_rbtree_build_subtree(
+            t, n, 0, cstl_rbtree_depth(n), pull, priv);
+        BN_SET_COLOR(t->t.root, CSTL_RBTREE_COLOR_B);
+    } else {
+        /*
+         * the first of the new elements joins the existing
+         * tree to a subtree built from the remaining ones
+         */
+        struct cstl_bintree_node * const k =
+            &__cstl_rbtree_node(t, pull(priv))->n;
+        struct cstl_bintree_node * const r = cstl_rbtree_build_subtree(
+            t, n - 1, 0, cstl_rbtree_depth(n - 1), pull, priv);
+
+        cstl_rbtree_join(t, k, r);
+    }
+
+    t->t.size += n;
+}
+
+/*! @private */
+static void * cstl_rbtree_pull_array(void * const p)
+{
+    void * const ** const e = p;
+    return *(*e)++;
+}
+
+void cstl_rbtree_append(struct cstl_rbtree * const t,
+                        void * const * e, const size_t n)
+{
+    __cstl_rbtree_append(t, n, cstl_rbtree_pull_array, &e);
+}
+
+void cstl_rbtree_build(struct cstl_rbtree * const t,
+                       void * const * const e, const size_t n)
+{
+    if (cstl_rbtree_size(t) != 0) {
+        abort();
+    }
+
+    cstl_rbtree_append(t, e, n);
+}
+
+void cstl_rbtree_set_ranked(struct cstl_rbtree * const t, const bool ranked)
+{
+    if (cstl_rbtree_size(t) != 0) {
+        abort();
+    }
+
+    t->ranked = ranked;
+}
+
+size_t cstl_rbtree_rank(const struct cstl_rbtree * const t,
+                        const void * const e)
+{
+    const struct cstl_bintree_node * const be =
+        &__cstl_rbtree_node(t, e)->n;
+    const struct cstl_bintree_node * bn = t->t.root;
+    size_t rank = 0;
+
+    if (!t->ranked) {
+        abort();
+    }
+
+    /*
+     * every time the search moves right, the node and
+     * everything in its left subtree are less than @e
+     */
+    while (bn != NULL) {
+        if (__cstl_bintree_cmp(&t->t, be, bn) <= 0) {
+            bn = bn->l;
+        } else {
+            rank += cstl_rbtree_subtree_size(bn->l) + 1;
+            bn = bn->r;
+        }
+    }
+
+    return rank;
+}
+
+const void * cstl_rbtree_select(const struct cstl_rbtree * const t,
+                                size_t i)
+{
+    const struct cstl_bintree_node * bn = t->t.root;
+
+    if (!t->ranked) {
+        abort();
+    }
+
+    while (bn != NULL) {
+        const size_t ls = cstl_rbtree_subtree_size(bn->l);
+
+        if (i < ls) {
+            bn = bn->l;
+        } else if (i > ls) {
+            i -= ls + 1;
+            bn = bn->r;
+        } else {
+            return (void *)((uintptr_t)bn - t->t.off);
+        }
+    }
+
+    return NULL;
+}
+
+size_t cstl_rbtree_count_range(const struct cstl_rbtree * const t,
+                               const void * const lo, const void * const hi)
+{
+    const size_t l = cstl_rbtree_rank(t, lo), h = cstl_rbtree_rank(t, hi);
+    return h > l ? h - l : 0;
+}
+
 #ifdef __cfg_test__
 // GCOV_EXCL_START
-#include <check.h>
+#include "internal/check.h"
 #include <stdlib.h>
+#include <string.h>
 
+/* the tests use the same elements for ranked and unranked trees */
 struct integer
 {
     int v;
-    struct cstl_rbtree_node n;
+    struct cstl_rbtree_ranked_node n;
 };
 
 static int cmp_integer(const void * const a, const void * const b,
@@ -355,6 +762,15 @@ START_TEST(init)
 {
     DECLARE_CSTL_RBTREE(t, struct integer, n, cmp_integer, NULL);
     (void)t;
+
+    /*
+     * the color shares a word with the parent pointer, and
+     * only the nodes of a ranked tree carry a subtree size
+     */
+    ck_assert_uint_eq(sizeof(struct cstl_bintree_node), 3 * sizeof(void *));
+    ck_assert_uint_eq(sizeof(struct cstl_rbtree_node), 3 * sizeof(void *));
+    ck_assert_uint_eq(sizeof(struct cstl_rbtree_ranked_node),
+                      sizeof(struct cstl_rbtree_node) + sizeof(size_t));
 }
 END_TEST
 
@@ -364,38 +780,48 @@ static int __cstl_rbtree_verify(const void * const elem,
 {
     if (order == CSTL_BINTREE_VISIT_ORDER_MID
         || order == CSTL_BINTREE_VISIT_ORDER_LEAF) {
-        const struct cstl_bintree * const t = priv;
+        const struct cstl_rbtree * const rt = priv;
+        const struct cstl_bintree * const t = &rt->t;
         const struct cstl_bintree_node * const bn =
-            &((const struct integer *)elem)->n.n;
+            &((const struct integer *)elem)->n.n.n;
 
-        size_t bh = 0;
-
-        if (*BN_COLOR(bn) == CSTL_RBTREE_COLOR_R) {
+        if (BN_COLOR(bn) == CSTL_RBTREE_COLOR_R) {
             ck_assert(bn->l == NULL
-                      || *BN_COLOR(bn->l) == CSTL_RBTREE_COLOR_B);
+                      || BN_COLOR(bn->l) == CSTL_RBTREE_COLOR_B);
             ck_assert(bn->r == NULL
-                      || *BN_COLOR(bn->r) == CSTL_RBTREE_COLOR_B);
+                      || BN_COLOR(bn->r) == CSTL_RBTREE_COLOR_B);
         }
 
         if (bn->l != NULL) {
+            ck_assert_ptr_eq(__cstl_bintree_parent(bn->l), bn);
             ck_assert_int_lt(__cstl_bintree_cmp(t, bn->l, bn), 0);
         }
         if (bn->r != NULL) {
+            ck_assert_ptr_eq(__cstl_bintree_parent(bn->r), bn);
             ck_assert_int_ge(__cstl_bintree_cmp(t, bn->r, bn), 0);
         }
 
-        if (bn->l == NULL && bn->r == NULL) {
+        if (rt->ranked) {
+            ck_assert_uint_eq(*BN_SIZE(bn),
+                              cstl_rbtree_subtree_size(bn->l)
+                              + cstl_rbtree_subtree_size(bn->r) + 1);
+        }
+
+        if (bn->l == NULL || bn->r == NULL) {
+            /*
+             * every path from the root to a missing child
+             * must pass through the same number of black nodes
+             */
             const struct cstl_bintree_node * n;
-            size_t h;
+            unsigned int h;
 
-            for (h = 0, n = bn; n != NULL; n = n->p) {
-                if (*BN_COLOR(n) == CSTL_RBTREE_COLOR_B) {
+            for (h = 0, n = bn; n != NULL; n = __cstl_bintree_parent(n)) {
+                if (BN_COLOR(n) == CSTL_RBTREE_COLOR_B) {
                     h++;
                 }
             }
 
-            ck_assert(bh == 0 || h == bh);
-            bh = h;
+            ck_assert_uint_eq(h, cstl_rbtree_black_height(t->root));
         }
     }
 
@@ -407,12 +833,15 @@ static void cstl_rbtree_verify(const struct cstl_rbtree * const t)
     if (t->t.root != NULL) {
         size_t min, max;
 
+        ck_assert_ptr_null(__cstl_bintree_parent(t->t.root));
+        ck_assert_int_eq(BN_COLOR(t->t.root), CSTL_RBTREE_COLOR_B);
+
         cstl_rbtree_height(t, &min, &max);
         ck_assert_uint_le(max, 2 * log2(cstl_rbtree_size(t) + 1));
         ck_assert_uint_le(max, 2 * min);
 
         cstl_rbtree_foreach(
-            t, __cstl_rbtree_verify, (void *)&t->t,
+            t, __cstl_rbtree_verify, (void *)t,
             CSTL_BINTREE_FOREACH_DIR_FWD);
     }
 }
@@ -500,6 +929,161 @@ START_TEST(random_empty)
 }
 END_TEST
 
+START_TEST(ranked)
+{
+    static const size_t n = 500;
+
+    DECLARE_CSTL_RBTREE(t, struct integer, n, cmp_integer, NULL);
+    unsigned char present[500];
+    struct integer lo, hi;
+    unsigned int i;
+
+    memset(present, 0, sizeof(present));
+
+    ck_assert_signal(SIGABRT, cstl_rbtree_rank(&t, &lo));
+    cstl_rbtree_set_ranked(&t, true);
+
+    /* insert and remove at random, checking ranks along the way */
+    for (i = 0; i < 8 * n; i++) {
+        struct integer * in = malloc(sizeof(*in));
+        size_t j, r;
+
+        in->v = rand() % n;
+        if (!present[in->v]) {
+            cstl_rbtree_insert(&t, in, NULL);
+            present[in->v] = 1;
+        } else {
+            const int v = in->v;
+
+            free(in);
+            lo.v = v;
+            in = cstl_rbtree_erase(&t, &lo);
+            ck_assert_ptr_nonnull(in);
+            free(in);
+            present[v] = 0;
+        }
+
+        if (i % 97 == 0) {
+            cstl_rbtree_verify(&t);
+
+            for (j = 0, r = 0; j < n; j++) {
+                const struct integer * sel;
+
+                lo.v = j;
+                ck_assert_uint_eq(cstl_rbtree_rank(&t, &lo), r);
+                if (present[j]) {
+                    sel = cstl_rbtree_select(&t, r);
+                    ck_assert_int_eq(sel->v, j);
+                    r++;
+                }
+            }
+            ck_assert_uint_eq(r, cstl_rbtree_size(&t));
+            ck_assert_ptr_null(cstl_rbtree_select(&t, r));
+        }
+    }
+
+    cstl_rbtree_clear(&t, __test_cstl_rbtree_free, NULL);
+
+    __test__cstl_rbtree_fill(&t, n);
+    cstl_rbtree_verify(&t);
+    ck_assert_signal(SIGABRT, cstl_rbtree_set_ranked(&t, false));
+
+    lo.v = 100; hi.v = 200;
+    ck_assert_uint_eq(cstl_rbtree_count_range(&t, &lo, &hi), 100);
+    lo.v = -5; hi.v = 5;
+    ck_assert_uint_eq(cstl_rbtree_count_range(&t, &lo, &hi), 5);
+    lo.v = 300; hi.v = 200;
+    ck_assert_uint_eq(cstl_rbtree_count_range(&t, &lo, &hi), 0);
+
+    cstl_rbtree_clear(&t, __test_cstl_rbtree_free, NULL);
+}
+END_TEST
+
+static int __test_cstl_rbtree_order_visit(
+    const void * const e, const cstl_bintree_visit_order_t order,
+    void * const p)
+{
+    int * const next = p;
+
+    ck_assert_int_eq(((const struct integer *)e)->v, *next);
+    (*next)++;
+
+    return 0;
+    (void)order;
+}
+
+static void __test_cstl_rbtree_order(const struct cstl_rbtree * const t,
+                                     const int first)
+{
+    int next = first;
+
+    cstl_rbtree_verify(t);
+    cstl_rbtree_foreach_inorder(t, __test_cstl_rbtree_order_visit, &next,
+                                CSTL_BINTREE_FOREACH_DIR_FWD);
+    ck_assert_uint_eq(next - first, cstl_rbtree_size(t));
+}
+
+START_TEST(build)
+{
+    static const unsigned int n = 300;
+
+    struct integer * const in = malloc(2 * n * sizeof(*in));
+    void ** const e = malloc(2 * n * sizeof(*e));
+    unsigned int i, j, k;
+
+    for (i = 0; i < 2 * n; i++) {
+        in[i].v = i;
+        e[i] = &in[i];
+    }
+
+    for (i = 0; i < n; i++) {
+        DECLARE_CSTL_RBTREE(t, struct integer, n, cmp_integer, NULL);
+
+        cstl_rbtree_set_ranked(&t, i % 2);
+
+        cstl_rbtree_build(&t, e, i);
+        ck_assert_uint_eq(cstl_rbtree_size(&t), i);
+        __test_cstl_rbtree_order(&t, 0);
+
+        if (i > 0) {
+            ck_assert_signal(SIGABRT, cstl_rbtree_build(&t, e, i));
+        }
+
+        /*
+         * append to the tree, in pieces of varying sizes, so
+         * that the existing tree is sometimes taller and
+         * sometimes shorter than the one being joined to it
+         */
+        for (j = i; j < 2 * n; j += k) {
+            k = j / 3 + 1;
+            if (j + k > 2 * n) {
+                k = 2 * n - j;
+            }
+
+            cstl_rbtree_append(&t, e + j, k);
+            __test_cstl_rbtree_order(&t, 0);
+        }
+
+        if (i % 2) {
+            struct integer lo;
+
+            lo.v = n;
+            ck_assert_uint_eq(cstl_rbtree_rank(&t, &lo), n);
+            ck_assert_ptr_eq(cstl_rbtree_select(&t, n - 1), &in[n - 1]);
+        }
+
+        /* an appended tree is still a valid tree */
+        for (j = 0; j < 2 * n; j += 3) {
+            cstl_rbtree_erase(&t, &in[j]);
+        }
+        cstl_rbtree_verify(&t);
+    }
+
+    free(e);
+    free(in);
+}
+END_TEST
+
 Suite * rbtree_suite(void)
 {
     Suite * const s = suite_create("rbtree");
@@ -511,6 +1095,8 @@ Suite * rbtree_suite(void)
     tcase_add_test(tc, fill);
     tcase_add_test(tc, random_fill);
     tcase_add_test(tc, random_empty);
+    tcase_add_test(tc, ranked);
+    tcase_add_test(tc, build);
 
     suite_add_tcase(s, tc);
 
@@ -0,0 +1,415 @@
+/*!
+ * @file
+ */
+
+#include "cstl/rheap.h"
+
+#include <stdlib.h>
+
+/*! @private */
+static inline struct cstl_rheap_node * cstl_rheap_node(
+    const struct cstl_rheap * const h, void * const e)
+{
+    return (void *)((uintptr_t)e + h->off);
+}
+
+/*!
+ * @private
+ *
+ * return the bucket for a key, given the last key removed
+ */
+static inline unsigned int cstl_rheap_bucket(const unsigned long last,
+                                             const unsigned long key)
+{
+    /* cstl_fls() returns -1 if the keys are equal, selecting bucket 0 */
+    return cstl_fls(key ^ last) + 1;
+}
+
+void cstl_rheap_init(struct cstl_rheap * const h, const size_t off)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(h->b) / sizeof(*h->b); i++) {
+        cstl_dlist_init(&h->b[i], off + offsetof(struct cstl_rheap_node, ln));
+    }
+
+    h->last = 0;
+    h->floor = 0;
+    h->size = 0;
+
+    h->off = off;
+}
+
+void cstl_rheap_push(struct cstl_rheap * const h,
+                     void * const e, const unsigned long key)
+{
+    if (key < h->floor) {
+        abort();
+    }
+
+    if (key < h->last) {
+        /*
+         * a call to get() raised the base above the new key, which
+         * is now the lowest in the heap. lower the base to the key.
+         * the key and the old base first differ in the bit selected
+         * by bucket b, in which the old base has the 1. the keys in
+         * the buckets below b all agree with the old base in that
+         * bit and above, so they differ from the new base first in
+         * that bit and move to bucket b, which is empty since no key
+         * in it could be greater than the old base. the keys in the
+         * buckets above b stay where they are.
+         */
+        const unsigned int b = cstl_rheap_bucket(h->last, key);
+        unsigned int i;
+
+        for (i = 0; i < b; i++) {
+            cstl_dlist_concat(&h->b[b], &h->b[i]);
+        }
+        h->last = key;
+    }
+
+    cstl_rheap_node(h, e)->key = key;
+    cstl_dlist_push_back(&h->b[cstl_rheap_bucket(h->last, key)], e);
+    h->size++;
+}
+
+/*! @private */
+struct cstl_rheap_min_priv
+{
+    const struct cstl_rheap * h;
+    unsigned long min;
+};
+
+/*! @private */
+static int cstl_rheap_min_visit(void * const e, void * const p)
+{
+    struct cstl_rheap_min_priv * const mp = p;
+    const unsigned long key = cstl_rheap_node(mp->h, e)->key;
+
+    if (key < mp->min) {
+        mp->min = key;
+    }
+
+    return 0;
+}
+
+void * cstl_rheap_get(struct cstl_rheap * const h, unsigned long * const key)
+{
+    void * e;
+
+    if (h->size == 0) {
+        return NULL;
+    }
+
+    if (cstl_dlist_size(&h->b[0]) == 0) {
+        struct cstl_rheap_min_priv mp;
+        unsigned int i;
+
+        /*
+         * find the lowest, nonempty bucket, and make the lowest key
+         * within it the last key. every other key in the bucket
+         * differs from the new last key in a lower bit than
+         * it did from the old one, so the objects are all
+         * redistributed into lower buckets
+         */
+        for (i = 1; cstl_dlist_size(&h->b[i]) == 0; i++)
+            ;
+
+        mp.h = h;
+        mp.min = ULONG_MAX;
+        cstl_dlist_foreach(&h->b[i],
+                           cstl_rheap_min_visit, &mp,
+                           CSTL_DLIST_FOREACH_DIR_FWD);
+        h->last = mp.min;
+
+        while ((e = cstl_dlist_pop_front(&h->b[i])) != NULL) {
+            cstl_dlist_push_back(
+                &h->b[cstl_rheap_bucket(h->last, cstl_rheap_node(h, e)->key)],
+                e);
+        }
+    }
+
+    e = cstl_dlist_front(&h->b[0]);
+    if (key != NULL) {
+        *key = h->last;
+    }
+
+    return e;
+}
+
+void * cstl_rheap_pop(struct cstl_rheap * const h, unsigned long * const key)
+{
+    void * const e = cstl_rheap_get(h, key);
+
+    if (e != NULL) {
+        cstl_dlist_erase(&h->b[0], e);
+        h->size--;
+
+        h->floor = h->last;
+    }
+
+    return e;
+}
+
+void cstl_rheap_erase(struct cstl_rheap * const h, void * const e)
+{
+    cstl_dlist_erase(
+        &h->b[cstl_rheap_bucket(h->last, cstl_rheap_node(h, e)->key)], e);
+    h->size--;
+}
+
+void cstl_rheap_clear(struct cstl_rheap * const h,
+                      cstl_xtor_func_t * const clr)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(h->b) / sizeof(*h->b); i++) {
+        cstl_dlist_clear(&h->b[i], clr);
+    }
+
+    h->last = 0;
+    h->floor = 0;
+    h->size = 0;
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include <stdbool.h>
+
+struct event
+{
+    unsigned long when;
+    struct cstl_rheap_node hn;
+};
+
+static void rheap_clr(void * const e, void * const p)
+{
+    (void)e;
+    (void)p;
+}
+
+START_TEST(init)
+{
+    struct cstl_rheap h;
+    struct event e;
+    unsigned long key;
+
+    cstl_rheap_init(&h, offsetof(struct event, hn));
+    ck_assert_uint_eq(cstl_rheap_size(&h), 0);
+    ck_assert_ptr_null(cstl_rheap_get(&h, &key));
+    ck_assert_ptr_null(cstl_rheap_pop(&h, NULL));
+
+    cstl_rheap_push(&h, &e, 0);
+    ck_assert_ptr_eq(cstl_rheap_get(&h, &key), &e);
+    ck_assert_uint_eq(key, 0);
+    ck_assert_ptr_eq(cstl_rheap_pop(&h, &key), &e);
+
+    cstl_rheap_push(&h, &e, ULONG_MAX);
+    ck_assert_ptr_eq(cstl_rheap_pop(&h, &key), &e);
+    ck_assert_uint_eq(key, ULONG_MAX);
+
+    /* keys may not go backward */
+    ck_assert_signal(SIGABRT, cstl_rheap_push(&h, &e, ULONG_MAX - 1));
+    cstl_rheap_push(&h, &e, ULONG_MAX);
+    ck_assert_uint_eq(cstl_rheap_size(&h), 1);
+    cstl_rheap_clear(&h, rheap_clr);
+    ck_assert_uint_eq(cstl_rheap_size(&h), 0);
+
+    /* after clearing, any key is valid again */
+    cstl_rheap_push(&h, &e, 0);
+    ck_assert_uint_eq(cstl_rheap_size(&h), 1);
+    cstl_rheap_clear(&h, rheap_clr);
+}
+END_TEST
+
+START_TEST(peek)
+{
+    static const unsigned int n = 1000;
+
+    struct event * const ev = malloc(n * sizeof(*ev));
+    struct cstl_rheap h;
+    struct event a, b, c;
+    unsigned long key, now;
+    unsigned int i, m;
+
+    cstl_rheap_init(&h, offsetof(struct event, hn));
+
+    /* looking at the lowest key doesn't prevent pushing a lower one */
+    cstl_rheap_push(&h, &a, 10);
+    ck_assert_ptr_eq(cstl_rheap_get(&h, &key), &a);
+    ck_assert_uint_eq(key, 10);
+    cstl_rheap_push(&h, &b, 5);
+    ck_assert_ptr_eq(cstl_rheap_get(&h, &key), &b);
+    ck_assert_uint_eq(key, 5);
+
+    /* but removing it does */
+    ck_assert_ptr_eq(cstl_rheap_pop(&h, &key), &b);
+    ck_assert_signal(SIGABRT, cstl_rheap_push(&h, &c, 4));
+    cstl_rheap_push(&h, &c, 5);
+    ck_assert_ptr_eq(cstl_rheap_pop(&h, &key), &c);
+    ck_assert_ptr_eq(cstl_rheap_pop(&h, &key), &a);
+    ck_assert_uint_eq(key, 10);
+
+    /*
+     * peek, push, and pop at random, pushing keys anywhere
+     * from the last key removed upward
+     */
+    now = key;
+    for (i = 0, m = 0; i < 20 * n; i++) {
+        const int op = rand() % 3;
+
+        if (op == 0 && m < n) {
+            ev[m].when = now + rand() % (1 << (i % 16));
+            cstl_rheap_push(&h, &ev[m], ev[m].when);
+            m++;
+        } else if (op == 1 && m > 0) {
+            const struct event * const e = cstl_rheap_get(&h, &key);
+
+            ck_assert_uint_eq(e->when, key);
+            ck_assert_uint_ge(key, now);
+        } else if (m > 0) {
+            struct event * const e = cstl_rheap_pop(&h, &key);
+
+            ck_assert_uint_eq(e->when, key);
+            ck_assert_uint_ge(key, now);
+            now = key;
+
+            /* keep the objects in the heap at the front of the array */
+            m--;
+            if (e != &ev[m]) {
+                cstl_rheap_erase(&h, &ev[m]);
+                *e = ev[m];
+                cstl_rheap_push(&h, e, e->when);
+            }
+        }
+        ck_assert_uint_eq(cstl_rheap_size(&h), m);
+    }
+
+    cstl_rheap_clear(&h, rheap_clr);
+    free(ev);
+}
+END_TEST
+
+/*
+ * a simulation: each event, when popped, schedules
+ * itself again at some point in the future
+ */
+START_TEST(monotone)
+{
+    static const unsigned int n = 1000;
+
+    struct event * const ev = malloc(n * sizeof(*ev));
+    struct cstl_rheap h;
+    unsigned long now;
+    unsigned int i;
+
+    cstl_rheap_init(&h, offsetof(struct event, hn));
+
+    for (i = 0; i < n; i++) {
+        ev[i].when = rand() % 10000;
+        cstl_rheap_push(&h, &ev[i], ev[i].when);
+    }
+
+    now = 0;
+    for (i = 0; i < 20 * n; i++) {
+        struct event * const e = cstl_rheap_pop(&h, &now);
+
+        ck_assert_uint_eq(e->when, now);
+        ck_assert_uint_eq(cstl_rheap_size(&h), n - 1);
+
+        /* some events recur at the same time */
+        e->when = now + (rand() % 4 == 0 ? 0 : rand() % (1 << (i % 24)));
+        cstl_rheap_push(&h, e, e->when);
+    }
+
+    for (i = 0; i < n; i++) {
+        const struct event * const e = cstl_rheap_pop(&h, NULL);
+
+        ck_assert_uint_ge(e->when, now);
+        now = e->when;
+    }
+    ck_assert_uint_eq(cstl_rheap_size(&h), 0);
+    ck_assert_ptr_null(cstl_rheap_pop(&h, NULL));
+
+    free(ev);
+}
+END_TEST
+
+START_TEST(erase)
+{
+    static const unsigned int n = 1000;
+
+    struct event * const ev = malloc(n * sizeof(*ev));
+    bool * const present = malloc(n * sizeof(*present));
+    struct cstl_rheap h;
+    unsigned long now, key;
+    unsigned int i;
+
+    cstl_rheap_init(&h, offsetof(struct event, hn));
+
+    for (i = 0; i < n; i++) {
+        ev[i].when = 101 + rand() % 10000;
+        cstl_rheap_push(&h, &ev[i], ev[i].when);
+        present[i] = true;
+    }
+
+    /* establish a last key so that the buckets are rearranged */
+    ev[0].when = 100;
+    cstl_rheap_erase(&h, &ev[0]);
+    cstl_rheap_push(&h, &ev[0], ev[0].when);
+    ck_assert_ptr_eq(cstl_rheap_get(&h, &key), &ev[0]);
+    ck_assert_uint_eq(key, 100);
+
+    /* lower the keys of some objects and remove others */
+    for (i = 1; i < n; i++) {
+        if (i % 3 == 0) {
+            cstl_rheap_erase(&h, &ev[i]);
+            present[i] = false;
+        } else if (i % 3 == 1) {
+            cstl_rheap_erase(&h, &ev[i]);
+            ev[i].when = key + (ev[i].when - key) / 2;
+            cstl_rheap_push(&h, &ev[i], ev[i].when);
+        }
+    }
+
+    now = 0;
+    while (cstl_rheap_size(&h) > 0) {
+        const struct event * const e = cstl_rheap_pop(&h, &key);
+
+        ck_assert(present[e - ev]);
+        present[e - ev] = false;
+
+        ck_assert_uint_eq(e->when, key);
+        ck_assert_uint_ge(key, now);
+        now = key;
+    }
+
+    for (i = 0; i < n; i++) {
+        ck_assert(!present[i]);
+    }
+
+    free(present);
+    free(ev);
+}
+END_TEST
+
+Suite * rheap_suite(void)
+{
+    Suite * const s = suite_create("rheap");
+
+    TCase * tc;
+
+    tc = tcase_create("rheap");
+    tcase_add_test(tc, init);
+    tcase_add_test(tc, peek);
+    tcase_add_test(tc, monotone);
+    tcase_add_test(tc, erase);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
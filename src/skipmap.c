@@ -0,0 +1,936 @@
+/*!
+ * @file
+ */
+
+#include "cstl/skipmap.h"
+#include "cstl/allocator.h"
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * the map is the lock-free skip list described by Herlihy and Shavit,
+ * in turn based on Fraser's. every node is in the bottom level of the
+ * list, and a node of height h is also in the h - 1 levels above that.
+ *
+ * a node is removed by first setting the low bit (the "mark") of each
+ * of its own next pointers, from the top down. once a pointer is marked,
+ * it can no longer be changed, so nothing can be inserted after the node.
+ * marking the bottom level is the point at which the node is removed
+ * from the map. searches that come across a marked node unlink it, and
+ * the thread that removed the node searches for it to make sure that it
+ * has been unlinked from every level.
+ */
+#define CSTL_SKIPMAP_MARK       ((uintptr_t)1)
+
+struct cstl_skipmap_node
+{
+    cstl_skipmap_elem_t e;
+
+    /*
+     * the inserting thread may still be linking the node into the
+     * upper levels when another thread removes it. the node can only
+     * be retired once both threads are finished with it, so this is
+     * the number of threads yet to finish
+     */
+    atomic_uint owed;
+    unsigned int height;
+
+    /* link in the list of retired nodes */
+    struct cstl_skipmap_node * retired;
+
+    atomic_uintptr_t next[];
+};
+
+/*
+ * a handle to the map, used by a single thread at a time. nodes are
+ * retired into the current list, and the handle moves on to the next
+ * list, emptying it first, each time it sees a new epoch at the start
+ * of an operation. a list is therefore emptied only after the handle
+ * has seen three new epochs since it last retired a node into it.
+ * the lists are rotated by the handle rather than indexed by the
+ * epoch so that the rotation doesn't depend on the epoch not wrapping
+ */
+struct cstl_skipmap_handle
+{
+    cstl_skipmap_t * sm;
+    /* the next handle in the map's list, immutable once published */
+    struct cstl_skipmap_handle * next;
+
+    atomic_uint attached;
+    /*
+     * twice the epoch in which the handle is operating, plus
+     * one, or zero if the handle isn't currently operating
+     */
+    atomic_uint epoch;
+
+    unsigned int seen;
+    struct cstl_skipmap_node * limbo[3];
+    /* the list into which nodes are currently being retired */
+    unsigned int cur;
+    unsigned int retired;
+
+    uint32_t rand;
+};
+
+/*
+ * the number of nodes retired by a handle between attempts to
+ * advance the epoch. the attempt requires a read of every handle
+ */
+#define CSTL_SKIPMAP_RETIRE_BATCH       64
+
+/*! @private */
+static inline struct cstl_skipmap_node * cstl_skipmap_ptr(const uintptr_t p)
+{
+    return (struct cstl_skipmap_node *)(p & ~CSTL_SKIPMAP_MARK);
+}
+
+/*! @private */
+static inline size_t cstl_skipmap_node_size(const unsigned int height)
+{
+    return offsetof(struct cstl_skipmap_node, next)
+        + height * sizeof(atomic_uintptr_t);
+}
+
+/*! @private */
+static void cstl_skipmap_node_free(struct cstl_skipmap_node * const n)
+{
+    cstl_allocator_free(NULL, n, cstl_skipmap_node_size(n->height));
+}
+
+/*! @private */
+static void cstl_skipmap_limbo_free(struct cstl_skipmap_node * n)
+{
+    while (n != NULL) {
+        struct cstl_skipmap_node * const r = n->retired;
+        cstl_skipmap_node_free(n);
+        n = r;
+    }
+}
+
+/*!
+ * @private
+ *
+ * move the global epoch forward if every handle that is
+ * currently operating on the map has seen the current epoch
+ */
+static void cstl_skipmap_advance(cstl_skipmap_t * const sm)
+{
+    unsigned int e = atomic_load(&sm->epoch);
+    const struct cstl_skipmap_handle * h;
+
+    for (h = (void *)atomic_load(&sm->handles); h != NULL; h = h->next) {
+        const unsigned int he = atomic_load(&h->epoch);
+
+        if (he != 0 && he != ((e << 1) | 1)) {
+            return;
+        }
+    }
+
+    atomic_compare_exchange_strong(&sm->epoch, &e, e + 1);
+}
+
+/*! @private */
+static void cstl_skipmap_enter(struct cstl_skipmap_handle * const h)
+{
+    const unsigned int e = atomic_load(&h->sm->epoch);
+
+    /*
+     * the store is sequentially consistent, so no pointer
+     * in the map is read until the epoch has been published
+     */
+    atomic_store(&h->epoch, (e << 1) | 1);
+
+    if (e != h->seen) {
+        h->seen = e;
+        h->cur = (h->cur + 1) % 3;
+
+        cstl_skipmap_limbo_free(h->limbo[h->cur]);
+        h->limbo[h->cur] = NULL;
+    }
+}
+
+/*! @private */
+static void cstl_skipmap_exit(struct cstl_skipmap_handle * const h)
+{
+    atomic_store_explicit(&h->epoch, 0, memory_order_release);
+}
+
+/*!
+ * @private
+ *
+ * give up the calling thread's claim on a node. the last
+ * thread to do so retires the node into its handle's limbo
+ */
+static void cstl_skipmap_release(struct cstl_skipmap_handle * const h,
+                                 struct cstl_skipmap_node * const n)
+{
+    if (atomic_fetch_sub(&n->owed, 1) == 1) {
+        n->retired = h->limbo[h->cur];
+        h->limbo[h->cur] = n;
+
+        if (++h->retired >= CSTL_SKIPMAP_RETIRE_BATCH) {
+            cstl_skipmap_advance(h->sm);
+            h->retired = 0;
+        }
+    }
+}
+
+/*!
+ * @private
+ *
+ * choose the height of a new node. each level
+ * is a quarter as likely as the one beneath it
+ */
+static unsigned int cstl_skipmap_height(struct cstl_skipmap_handle * const h)
+{
+    uint32_t r = h->rand;
+    unsigned int height;
+
+    /* xorshift32 */
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    h->rand = r;
+
+    for (height = 1;
+         height < CSTL_SKIPMAP_MAX_LEVEL && (r & 3) == 0;
+         height++, r >>= 2)
+        ;
+
+    return height;
+}
+
+/*!
+ * @private
+ *
+ * find the links at each level between which @key would be inserted.
+ * @preds receives the next arrays of the nodes before the position,
+ * and @succs receives the nodes after it. marked nodes encountered
+ * along the way are unlinked
+ *
+ * returns true if @succs[0] contains the key
+ */
+static bool cstl_skipmap_search(cstl_skipmap_t * const sm,
+                                const void * const key,
+                                atomic_uintptr_t ** const preds,
+                                struct cstl_skipmap_node ** const succs)
+{
+    atomic_uintptr_t * pred;
+    unsigned int l;
+
+retry:
+    pred = sm->head;
+    for (l = CSTL_SKIPMAP_MAX_LEVEL; l-- > 0;) {
+        struct cstl_skipmap_node * curr =
+            cstl_skipmap_ptr(atomic_load(&pred[l]));
+
+        while (curr != NULL) {
+            uintptr_t succ = atomic_load(&curr->next[l]);
+
+            if ((succ & CSTL_SKIPMAP_MARK) != 0) {
+                uintptr_t exp = (uintptr_t)curr;
+
+                /* the current node is being removed; unlink it */
+                if (!atomic_compare_exchange_strong(
+                        &pred[l], &exp, succ & ~CSTL_SKIPMAP_MARK)) {
+                    goto retry;
+                }
+                curr = cstl_skipmap_ptr(succ);
+            } else if (sm->cmp.f(curr->e.key, key, sm->cmp.p) < 0) {
+                pred = curr->next;
+                curr = cstl_skipmap_ptr(succ);
+            } else {
+                break;
+            }
+        }
+
+        preds[l] = pred;
+        succs[l] = curr;
+    }
+
+    return succs[0] != NULL
+        && sm->cmp.f(succs[0]->e.key, key, sm->cmp.p) == 0;
+}
+
+/*!
+ * @private
+ *
+ * find the first node whose key is not less than @key, without
+ * modifying the list. if @key is NULL, the first node is returned
+ */
+static struct cstl_skipmap_node * cstl_skipmap_lower_bound(
+    const cstl_skipmap_t * const sm, const void * const key)
+{
+    const atomic_uintptr_t * pred = sm->head;
+    struct cstl_skipmap_node * curr = NULL;
+    unsigned int l;
+
+    for (l = CSTL_SKIPMAP_MAX_LEVEL; l-- > 0;) {
+        curr = cstl_skipmap_ptr(atomic_load(&pred[l]));
+
+        while (curr != NULL) {
+            const uintptr_t succ = atomic_load(&curr->next[l]);
+
+            if ((succ & CSTL_SKIPMAP_MARK) != 0) {
+                /* a removed node's pointers no longer change */
+                curr = cstl_skipmap_ptr(succ);
+            } else if (key != NULL
+                       && sm->cmp.f(curr->e.key, key, sm->cmp.p) < 0) {
+                pred = curr->next;
+                curr = cstl_skipmap_ptr(succ);
+            } else {
+                break;
+            }
+        }
+    }
+
+    return curr;
+}
+
+void cstl_skipmap_init(cstl_skipmap_t * const sm,
+                       cstl_compare_func_t * const cmp, void * const priv)
+{
+    unsigned int l;
+
+    for (l = 0; l < CSTL_SKIPMAP_MAX_LEVEL; l++) {
+        atomic_init(&sm->head[l], 0);
+    }
+    atomic_init(&sm->size, 0);
+
+    sm->cmp.f = cmp;
+    sm->cmp.p = priv;
+
+    atomic_init(&sm->epoch, 0);
+    atomic_init(&sm->handles, 0);
+}
+
+cstl_skipmap_handle_t * cstl_skipmap_attach(cstl_skipmap_t * const sm)
+{
+    struct cstl_skipmap_handle * h;
+    uintptr_t head;
+
+    for (h = (void *)atomic_load(&sm->handles); h != NULL; h = h->next) {
+        unsigned int exp = 0;
+
+        if (atomic_compare_exchange_strong(&h->attached, &exp, 1)) {
+            return h;
+        }
+    }
+
+    h = cstl_allocator_alloc(NULL, sizeof(*h));
+    if (h != NULL) {
+        h->sm = sm;
+
+        atomic_init(&h->attached, 1);
+        atomic_init(&h->epoch, 0);
+
+        h->seen = 0;
+        h->limbo[0] = h->limbo[1] = h->limbo[2] = NULL;
+        h->cur = 0;
+        h->retired = 0;
+
+        /* any nonzero seed will do */
+        h->rand = (uint32_t)(uintptr_t)h | 1;
+
+        head = atomic_load(&sm->handles);
+        do {
+            h->next = (void *)head;
+        } while (!atomic_compare_exchange_weak(
+                     &sm->handles, &head, (uintptr_t)h));
+    }
+
+    return h;
+}
+
+void cstl_skipmap_detach(cstl_skipmap_handle_t * const h)
+{
+    atomic_store(&h->attached, 0);
+}
+
+bool cstl_skipmap_find(cstl_skipmap_handle_t * const h,
+                       const void * const key, void ** const val)
+{
+    const cstl_skipmap_t * const sm = h->sm;
+    struct cstl_skipmap_node * n;
+    bool found;
+
+    cstl_skipmap_enter(h);
+
+    n = cstl_skipmap_lower_bound(sm, key);
+    found = n != NULL && sm->cmp.f(n->e.key, key, sm->cmp.p) == 0;
+    if (found && val != NULL) {
+        *val = n->e.val;
+    }
+
+    cstl_skipmap_exit(h);
+
+    return found;
+}
+
+int cstl_skipmap_insert(cstl_skipmap_handle_t * const h,
+                        const void * const key, void * const val)
+{
+    cstl_skipmap_t * const sm = h->sm;
+
+    atomic_uintptr_t * preds[CSTL_SKIPMAP_MAX_LEVEL];
+    struct cstl_skipmap_node * succs[CSTL_SKIPMAP_MAX_LEVEL];
+    struct cstl_skipmap_node * n = NULL;
+    unsigned int l;
+
+    cstl_skipmap_enter(h);
+
+    for (;;) {
+        uintptr_t exp;
+
+        if (cstl_skipmap_search(sm, key, preds, succs)) {
+            /* the node was never visible to any other thread */
+            if (n != NULL) {
+                cstl_skipmap_node_free(n);
+            }
+            cstl_skipmap_exit(h);
+            return 1;
+        }
+
+        if (n == NULL) {
+            const unsigned int height = cstl_skipmap_height(h);
+
+            n = cstl_allocator_alloc(NULL, cstl_skipmap_node_size(height));
+            if (n == NULL) {
+                cstl_skipmap_exit(h);
+                return -1;
+            }
+
+            n->e.key = key;
+            n->e.val = val;
+
+            atomic_init(&n->owed, 2);
+            n->height = height;
+        }
+
+        for (l = 0; l < n->height; l++) {
+            atomic_init(&n->next[l], (uintptr_t)succs[l]);
+        }
+
+        /* the node is in the map once it's in the bottom level */
+        exp = (uintptr_t)succs[0];
+        if (atomic_compare_exchange_strong(
+                &preds[0][0], &exp, (uintptr_t)n)) {
+            break;
+        }
+    }
+
+    atomic_fetch_add(&sm->size, 1);
+
+    for (l = 1; l < n->height; l++) {
+        for (;;) {
+            uintptr_t nx = atomic_load(&n->next[l]), exp;
+
+            /*
+             * make sure the node points at the current successor
+             * before linking it in. only the remover changes a
+             * pointer that this thread has set, and only to mark it,
+             * in which case there's no point in going further
+             */
+            if ((nx & CSTL_SKIPMAP_MARK) != 0
+                || (nx != (uintptr_t)succs[l]
+                    && !atomic_compare_exchange_strong(
+                        &n->next[l], &nx, (uintptr_t)succs[l]))) {
+                goto linked;
+            }
+
+            exp = (uintptr_t)succs[l];
+            if (atomic_compare_exchange_strong(
+                    &preds[l][l], &exp, (uintptr_t)n)) {
+                break;
+            }
+
+            /* the neighborhood changed; find it again */
+            if (!cstl_skipmap_search(sm, key, preds, succs)
+                || succs[0] != n) {
+                goto linked;
+            }
+        }
+    }
+
+linked:
+    /*
+     * if the node was removed while it was being linked in, the
+     * remover may have missed the levels linked after its search
+     */
+    if ((atomic_load(&n->next[0]) & CSTL_SKIPMAP_MARK) != 0) {
+        cstl_skipmap_search(sm, key, preds, succs);
+    }
+    cstl_skipmap_release(h, n);
+
+    cstl_skipmap_exit(h);
+
+    return 0;
+}
+
+int cstl_skipmap_erase(cstl_skipmap_handle_t * const h,
+                       const void * const key, void ** const val)
+{
+    cstl_skipmap_t * const sm = h->sm;
+
+    atomic_uintptr_t * preds[CSTL_SKIPMAP_MAX_LEVEL];
+    struct cstl_skipmap_node * succs[CSTL_SKIPMAP_MAX_LEVEL];
+    struct cstl_skipmap_node * n;
+    uintptr_t nx;
+    unsigned int l;
+
+    cstl_skipmap_enter(h);
+
+    if (!cstl_skipmap_search(sm, key, preds, succs)) {
+        cstl_skipmap_exit(h);
+        return 1;
+    }
+    n = succs[0];
+
+    for (l = n->height - 1; l > 0; l--) {
+        nx = atomic_load(&n->next[l]);
+        while ((nx & CSTL_SKIPMAP_MARK) == 0
+               && !atomic_compare_exchange_weak(
+                   &n->next[l], &nx, nx | CSTL_SKIPMAP_MARK))
+            ;
+    }
+
+    nx = atomic_load(&n->next[0]);
+    do {
+        if ((nx & CSTL_SKIPMAP_MARK) != 0) {
+            /* another thread removed it first */
+            cstl_skipmap_exit(h);
+            return 1;
+        }
+    } while (!atomic_compare_exchange_weak(
+                 &n->next[0], &nx, nx | CSTL_SKIPMAP_MARK));
+
+    atomic_fetch_sub(&sm->size, 1);
+    if (val != NULL) {
+        *val = n->e.val;
+    }
+
+    /* unlink the node from every level */
+    cstl_skipmap_search(sm, key, preds, succs);
+    cstl_skipmap_release(h, n);
+
+    cstl_skipmap_exit(h);
+
+    return 0;
+}
+
+int cstl_skipmap_foreach_range(cstl_skipmap_handle_t * const h,
+                               const void * const lo, const void * const hi,
+                               cstl_const_visit_func_t * const visit,
+                               void * const priv)
+{
+    const cstl_skipmap_t * const sm = h->sm;
+    struct cstl_skipmap_node * n;
+    int res = 0;
+
+    cstl_skipmap_enter(h);
+
+    for (n = cstl_skipmap_lower_bound(sm, lo);
+         res == 0 && n != NULL
+             && (hi == NULL || sm->cmp.f(n->e.key, hi, sm->cmp.p) < 0);) {
+        const uintptr_t nx = atomic_load(&n->next[0]);
+
+        if ((nx & CSTL_SKIPMAP_MARK) == 0) {
+            res = visit(&n->e, priv);
+        }
+
+        n = cstl_skipmap_ptr(nx);
+    }
+
+    cstl_skipmap_exit(h);
+
+    return res;
+}
+
+void cstl_skipmap_clear(cstl_skipmap_t * const sm,
+                        cstl_xtor_func_t * const clr, void * const priv)
+{
+    struct cstl_skipmap_node * n;
+    struct cstl_skipmap_handle * h;
+    unsigned int l;
+
+    n = cstl_skipmap_ptr(atomic_load(&sm->head[0]));
+    while (n != NULL) {
+        struct cstl_skipmap_node * const nx =
+            cstl_skipmap_ptr(atomic_load(&n->next[0]));
+
+        if (clr != NULL) {
+            clr(&n->e, priv);
+        }
+        cstl_skipmap_node_free(n);
+
+        n = nx;
+    }
+
+    h = (void *)atomic_load(&sm->handles);
+    while (h != NULL) {
+        struct cstl_skipmap_handle * const nx = h->next;
+
+        for (l = 0; l < 3; l++) {
+            cstl_skipmap_limbo_free(h->limbo[l]);
+        }
+        cstl_allocator_free(NULL, h, sizeof(*h));
+
+        h = nx;
+    }
+
+    cstl_skipmap_init(sm, sm->cmp.f, sm->cmp.p);
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include <limits.h>
+#include <pthread.h>
+
+static int int_key_cmp(const void * const a, const void * const b,
+                       void * const nil)
+{
+    return (intptr_t)a - (intptr_t)b;
+
+    (void)nil;
+}
+
+/*
+ * check that each level is in order and contains only unmarked
+ * nodes that are also in the level beneath it. the map must not
+ * be in use by any other thread
+ */
+static void cstl_skipmap_verify(cstl_skipmap_t * const sm)
+{
+    unsigned int l;
+    size_t size = 0;
+
+    for (l = 0; l < CSTL_SKIPMAP_MAX_LEVEL; l++) {
+        const struct cstl_skipmap_node * n, * below = NULL;
+        const struct cstl_skipmap_node * p = NULL;
+
+        if (l > 0) {
+            below = cstl_skipmap_ptr(atomic_load(&sm->head[l - 1]));
+        }
+
+        for (n = cstl_skipmap_ptr(atomic_load(&sm->head[l]));
+             n != NULL;
+             n = cstl_skipmap_ptr(atomic_load(&n->next[l]))) {
+            ck_assert_uint_eq(atomic_load(&n->next[l]) & CSTL_SKIPMAP_MARK,
+                              0);
+            ck_assert_uint_gt(n->height, l);
+            if (p != NULL) {
+                ck_assert_int_lt(sm->cmp.f(p->e.key, n->e.key, sm->cmp.p),
+                                 0);
+            }
+
+            if (l > 0) {
+                while (below != n) {
+                    ck_assert_ptr_nonnull(below);
+                    below = cstl_skipmap_ptr(
+                        atomic_load(&below->next[l - 1]));
+                }
+            } else {
+                size++;
+            }
+
+            p = n;
+        }
+    }
+
+    ck_assert_uint_eq(size, cstl_skipmap_size(sm));
+}
+
+struct skipmap_range
+{
+    intptr_t next;
+    unsigned int count;
+};
+
+static int skipmap_range_visit(const void * const e, void * const priv)
+{
+    const cstl_skipmap_elem_t * const se = e;
+    struct skipmap_range * const r = priv;
+
+    /* only the odd keys are present */
+    ck_assert_int_eq((intptr_t)se->key, r->next | 1);
+    ck_assert_int_eq((intptr_t)se->val, -(intptr_t)se->key);
+
+    r->next = (intptr_t)se->key + 1;
+    r->count++;
+
+    return 0;
+}
+
+static void skipmap_clear_count(void * const e, void * const priv)
+{
+    (*(unsigned int *)priv)++;
+    (void)e;
+}
+
+START_TEST(basic)
+{
+    static const intptr_t n = 1000;
+
+    cstl_skipmap_handle_t * h, * h2;
+    struct skipmap_range r;
+    cstl_skipmap_t sm;
+    unsigned int cleared;
+    intptr_t i;
+    void * v;
+
+    cstl_skipmap_init(&sm, int_key_cmp, NULL);
+    h = cstl_skipmap_attach(&sm);
+    ck_assert_ptr_nonnull(h);
+
+    for (i = 1; i < n; i++) {
+        const intptr_t k = (i * 7) % n;
+
+        ck_assert_int_eq(cstl_skipmap_insert(h, (void *)k, (void *)-k), 0);
+        ck_assert_int_eq(cstl_skipmap_insert(h, (void *)k, NULL), 1);
+    }
+    cstl_skipmap_verify(&sm);
+    ck_assert_uint_eq(cstl_skipmap_size(&sm), n - 1);
+
+    ck_assert(!cstl_skipmap_find(h, (void *)0, &v));
+    ck_assert(!cstl_skipmap_find(h, (void *)n, NULL));
+
+    for (i = 2; i < n; i += 2) {
+        ck_assert(cstl_skipmap_find(h, (void *)i, &v));
+        ck_assert_int_eq((intptr_t)v, -i);
+
+        v = NULL;
+        ck_assert_int_eq(cstl_skipmap_erase(h, (void *)i, &v), 0);
+        ck_assert_int_eq((intptr_t)v, -i);
+        ck_assert_int_eq(cstl_skipmap_erase(h, (void *)i, NULL), 1);
+        ck_assert(!cstl_skipmap_find(h, (void *)i, NULL));
+    }
+    cstl_skipmap_verify(&sm);
+    ck_assert_uint_eq(cstl_skipmap_size(&sm), n / 2);
+
+    r.next = 0;
+    r.count = 0;
+    ck_assert_int_eq(cstl_skipmap_foreach_range(
+                         h, NULL, NULL, skipmap_range_visit, &r), 0);
+    ck_assert_uint_eq(r.count, n / 2);
+
+    r.next = 100;
+    r.count = 0;
+    ck_assert_int_eq(cstl_skipmap_foreach_range(
+                         h, (void *)100, (void *)200,
+                         skipmap_range_visit, &r), 0);
+    ck_assert_uint_eq(r.count, 50);
+
+    /* a detached handle is reused */
+    cstl_skipmap_detach(h);
+    h2 = cstl_skipmap_attach(&sm);
+    ck_assert_ptr_eq(h, h2);
+    h = cstl_skipmap_attach(&sm);
+    ck_assert_ptr_ne(h, h2);
+
+    cleared = 0;
+    cstl_skipmap_clear(&sm, skipmap_clear_count, &cleared);
+    ck_assert_uint_eq(cleared, n / 2);
+    ck_assert_uint_eq(cstl_skipmap_size(&sm), 0);
+}
+END_TEST
+
+struct skipmap_thread
+{
+    cstl_skipmap_t * sm;
+    unsigned int id, nthreads;
+    unsigned int ops;
+
+    unsigned char * present;
+    unsigned int errors;
+};
+
+#define SKIPMAP_TEST_KEYS       512
+
+/*
+ * each thread inserts and removes its own keys, which are interleaved
+ * with those of the other threads so that they modify neighboring
+ * links, and also walks the whole map, checking its order
+ */
+static int skipmap_thread_visit(const void * const e, void * const priv)
+{
+    const cstl_skipmap_elem_t * const se = e;
+    intptr_t * const last = priv;
+
+    if ((intptr_t)se->key <= *last) {
+        return -1;
+    }
+    *last = (intptr_t)se->key;
+
+    return 0;
+}
+
+static void * skipmap_thread(void * const arg)
+{
+    struct skipmap_thread * const t = arg;
+    cstl_skipmap_handle_t * const h = cstl_skipmap_attach(t->sm);
+    unsigned int i, seed = t->id + 1;
+
+    for (i = 0; i < t->ops; i++) {
+        const intptr_t k =
+            (rand_r(&seed) % (SKIPMAP_TEST_KEYS / t->nthreads))
+            * t->nthreads + t->id + 1;
+        intptr_t last = 0;
+        void * v;
+
+        switch (rand_r(&seed) % 4) {
+        case 0:
+        case 1:
+            if (cstl_skipmap_insert(h, (void *)k, (void *)k)
+                != t->present[k]) {
+                t->errors++;
+            }
+            t->present[k] = 1;
+            break;
+        case 2:
+            if (cstl_skipmap_erase(h, (void *)k, &v) != !t->present[k]
+                || (t->present[k] && v != (void *)k)) {
+                t->errors++;
+            }
+            t->present[k] = 0;
+            break;
+        default:
+            if (cstl_skipmap_find(h, (void *)k, NULL) != t->present[k]) {
+                t->errors++;
+            }
+            if (i % 64 == 0
+                && cstl_skipmap_foreach_range(
+                    h, NULL, NULL, skipmap_thread_visit, &last) != 0) {
+                t->errors++;
+            }
+            break;
+        }
+    }
+
+    cstl_skipmap_detach(h);
+
+    return NULL;
+}
+
+static unsigned int skipmap_limbo_count(
+    const struct cstl_skipmap_handle * const h)
+{
+    unsigned int l, c = 0;
+
+    for (l = 0; l < 3; l++) {
+        const struct cstl_skipmap_node * n;
+
+        for (n = h->limbo[l]; n != NULL; n = n->retired) {
+            c++;
+        }
+    }
+
+    return c;
+}
+
+START_TEST(wrap)
+{
+    cstl_skipmap_handle_t * h;
+    cstl_skipmap_t sm;
+    unsigned int i;
+
+    cstl_skipmap_init(&sm, int_key_cmp, NULL);
+    atomic_store(&sm.epoch, UINT_MAX);
+    h = cstl_skipmap_attach(&sm);
+
+    /* retire a node during the last epoch before the wrap */
+    ck_assert_int_eq(cstl_skipmap_insert(h, (void *)1, NULL), 0);
+    ck_assert_int_eq(cstl_skipmap_erase(h, (void *)1, NULL), 0);
+    ck_assert_uint_eq(skipmap_limbo_count(h), 1);
+
+    /*
+     * other threads may still be looking at the node, so it
+     * is kept through the next two epochs, despite the wrap
+     */
+    for (i = 0; i < 2; i++) {
+        atomic_store(&sm.epoch, i);
+        ck_assert(!cstl_skipmap_find(h, (void *)1, NULL));
+        ck_assert_uint_eq(skipmap_limbo_count(h), 1);
+    }
+
+    atomic_store(&sm.epoch, 2);
+    ck_assert(!cstl_skipmap_find(h, (void *)1, NULL));
+    ck_assert_uint_eq(skipmap_limbo_count(h), 0);
+
+    cstl_skipmap_detach(h);
+    cstl_skipmap_clear(&sm, NULL, NULL);
+}
+END_TEST
+
+START_TEST(threads)
+{
+    static const unsigned int nthreads = 4;
+
+    struct skipmap_thread t[4];
+    pthread_t th[4];
+    unsigned char * present;
+    cstl_skipmap_handle_t * h;
+    cstl_skipmap_t sm;
+    unsigned int i;
+    size_t size;
+    intptr_t k;
+
+    present = calloc(nthreads * (SKIPMAP_TEST_KEYS + 1), 1);
+    cstl_skipmap_init(&sm, int_key_cmp, NULL);
+
+    for (i = 0; i < nthreads; i++) {
+        t[i].sm = &sm;
+        t[i].id = i;
+        t[i].nthreads = nthreads;
+        t[i].ops = 20000;
+        t[i].present = &present[i * (SKIPMAP_TEST_KEYS + 1)];
+        t[i].errors = 0;
+
+        ck_assert_int_eq(
+            pthread_create(&th[i], NULL, skipmap_thread, &t[i]), 0);
+    }
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(th[i], NULL);
+        ck_assert_uint_eq(t[i].errors, 0);
+    }
+
+    cstl_skipmap_verify(&sm);
+
+    h = cstl_skipmap_attach(&sm);
+    size = 0;
+    for (k = 1; k <= SKIPMAP_TEST_KEYS; k++) {
+        const unsigned char p =
+            t[(k - 1) % nthreads].present[k];
+
+        ck_assert_int_eq(cstl_skipmap_find(h, (void *)k, NULL), p);
+        size += p;
+    }
+    ck_assert_uint_eq(cstl_skipmap_size(&sm), size);
+    cstl_skipmap_detach(h);
+
+    cstl_skipmap_clear(&sm, NULL, NULL);
+    free(present);
+}
+END_TEST
+
+Suite * skipmap_suite(void)
+{
+    Suite * const s = suite_create("skipmap");
+
+    TCase * tc;
+
+    tc = tcase_create("skipmap");
+    tcase_add_test(tc, basic);
+    tcase_add_test(tc, wrap);
+    tcase_add_test(tc, threads);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
@@ -0,0 +1,336 @@
+/*!
+ * @file
+ */
+
+#include "cstl/spsc.h"
+#include "cstl/allocator.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+ * @private
+ *
+ * the indices count records from the time the buffer was created
+ * and are reduced modulo the capacity only to locate records in
+ * the buffer. the number of records in the buffer is always the
+ * difference between them, even after they wrap around. the producer's
+ * fields and the consumer's are padded out to separate cache lines
+ */
+struct cstl_spsc_ring
+{
+    /* fixed at initialization; only read afterward */
+    union
+    {
+        struct
+        {
+            size_t mask, size;
+        } s;
+        char pad[CSTL_CACHE_LINE];
+    } shr;
+
+    /*
+     * the producer's index (the next record to be written) and
+     * its copy of the consumer's index, as of the last time it
+     * looked at it. the consumer's index can only have increased
+     * since then, so the copy never overstates the free space
+     */
+    union
+    {
+        struct
+        {
+            atomic_size_t tail;
+            size_t head;
+        } s;
+        char pad[CSTL_CACHE_LINE];
+    } prod;
+
+    /* the consumer's index and its copy of the producer's */
+    union
+    {
+        struct
+        {
+            atomic_size_t head;
+            size_t tail;
+        } s;
+        char pad[CSTL_CACHE_LINE];
+    } cons;
+
+    unsigned char buf[];
+};
+
+/*! @private */
+static size_t cstl_spsc_bytes(const size_t cap, const size_t sz)
+{
+    return sizeof(struct cstl_spsc_ring) + cap * sz;
+}
+
+int cstl_spsc_init(cstl_spsc_t * const q, const size_t n, const size_t sz)
+{
+    struct cstl_spsc_ring * r;
+    size_t cap;
+
+    if (n == 0 || sz == 0) {
+        abort();
+    }
+
+    for (cap = 1; cap < n; cap <<= 1)
+        ;
+
+    r = cstl_allocator_alloc(NULL, cstl_spsc_bytes(cap, sz));
+    if (r == NULL) {
+        return -1;
+    }
+
+    r->shr.s.mask = cap - 1;
+    r->shr.s.size = sz;
+
+    atomic_init(&r->prod.s.tail, 0);
+    r->prod.s.head = 0;
+
+    atomic_init(&r->cons.s.head, 0);
+    r->cons.s.tail = 0;
+
+    q->r = r;
+
+    return 0;
+}
+
+size_t cstl_spsc_capacity(const cstl_spsc_t * const q)
+{
+    return q->r->shr.s.mask + 1;
+}
+
+size_t cstl_spsc_size(const cstl_spsc_t * const q)
+{
+    struct cstl_spsc_ring * const r = q->r;
+    const size_t head =
+        atomic_load_explicit(&r->cons.s.head, memory_order_acquire);
+    const size_t tail =
+        atomic_load_explicit(&r->prod.s.tail, memory_order_acquire);
+
+    return tail - head;
+}
+
+size_t cstl_spsc_push(cstl_spsc_t * const q,
+                      const void * const e, size_t n)
+{
+    struct cstl_spsc_ring * const r = q->r;
+    const size_t cap = r->shr.s.mask + 1, sz = r->shr.s.size;
+    const size_t tail =
+        atomic_load_explicit(&r->prod.s.tail, memory_order_relaxed);
+
+    if (cap - (tail - r->prod.s.head) < n) {
+        /*
+         * there may not be room for all of the records. look
+         * at the consumer's index to see how far it has gotten
+         */
+        r->prod.s.head =
+            atomic_load_explicit(&r->cons.s.head, memory_order_acquire);
+        if (cap - (tail - r->prod.s.head) < n) {
+            n = cap - (tail - r->prod.s.head);
+        }
+    }
+
+    if (n > 0) {
+        /* the records may wrap around the end of the buffer */
+        const size_t i = tail & r->shr.s.mask;
+        const size_t m = n < cap - i ? n : cap - i;
+
+        memcpy(&r->buf[i * sz], e, m * sz);
+        memcpy(r->buf, (const unsigned char *)e + m * sz, (n - m) * sz);
+
+        /* publish the records to the consumer */
+        atomic_store_explicit(&r->prod.s.tail, tail + n,
+                              memory_order_release);
+    }
+
+    return n;
+}
+
+size_t cstl_spsc_pop(cstl_spsc_t * const q, void * const e, size_t n)
+{
+    struct cstl_spsc_ring * const r = q->r;
+    const size_t cap = r->shr.s.mask + 1, sz = r->shr.s.size;
+    const size_t head =
+        atomic_load_explicit(&r->cons.s.head, memory_order_relaxed);
+
+    if (r->cons.s.tail - head < n) {
+        r->cons.s.tail =
+            atomic_load_explicit(&r->prod.s.tail, memory_order_acquire);
+        if (r->cons.s.tail - head < n) {
+            n = r->cons.s.tail - head;
+        }
+    }
+
+    if (n > 0) {
+        const size_t i = head & r->shr.s.mask;
+        const size_t m = n < cap - i ? n : cap - i;
+
+        memcpy(e, &r->buf[i * sz], m * sz);
+        memcpy((unsigned char *)e + m * sz, r->buf, (n - m) * sz);
+
+        /* give the space back to the producer */
+        atomic_store_explicit(&r->cons.s.head, head + n,
+                              memory_order_release);
+    }
+
+    return n;
+}
+
+void cstl_spsc_clear(cstl_spsc_t * const q)
+{
+    cstl_allocator_free(NULL, q->r,
+                        cstl_spsc_bytes(q->r->shr.s.mask + 1,
+                                        q->r->shr.s.size));
+    q->r = NULL;
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+START_TEST(simple)
+{
+    cstl_spsc_t q;
+    int e[16], i;
+
+    ck_assert_signal(SIGABRT, cstl_spsc_init(&q, 0, sizeof(int)));
+    ck_assert_signal(SIGABRT, cstl_spsc_init(&q, 5, 0));
+
+    ck_assert_int_eq(cstl_spsc_init(&q, 5, sizeof(int)), 0);
+    ck_assert_uint_eq(cstl_spsc_capacity(&q), 8);
+    ck_assert_uint_eq(cstl_spsc_pop(&q, e, 16), 0);
+
+    for (i = 0; i < 16; i++) {
+        e[i] = i;
+    }
+
+    /* only as many as fit are added */
+    ck_assert_uint_eq(cstl_spsc_push(&q, e, 10), 8);
+    ck_assert_uint_eq(cstl_spsc_size(&q), 8);
+    ck_assert_uint_eq(cstl_spsc_push(&q, &e[8], 2), 0);
+
+    ck_assert_uint_eq(cstl_spsc_pop(&q, e, 3), 3);
+    ck_assert_int_eq(e[0], 0);
+    ck_assert_int_eq(e[2], 2);
+
+    /* these wrap around the end of the buffer */
+    e[0] = 8; e[1] = 9; e[2] = 10;
+    ck_assert_uint_eq(cstl_spsc_push(&q, e, 3), 3);
+    ck_assert_uint_eq(cstl_spsc_size(&q), 8);
+
+    ck_assert_uint_eq(cstl_spsc_pop(&q, e, 16), 8);
+    for (i = 0; i < 8; i++) {
+        ck_assert_int_eq(e[i], i + 3);
+    }
+    ck_assert_uint_eq(cstl_spsc_size(&q), 0);
+    ck_assert_uint_eq(cstl_spsc_pop(&q, e, 1), 0);
+
+    cstl_spsc_clear(&q);
+}
+END_TEST
+
+static void * spsc_fail_alloc(const size_t sz, void * const priv)
+{
+    (void)sz; (void)priv;
+    return NULL;
+}
+
+START_TEST(nomem)
+{
+    const cstl_allocator_t * const def = cstl_allocator_default();
+    cstl_allocator_t a = *def;
+    cstl_spsc_t q;
+
+    a.alloc = spsc_fail_alloc;
+    cstl_allocator_set_default(&a);
+    ck_assert_int_eq(cstl_spsc_init(&q, 5, sizeof(int)), -1);
+    cstl_allocator_set_default(def);
+}
+END_TEST
+
+#define SPSC_THREAD_COUNT       200000
+
+/* the producer passes the numbers in order, in batches of random size */
+static void * spsc_producer(void * const arg)
+{
+    cstl_spsc_t * const q = arg;
+    unsigned int seed = 1;
+    unsigned long e[17];
+    unsigned long i = 0;
+
+    while (i < SPSC_THREAD_COUNT) {
+        size_t n = rand_r(&seed) % 17 + 1, j;
+
+        if (n > SPSC_THREAD_COUNT - i) {
+            n = SPSC_THREAD_COUNT - i;
+        }
+        for (j = 0; j < n; j++) {
+            e[j] = i + j;
+        }
+
+        n = cstl_spsc_push(q, e, n);
+        if (n == 0) {
+            sched_yield();
+        }
+        i += n;
+    }
+
+    return NULL;
+}
+
+START_TEST(threads)
+{
+    cstl_spsc_t q;
+    pthread_t th;
+    unsigned int seed = 2;
+    unsigned long e[13];
+    unsigned long i = 0;
+
+    ck_assert_int_eq(cstl_spsc_init(&q, 64, sizeof(*e)), 0);
+    ck_assert_int_eq(pthread_create(&th, NULL, spsc_producer, &q), 0);
+
+    /* the consumer receives them in order, in batches of random size */
+    while (i < SPSC_THREAD_COUNT) {
+        const size_t n = cstl_spsc_pop(&q, e, rand_r(&seed) % 13 + 1);
+        size_t j;
+
+        if (n == 0) {
+            sched_yield();
+        }
+        for (j = 0; j < n; j++) {
+            ck_assert_uint_eq(e[j], i + j);
+        }
+        i += n;
+    }
+
+    pthread_join(th, NULL);
+    ck_assert_uint_eq(cstl_spsc_size(&q), 0);
+
+    cstl_spsc_clear(&q);
+}
+END_TEST
+
+Suite * spsc_suite(void)
+{
+    Suite * const s = suite_create("spsc");
+
+    TCase * tc;
+
+    tc = tcase_create("spsc");
+    tcase_add_test(tc, simple);
+    tcase_add_test(tc, nomem);
+    tcase_add_test(tc, threads);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
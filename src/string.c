@@ -147,6 +147,25 @@ START_TEST(swap)
 }
 END_TEST
 
+START_TEST(allocator)
+{
+    DECLARE_CSTL_STRING(string, s);
+    struct ck_counting_allocator ca;
+
+    ck_counting_allocator_init(&ca);
+    cstl_string_set_allocator(&s, &ca.a);
+
+    cstl_string_set_str(&s, "hello, world");
+    ck_assert_str_eq(cstl_string_str(&s), "hello, world");
+    ck_assert_uint_gt(ca.bytes, cstl_string_size(&s));
+
+    ck_assert_signal(SIGABRT, cstl_string_set_allocator(&s, NULL));
+
+    cstl_string_clear(&s);
+    ck_assert_uint_eq(ca.bytes, 0);
+}
+END_TEST
+
 Suite * string_suite(void)
 {
     Suite * const s = suite_create("string");
@@ -158,6 +177,7 @@ Suite * string_suite(void)
     tcase_add_test(tc, substr);
     tcase_add_test(tc, find);
     tcase_add_test(tc, swap);
+    tcase_add_test(tc, allocator);
     suite_add_tcase(s, tc);
 
     return s;
@@ -0,0 +1,462 @@
+/*!
+ * @file
+ */
+
+#include "cstl/twheel.h"
+
+/*
+ * the slot number of an object that isn't scheduled. the slots
+ * are numbered level * CSTL_TWHEEL_SLOTS + index within the level
+ */
+#define CSTL_TWHEEL_IDLE        (~0U)
+
+/*
+ * the largest number of ticks in the future that can be held by the
+ * wheel without being clamped into the last slot of the top level
+ */
+#define CSTL_TWHEEL_RANGE                                               \
+    ((1UL << (CSTL_TWHEEL_BITS * CSTL_TWHEEL_LEVELS)) - 1)
+
+/*! @private */
+static inline struct cstl_twheel_node * cstl_twheel_node(
+    const struct cstl_twheel * const w, void * const e)
+{
+    return (void *)((uintptr_t)e + w->off);
+}
+
+void cstl_twheel_init(struct cstl_twheel * const w,
+                      const size_t off, const unsigned long now)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(w->slot) / sizeof(*w->slot); i++) {
+        cstl_dlist_init(&w->slot[i],
+                        off + offsetof(struct cstl_twheel_node, ln));
+    }
+
+    for (i = 0; i < CSTL_TWHEEL_LEVELS; i++) {
+        w->count[i] = 0;
+    }
+
+    w->tick = now + 1;
+    w->size = 0;
+
+    w->off = off;
+}
+
+/*!
+ * @private
+ *
+ * place a node in the slot appropriate to its expiration, relative
+ * to the next tick to be processed.
+ *
+ * the level is determined by the number of ticks until the expiration,
+ * and the slot within the level by the expiration's digit (in base 64)
+ * for that level. the slot is reached when the wheel's tick has the
+ * same digit for that level and zeroes in all of the lower ones. because
+ * the expiration is at least 64^level ticks away, that can't happen
+ * until the tick has all of the expiration's digits from that level up
+ */
+static void cstl_twheel_place(struct cstl_twheel * const w,
+                              void * const e,
+                              struct cstl_twheel_node * const n)
+{
+    unsigned long x = n->expires, d;
+    unsigned int l;
+
+    if (x < w->tick) {
+        x = w->tick;
+    }
+
+    d = x - w->tick;
+    if (d > CSTL_TWHEEL_RANGE) {
+        x = w->tick + CSTL_TWHEEL_RANGE;
+        d = CSTL_TWHEEL_RANGE;
+    }
+
+    for (l = 0; d >= CSTL_TWHEEL_SLOTS; l++) {
+        d >>= CSTL_TWHEEL_BITS;
+    }
+
+    n->slot = l * CSTL_TWHEEL_SLOTS
+        + ((x >> (l * CSTL_TWHEEL_BITS)) & (CSTL_TWHEEL_SLOTS - 1));
+    cstl_dlist_push_back(&w->slot[n->slot], e);
+    w->count[l]++;
+}
+
+/*!
+ * @private
+ *
+ * remove a node from the slot in which it's held
+ */
+static void cstl_twheel_remove(struct cstl_twheel * const w,
+                               void * const e,
+                               struct cstl_twheel_node * const n)
+{
+    cstl_dlist_erase(&w->slot[n->slot], e);
+    w->count[n->slot / CSTL_TWHEEL_SLOTS]--;
+    n->slot = CSTL_TWHEEL_IDLE;
+    w->size--;
+}
+
+void cstl_twheel_schedule(struct cstl_twheel * const w,
+                          void * const e, const unsigned long expires)
+{
+    struct cstl_twheel_node * const n = cstl_twheel_node(w, e);
+
+    n->expires = expires;
+    cstl_twheel_place(w, e, n);
+    w->size++;
+}
+
+bool cstl_twheel_cancel(struct cstl_twheel * const w, void * const e)
+{
+    struct cstl_twheel_node * const n = cstl_twheel_node(w, e);
+
+    if (n->slot == CSTL_TWHEEL_IDLE) {
+        return false;
+    }
+
+    cstl_twheel_remove(w, e, n);
+    return true;
+}
+
+/*!
+ * @private
+ *
+ * redistribute the objects in a slot into the levels below it
+ */
+static void cstl_twheel_cascade(struct cstl_twheel * const w,
+                                const unsigned int s)
+{
+    struct cstl_dlist l;
+    void * e;
+
+    /*
+     * objects clamped into the top level may land back in the
+     * same slot, so the slot is emptied before any are placed
+     */
+    cstl_dlist_init(&l, w->slot[s].off);
+    cstl_dlist_swap(&l, &w->slot[s]);
+    w->count[s / CSTL_TWHEEL_SLOTS] -= cstl_dlist_size(&l);
+
+    while ((e = cstl_dlist_pop_front(&l)) != NULL) {
+        cstl_twheel_place(w, e, cstl_twheel_node(w, e));
+    }
+}
+
+size_t cstl_twheel_advance(struct cstl_twheel * const w,
+                           const unsigned long now,
+                           cstl_twheel_expire_func_t * const f,
+                           void * const priv)
+{
+    size_t count = 0;
+
+    while (w->tick <= now) {
+        const unsigned long t = w->tick;
+        struct cstl_dlist * const s =
+            &w->slot[t & (CSTL_TWHEEL_SLOTS - 1)];
+        unsigned int l;
+        void * e;
+
+        if (w->size == 0) {
+            /* nothing can expire; skip straight to the end */
+            w->tick = now + 1;
+            break;
+        }
+
+        /*
+         * when the lower digits of the tick roll over to zero,
+         * the slot for the new digit in the next level up is
+         * reached, and so on up the levels
+         */
+        for (l = 1;
+             l < CSTL_TWHEEL_LEVELS
+                 && (t & ((1UL << (l * CSTL_TWHEEL_BITS)) - 1)) == 0;
+             l++) {
+            cstl_twheel_cascade(
+                w,
+                l * CSTL_TWHEEL_SLOTS
+                + ((t >> (l * CSTL_TWHEEL_BITS)) & (CSTL_TWHEEL_SLOTS - 1)));
+        }
+
+        /*
+         * if the lowest levels are empty, nothing happens until
+         * the tick reaches the next slot in the lowest level that
+         * isn't. the ticks in between are skipped.
+         */
+        for (l = 0; w->count[l] == 0; l++)
+            ;
+        if (l > 0) {
+            const unsigned long b =
+                (t | ((1UL << (l * CSTL_TWHEEL_BITS)) - 1)) + 1;
+
+            w->tick = b <= now ? b : now + 1;
+            continue;
+        }
+
+        w->tick++;
+
+        /*
+         * every object in the slot expires at this tick. any object
+         * scheduled by the callback lands at the back of a slot, so
+         * the objects are removed from the front until one that
+         * expires later, if any, is found.
+         */
+        while ((e = cstl_dlist_front(s)) != NULL) {
+            struct cstl_twheel_node * const n = cstl_twheel_node(w, e);
+
+            if (n->expires > t) {
+                break;
+            }
+
+            cstl_twheel_remove(w, e, n);
+            count++;
+
+            f(e, priv);
+        }
+    }
+
+    return count;
+}
+
+void cstl_twheel_clear(struct cstl_twheel * const w,
+                       cstl_xtor_func_t * const clr)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(w->slot) / sizeof(*w->slot); i++) {
+        void * e;
+
+        while ((e = cstl_dlist_front(&w->slot[i])) != NULL) {
+            cstl_twheel_remove(w, e, cstl_twheel_node(w, e));
+            clr(e, NULL);
+        }
+    }
+}
+
+#ifdef __cfg_test__
+// GCOV_EXCL_START
+#include "internal/check.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct timer
+{
+    unsigned long when;
+    unsigned long fired;
+    struct cstl_twheel_node tn;
+};
+
+/* record the tick being processed when the timer fires */
+static void timer_expire(void * const e, void * const p)
+{
+    struct timer * const t = e;
+    const struct cstl_twheel * const w = p;
+
+    ck_assert_uint_eq(t->fired, 0);
+    t->fired = w->tick - 1;
+}
+
+static void timer_clr(void * const e, void * const p)
+{
+    struct timer * const t = e;
+
+    (void)p;
+    t->fired = ULONG_MAX;
+}
+
+START_TEST(simple)
+{
+    struct cstl_twheel w;
+    struct timer t[3];
+    unsigned long now;
+    unsigned int i;
+
+    memset(t, 0, sizeof(t));
+
+    now = 1000;
+    cstl_twheel_init(&w, offsetof(struct timer, tn), now);
+    ck_assert_uint_eq(cstl_twheel_size(&w), 0);
+
+    /* nothing to do */
+    ck_assert_uint_eq(cstl_twheel_advance(&w, now, timer_expire, &w), 0);
+    now++;
+    ck_assert_uint_eq(cstl_twheel_advance(&w, now, timer_expire, &w), 0);
+
+    /* an object in the past expires at the next tick */
+    cstl_twheel_schedule(&w, &t[0], 5);
+    cstl_twheel_schedule(&w, &t[1], now + 1);
+    cstl_twheel_schedule(&w, &t[2], now + 100);
+    ck_assert_uint_eq(cstl_twheel_size(&w), 3);
+
+    ck_assert_uint_eq(cstl_twheel_advance(&w, now, timer_expire, &w), 0);
+    now++;
+    ck_assert_uint_eq(cstl_twheel_advance(&w, now, timer_expire, &w), 2);
+    ck_assert_uint_eq(t[0].fired, now);
+    ck_assert_uint_eq(t[1].fired, now);
+    ck_assert_uint_eq(cstl_twheel_size(&w), 1);
+
+    /* cancellation */
+    ck_assert(!cstl_twheel_cancel(&w, &t[0]));
+    ck_assert(cstl_twheel_cancel(&w, &t[2]));
+    ck_assert(!cstl_twheel_cancel(&w, &t[2]));
+    ck_assert_uint_eq(cstl_twheel_size(&w), 0);
+    ck_assert_uint_eq(
+        cstl_twheel_advance(&w, now + 1000, timer_expire, &w), 0);
+    ck_assert_uint_eq(t[2].fired, 0);
+
+    for (i = 0; i < 3; i++) {
+        t[i].fired = 0;
+        cstl_twheel_schedule(&w, &t[i], ULONG_MAX / (i + 1));
+    }
+    cstl_twheel_clear(&w, timer_clr);
+    ck_assert_uint_eq(cstl_twheel_size(&w), 0);
+    for (i = 0; i < 3; i++) {
+        ck_assert_uint_eq(t[i].fired, ULONG_MAX);
+        ck_assert(!cstl_twheel_cancel(&w, &t[i]));
+    }
+}
+END_TEST
+
+/* a timer that schedules itself again, some number of ticks later */
+struct periodic
+{
+    unsigned long period;
+    unsigned int count;
+    struct cstl_twheel_node tn;
+};
+
+static void periodic_expire(void * const e, void * const p)
+{
+    struct periodic * const t = e;
+    struct cstl_twheel * const w = p;
+
+    t->count++;
+    cstl_twheel_schedule(w, t, w->tick - 1 + t->period);
+}
+
+START_TEST(periodic)
+{
+    struct cstl_twheel w;
+    struct periodic t[4];
+    unsigned int i;
+
+    cstl_twheel_init(&w, offsetof(struct periodic, tn), 0);
+    for (i = 0; i < 4; i++) {
+        t[i].count = 0;
+        t[i].period = 1;
+    }
+    t[1].period = 64;
+    t[2].period = 100;
+    t[3].period = 5000;
+
+    /* a period of zero makes the timer fire again at the next tick */
+    cstl_twheel_schedule(&w, &t[0], 0);
+    for (i = 1; i < 4; i++) {
+        cstl_twheel_schedule(&w, &t[i], t[i].period);
+    }
+
+    ck_assert_uint_eq(cstl_twheel_advance(&w, 10000, periodic_expire, &w),
+                      10000 + 10000 / 64 + 10000 / 100 + 10000 / 5000);
+    ck_assert_uint_eq(t[0].count, 10000);
+    ck_assert_uint_eq(t[1].count, 10000 / 64);
+    ck_assert_uint_eq(t[2].count, 10000 / 100);
+    ck_assert_uint_eq(t[3].count, 10000 / 5000);
+    ck_assert_uint_eq(cstl_twheel_size(&w), 4);
+}
+END_TEST
+
+/*
+ * schedule objects at ticks spread over all of the levels, and beyond
+ * them, and then advance the clock by irregular steps, cancelling
+ * some objects along the way. each object must fire exactly at its
+ * tick, or at the first tick after the wheel's start if it was
+ * scheduled in the past
+ */
+START_TEST(random)
+{
+    static const unsigned int n = 4000;
+    const unsigned int bits = sizeof(unsigned long) > 4 ? 40 : 31;
+
+    struct timer * const t = malloc(n * sizeof(*t));
+    struct cstl_twheel w;
+    unsigned long now, start;
+    unsigned int i, cancelled;
+
+    start = now = rand() % 100000;
+    cstl_twheel_init(&w, offsetof(struct timer, tn), now);
+
+    for (i = 0; i < n; i++) {
+        const unsigned int b = rand() % bits;
+
+        t[i].when = now - 100
+            + (((unsigned long)rand() << 16 ^ rand()) & ((1UL << b) - 1));
+        t[i].fired = 0;
+        cstl_twheel_schedule(&w, &t[i], t[i].when);
+    }
+
+    /* most timeouts never fire */
+    cancelled = 0;
+    for (i = 0; i < n; i += 2) {
+        ck_assert(cstl_twheel_cancel(&w, &t[i]));
+        t[i].fired = ULONG_MAX;
+        cancelled++;
+    }
+
+    while (cstl_twheel_size(&w) > 0) {
+        switch (rand() % 4) {
+        case 0:
+            now += 1 + rand() % 100;
+            break;
+        case 1:
+            now += 1UL << (rand() % (bits - 4));
+            break;
+        default:
+            now += 1 + ((unsigned long)rand() << 16 ^ rand())
+                % (1UL << (rand() % bits));
+            break;
+        }
+
+        if (rand() % 2 == 0) {
+            i = rand() % n;
+            if (cstl_twheel_cancel(&w, &t[i])) {
+                ck_assert_uint_eq(t[i].fired, 0);
+                t[i].fired = ULONG_MAX;
+                cancelled++;
+            }
+        }
+
+        cstl_twheel_advance(&w, now, timer_expire, &w);
+    }
+
+    for (i = 0; i < n; i++) {
+        if (t[i].fired != ULONG_MAX) {
+            ck_assert_uint_eq(t[i].fired,
+                              t[i].when > start ? t[i].when : start + 1);
+        }
+    }
+    ck_assert_uint_lt(cancelled, n);
+
+    free(t);
+}
+END_TEST
+
+Suite * twheel_suite(void)
+{
+    Suite * const s = suite_create("twheel");
+
+    TCase * tc;
+
+    tc = tcase_create("twheel");
+    tcase_add_test(tc, simple);
+    tcase_add_test(tc, periodic);
+    tcase_add_test(tc, random);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+// GCOV_EXCL_STOP
+#endif
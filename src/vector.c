@@ -30,6 +30,18 @@ void * cstl_vector_at(struct cstl_vector * const v, const size_t i)
     return (void *)cstl_vector_at_const(v, i);
 }
 
+/*! @private */
+static size_t cstl_vector_bytes(
+    const struct cstl_vector * const v, const size_t cap)
+{
+    /*
+     * the vector always (quietly) stores space for one extra
+     * element at the end to use as scratch space for exchanging
+     * elements during sort and reverse operations
+     */
+    return (cap + 1) * v->elem.size;
+}
+
 /*! @private */
 static void cstl_vector_set_capacity(
     struct cstl_vector * const v, const size_t sz)
@@ -44,18 +56,26 @@ static void cstl_vector_set_capacity(
      */
     assert(sz >= v->count);
 
-    /*
-     * the vector always (quietly) stores space for one extra
-     * element at the end to use as scratch space for exchanging
-     * elements during sort and reverse operations
-     */
-    e = realloc(v->elem.base, (sz + 1) * v->elem.size);
+    e = cstl_allocator_realloc(
+        v->allocator, v->elem.base,
+        v->elem.base != NULL ? cstl_vector_bytes(v, v->cap) : 0,
+        cstl_vector_bytes(v, sz));
     if (e != NULL) {
         v->elem.base = e;
         v->cap = sz;
     }
 }
 
+void cstl_vector_set_allocator(struct cstl_vector * const v,
+                               const cstl_allocator_t * const a)
+{
+    if (v->elem.base != NULL) {
+        abort();
+    }
+
+    v->allocator = a;
+}
+
 void cstl_vector_reserve(struct cstl_vector * const v, const size_t sz)
 {
     if (sz > v->cap) {
@@ -107,7 +127,8 @@ void cstl_vector_resize(struct cstl_vector * const v, const size_t sz)
 void cstl_vector_clear(struct cstl_vector * const v)
 {
     cstl_vector_resize(v, 0);
-    free(v->elem.base);
+    cstl_allocator_free(
+        v->allocator, v->elem.base, cstl_vector_bytes(v, v->cap));
 
     v->elem.base = NULL;
     v->cap = 0;
@@ -125,6 +146,67 @@ void __cstl_vector_sort(struct cstl_vector * const v,
         algo);
 }
 
+void __cstl_vector_nth_element(struct cstl_vector * const v,
+                               const size_t n,
+                               cstl_compare_func_t * const cmp,
+                               void * const priv,
+                               cstl_swap_func_t * const swap)
+{
+    cstl_raw_array_nth_element(
+        v->elem.base, v->count, v->elem.size,
+        n,
+        cmp, priv,
+        swap, __cstl_vector_at(v, v->cap));
+}
+
+void __cstl_vector_partial_sort(struct cstl_vector * const v,
+                                const size_t k,
+                                cstl_compare_func_t * const cmp,
+                                void * const priv,
+                                cstl_swap_func_t * const swap)
+{
+    cstl_raw_array_partial_sort(
+        v->elem.base, v->count, v->elem.size,
+        k,
+        cmp, priv,
+        swap, __cstl_vector_at(v, v->cap));
+}
+
+void __cstl_vector_top_k_push(struct cstl_vector * const v,
+                              const size_t k, void * const e,
+                              cstl_compare_func_t * const cmp,
+                              void * const priv,
+                              cstl_swap_func_t * const swap)
+{
+    const size_t count = v->count;
+
+    if (count < k) {
+        /*
+         * make room for all k elements at once rather
+         * than reallocating each time the vector grows
+         */
+        cstl_vector_reserve(v, k);
+        cstl_vector_resize(v, count + 1);
+    }
+
+    cstl_raw_array_top_k_push(
+        v->elem.base, count, v->elem.size,
+        k, e,
+        cmp, priv,
+        swap, __cstl_vector_at(v, v->cap));
+}
+
+void __cstl_vector_top_k_sort(struct cstl_vector * const v,
+                              cstl_compare_func_t * const cmp,
+                              void * const priv,
+                              cstl_swap_func_t * const swap)
+{
+    cstl_raw_array_top_k_sort(
+        v->elem.base, v->count, v->elem.size,
+        cmp, priv,
+        swap, __cstl_vector_at(v, v->cap));
+}
+
 ssize_t cstl_vector_search(const struct cstl_vector * const v,
                            const void * const e,
                            cstl_compare_func_t * const cmp,
@@ -287,6 +369,78 @@ static void int_dest(void * const i, void * const p)
     *(int *)i = -1;
 }
 
+START_TEST(partial)
+{
+    static size_t n = 83, k = 7;
+
+    DECLARE_CSTL_VECTOR(v, int);
+    DECLARE_CSTL_VECTOR(s, int);
+    unsigned int i;
+
+    cstl_vector_resize(&v, n);
+    cstl_vector_resize(&s, n);
+    for (i = 0; i < n; i++) {
+        *(int *)cstl_vector_at(&v, i) =
+            *(int *)cstl_vector_at(&s, i) = rand() % n;
+    }
+    cstl_vector_sort(&s, int_cmp, NULL);
+
+    cstl_vector_nth_element(&v, k, int_cmp, NULL);
+    ck_assert_int_eq(*(int *)cstl_vector_at(&v, k),
+                     *(int *)cstl_vector_at(&s, k));
+    ck_assert_signal(SIGABRT, cstl_vector_nth_element(&v, n, int_cmp, NULL));
+
+    cstl_vector_reverse(&v);
+    cstl_vector_partial_sort(&v, k, int_cmp, NULL);
+    for (i = 0; i < k; i++) {
+        ck_assert_int_eq(*(int *)cstl_vector_at(&v, i),
+                         *(int *)cstl_vector_at(&s, i));
+    }
+
+    cstl_vector_clear(&v);
+    cstl_vector_clear(&s);
+}
+END_TEST
+
+START_TEST(top_k)
+{
+    static size_t n = 500, k = 17;
+
+    DECLARE_CSTL_VECTOR(s, int);
+    struct cstl_vector v;
+    unsigned int i;
+
+    cstl_vector_init_complex(&v, sizeof(int), int_cons, NULL, NULL);
+
+    cstl_vector_resize(&s, n);
+    for (i = 0; i < n; i++) {
+        int e;
+
+        e = *(int *)cstl_vector_at(&s, i) = rand() % n + 1;
+        cstl_vector_top_k_push(&v, k, &e, int_cmp, NULL);
+        /*
+         * while the vector is growing, the offered element is
+         * exchanged for the newly constructed one
+         */
+        if (i < k) {
+            ck_assert_int_eq(e, 0);
+        }
+    }
+    ck_assert_uint_eq(cstl_vector_size(&v), k);
+    ck_assert_uint_eq(cstl_vector_capacity(&v), k);
+    cstl_vector_top_k_sort(&v, int_cmp, NULL);
+
+    cstl_vector_sort(&s, int_cmp, NULL);
+    for (i = 0; i < k; i++) {
+        ck_assert_int_eq(*(int *)cstl_vector_at(&v, i),
+                         *(int *)cstl_vector_at(&s, i));
+    }
+
+    cstl_vector_clear(&v);
+    cstl_vector_clear(&s);
+}
+END_TEST
+
 START_TEST(complex)
 {
     struct cstl_vector v;
@@ -333,6 +487,35 @@ START_TEST(complex)
 }
 END_TEST
 
+START_TEST(allocator)
+{
+    DECLARE_CSTL_VECTOR(v, int);
+    struct ck_counting_allocator ca;
+
+    ck_counting_allocator_init(&ca);
+    cstl_vector_set_allocator(&v, &ca.a);
+
+    cstl_vector_resize(&v, 10);
+    ck_assert_uint_eq(ca.bytes, (cstl_vector_capacity(&v) + 1) * sizeof(int));
+    cstl_vector_reserve(&v, 100);
+    ck_assert_uint_eq(ca.bytes, 101 * sizeof(int));
+    cstl_vector_shrink_to_fit(&v);
+    ck_assert_uint_eq(ca.bytes, 11 * sizeof(int));
+
+    ck_assert_signal(SIGABRT, cstl_vector_set_allocator(&v, NULL));
+
+    cstl_vector_clear(&v);
+    ck_assert_uint_eq(ca.bytes, 0);
+    ck_assert_uint_eq(ca.calls, 4);
+
+    /* the allocator is retained after the clear */
+    cstl_vector_resize(&v, 1);
+    ck_assert_uint_eq(ca.calls, 5);
+    cstl_vector_clear(&v);
+    ck_assert_uint_eq(ca.bytes, 0);
+}
+END_TEST
+
 Suite * vector_suite(void)
 {
     Suite * const s = suite_create("vector");
@@ -344,7 +527,10 @@ Suite * vector_suite(void)
     tcase_add_test(tc, sort);
     tcase_add_test(tc, search);
     tcase_add_test(tc, reverse);
+    tcase_add_test(tc, partial);
+    tcase_add_test(tc, top_k);
     tcase_add_test(tc, complex);
+    tcase_add_test(tc, allocator);
     suite_add_tcase(s, tc);
 
     return s;